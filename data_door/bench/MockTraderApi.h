@@ -0,0 +1,105 @@
+#ifndef __MOCK_TRADER_API_H__
+#define __MOCK_TRADER_API_H__
+
+#include "../CTP/KSTraderApiEx.h"
+#include "../common/LatencyStats.h"
+#include <string.h>
+
+using namespace KingstarAPI;
+
+// Trader api that goes nowhere, for benchmarks. ReqOrderInsert() keeps the
+// last order and the cycle counter at the moment it was called; every other
+// request succeeds and does nothing.
+class MockTraderApi : public CThostFtdcTraderApi
+{
+public:
+    MockTraderApi() : m_pSpi(0), m_nInserts(0), m_nInsertTime(0) { memset(&m_lastOrder, 0, sizeof(m_lastOrder)); }
+    ~MockTraderApi() {}
+
+    virtual int ReqOrderInsert(CThostFtdcInputOrderField *pInputOrder, int nRequestID)
+    {
+        m_nInsertTime = latency_now();
+        m_lastOrder = *pInputOrder;
+        m_nInserts++;
+        return 0;
+    }
+
+    virtual const char *GetTradingDay() { return "20240102"; }
+    virtual void RegisterSpi(CThostFtdcTraderSpi *pSpi) { m_pSpi = pSpi; }
+
+    virtual void Release() {}
+    virtual void Init() {}
+    virtual int Join() { return 0; }
+    virtual void RegisterFront(char *pszFrontAddress) {}
+    virtual void RegisterNameServer(char *pszNsAddress) {}
+    virtual void RegisterFensUserInfo(CThostFtdcFensUserInfoField *pFensUserInfo) {}
+    virtual void SubscribePrivateTopic(THOST_TE_RESUME_TYPE nResumeType) {}
+    virtual void SubscribePublicTopic(THOST_TE_RESUME_TYPE nResumeType) {}
+    virtual int ReqAuthenticate(CThostFtdcReqAuthenticateField *pReqAuthenticateField, int nRequestID) { return 0; }
+    virtual int ReqUserLogin(CThostFtdcReqUserLoginField *pReqUserLoginField, int nRequestID) { return 0; }
+    virtual int ReqUserLogout(CThostFtdcUserLogoutField *pUserLogout, int nRequestID) { return 0; }
+    virtual int ReqUserPasswordUpdate(CThostFtdcUserPasswordUpdateField *pUserPasswordUpdate, int nRequestID) { return 0; }
+    virtual int ReqTradingAccountPasswordUpdate(CThostFtdcTradingAccountPasswordUpdateField *pTradingAccountPasswordUpdate, int nRequestID) { return 0; }
+    virtual int ReqParkedOrderInsert(CThostFtdcParkedOrderField *pParkedOrder, int nRequestID) { return 0; }
+    virtual int ReqParkedOrderAction(CThostFtdcParkedOrderActionField *pParkedOrderAction, int nRequestID) { return 0; }
+    virtual int ReqOrderAction(CThostFtdcInputOrderActionField *pInputOrderAction, int nRequestID) { return 0; }
+    virtual int ReqQueryMaxOrderVolume(CThostFtdcQueryMaxOrderVolumeField *pQueryMaxOrderVolume, int nRequestID) { return 0; }
+    virtual int ReqSettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, int nRequestID) { return 0; }
+    virtual int ReqRemoveParkedOrder(CThostFtdcRemoveParkedOrderField *pRemoveParkedOrder, int nRequestID) { return 0; }
+    virtual int ReqRemoveParkedOrderAction(CThostFtdcRemoveParkedOrderActionField *pRemoveParkedOrderAction, int nRequestID) { return 0; }
+    virtual int ReqExecOrderInsert(CThostFtdcInputExecOrderField *pInputExecOrder, int nRequestID) { return 0; }
+    virtual int ReqExecOrderAction(CThostFtdcInputExecOrderActionField *pInputExecOrderAction, int nRequestID) { return 0; }
+    virtual int ReqForQuoteInsert(CThostFtdcInputForQuoteField *pInputForQuote, int nRequestID) { return 0; }
+    virtual int ReqQuoteInsert(CThostFtdcInputQuoteField *pInputQuote, int nRequestID) { return 0; }
+    virtual int ReqQuoteAction(CThostFtdcInputQuoteActionField *pInputQuoteAction, int nRequestID) { return 0; }
+    virtual int ReqQryOrder(CThostFtdcQryOrderField *pQryOrder, int nRequestID) { return 0; }
+    virtual int ReqQryTrade(CThostFtdcQryTradeField *pQryTrade, int nRequestID) { return 0; }
+    virtual int ReqQryInvestorPosition(CThostFtdcQryInvestorPositionField *pQryInvestorPosition, int nRequestID) { return 0; }
+    virtual int ReqQryTradingAccount(CThostFtdcQryTradingAccountField *pQryTradingAccount, int nRequestID) { return 0; }
+    virtual int ReqQryInvestor(CThostFtdcQryInvestorField *pQryInvestor, int nRequestID) { return 0; }
+    virtual int ReqQryTradingCode(CThostFtdcQryTradingCodeField *pQryTradingCode, int nRequestID) { return 0; }
+    virtual int ReqQryInstrumentMarginRate(CThostFtdcQryInstrumentMarginRateField *pQryInstrumentMarginRate, int nRequestID) { return 0; }
+    virtual int ReqQryInstrumentCommissionRate(CThostFtdcQryInstrumentCommissionRateField *pQryInstrumentCommissionRate, int nRequestID) { return 0; }
+    virtual int ReqQryExchange(CThostFtdcQryExchangeField *pQryExchange, int nRequestID) { return 0; }
+    virtual int ReqQryProduct(CThostFtdcQryProductField *pQryProduct, int nRequestID) { return 0; }
+    virtual int ReqQryInstrument(CThostFtdcQryInstrumentField *pQryInstrument, int nRequestID) { return 0; }
+    virtual int ReqQryDepthMarketData(CThostFtdcQryDepthMarketDataField *pQryDepthMarketData, int nRequestID) { return 0; }
+    virtual int ReqQrySettlementInfo(CThostFtdcQrySettlementInfoField *pQrySettlementInfo, int nRequestID) { return 0; }
+    virtual int ReqQryTransferBank(CThostFtdcQryTransferBankField *pQryTransferBank, int nRequestID) { return 0; }
+    virtual int ReqQryInvestorPositionDetail(CThostFtdcQryInvestorPositionDetailField *pQryInvestorPositionDetail, int nRequestID) { return 0; }
+    virtual int ReqQryNotice(CThostFtdcQryNoticeField *pQryNotice, int nRequestID) { return 0; }
+    virtual int ReqQrySettlementInfoConfirm(CThostFtdcQrySettlementInfoConfirmField *pQrySettlementInfoConfirm, int nRequestID) { return 0; }
+    virtual int ReqQryInvestorPositionCombineDetail(CThostFtdcQryInvestorPositionCombineDetailField *pQryInvestorPositionCombineDetail, int nRequestID) { return 0; }
+    virtual int ReqQryCFMMCTradingAccountKey(CThostFtdcQryCFMMCTradingAccountKeyField *pQryCFMMCTradingAccountKey, int nRequestID) { return 0; }
+    virtual int ReqQryEWarrantOffset(CThostFtdcQryEWarrantOffsetField *pQryEWarrantOffset, int nRequestID) { return 0; }
+    virtual int ReqQryInvestorProductGroupMargin(CThostFtdcQryInvestorProductGroupMarginField *pQryInvestorProductGroupMargin, int nRequestID) { return 0; }
+    virtual int ReqQryExchangeMarginRate(CThostFtdcQryExchangeMarginRateField *pQryExchangeMarginRate, int nRequestID) { return 0; }
+    virtual int ReqQryExchangeMarginRateAdjust(CThostFtdcQryExchangeMarginRateAdjustField *pQryExchangeMarginRateAdjust, int nRequestID) { return 0; }
+    virtual int ReqQryExchangeRate(CThostFtdcQryExchangeRateField *pQryExchangeRate, int nRequestID) { return 0; }
+    virtual int ReqQrySecAgentACIDMap(CThostFtdcQrySecAgentACIDMapField *pQrySecAgentACIDMap, int nRequestID) { return 0; }
+    virtual int ReqQryOptionInstrTradeCost(CThostFtdcQryOptionInstrTradeCostField *pQryOptionInstrTradeCost, int nRequestID) { return 0; }
+    virtual int ReqQryOptionInstrCommRate(CThostFtdcQryOptionInstrCommRateField *pQryOptionInstrCommRate, int nRequestID) { return 0; }
+    virtual int ReqQryExecOrder(CThostFtdcQryExecOrderField *pQryExecOrder, int nRequestID) { return 0; }
+    virtual int ReqQryForQuote(CThostFtdcQryForQuoteField *pQryForQuote, int nRequestID) { return 0; }
+    virtual int ReqQryQuote(CThostFtdcQryQuoteField *pQryQuote, int nRequestID) { return 0; }
+    virtual int ReqQryTransferSerial(CThostFtdcQryTransferSerialField *pQryTransferSerial, int nRequestID) { return 0; }
+    virtual int ReqQryAccountregister(CThostFtdcQryAccountregisterField *pQryAccountregister, int nRequestID) { return 0; }
+    virtual int ReqQryContractBank(CThostFtdcQryContractBankField *pQryContractBank, int nRequestID) { return 0; }
+    virtual int ReqQryParkedOrder(CThostFtdcQryParkedOrderField *pQryParkedOrder, int nRequestID) { return 0; }
+    virtual int ReqQryParkedOrderAction(CThostFtdcQryParkedOrderActionField *pQryParkedOrderAction, int nRequestID) { return 0; }
+    virtual int ReqQryTradingNotice(CThostFtdcQryTradingNoticeField *pQryTradingNotice, int nRequestID) { return 0; }
+    virtual int ReqQryBrokerTradingParams(CThostFtdcQryBrokerTradingParamsField *pQryBrokerTradingParams, int nRequestID) { return 0; }
+    virtual int ReqQryBrokerTradingAlgos(CThostFtdcQryBrokerTradingAlgosField *pQryBrokerTradingAlgos, int nRequestID) { return 0; }
+    virtual int ReqFromBankToFutureByFuture(CThostFtdcReqTransferField *pReqTransfer, int nRequestID) { return 0; }
+    virtual int ReqFromFutureToBankByFuture(CThostFtdcReqTransferField *pReqTransfer, int nRequestID) { return 0; }
+    virtual int ReqQueryBankAccountMoneyByFuture(CThostFtdcReqQueryAccountField *pReqQueryAccount, int nRequestID) { return 0; }
+    virtual void *LoadExtApi(void *spi, const char *ExtApiName) { return 0; }
+    virtual int ReqBulkCancelOrder(CThostFtdcBulkCancelOrderField *pBulkCancelOrder, int nRequestID) { return 0; }
+
+    CThostFtdcTraderSpi *m_pSpi;
+    int m_nInserts;
+    unsigned long long m_nInsertTime;
+    CThostFtdcInputOrderField m_lastOrder;
+};
+
+#endif
@@ -0,0 +1,103 @@
+// event_bench.cpp : signal-to-wake latency of the event_* primitives.
+//
+// Built twice from this file: event_bench on the futex event of the
+// data_door binaries, event_bench_legacy with -DLEGACY_EVENT on the
+// original pthread mutex/cond event.c.
+//
+#ifdef LEGACY_EVENT
+#include "../testKSMarketDataAPI/event.h"
+#else
+#include "../common/event.h"
+#endif
+#include "../common/LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+
+const int ROUNDS = 20000;
+const int SET_ITERATIONS = 5000000;
+
+static event_handle g_hPing;
+static event_handle g_hPong;
+// latency_now() just before event_set()
+static unsigned long long g_nSetAt;
+static unsigned long long *g_pWake;
+// sleep before each set so the waiter has parked, 0 for back to back
+static int g_nParkUs;
+
+static void *waiter_main(void *)
+{
+    for (int n = 0; n < ROUNDS; n++)
+    {
+        event_wait(g_hPing);
+        unsigned long long nNow = latency_now();
+        g_pWake[n] = nNow - __atomic_load_n(&g_nSetAt, __ATOMIC_ACQUIRE);
+        event_set(g_hPong);
+    }
+    return 0;
+}
+
+static void run(const char *pName, int nParkUs)
+{
+    g_nParkUs = nParkUs;
+    pthread_t hThread;
+    pthread_create(&hThread, NULL, waiter_main, NULL);
+    for (int n = 0; n < ROUNDS; n++)
+    {
+        if (g_nParkUs > 0)
+            usleep(g_nParkUs);
+        __atomic_store_n(&g_nSetAt, latency_now(), __ATOMIC_RELEASE);
+        event_set(g_hPing);
+        event_wait(g_hPong);
+    }
+    pthread_join(hThread, NULL);
+
+    std::sort(g_pWake, g_pWake + ROUNDS);
+    double dCycle = LatencyStats::nsPerCycle();
+    printf("%-24s p50 %6.0f p99 %7.0f p99.9 %7.0f max %8.0f ns\n", pName,
+           g_pWake[ROUNDS / 2] * dCycle, g_pWake[ROUNDS / 100 * 99] * dCycle,
+           g_pWake[ROUNDS / 1000 * 999] * dCycle, g_pWake[ROUNDS - 1] * dCycle);
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef LEGACY_EVENT
+    printf("pthread mutex/cond event\n");
+#else
+    printf("futex event\n");
+#endif
+    g_pWake = new unsigned long long[ROUNDS];
+    g_hPing = event_create(false, false);
+    g_hPong = event_create(false, false);
+
+    // waiter parked in the kernel, then waiter still running when signalled
+    run("wake parked waiter", 50);
+    run("wake back to back", 0);
+
+    // set with nobody waiting, the logout and handler signalling case
+    event_handle hIdle = event_create(true, false);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < SET_ITERATIONS; n++)
+        event_set(hIdle);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("%-24s %.1f ns\n", "set without waiter",
+           ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / SET_ITERATIONS);
+
+    // timed wait that expires, to check the timeout itself
+    event_reset(hIdle);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int nResult = event_timedwait(hIdle, 20);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("%-24s returned %d after %.2f ms\n", "timedwait 20 ms", nResult,
+           ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e6);
+
+    event_destroy(hIdle);
+    event_destroy(g_hPing);
+    event_destroy(g_hPong);
+    delete[] g_pWake;
+    return 0;
+}
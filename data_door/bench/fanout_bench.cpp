@@ -0,0 +1,339 @@
+// fanout_bench.cpp : tick to subscriber latency of the ingest_server fanout.
+//
+// Publishes MARKET lines to a running ingest_server started with -fanout,
+// and reads them back on many subscriber connections:
+//   fanout_bench [-host 127.0.0.1] [-port 9999] [-fanout 9998] [-clients 128]
+//                [-slow 0] [-disconnect] [-messages 100000] [-instruments 64]
+//                [-pattern *] [-pipeline 32] [-rate 0] [-late 0]
+// Every line carries its send time (latency_now(), same host) in the
+// PreClosePrice field, the server forwards MARKET lines as they are; the
+// latency is that to the subscriber's read. -rate paces the ticks per
+// second, 0 sends as fast as the acks come back. -slow adds subscribers
+// that never read, to show that they do not hold back the others; with
+// -disconnect they ask to be closed instead of conflated. -late subscribers
+// join once the ticks are over, one after the other, and report the time
+// from their connect to the end of the snapshot that warms them.
+//
+#include "../common/LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+
+static const char *g_pHost = "127.0.0.1";
+static int g_nPort = 9999;
+static int g_nMessages = 100000;
+static int g_nInstruments = 64;
+static int g_nPipeline = 32;
+static int g_nRate = 0;
+
+struct Subscriber
+{
+    int fd;
+    int nIn;
+    unsigned long long nLines;
+    // inside a late join snapshot, and when its end was read
+    bool bSnapshot;
+    unsigned long long nSnapshotLines;
+    unsigned long long nWarmAt;
+    char chIn[8192];
+};
+
+static int connect_to(int nPort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(nPort);
+    inet_pton(AF_INET, g_pHost, &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+static bool send_line(int fd, const char *pLine)
+{
+    int nLength = strlen(pLine);
+    return send(fd, pLine, nLength, MSG_NOSIGNAL) == nLength;
+}
+
+// skip nLines reply lines
+static bool read_replies(int fd, int nLines)
+{
+    char chBuf[4096];
+    while (nLines > 0)
+    {
+        ssize_t n = recv(fd, chBuf, sizeof(chBuf), 0);
+        if (n <= 0)
+            return false;
+        for (ssize_t i = 0; i < n; i++)
+            nLines -= chBuf[i] == '\n';
+    }
+    return true;
+}
+
+static void *publisher_main(void *pArg)
+{
+    int fd = connect_to(g_nPort);
+    if (fd < 0)
+    {
+        printf("cannot connect to the ingest port %d\n", g_nPort);
+        return NULL;
+    }
+    char chLine[512];
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < g_nMessages; )
+    {
+        if (g_nRate > 0)
+        {
+            // wait for the time of tick n
+            struct timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+            long long nDue = (long long)n * 1000000000LL / g_nRate - ((t.tv_sec - t0.tv_sec) * 1000000000LL + t.tv_nsec - t0.tv_nsec);
+            if (nDue > 0)
+            {
+                struct timespec ts = { (time_t)(nDue / 1000000000LL), (long)(nDue % 1000000000LL) };
+                nanosleep(&ts, NULL);
+            }
+        }
+        int nBatch = std::min(g_nPipeline, g_nMessages - n);
+        for (int i = 0; i < nBatch; i++, n++)
+        {
+            snprintf(chLine, sizeof(chLine), "FCMESSAGE_TYPE_MARKET|SHFE|cu%04d|%llu|70010.0000|70100.0000|69900.0000|%d.0000|%d|"
+                     "1234567890.0000|70000.0000|70010.0000|5|7|73500.0000|66500.0000|70000.0000|0.0000|123456.0000|20141103|"
+                     "1|69990.0000|2|69980.0000|3|69970.0000|4|69960.0000|1|70020.0000|2|70030.0000|3|70040.0000|4|70050.0000|\n",
+                     n % g_nInstruments, latency_now(), 70000 + n % 100, n);
+            if (!send_line(fd, chLine))
+                break;
+        }
+        if (!read_replies(fd, nBatch))
+            break;
+    }
+    close(fd);
+    return NULL;
+}
+
+static bool starts_with(const char *p, const char *pPrefix)
+{
+    return strncmp(p, pPrefix, strlen(pPrefix)) == 0;
+}
+
+// the latency of every complete live line read
+static void consume(Subscriber *pSub, ssize_t n)
+{
+    unsigned long long nNow = latency_now();
+    pSub->nIn += n;
+    char *p = pSub->chIn;
+    char *pEnd = pSub->chIn + pSub->nIn;
+    char *pNewline;
+    while ((pNewline = (char *)memchr(p, '\n', pEnd - p)) != NULL)
+    {
+        if (starts_with(p, "FCMESSAGE_TYPE_SNAPSHOT|"))
+            pSub->bSnapshot = true;
+        else if (starts_with(p, "FCMESSAGE_TYPE_SNAPSHOT_END|"))
+        {
+            pSub->bSnapshot = false;
+            pSub->nWarmAt = nNow;
+        }
+        else if (pSub->bSnapshot)
+            pSub->nSnapshotLines++;
+        if (pSub->bSnapshot || starts_with(p, "FCMESSAGE_TYPE_SNAPSHOT"))
+        {
+            p = pNewline + 1;
+            continue;
+        }
+        // the send time is the fourth field
+        const char *pField = p;
+        for (int f = 0; f < 3 && pField != NULL; f++)
+        {
+            pField = (const char *)memchr(pField, '|', pNewline - pField);
+            if (pField != NULL)
+                pField++;
+        }
+        if (pField != NULL)
+            LatencyStats::record(LAT_FANOUT, nNow - strtoull(pField, NULL, 10));
+        pSub->nLines++;
+        p = pNewline + 1;
+    }
+    pSub->nIn = pEnd - p;
+    memmove(pSub->chIn, p, pSub->nIn);
+}
+
+static void init_subscriber(Subscriber *pSub, int fd)
+{
+    pSub->fd = fd;
+    pSub->nIn = 0;
+    pSub->nLines = 0;
+    pSub->bSnapshot = false;
+    pSub->nSnapshotLines = 0;
+    pSub->nWarmAt = 0;
+}
+
+// subscribers joining after the ticks: connect to the snapshot's end
+static void late_join(int nFanoutPort, const char *pSubscribe, int nLate)
+{
+    double dMin = 1e30, dMax = 0, dTotal = 0;
+    unsigned long long nLines = 0;
+    int nWarm = 0;
+    for (int l = 0; l < nLate; l++)
+    {
+        Subscriber sub;
+        unsigned long long t0 = latency_now();
+        init_subscriber(&sub, connect_to(nFanoutPort));
+        if (sub.fd < 0 || !send_line(sub.fd, pSubscribe))
+            break;
+        struct timeval tv = { 2, 0 };
+        setsockopt(sub.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        ssize_t n;
+        while (sub.nWarmAt == 0 && (n = recv(sub.fd, sub.chIn + sub.nIn, sizeof(sub.chIn) - sub.nIn, 0)) > 0)
+            consume(&sub, n);
+        close(sub.fd);
+        if (sub.nWarmAt == 0)
+            continue;
+        double dUs = (sub.nWarmAt - t0) * LatencyStats::nsPerCycle() / 1000;
+        dMin = std::min(dMin, dUs);
+        dMax = std::max(dMax, dUs);
+        dTotal += dUs;
+        nLines += sub.nSnapshotLines;
+        nWarm++;
+    }
+    printf("%d of %d late subscribers warm, %.0f snapshot lines each, connect to snapshot end %.0f/%.0f/%.0f us min/avg/max\n",
+           nWarm, nLate, nWarm > 0 ? (double)nLines / nWarm : 0, nWarm > 0 ? dMin : 0, nWarm > 0 ? dTotal / nWarm : 0, dMax);
+}
+
+int main(int argc, char* argv[])
+{
+    int nFanoutPort = 9998;
+    int nClients = 128;
+    int nSlow = 0;
+    bool bDisconnect = false;
+    int nLate = 0;
+    const char *pPattern = "*";
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-host") == 0 && a + 1 < argc)
+            g_pHost = argv[++a];
+        else if (strcmp(argv[a], "-port") == 0 && a + 1 < argc)
+            g_nPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-fanout") == 0 && a + 1 < argc)
+            nFanoutPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-clients") == 0 && a + 1 < argc)
+            nClients = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-slow") == 0 && a + 1 < argc)
+            nSlow = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-disconnect") == 0)
+            bDisconnect = true;
+        else if (strcmp(argv[a], "-messages") == 0 && a + 1 < argc)
+            g_nMessages = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-instruments") == 0 && a + 1 < argc)
+            g_nInstruments = std::max(1, atoi(argv[++a]));
+        else if (strcmp(argv[a], "-pattern") == 0 && a + 1 < argc)
+            pPattern = argv[++a];
+        else if (strcmp(argv[a], "-pipeline") == 0 && a + 1 < argc)
+            g_nPipeline = std::max(1, atoi(argv[++a]));
+        else if (strcmp(argv[a], "-rate") == 0 && a + 1 < argc)
+            g_nRate = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-late") == 0 && a + 1 < argc)
+            nLate = atoi(argv[++a]);
+    }
+
+    char chSubscribe[256];
+    snprintf(chSubscribe, sizeof(chSubscribe), "FCSUBSCRIBE|%s\n", pPattern);
+    int nEpoll = epoll_create1(0);
+    Subscriber *pSubs = new Subscriber[nClients];
+    for (int c = 0; c < nClients; c++)
+    {
+        init_subscriber(&pSubs[c], connect_to(nFanoutPort));
+        if (pSubs[c].fd < 0 || !send_line(pSubs[c].fd, chSubscribe))
+        {
+            printf("cannot subscribe on port %d\n", nFanoutPort);
+            return 1;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = c;
+        epoll_ctl(nEpoll, EPOLL_CTL_ADD, pSubs[c].fd, &ev);
+    }
+    int *pSlow = new int[nSlow + 1];
+    for (int s = 0; s < nSlow; s++)
+    {
+        pSlow[s] = connect_to(nFanoutPort);
+        // a small receive buffer, so they fall behind early
+        int nSize = 4096;
+        if (pSlow[s] >= 0)
+            setsockopt(pSlow[s], SOL_SOCKET, SO_RCVBUF, &nSize, sizeof(nSize));
+        if (pSlow[s] < 0 || (bDisconnect && !send_line(pSlow[s], "FCSLOW|disconnect\n")) || !send_line(pSlow[s], chSubscribe))
+        {
+            printf("cannot subscribe on port %d\n", nFanoutPort);
+            return 1;
+        }
+    }
+    // the subscriptions are in before the first tick
+    usleep(200000);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pthread_t publisher;
+    pthread_create(&publisher, NULL, publisher_main, NULL);
+
+    // read until nothing came for a second
+    struct epoll_event events[256];
+    int n;
+    while ((n = epoll_wait(nEpoll, events, 256, 1000)) > 0)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            Subscriber *pSub = &pSubs[events[i].data.u32];
+            ssize_t nRead = recv(pSub->fd, pSub->chIn + pSub->nIn, sizeof(pSub->chIn) - pSub->nIn, 0);
+            if (nRead > 0)
+                consume(pSub, nRead);
+            else if (nRead == 0 || (errno != EAGAIN && errno != EINTR))
+                epoll_ctl(nEpoll, EPOLL_CTL_DEL, pSub->fd, NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+    }
+    pthread_join(publisher, NULL);
+
+    unsigned long long nTotal = 0;
+    unsigned long long nMin = ~0ULL;
+    for (int c = 0; c < nClients; c++)
+    {
+        nTotal += pSubs[c].nLines;
+        nMin = std::min(nMin, pSubs[c].nLines);
+        close(pSubs[c].fd);
+    }
+    for (int s = 0; s < nSlow; s++)
+        close(pSlow[s]);
+    double dSeconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%d subscribers to %s, %d not reading (%s), %d ticks over %d instruments, %d/s\n", nClients, pPattern,
+           nSlow, bDisconnect ? "disconnect" : "conflate", g_nMessages, g_nInstruments, g_nRate);
+    printf("%llu lines delivered, fewest per subscriber %llu, %.0f lines/s\n", nTotal, nClients > 0 ? nMin : 0,
+           nTotal / dSeconds);
+    if (nLate > 0)
+        late_join(nFanoutPort, chSubscribe, nLate);
+    char chStats[4096];
+    LatencyStats::dump(chStats, sizeof(chStats));
+    printf("%s", chStats);
+
+    delete[] pSubs;
+    delete[] pSlow;
+    return 0;
+}
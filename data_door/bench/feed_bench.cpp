@@ -0,0 +1,118 @@
+// feed_bench.cpp : cost of FeedMonitor::onTick() per tick and of a scan of
+// every instrument, and the stale alerts it raises.
+//
+//   feed_bench [-instruments 1000] [-ticks 10000000] [-scans 1000]
+// Half the instruments are cu, half IF with a 1000 ms threshold of their
+// own. Every instrument ticks 3 ms behind the local clock, then the first
+// cu has been silent 40s and the first IF 2s while the others tick on:
+// both must be reported stale, nothing else. Prints the time per tick and
+// per scan, the alerts (on stdout) and the monitor's summary.
+//
+#include "../common/FeedMonitor.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+// milliseconds since local midnight, as NormalizedTick::nTimeMs
+static int local_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm now;
+    localtime_r(&ts.tv_sec, &now);
+    return (now.tm_hour * 3600 + now.tm_min * 60 + now.tm_sec) * 1000 + (int)(ts.tv_nsec / 1000000);
+}
+
+int main(int argc, char* argv[])
+{
+    int nInstruments = 1000;
+    int nTicks = 10000000;
+    int nScans = 1000;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-instruments") == 0 && a + 1 < argc)
+            nInstruments = std::min(std::max(2, atoi(argv[++a])), MAX_INSTRUMENTS);
+        else if (strcmp(argv[a], "-ticks") == 0 && a + 1 < argc)
+            nTicks = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-scans") == 0 && a + 1 < argc)
+            nScans = std::max(1, atoi(argv[++a]));
+    }
+    // the alerts go to stdout
+    AsyncLogger::start(NULL, LOG_LEVEL_WARN);
+
+    InstrumentIndex index;
+    for (int i = 0; i < nInstruments; i++)
+    {
+        char chID[31];
+        snprintf(chID, sizeof(chID), i % 2 == 0 ? "cu%04d" : "IF%04d", 1501 + i / 2);
+        index.insert(chID);
+    }
+    FeedMonitor monitor(&index);
+    monitor.setThresholds(30000, 5000, 0);
+    if (!monitor.setProducts("IF:1000"))
+    {
+        printf("bad product list\n");
+        return 1;
+    }
+    double dCyclesPerMs = 1e6 / LatencyStats::nsPerCycle();
+
+    // the publisher's side: the receive stamp is already taken
+    unsigned long long nRecv = latency_now();
+    int nTimeMs = local_ms() - 3;
+    unsigned long long t = latency_now();
+    for (int n = 0; n < nTicks; n++)
+        monitor.onTick(n % nInstruments, nTimeMs, nRecv);
+    double dTickNs = (latency_now() - t) * LatencyStats::nsPerCycle() / std::max(1, nTicks);
+
+    // the silent ones, then one scan taking every instrument in
+    nRecv = latency_now();
+    nTimeMs = local_ms() - 3;
+    monitor.onTick(0, nTimeMs - 40000, nRecv - (unsigned long long)(40000 * dCyclesPerMs));
+    monitor.onTick(1, nTimeMs - 2000, nRecv - (unsigned long long)(2000 * dCyclesPerMs));
+    monitor.scan();
+
+    unsigned long long nScanCycles = 0;
+    for (int s = 0; s < nScans; s++)
+    {
+        nRecv = latency_now();
+        nTimeMs = local_ms() - 3;
+        for (int i = 2; i < nInstruments; i++)
+            monitor.onTick(i, nTimeMs, nRecv);
+        t = latency_now();
+        monitor.scan();
+        nScanCycles += latency_now() - t;
+    }
+
+    const int nReportSize = LAT_REPORT_SIZE;
+    char *pReport = new char[nReportSize];
+    t = latency_now();
+    int nDetail = monitor.format(pReport, nReportSize, true);
+    double dFormatUs = (latency_now() - t) * LatencyStats::nsPerCycle() / 1000;
+    AsyncLogger::stop();
+
+    printf("%d instruments, %d ticks, %d scans\n", nInstruments, nTicks, nScans);
+    printf("onTick %.2f ns mean, scan %.1f us mean, detailed report %.1f us for %d bytes\n", dTickNs,
+           nScanCycles * LatencyStats::nsPerCycle() / 1000 / nScans, dFormatUs, nDetail);
+    printf("%llu alerts, %d stale (expected 2 and 2)\n", monitor.alerts(), monitor.stale());
+    monitor.format(pReport, nReportSize, false);
+    printf("%s", pReport);
+    // the heading and the two silent instruments
+    monitor.format(pReport, nReportSize, true);
+    char *pLine = strchr(pReport, '\n');
+    pLine = pLine != NULL ? strchr(pLine + 1, '\n') : NULL;
+    for (int i = 0; i < 3 && pLine != NULL; i++)
+    {
+        char *pNext = strchr(pLine + 1, '\n');
+        if (pNext == NULL)
+            break;
+        printf("%.*s", (int)(pNext - pLine), pLine + 1);
+        pLine = pNext;
+    }
+
+    delete[] pReport;
+    return monitor.alerts() == 2 && monitor.stale() == 2 ? 0 : 1;
+}
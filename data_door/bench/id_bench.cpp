@@ -0,0 +1,84 @@
+// id_bench.cpp : cost of the message ids, per thread and with threads in parallel.
+//
+// MessageIdGenerator::next() is what a publisher pays per message when it
+// stamps its own ids; the text form and the server's random v4 uuid are
+// timed for comparison.
+//
+#include "../common/MessageId.h"
+#include "../common/UuidGenerator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+const int ID_ITERATIONS = 100000000;
+const int TEXT_ITERATIONS = 10000000;
+
+static double seconds_since(const struct timespec &t0)
+{
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void *id_main(void *pArg)
+{
+    // folded into the result so the loop is not optimized away
+    unsigned long long nSum = 0;
+    for (int n = 0; n < ID_ITERATIONS; n++)
+        nSum += MessageIdGenerator::next().lo;
+    *(unsigned long long *)pArg = nSum;
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int nThreads = argc > 1 ? atoi(argv[1]) : 4;
+    MessageIdGenerator::setNode(1);
+
+    unsigned long long nSum;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    id_main(&nSum);
+    double d = seconds_since(t0);
+    printf("%-28s %8.2f ns  %7.1f M/s\n", "MessageId next", d * 1e9 / ID_ITERATIONS, ID_ITERATIONS / d / 1e6);
+
+    char chText[UUID_TEXT_LENGTH + 1];
+    chText[UUID_TEXT_LENGTH] = '\0';
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < TEXT_ITERATIONS; n++)
+        MessageIdGenerator::next().format(chText);
+    d = seconds_since(t0);
+    printf("%-28s %8.2f ns  %7.1f M/s  %s\n", "MessageId next + format", d * 1e9 / TEXT_ITERATIONS, TEXT_ITERATIONS / d / 1e6, chText);
+
+    MessageId id;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int nParsed = 0;
+    for (int n = 0; n < TEXT_ITERATIONS; n++)
+        nParsed += id.parse(chText);
+    d = seconds_since(t0);
+    printf("%-28s %8.2f ns  %7.1f M/s\n", "MessageId parse", d * 1e9 / TEXT_ITERATIONS, nParsed / d / 1e6);
+
+    UuidGenerator uuid;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < TEXT_ITERATIONS; n++)
+        uuid.next(chText);
+    d = seconds_since(t0);
+    printf("%-28s %8.2f ns  %7.1f M/s  %s\n", "random v4 uuid", d * 1e9 / TEXT_ITERATIONS, TEXT_ITERATIONS / d / 1e6, chText);
+
+    // no shared state between the threads: the rate scales with the cores
+    pthread_t *pThreads = new pthread_t[nThreads];
+    unsigned long long *pSums = new unsigned long long[nThreads];
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < nThreads; i++)
+        pthread_create(&pThreads[i], NULL, id_main, &pSums[i]);
+    for (int i = 0; i < nThreads; i++)
+        pthread_join(pThreads[i], NULL);
+    d = seconds_since(t0);
+    printf("MessageId next, %d threads    %7.1f M/s total\n", nThreads, (double)ID_ITERATIONS * nThreads / d / 1e6);
+
+    delete[] pThreads;
+    delete[] pSums;
+    return nSum == 0;
+}
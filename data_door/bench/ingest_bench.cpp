@@ -0,0 +1,213 @@
+// ingest_bench.cpp : round trip latency and throughput of a port 9999 listener.
+//
+// Drives a running ingest_server, or the Java FCRequestListener for the
+// comparison, with MARKET lines from several client threads:
+//   ingest_bench [-host 127.0.0.1] [-port 9999] [-clients 4] [-messages 20000]
+//                [-connect] [-pipeline n]
+// -connect opens a connection per line as the servants' publish() does;
+// otherwise every client keeps one connection and keeps up to -pipeline
+// lines in flight (1, ping pong, by default). A round trip is the line's
+// send() to its reply line read.
+//
+#include "../common/LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+
+static const char *g_pHost = "127.0.0.1";
+static int g_nPort = 9999;
+static int g_nMessages = 20000;
+static bool g_bConnect = false;
+static int g_nPipeline = 1;
+
+struct BenchClient
+{
+    int nIndex;
+    unsigned long long *pRoundTrip;
+    int nDone;
+    int nBadReplies;
+};
+
+static int connect_to()
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(g_nPort);
+    inet_pton(AF_INET, g_pHost, &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+// a MARKET line as servant_market publishes it, instrument varied per client
+static int market_line(char *pBuf, int nSize, int nClient, int n)
+{
+    return snprintf(pBuf, nSize, "FCMESSAGE_TYPE_MARKET|SHFE|cu15%02d|70000.0000|70010.0000|70100.0000|69900.0000|%d.0000|%d|"
+                    "1234567890.0000|70000.0000|70010.0000|5|7|73500.0000|66500.0000|70000.0000|0.0000|123456.0000|20141103|"
+                    "1|69990.0000|2|69980.0000|3|69970.0000|4|69960.0000|1|70020.0000|2|70030.0000|3|70040.0000|4|70050.0000|\n",
+                    nClient % 12 + 1, 70000 + n % 100, n);
+}
+
+// read until nLines reply lines are complete, false on EOF or error
+static bool read_replies(int fd, int nLines, BenchClient *pClient)
+{
+    char chBuf[4096];
+    static __thread int s_nLineLength = 0;
+    while (nLines > 0)
+    {
+        ssize_t n = recv(fd, chBuf, sizeof(chBuf), 0);
+        if (n <= 0)
+            return false;
+        for (ssize_t i = 0; i < n; i++)
+        {
+            if (chBuf[i] != '\n')
+            {
+                s_nLineLength++;
+                continue;
+            }
+            // a uuid is 36 characters
+            if (s_nLineLength != 36)
+                pClient->nBadReplies++;
+            s_nLineLength = 0;
+            nLines--;
+        }
+    }
+    return true;
+}
+
+static void *client_main(void *pArg)
+{
+    BenchClient *pClient = (BenchClient *)pArg;
+    char chLine[512];
+    int fd = g_bConnect ? -1 : connect_to();
+    if (!g_bConnect && fd < 0)
+        return NULL;
+
+    unsigned long long *pSentAt = new unsigned long long[g_nPipeline];
+    int n = 0;
+    while (n < g_nMessages)
+    {
+        if (g_bConnect)
+        {
+            unsigned long long t = latency_now();
+            fd = connect_to();
+            if (fd < 0)
+                break;
+            int nLength = market_line(chLine, sizeof(chLine), pClient->nIndex, n);
+            bool bOk = send(fd, chLine, nLength, MSG_NOSIGNAL) == nLength && read_replies(fd, 1, pClient);
+            close(fd);
+            if (!bOk)
+                break;
+            pClient->pRoundTrip[n++] = latency_now() - t;
+            continue;
+        }
+
+        int nBatch = std::min(g_nPipeline, g_nMessages - n);
+        for (int i = 0; i < nBatch; i++)
+        {
+            int nLength = market_line(chLine, sizeof(chLine), pClient->nIndex, n + i);
+            pSentAt[i] = latency_now();
+            if (send(fd, chLine, nLength, MSG_NOSIGNAL) != nLength)
+                break;
+        }
+        if (!read_replies(fd, nBatch, pClient))
+            break;
+        unsigned long long nNow = latency_now();
+        for (int i = 0; i < nBatch; i++)
+            pClient->pRoundTrip[n++] = nNow - pSentAt[i];
+    }
+    if (!g_bConnect)
+        close(fd);
+    delete[] pSentAt;
+    pClient->nDone = n;
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int nClients = 4;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-host") == 0 && a + 1 < argc)
+            g_pHost = argv[++a];
+        else if (strcmp(argv[a], "-port") == 0 && a + 1 < argc)
+            g_nPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-clients") == 0 && a + 1 < argc)
+            nClients = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-messages") == 0 && a + 1 < argc)
+            g_nMessages = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-connect") == 0)
+            g_bConnect = true;
+        else if (strcmp(argv[a], "-pipeline") == 0 && a + 1 < argc)
+            g_nPipeline = std::max(1, atoi(argv[++a]));
+    }
+
+    BenchClient *pClients = new BenchClient[nClients];
+    pthread_t *pThreads = new pthread_t[nClients];
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int c = 0; c < nClients; c++)
+    {
+        pClients[c].nIndex = c;
+        pClients[c].pRoundTrip = new unsigned long long[g_nMessages];
+        pClients[c].nDone = 0;
+        pClients[c].nBadReplies = 0;
+        pthread_create(&pThreads[c], NULL, client_main, &pClients[c]);
+    }
+    for (int c = 0; c < nClients; c++)
+        pthread_join(pThreads[c], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    int nTotal = 0;
+    int nBad = 0;
+    for (int c = 0; c < nClients; c++)
+    {
+        nTotal += pClients[c].nDone;
+        nBad += pClients[c].nBadReplies;
+    }
+    if (nTotal == 0)
+    {
+        printf("no replies from %s:%d\n", g_pHost, g_nPort);
+        return 1;
+    }
+    unsigned long long *pAll = new unsigned long long[nTotal];
+    int nAll = 0;
+    for (int c = 0; c < nClients; c++)
+    {
+        memcpy(pAll + nAll, pClients[c].pRoundTrip, sizeof(unsigned long long) * pClients[c].nDone);
+        nAll += pClients[c].nDone;
+    }
+    std::sort(pAll, pAll + nAll);
+    double dUs = LatencyStats::nsPerCycle() / 1000.0;
+    double dSeconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%d clients, %s, %d of %d lines answered, %d bad replies\n", nClients,
+           g_bConnect ? "connection per line" : (g_nPipeline > 1 ? "persistent, pipelined" : "persistent"),
+           nTotal, nClients * g_nMessages, nBad);
+    printf("round trip p50 %.1f p99 %.1f p99.9 %.1f max %.1f us, %.0f lines/s\n",
+           pAll[nAll / 2] * dUs, pAll[(int)(nAll * 0.99)] * dUs, pAll[(int)(nAll * 0.999)] * dUs,
+           pAll[nAll - 1] * dUs, nTotal / dSeconds);
+
+    for (int c = 0; c < nClients; c++)
+        delete[] pClients[c].pRoundTrip;
+    delete[] pClients;
+    delete[] pThreads;
+    delete[] pAll;
+    return 0;
+}
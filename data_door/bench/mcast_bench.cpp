@@ -0,0 +1,237 @@
+// mcast_bench.cpp : delivery latency and recovery of the McastFeed multicast.
+//
+// One publisher thread multicasts DepthDeltaCodec frames as servant_market
+// does, several receiver threads in the same process decode them:
+//   mcast_bench [-group 239.10.10.1] [-port 31001] [-interface 127.0.0.1]
+//               [-receivers 4] [-messages 100000] [-instruments 64]
+//               [-rate 20000] [-batch 8] [-loss 0]
+// -rate paces the ticks per second, -batch ticks share a datagram as a
+// publisher batch would. -loss drops that share of the datagrams on
+// arrival at every receiver, so the gaps go through the TCP recovery. The
+// latency is the packet's send() to its messages handed to the receiver,
+// retransmissions included. Loopback multicast needs a route for the
+// group, the -interface address is used for both the sending and the join.
+//
+#include "../common/McastFeed.h"
+#include "../common/DepthDeltaCodec.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+
+static const char *g_pGroup = "239.10.10.1";
+static int g_nPort = 31001;
+static const char *g_pInterface = "127.0.0.1";
+static int g_nMessages = 100000;
+static int g_nInstruments = 64;
+static int g_nRate = 20000;
+static int g_nBatch = 8;
+static double g_dLoss = 0;
+static volatile bool g_bStop = false;
+
+class BenchReceiver : public McastHandler
+{
+public:
+    BenchReceiver() : nMessages(0), nDecoded(0), nWaiting(0), nOutOfOrder(0), nLastVolume(-1), nLossEvents(0) {}
+
+    virtual void onMessage(const char *pMessage, int nLength, const McastHeader &header)
+    {
+        CThostFtdcDepthMarketDataField tick;
+        int nConsumed;
+        nMessages++;
+        int nResult = decoder.decode(pMessage, nLength, &tick, &nConsumed);
+        if (nResult == 1)
+            nWaiting++;
+        if (nResult != 0)
+            return;
+        nDecoded++;
+        // Volume numbers the ticks across instruments
+        if (tick.Volume <= nLastVolume)
+            nOutOfOrder++;
+        nLastVolume = tick.Volume;
+    }
+
+    virtual void onLoss(int nStream, unsigned long long nSeq, unsigned long long nCount)
+    {
+        nLossEvents++;
+    }
+
+    McastReceiver receiver;
+    DepthDeltaDecoder decoder;
+    unsigned long long nMessages;
+    unsigned long long nDecoded;
+    unsigned long long nWaiting;
+    unsigned long long nOutOfOrder;
+    int nLastVolume;
+    unsigned long long nLossEvents;
+    pthread_t thread;
+};
+
+static void *receiver_main(void *pArg)
+{
+    BenchReceiver *pThis = (BenchReceiver *)pArg;
+    struct pollfd pfd;
+    pfd.fd = pThis->receiver.fd();
+    pfd.events = POLLIN;
+    while (!g_bStop && pThis->nMessages < (unsigned long long)g_nMessages)
+    {
+        // the timeout drives the retries of an open gap
+        ::poll(&pfd, 1, 10);
+        pThis->receiver.poll(pThis);
+    }
+    return NULL;
+}
+
+static void *publisher_main(void *pArg)
+{
+    McastPublisher *pPublisher = (McastPublisher *)pArg;
+    DepthDeltaEncoder encoder(100);
+    CThostFtdcDepthMarketDataField tick;
+    memset(&tick, 0, sizeof(tick));
+    strcpy(tick.ExchangeID, "SHFE");
+    strcpy(tick.TradingDay, "20141103");
+    char frame[DEPTH_DELTA_MAX_FRAME];
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < g_nMessages; )
+    {
+        if (g_nRate > 0)
+        {
+            // wait for the time of tick n, serving recovery meanwhile
+            struct timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+            long long nDue = (long long)n * 1000000000LL / g_nRate - ((t.tv_sec - t0.tv_sec) * 1000000000LL + t.tv_nsec - t0.tv_nsec);
+            if (nDue > 0)
+            {
+                pPublisher->poll();
+                struct timespec ts = { (time_t)(nDue / 1000000000LL), (long)(nDue % 1000000000LL) };
+                nanosleep(&ts, NULL);
+            }
+        }
+        int nBatch = std::min(g_nBatch, g_nMessages - n);
+        for (int i = 0; i < nBatch; i++, n++)
+        {
+            snprintf(tick.InstrumentID, sizeof(tick.InstrumentID), "cu%04d", n % g_nInstruments);
+            tick.LastPrice = 70000 + n % 100 * 10;
+            tick.BidPrice1 = tick.LastPrice - 10;
+            tick.AskPrice1 = tick.LastPrice + 10;
+            tick.BidVolume1 = 1 + n % 7;
+            tick.AskVolume1 = 1 + n % 5;
+            tick.Volume = n;
+            int nFrame = encoder.encode(&tick, frame, sizeof(frame));
+            if (nFrame > 0)
+                pPublisher->add(frame, nFrame);
+        }
+        pPublisher->flush();
+        pPublisher->poll();
+    }
+    // keep answering the receivers' last requests
+    while (!g_bStop)
+    {
+        pPublisher->poll();
+        usleep(1000);
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int nReceivers = 4;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-group") == 0 && a + 1 < argc)
+            g_pGroup = argv[++a];
+        else if (strcmp(argv[a], "-port") == 0 && a + 1 < argc)
+            g_nPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-interface") == 0 && a + 1 < argc)
+            g_pInterface = argv[++a];
+        else if (strcmp(argv[a], "-receivers") == 0 && a + 1 < argc)
+            nReceivers = std::max(1, atoi(argv[++a]));
+        else if (strcmp(argv[a], "-messages") == 0 && a + 1 < argc)
+            g_nMessages = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-instruments") == 0 && a + 1 < argc)
+            g_nInstruments = std::max(1, atoi(argv[++a]));
+        else if (strcmp(argv[a], "-rate") == 0 && a + 1 < argc)
+            g_nRate = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-batch") == 0 && a + 1 < argc)
+            g_nBatch = std::max(1, atoi(argv[++a]));
+        else if (strcmp(argv[a], "-loss") == 0 && a + 1 < argc)
+            g_dLoss = atof(argv[++a]);
+    }
+    // gaps given up are logged as warnings
+    AsyncLogger::start(NULL, LOG_LEVEL_WARN);
+
+    McastPublisher publisher;
+    if (!publisher.open(g_pGroup, g_nPort, g_pInterface, 1, 0, MCAST_HISTORY))
+    {
+        printf("cannot open multicast %s:%d on %s\n", g_pGroup, g_nPort, g_pInterface);
+        return 1;
+    }
+    BenchReceiver *pReceivers = new BenchReceiver[nReceivers];
+    for (int r = 0; r < nReceivers; r++)
+    {
+        if (!pReceivers[r].receiver.open(g_pGroup, g_nPort, g_pInterface))
+        {
+            printf("cannot join %s:%d on %s\n", g_pGroup, g_nPort, g_pInterface);
+            return 1;
+        }
+        pReceivers[r].receiver.setLossRate(g_dLoss);
+        pthread_create(&pReceivers[r].thread, NULL, receiver_main, &pReceivers[r]);
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pthread_t publisherThread;
+    pthread_create(&publisherThread, NULL, publisher_main, &publisher);
+
+    // until every receiver has everything, or nothing moved for three
+    // seconds, longer than a gap is kept open
+    unsigned long long nLast = 0;
+    int nQuiet = 0;
+    for (;;)
+    {
+        usleep(100000);
+        unsigned long long nTotal = 0;
+        bool bDone = true;
+        for (int r = 0; r < nReceivers; r++)
+        {
+            nTotal += pReceivers[r].nMessages;
+            bDone = bDone && pReceivers[r].nMessages >= (unsigned long long)g_nMessages;
+        }
+        nQuiet = nTotal == nLast ? nQuiet + 1 : 0;
+        nLast = nTotal;
+        if (bDone || nQuiet >= 30)
+            break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    g_bStop = true;
+    for (int r = 0; r < nReceivers; r++)
+        pthread_join(pReceivers[r].thread, NULL);
+    pthread_join(publisherThread, NULL);
+
+    double dSeconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%d receivers of %s:%d, %d ticks over %d instruments, %d/s, %d per packet, %.1f%% loss\n", nReceivers, g_pGroup,
+           g_nPort, g_nMessages, g_nInstruments, g_nRate, g_nBatch, g_dLoss * 100);
+    printf("publisher: packets=%llu requests=%llu retransmitted=%llu gone=%llu, %.2f s\n", publisher.packets(),
+           publisher.requests(), publisher.retransmitted(), publisher.gone(), dSeconds);
+    for (int r = 0; r < nReceivers; r++)
+    {
+        BenchReceiver &rcv = pReceivers[r];
+        printf("receiver %d: messages=%llu decoded=%llu waiting=%llu out_of_order=%llu packets=%llu recovered=%llu "
+               "lost=%llu duplicates=%llu requests=%llu\n", r, rcv.nMessages, rcv.nDecoded, rcv.nWaiting, rcv.nOutOfOrder,
+               rcv.receiver.packets(), rcv.receiver.recovered(), rcv.receiver.lost(), rcv.receiver.duplicates(),
+               rcv.receiver.requests());
+    }
+    char chStats[4096];
+    LatencyStats::dump(chStats, sizeof(chStats));
+    printf("%s", chStats);
+
+    delete[] pReceivers;
+    AsyncLogger::stop();
+    return 0;
+}
@@ -0,0 +1,196 @@
+// option_bench.cpp : cost of OptionSurface::refresh() per chain, AVX2
+// against scalar, and the accuracy of the volatilities it solves.
+//
+//   option_bench [-chains 8] [-strikes 60] [-rounds 2000]
+// Chains of calls and puts on futures around 3000, strikes from 70% to
+// 130% of the forward, priced by Black-76 (libm's erfc) off a volatility
+// smile. Every round moves each forward, reprices every option and
+// refreshes two surfaces, one forced to the scalar pass. Prints the time
+// per chain of each, the time to format the surface lines, how far the
+// two passes and the smile are from the solved volatilities, and a line.
+//
+#include "../common/OptionSurface.h"
+#include "../common/LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+static unsigned int s_nSeed = 12345;
+
+static int next_random()
+{
+    s_nSeed = s_nSeed * 1103515245 + 12345;
+    return (s_nSeed >> 8) & 0xffff;
+}
+
+static double smile(double dForward, double dStrike)
+{
+    double x = log(dStrike / dForward);
+    return 0.2 - 0.1 * x + 0.8 * x * x;
+}
+
+// the reference price, discounted at dRate
+static double black(double F, double K, double T, double vol, double dRate, bool bCall)
+{
+    double sv = vol * sqrt(T);
+    double d1 = log(F / K) / sv + 0.5 * sv;
+    double d2 = d1 - sv;
+    double s = bCall ? 1 : -1;
+    return exp(-dRate * T) * s * (F * 0.5 * erfc(-s * d1 * M_SQRT1_2) - K * 0.5 * erfc(-s * d2 * M_SQRT1_2));
+}
+
+int main(int argc, char* argv[])
+{
+    int nChains = 8;
+    int nStrikes = 60;
+    int nRounds = 2000;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-chains") == 0 && a + 1 < argc)
+            nChains = std::min(std::max(1, atoi(argv[++a])), MAX_OPTION_CHAINS);
+        else if (strcmp(argv[a], "-strikes") == 0 && a + 1 < argc)
+            nStrikes = std::min(std::max(1, atoi(argv[++a])), OPTION_CHAIN_SIZE / 2);
+        else if (strcmp(argv[a], "-rounds") == 0 && a + 1 < argc)
+            nRounds = atoi(argv[++a]);
+    }
+    // options and underlyings share the instrument slots
+    nChains = std::min(nChains, MAX_INSTRUMENTS / (2 * nStrikes + 1));
+    const double dRate = 0.03;
+
+    OptionSurface vector;
+    OptionSurface scalar;
+    scalar.useAvx2(false);
+    vector.setRate(dRate);
+    scalar.setRate(dRate);
+    for (int c = 0; c < nChains; c++)
+    {
+        char chUnderlying[31];
+        snprintf(chUnderlying, sizeof(chUnderlying), "m%04d", 1501 + c);
+        for (int k = 0; k < nStrikes; k++)
+        {
+            double dStrike = 2100 + 1800.0 * k / std::max(1, nStrikes - 1);
+            for (int t = 0; t < 2; t++)
+            {
+                char chID[31];
+                snprintf(chID, sizeof(chID), "%s-%c-%.0f", chUnderlying, t == 0 ? 'C' : 'P', dStrike);
+                char cType = t == 0 ? THOST_FTDC_CP_CallOptions : THOST_FTDC_CP_PutOptions;
+                if (!vector.addOption(chID, chUnderlying, "m_o", cType, dStrike, "20141219") ||
+                    !scalar.addOption(chID, chUnderlying, "m_o", cType, dStrike, "20141219"))
+                {
+                    printf("cannot add %s\n", chID);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    CThostFtdcDepthMarketDataField tick;
+    memset(&tick, 0, sizeof(tick));
+    strcpy(tick.ExchangeID, "DCE");
+    strcpy(tick.TradingDay, "20141103");
+    strcpy(tick.ActionDay, "20141103");
+    strcpy(tick.UpdateTime, "10:30:00");
+    tick.BidVolume1 = tick.AskVolume1 = 10;
+    // 46 days and 4.5 hours
+    double T = (46 * 86400 + 4.5 * 3600) / (365.0 * 86400);
+
+    double *pForward = new double[nChains];
+    for (int c = 0; c < nChains; c++)
+        pForward[c] = 3000;
+    unsigned long long nVectorCycles = 0, nScalarCycles = 0, nFormatCycles = 0;
+    long long nRefreshed = 0, nLines = 0, nBytes = 0;
+    double dMaxPass = 0, dMaxSmile = 0;
+    long long nSolved = 0, nUnsolved = 0;
+    char chLine[OPTION_SURFACE_SIZE];
+    for (int r = 0; r < nRounds; r++)
+    {
+        for (int c = 0; c < nChains; c++)
+        {
+            pForward[c] += next_random() % 21 - 10;
+            snprintf(tick.InstrumentID, sizeof(tick.InstrumentID), "m%04d", 1501 + c);
+            tick.BidPrice1 = tick.AskPrice1 = pForward[c];
+            vector.onTick(&tick);
+            scalar.onTick(&tick);
+            for (int k = 0; k < nStrikes; k++)
+            {
+                double dStrike = 2100 + 1800.0 * k / std::max(1, nStrikes - 1);
+                for (int t = 0; t < 2; t++)
+                {
+                    snprintf(tick.InstrumentID, sizeof(tick.InstrumentID), "m%04d-%c-%.0f", 1501 + c, t == 0 ? 'C' : 'P', dStrike);
+                    tick.BidPrice1 = tick.AskPrice1 = black(pForward[c], dStrike, T, smile(pForward[c], dStrike), dRate, t == 0);
+                    vector.onTick(&tick);
+                    scalar.onTick(&tick);
+                }
+            }
+        }
+
+        unsigned long long t0 = latency_now();
+        int nVector = vector.refresh();
+        unsigned long long t1 = latency_now();
+        int nScalar = scalar.refresh();
+        unsigned long long t2 = latency_now();
+        nVectorCycles += t1 - t0;
+        nScalarCycles += t2 - t1;
+        if (nVector > 0)
+            LatencyStats::record(LAT_OPTION_CHAIN, (t1 - t0) / nVector);
+        nRefreshed += nVector;
+        if (nVector != nScalar)
+        {
+            printf("the passes refreshed %d and %d chains\n", nVector, nScalar);
+            return 1;
+        }
+
+        t0 = latency_now();
+        for (int i = 0; i < nVector; i++)
+        {
+            int nFrom = 0;
+            int n;
+            while ((n = vector.format(vector.changed(i), &nFrom, chLine, sizeof(chLine))) > 0)
+            {
+                nLines++;
+                nBytes += n;
+            }
+        }
+        nFormatCycles += latency_now() - t0;
+
+        for (int i = 0; i < nVector; i++)
+        {
+            int c = vector.changed(i);
+            const OptionGreeks *pVector = vector.greeks(c);
+            const OptionGreeks *pScalar = scalar.greeks(c);
+            for (int k = 0; k < vector.chainSize(c); k++)
+            {
+                double dStrike = 2100 + 1800.0 * (k / 2) / std::max(1, nStrikes - 1);
+                if (pVector[k].dVol > 0)
+                {
+                    nSolved++;
+                    dMaxSmile = std::max(dMaxSmile, fabs(pVector[k].dVol - smile(pForward[c], dStrike)));
+                }
+                else
+                    nUnsolved++;
+                dMaxPass = std::max(dMaxPass, fabs(pVector[k].dVol - pScalar[k].dVol));
+                dMaxPass = std::max(dMaxPass, fabs(pVector[k].dDelta - pScalar[k].dDelta));
+            }
+        }
+    }
+
+    double dNs = LatencyStats::nsPerCycle();
+    printf("%d chains of %d options, %d rounds, AVX2 %s\n", nChains, 2 * nStrikes, nRounds,
+           vector.usingAvx2() ? "used" : "not available");
+    printf("refresh: vector %.2f us/chain, scalar %.2f us/chain; format %.2f us/chain, %lld lines of %lld bytes mean\n",
+           nVectorCycles * dNs / 1000 / nRefreshed, nScalarCycles * dNs / 1000 / nRefreshed, nFormatCycles * dNs / 1000 / nRefreshed,
+           nLines, nLines > 0 ? nBytes / nLines : 0);
+    printf("%lld solved, %lld without a volatility; vector against scalar %.2e, against the smile %.2e\n", nSolved, nUnsolved,
+           dMaxPass, dMaxSmile);
+    int nFrom = 0;
+    if (vector.format(0, &nFrom, chLine, sizeof(chLine)) > 0)
+        printf("%.200s...\n", chLine);
+    char chStats[4096];
+    LatencyStats::dump(chStats, sizeof(chStats));
+    printf("%s", chStats);
+
+    delete[] pForward;
+    return 0;
+}
@@ -0,0 +1,201 @@
+// order_bench.cpp : tick to ReqOrderInsert latency of market_monitor's
+// order path, and what the order templates take off it.
+//
+// The ticks go to the real MarketHandler::OnRtnDepthMarketData, which
+// caches them, marks the positions and runs the TriggerEngine; each tick
+// crosses one armed trigger, whose order is built from the templates,
+// pre-checked by the RiskEngine and sent to a MockTraderApi. The orders
+// are then registered as the trader thread does (registerTriggered()) and
+// cancelled at once to keep the working lists short; that part is not
+// timed. The build step alone is then timed both ways: a template copy
+// against filling the CThostFtdcInputOrderField field by field, as the
+// handler did before.
+//
+#include "MockTraderApi.h"
+#include "../market_monitor/MarketHandler.h"
+#include "../common/OrderTemplates.h"
+#include "../common/OrderManager.h"
+#include "../common/RiskEngine.h"
+#include "../common/PositionKeeper.h"
+#include "../common/TriggerEngine.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+const int INSTRUMENTS = 500;
+// triggers armed per TriggerEngine, which never reuses an id
+const int TRIGGERS_PER_ENGINE = 60000;
+const int ENGINES = 10;
+const int ITERATIONS = TRIGGERS_PER_ENGINE * ENGINES;
+const int BUILDS = 2000000;
+
+static void print(const char *pName, unsigned long long *pCycles, int nCount)
+{
+    std::sort(pCycles, pCycles + nCount);
+    double dCycle = LatencyStats::nsPerCycle();
+    printf("%-10s n=%d p50 %.0f p90 %.0f p99 %.0f p99.9 %.0f max %.0f ns\n", pName, nCount, pCycles[nCount / 2] * dCycle,
+           pCycles[nCount / 10 * 9] * dCycle, pCycles[nCount / 100 * 99] * dCycle, pCycles[nCount / 1000 * 999] * dCycle,
+           pCycles[nCount - 1] * dCycle);
+}
+
+// the handler's field by field build, before the templates
+static void build_fields(CThostFtdcInputOrderField *pOrder, const char *pInstrumentID, double dPrice, int nRequestID)
+{
+    memset(pOrder, 0, sizeof(*pOrder));
+    strcpy(pOrder->BrokerID, "3748FD77");
+    strcpy(pOrder->InvestorID, "8023901");
+    strcpy(pOrder->InstrumentID, pInstrumentID);
+    strcpy(pOrder->UserID, "8023901");
+    pOrder->OrderPriceType = THOST_FTDC_OPT_LimitPrice;
+    pOrder->Direction = THOST_FTDC_D_Buy;
+    pOrder->CombOffsetFlag[0] = THOST_FTDC_OF_Open;
+    pOrder->CombHedgeFlag[0] = THOST_FTDC_HF_Speculation;
+    pOrder->LimitPrice = dPrice;
+    pOrder->VolumeTotalOriginal = 1;
+    pOrder->TimeCondition = THOST_FTDC_TC_GFD;
+    strcpy(pOrder->GTDDate, "");
+    pOrder->VolumeCondition = THOST_FTDC_VC_AV;
+    pOrder->MinVolume = 1;
+    pOrder->ContingentCondition = THOST_FTDC_CC_Immediately;
+    pOrder->StopPrice = 0;
+    pOrder->ForceCloseReason = THOST_FTDC_FCC_NotForceClose;
+    pOrder->IsAutoSuspend = 0;
+    pOrder->RequestID = nRequestID;
+}
+
+int main(int argc, char* argv[])
+{
+    // the handler's tick lines are below the level, as in production
+    AsyncLogger::start(NULL, LOG_LEVEL_WARN);
+
+    MockTraderApi api;
+    LastValueCache *pCache = new LastValueCache;
+    RiskEngine *pRisk = new RiskEngine(pCache);
+    OrderTemplates *pTemplates = new OrderTemplates(pCache);
+    OrderManager *pOrders = new OrderManager;
+    PositionKeeper *pPositions = new PositionKeeper(pCache);
+    pTemplates->setAccount("3748FD77", "8023901", "8023901");
+    pPositions->markSeeded();
+    MarketHandler handler(NULL);
+    handler.m_pCache = pCache;
+    handler.m_pPositions = pPositions;
+
+    CThostFtdcDepthMarketDataField *pTicks = new CThostFtdcDepthMarketDataField[INSTRUMENTS];
+    for (int i = 0; i < INSTRUMENTS; i++)
+    {
+        CThostFtdcInstrumentField inst;
+        memset(&inst, 0, sizeof(inst));
+        snprintf(inst.InstrumentID, sizeof(inst.InstrumentID), "rb%04d", 1000 + i);
+        strcpy(inst.ExchangeID, "SHFE");
+        inst.VolumeMultiple = 10;
+        inst.PriceTick = 1;
+        pRisk->addInstrument(&inst);
+        pPositions->addInstrument(&inst);
+        pTemplates->addInstrument(inst.InstrumentID);
+
+        CThostFtdcDepthMarketDataField &tick = pTicks[i];
+        memset(&tick, 0, sizeof(tick));
+        strcpy(tick.InstrumentID, inst.InstrumentID);
+        strcpy(tick.UpdateTime, "10:15:00");
+        tick.LastPrice = 3500;
+        tick.BidPrice1 = 3499;
+        tick.AskPrice1 = 3501;
+        tick.UpperLimitPrice = 3800;
+        tick.LowerLimitPrice = 3200;
+        pCache->update(&tick);
+    }
+
+    unsigned int nSeed = 12345;
+    int *pPick = new int[std::max(ITERATIONS, BUILDS)];
+    for (int n = 0; n < std::max(ITERATIONS, BUILDS); n++)
+    {
+        nSeed = nSeed * 1103515245 + 12345;
+        pPick[n] = (nSeed >> 8) % INSTRUMENTS;
+    }
+
+    unsigned long long *pCycles = new unsigned long long[std::max(ITERATIONS, BUILDS)];
+    printf("instruments=%d, probe overhead included\n", INSTRUMENTS);
+    // twice each, the first round warms the caches
+    for (int nRound = 0; nRound < 2; nRound++)
+    {
+        int nSent = 0;
+        for (int e = 0; e < ENGINES; e++)
+        {
+            TriggerEngine *pTriggers = new TriggerEngine(pCache, pTemplates, pOrders, pRisk);
+            pTriggers->setTraderApi(&api);
+            handler.m_pTriggers = pTriggers;
+            for (int k = 0; k < TRIGGERS_PER_ENGINE; k++)
+            {
+                int n = e * TRIGGERS_PER_ENGINE + k;
+                CThostFtdcDepthMarketDataField *pTick = &pTicks[pPick[n]];
+                TriggerOrder order;
+                order.chDirection = THOST_FTDC_D_Buy;
+                order.chOffsetFlag = THOST_FTDC_OF_Open;
+                order.chHedgeFlag = THOST_FTDC_HF_Speculation;
+                order.nVolume = 1;
+                order.dLimitPrice = 0;
+                pTriggers->addTrigger(pTick->InstrumentID, TRIGGER_AT_OR_ABOVE, 3500, order);
+
+                int nInserts = api.m_nInserts;
+                unsigned long long t = latency_now();
+                handler.OnRtnDepthMarketData(pTick);
+                if (api.m_nInserts == nInserts)
+                    continue;
+                pCycles[nSent++] = api.m_nInsertTime - t;
+
+                // the trader thread's side
+                CThostFtdcInputOrderField ord;
+                while (pTriggers->popFired(&ord, 1) > 0)
+                {
+                    int nOrderID = pOrders->onInsert(&ord);
+                    pRisk->onTriggered(&ord, nOrderID);
+                    pRisk->onOrderUpdate(ord.InstrumentID, nOrderID, 0, true);
+                }
+                if (pOrders->count() >= MAX_ORDERS - 1)
+                    pOrders->reset();
+            }
+            handler.m_pTriggers = NULL;
+            delete pTriggers;
+        }
+        if (nRound == 1)
+        {
+            printf("tick to ReqOrderInsert through MarketHandler::OnRtnDepthMarketData, %d of %d ticks sent\n", nSent, ITERATIONS);
+            print("handler", pCycles, nSent);
+        }
+
+        CThostFtdcInputOrderField ord;
+        for (int n = 0; n < BUILDS; n++)
+        {
+            unsigned long long t = latency_now();
+            build_fields(&ord, pTicks[pPick[n]].InstrumentID, 3501, n);
+            pCycles[n] = latency_now() - t;
+        }
+        if (nRound == 1)
+        {
+            printf("order build alone\n");
+            print("fields", pCycles, BUILDS);
+        }
+        for (int n = 0; n < BUILDS; n++)
+        {
+            unsigned long long t = latency_now();
+            pTemplates->build(&ord, pPick[n], THOST_FTDC_D_Buy, THOST_FTDC_OF_Open, THOST_FTDC_HF_Speculation, 3501, 1, n);
+            pCycles[n] = latency_now() - t;
+        }
+        if (nRound == 1)
+            print("template", pCycles, BUILDS);
+    }
+    AsyncLogger::stop();
+
+    delete[] pCycles;
+    delete[] pPick;
+    delete[] pTicks;
+    delete pPositions;
+    delete pOrders;
+    delete pTemplates;
+    delete pRisk;
+    delete pCache;
+    return 0;
+}
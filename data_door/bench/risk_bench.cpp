@@ -0,0 +1,99 @@
+// risk_bench.cpp : cost of RiskEngine::check() on a populated book.
+//
+#include "../common/RiskEngine.h"
+#include "../common/LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+const int INSTRUMENTS = 500;
+const int ITERATIONS = 5000000;
+
+int main(int argc, char* argv[])
+{
+    LastValueCache *pCache = new LastValueCache;
+    RiskEngine *pRisk = new RiskEngine(pCache);
+
+    RiskLimits limits;
+    limits.nMaxOrderVolume = 50;
+    limits.nMaxPosition = 200;
+    limits.dMaxNotional = 5e7;
+    pRisk->setDefaultLimits(limits);
+
+    // instruments with a tick each and a few working orders on both sides
+    CThostFtdcInputOrderField *pOrders = new CThostFtdcInputOrderField[INSTRUMENTS];
+    int nOrderID = 0;
+    for (int i = 0; i < INSTRUMENTS; i++)
+    {
+        CThostFtdcInstrumentField inst;
+        memset(&inst, 0, sizeof(inst));
+        snprintf(inst.InstrumentID, sizeof(inst.InstrumentID), "rb%04d", 1000 + i);
+        inst.VolumeMultiple = 10;
+        pRisk->addInstrument(&inst);
+
+        CThostFtdcDepthMarketDataField tick;
+        memset(&tick, 0, sizeof(tick));
+        strcpy(tick.InstrumentID, inst.InstrumentID);
+        strcpy(tick.UpdateTime, "10:15:00");
+        tick.LastPrice = 3500;
+        tick.UpperLimitPrice = 3800;
+        tick.LowerLimitPrice = 3200;
+        pCache->update(&tick);
+
+        CThostFtdcInputOrderField &ord = pOrders[i];
+        memset(&ord, 0, sizeof(ord));
+        strcpy(ord.InstrumentID, inst.InstrumentID);
+        ord.CombOffsetFlag[0] = THOST_FTDC_OF_Open;
+        ord.VolumeTotalOriginal = 2;
+        for (int k = 0; k < 6; k++)
+        {
+            ord.Direction = (k & 1) ? THOST_FTDC_D_Sell : THOST_FTDC_D_Buy;
+            ord.LimitPrice = (k & 1) ? 3510 + k : 3490 - k;
+            pRisk->onInsert(&ord, nOrderID++);
+        }
+        ord.Direction = THOST_FTDC_D_Buy;
+        ord.LimitPrice = 3495;
+    }
+
+    // order stream cycling over the instruments
+    unsigned int nSeed = 12345;
+    int *pPick = new int[ITERATIONS];
+    for (int n = 0; n < ITERATIONS; n++)
+    {
+        nSeed = nSeed * 1103515245 + 12345;
+        pPick[n] = (nSeed >> 8) % INSTRUMENTS;
+    }
+
+    int nPassed = 0;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int n = 0; n < ITERATIONS; n++)
+        nPassed += pRisk->check(&pOrders[pPick[n]]) == RISK_OK;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double dNs = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ITERATIONS;
+
+    // the same again with each check timed on its own for the distribution
+    unsigned long long *pCycles = new unsigned long long[ITERATIONS];
+    for (int n = 0; n < ITERATIONS; n++)
+    {
+        unsigned long long t = latency_now();
+        nPassed += pRisk->check(&pOrders[pPick[n]]) == RISK_OK;
+        pCycles[n] = latency_now() - t;
+    }
+    std::sort(pCycles, pCycles + ITERATIONS);
+    double dCycle = LatencyStats::nsPerCycle();
+
+    printf("instruments=%d checks=%d passed=%d\n", INSTRUMENTS, ITERATIONS, nPassed / 2);
+    printf("mean %.1f ns/check\n", dNs);
+    printf("timed one by one, probe overhead included: p50 %.0f p99 %.0f p99.9 %.0f max %.0f ns\n",
+           pCycles[ITERATIONS / 2] * dCycle, pCycles[ITERATIONS / 100 * 99] * dCycle,
+           pCycles[ITERATIONS / 1000 * 999] * dCycle, pCycles[ITERATIONS - 1] * dCycle);
+
+    delete[] pCycles;
+    delete[] pPick;
+    delete[] pOrders;
+    delete pRisk;
+    delete pCache;
+    return 0;
+}
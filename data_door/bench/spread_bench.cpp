@@ -0,0 +1,175 @@
+// spread_bench.cpp : cost of SpreadBook::onTick() per leg update.
+//
+//   spread_bench [-legs 500] [-spreads 5000] [-ticks 1000000]
+// Defines calendar spreads (ratio 1/-1) and some ratio spreads (2/-1,
+// three legs) over random legs, then feeds random level one moves of the
+// legs. Prints the time per leg tick, as the spread stage of the latency
+// table, and checks every implied tick published against the spread
+// recomputed from scratch.
+//
+#include "../common/SpreadBook.h"
+#include "../common/LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+static unsigned int s_nSeed = 12345;
+
+static int next_random()
+{
+    s_nSeed = s_nSeed * 1103515245 + 12345;
+    return (s_nSeed >> 8) & 0xffff;
+}
+
+struct BenchSpread
+{
+    int nLegs;
+    int nLeg[3];
+    double dRatio[3];
+};
+
+int main(int argc, char* argv[])
+{
+    int nLegs = 500;
+    int nSpreads = 5000;
+    int nTicks = 1000000;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-legs") == 0 && a + 1 < argc)
+            nLegs = std::min(std::max(3, atoi(argv[++a])), MAX_INSTRUMENTS);
+        else if (strcmp(argv[a], "-spreads") == 0 && a + 1 < argc)
+            nSpreads = std::min(std::max(1, atoi(argv[++a])), MAX_SPREADS);
+        else if (strcmp(argv[a], "-ticks") == 0 && a + 1 < argc)
+            nTicks = atoi(argv[++a]);
+    }
+
+    SpreadBook book;
+    BenchSpread *pSpreads = new BenchSpread[nSpreads];
+    int nDefined = 0;
+    while (nDefined < nSpreads)
+    {
+        BenchSpread &s = pSpreads[nDefined];
+        int nKind = next_random() % 10;
+        s.nLegs = nKind == 0 ? 3 : 2;
+        // distinct legs
+        for (int i = 0; i < s.nLegs; i++)
+        {
+            bool bTaken;
+            do
+            {
+                s.nLeg[i] = next_random() % nLegs;
+                bTaken = false;
+                for (int j = 0; j < i; j++)
+                    bTaken = bTaken || s.nLeg[j] == s.nLeg[i];
+            } while (bTaken);
+        }
+        s.dRatio[0] = nKind == 1 ? 2 : 1;
+        s.dRatio[1] = -1;
+        s.dRatio[2] = -1;
+        char chID[31];
+        char chLegs[3][31];
+        const char *pLegs[3];
+        double dRatios[3];
+        snprintf(chID, sizeof(chID), "sp%05d", nDefined);
+        for (int i = 0; i < s.nLegs; i++)
+        {
+            snprintf(chLegs[i], sizeof(chLegs[i]), "al%04d", 1000 + s.nLeg[i]);
+            pLegs[i] = chLegs[i];
+            dRatios[i] = s.dRatio[i];
+        }
+        if (!book.define(chID, pLegs, dRatios, s.nLegs))
+        {
+            printf("cannot define %s\n", chID);
+            return 1;
+        }
+        nDefined++;
+    }
+
+    // the legs' level one as the bench sets it
+    double *pBid = new double[nLegs];
+    double *pAsk = new double[nLegs];
+    int *pBidVolume = new int[nLegs];
+    int *pAskVolume = new int[nLegs];
+    for (int l = 0; l < nLegs; l++)
+    {
+        pBid[l] = pAsk[l] = 0;
+        pBidVolume[l] = pAskVolume[l] = 0;
+    }
+
+    CThostFtdcDepthMarketDataField tick;
+    memset(&tick, 0, sizeof(tick));
+    strcpy(tick.ExchangeID, "SHFE");
+    strcpy(tick.TradingDay, "20141103");
+    strcpy(tick.UpdateTime, "09:00:00");
+    // the first tick builds the graph
+    strcpy(tick.InstrumentID, "none");
+    book.onTick(&tick);
+    unsigned long long nCycles = 0, nImplied = 0;
+    long long nWrong = 0;
+    for (int n = 0; n < nTicks; n++)
+    {
+        int l = next_random() % nLegs;
+        pBid[l] = 14000 + next_random() % 20 * 5;
+        pAsk[l] = pBid[l] + 5;
+        // now and then a side empties
+        pBidVolume[l] = next_random() % 50 == 0 ? 0 : 1 + next_random() % 30;
+        pAskVolume[l] = 1 + next_random() % 30;
+        snprintf(tick.InstrumentID, sizeof(tick.InstrumentID), "al%04d", 1000 + l);
+        tick.BidPrice1 = pBidVolume[l] > 0 ? pBid[l] : 1.7976931348623157e308;
+        tick.AskPrice1 = pAsk[l];
+        tick.BidVolume1 = pBidVolume[l];
+        tick.AskVolume1 = pAskVolume[l];
+
+        unsigned long long t = latency_now();
+        int nOut = book.onTick(&tick);
+        t = latency_now() - t;
+        LatencyStats::record(LAT_SPREAD, t);
+        nCycles += t;
+        nImplied += nOut;
+
+        for (int i = 0; i < nOut; i++)
+        {
+            const CThostFtdcDepthMarketDataField &out = book.ticks()[i];
+            const BenchSpread &s = pSpreads[atoi(out.InstrumentID + 2)];
+            double dBid = 0, dAsk = 0;
+            int nBidVolume = 1 << 30, nAskVolume = 1 << 30;
+            for (int k = 0; k < s.nLegs; k++)
+            {
+                int m = s.nLeg[k];
+                bool bLong = s.dRatio[k] > 0;
+                // an empty side, or a leg not ticked yet, empties the spread's
+                double dLegBid = pBidVolume[m] > 0 ? pBid[m] : 0;
+                double dLegAsk = pAskVolume[m] > 0 ? pAsk[m] : 0;
+                double dSell = bLong ? dLegBid : dLegAsk;
+                double dBuy = bLong ? dLegAsk : dLegBid;
+                dBid += s.dRatio[k] * dSell;
+                dAsk += s.dRatio[k] * dBuy;
+                nBidVolume = std::min(nBidVolume, dSell > 0 ? (int)((bLong ? pBidVolume[m] : pAskVolume[m]) / fabs(s.dRatio[k])) : 0);
+                nAskVolume = std::min(nAskVolume, dBuy > 0 ? (int)((bLong ? pAskVolume[m] : pBidVolume[m]) / fabs(s.dRatio[k])) : 0);
+            }
+            if (nBidVolume == 0)
+                dBid = 0;
+            if (nAskVolume == 0)
+                dAsk = 0;
+            if (out.BidPrice1 != dBid || out.AskPrice1 != dAsk || out.BidVolume1 != nBidVolume || out.AskVolume1 != nAskVolume)
+                nWrong++;
+        }
+    }
+
+    double dNs = LatencyStats::nsPerCycle();
+    printf("%d spreads over %d legs, %d leg ticks\n", nSpreads, book.legs(), nTicks);
+    printf("onTick %.1f ns mean, %.2f implied ticks per leg tick, %lld wrong\n", nCycles * dNs / nTicks,
+           (double)nImplied / nTicks, nWrong);
+    char chStats[4096];
+    LatencyStats::dump(chStats, sizeof(chStats));
+    printf("%s", chStats);
+
+    delete[] pSpreads;
+    delete[] pBid;
+    delete[] pAsk;
+    delete[] pBidVolume;
+    delete[] pAskVolume;
+    return 0;
+}
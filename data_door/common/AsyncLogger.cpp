@@ -0,0 +1,500 @@
+// AsyncLogger.cpp : per thread record rings and the writer thread.
+//
+#include "AsyncLogger.h"
+#include "ThreadTopology.h"
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+
+// bytes of record ring per logging thread, a power of two
+static const unsigned int LOG_RING_SIZE = 1 << 18;
+// partial line kept per ring until its newline arrives
+static const int LOG_LINE_SIZE = 8192;
+// formatted output collected before one fwrite
+static const int LOG_BATCH_SIZE = 1 << 16;
+// record length marking the unused tail of the ring before a wrap
+static const int LOG_WRAP = -1;
+
+// record header, followed by the encoded arguments
+struct LogRecord
+{
+    int nLength;
+    int nLevel;
+    const char *pFormat;
+};
+
+// argument tags
+enum
+{
+    LOG_ARG_INT = 'i',
+    LOG_ARG_DOUBLE = 'd',
+    LOG_ARG_STRING = 's',
+    LOG_ARG_POINTER = 'p'
+};
+
+struct LogRing
+{
+    // written by the owning thread
+    unsigned long long nHead __attribute__((aligned(64)));
+    // written by the writer thread
+    unsigned long long nTail __attribute__((aligned(64)));
+    char *pData;
+    // writer thread only: the current unfinished line
+    char *pLine;
+    int nLine;
+    LogRing *pNext;
+};
+
+int AsyncLogger::s_nLevel = LOG_LEVEL_INFO;
+__thread LogRing *AsyncLogger::s_pRing = 0;
+
+// every registered ring, pushed with CAS and never removed
+static LogRing *s_pHead = 0;
+static unsigned long long s_nDropped = 0;
+
+struct LogWriter
+{
+    FILE *fp;
+    bool bOwnFile;
+    // path of an owned file, for reopen()
+    char *pPath;
+    volatile bool bRunning;
+    volatile bool bReopen;
+    pthread_t hThread;
+    char *pBatch;
+    int nBatch;
+};
+
+static LogWriter *s_pWriter = 0;
+
+static int align8(int n)
+{
+    return (n + 7) & ~7;
+}
+
+LogRing *AsyncLogger::registerThread()
+{
+    LogRing *p = (LogRing *)calloc(1, sizeof(LogRing));
+    p->pData = (char *)malloc(LOG_RING_SIZE);
+    p->pLine = (char *)malloc(LOG_LINE_SIZE);
+    LogRing *pHead = __atomic_load_n(&s_pHead, __ATOMIC_ACQUIRE);
+    do
+    {
+        p->pNext = pHead;
+    } while (!__atomic_compare_exchange_n(&s_pHead, &pHead, p, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    s_pRing = p;
+    return p;
+}
+
+int AsyncLogger::beginRecord(char *pBuf, int nLevel, const char *pFormat)
+{
+    LogRecord *r = (LogRecord *)pBuf;
+    r->nLevel = nLevel;
+    r->pFormat = pFormat;
+    return sizeof(LogRecord);
+}
+
+int AsyncLogger::encodeInt(char *pBuf, int nLen, long long v)
+{
+    if (nLen + 1 + (int)sizeof(v) > LOG_MAX_RECORD)
+        return nLen;
+    pBuf[nLen] = LOG_ARG_INT;
+    memcpy(pBuf + nLen + 1, &v, sizeof(v));
+    return nLen + 1 + sizeof(v);
+}
+
+int AsyncLogger::encode(char *pBuf, int nLen, double v)
+{
+    if (nLen + 1 + (int)sizeof(v) > LOG_MAX_RECORD)
+        return nLen;
+    pBuf[nLen] = LOG_ARG_DOUBLE;
+    memcpy(pBuf + nLen + 1, &v, sizeof(v));
+    return nLen + 1 + sizeof(v);
+}
+
+int AsyncLogger::encode(char *pBuf, int nLen, const char *v)
+{
+    if (v == NULL)
+        v = "(null)";
+    int n = strnlen(v, LOG_MAX_STRING);
+    if (nLen + 2 + n > LOG_MAX_RECORD)
+        return nLen;
+    pBuf[nLen] = LOG_ARG_STRING;
+    pBuf[nLen + 1] = (char)n;
+    memcpy(pBuf + nLen + 2, v, n);
+    return nLen + 2 + n;
+}
+
+int AsyncLogger::encode(char *pBuf, int nLen, const void *v)
+{
+    if (nLen + 1 + (int)sizeof(v) > LOG_MAX_RECORD)
+        return nLen;
+    pBuf[nLen] = LOG_ARG_POINTER;
+    memcpy(pBuf + nLen + 1, &v, sizeof(v));
+    return nLen + 1 + sizeof(v);
+}
+
+void AsyncLogger::commit(const char *pRecord, int nLen)
+{
+    LogRing *p = s_pRing;
+    if (p == 0)
+        p = registerThread();
+
+    int nSize = align8(nLen);
+    unsigned long long nHead = p->nHead;
+    unsigned long long nTail = __atomic_load_n(&p->nTail, __ATOMIC_ACQUIRE);
+    unsigned int nPos = (unsigned int)(nHead & (LOG_RING_SIZE - 1));
+    unsigned int nToEnd = LOG_RING_SIZE - nPos;
+
+    // a record never wraps: the tail of the ring is skipped instead
+    unsigned int nNeed = nToEnd < (unsigned int)nSize ? nToEnd + nSize : nSize;
+    if (nHead + nNeed - nTail > LOG_RING_SIZE)
+    {
+        __atomic_add_fetch(&s_nDropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (nToEnd < (unsigned int)nSize)
+    {
+        *(int *)(p->pData + nPos) = LOG_WRAP;
+        nHead += nToEnd;
+        nPos = 0;
+    }
+    memcpy(p->pData + nPos, pRecord, nLen);
+    ((LogRecord *)(p->pData + nPos))->nLength = nLen;
+    __atomic_store_n(&p->nHead, nHead + nSize, __ATOMIC_RELEASE);
+}
+
+void AsyncLogger::setLevel(int nLevel)
+{
+    if (nLevel < LOG_LEVEL_TICK)
+        nLevel = LOG_LEVEL_TICK;
+    if (nLevel > LOG_LEVEL_OFF)
+        nLevel = LOG_LEVEL_OFF;
+    __atomic_store_n(&s_nLevel, nLevel, __ATOMIC_RELAXED);
+}
+
+int AsyncLogger::parseLevel(const char *pName)
+{
+    static const char *s_names[] = { "tick", "debug", "info", "warn", "error", "off" };
+    for (int i = 0; i <= LOG_LEVEL_OFF; i++)
+    {
+        if (strcasecmp(pName, s_names[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+unsigned long long AsyncLogger::dropped()
+{
+    return __atomic_load_n(&s_nDropped, __ATOMIC_RELAXED);
+}
+
+static void on_level_signal(int nSignal)
+{
+    AsyncLogger::setLevel(AsyncLogger::level() + (nSignal == SIGUSR1 ? -1 : 1));
+}
+
+void AsyncLogger::installLevelSignals()
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_level_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+}
+
+static void flush_batch(LogWriter *w)
+{
+    if (w->nBatch > 0)
+    {
+        fwrite(w->pBatch, 1, w->nBatch, w->fp);
+        fflush(w->fp);
+        w->nBatch = 0;
+    }
+}
+
+static void append_batch(LogWriter *w, const char *p, int n)
+{
+    if (w->nBatch + n > LOG_BATCH_SIZE)
+        flush_batch(w);
+    if (n > LOG_BATCH_SIZE)
+    {
+        fwrite(p, 1, n, w->fp);
+        return;
+    }
+    memcpy(w->pBatch + w->nBatch, p, n);
+    w->nBatch += n;
+}
+
+// move the complete lines of the ring's partial line to the batch, or all
+// of it when bAll or the line buffer is nearly full
+static void release_lines(LogWriter *w, LogRing *r, bool bAll)
+{
+    int nEnd = r->nLine;
+    if (!bAll && r->nLine < LOG_LINE_SIZE - 512)
+    {
+        while (nEnd > 0 && r->pLine[nEnd - 1] != '\n')
+            nEnd--;
+    }
+    if (nEnd == 0)
+        return;
+    append_batch(w, r->pLine, nEnd);
+    memmove(r->pLine, r->pLine + nEnd, r->nLine - nEnd);
+    r->nLine -= nEnd;
+}
+
+static void append_line(LogWriter *w, LogRing *r, const char *p, int n)
+{
+    while (n > 0)
+    {
+        if (r->nLine == LOG_LINE_SIZE)
+            release_lines(w, r, true);
+        int nCopy = LOG_LINE_SIZE - r->nLine < n ? LOG_LINE_SIZE - r->nLine : n;
+        memcpy(r->pLine + r->nLine, p, nCopy);
+        r->nLine += nCopy;
+        p += nCopy;
+        n -= nCopy;
+    }
+}
+
+// printf the record's format with its decoded arguments. Every conversion
+// is rebuilt with the length modifier matching how the argument was stored,
+// so the caller's modifiers do not matter.
+static void format_record(LogWriter *w, LogRing *r, const LogRecord *pRecord)
+{
+    const char *pArg = (const char *)pRecord + sizeof(LogRecord);
+    const char *pArgEnd = (const char *)pRecord + pRecord->nLength;
+    const char *f = pRecord->pFormat;
+    char chOut[512];
+
+    while (*f != '\0')
+    {
+        const char *pLiteral = f;
+        while (*f != '\0' && *f != '%')
+            f++;
+        if (f > pLiteral)
+            append_line(w, r, pLiteral, f - pLiteral);
+        if (*f == '\0')
+            break;
+
+        const char *pSpec = f++;
+        if (*f == '%')
+        {
+            append_line(w, r, "%", 1);
+            f++;
+            continue;
+        }
+
+        // flags, width and precision are kept, '*' is not supported
+        char chSpec[32];
+        int nSpec = 0;
+        chSpec[nSpec++] = '%';
+        while (*f != '\0' && strchr("-+ #0123456789.", *f) != NULL)
+        {
+            if (nSpec < 24)
+                chSpec[nSpec++] = *f;
+            f++;
+        }
+        while (*f != '\0' && strchr("hlLqjzt", *f) != NULL)
+            f++;
+        char chConv = *f;
+        if (chConv == '\0' || pArg >= pArgEnd)
+        {
+            // malformed format or truncated record: show the rest verbatim
+            append_line(w, r, pSpec, strlen(pSpec));
+            break;
+        }
+        f++;
+
+        char chTag = *pArg++;
+        int n = 0;
+        if (chTag == LOG_ARG_STRING)
+        {
+            int nLen = (unsigned char)*pArg++;
+            chSpec[nSpec++] = 's';
+            chSpec[nSpec] = '\0';
+            char chStr[LOG_MAX_STRING + 1];
+            memcpy(chStr, pArg, nLen);
+            chStr[nLen] = '\0';
+            pArg += nLen;
+            n = snprintf(chOut, sizeof(chOut), chSpec, chStr);
+        }
+        else
+        {
+            long long i;
+            double d;
+            void *v;
+            memcpy(&i, pArg, sizeof(i));
+            memcpy(&d, pArg, sizeof(d));
+            memcpy(&v, pArg, sizeof(v));
+            pArg += 8;
+            bool bFloatConv = strchr("feEgGaA", chConv) != NULL;
+            if (chTag == LOG_ARG_DOUBLE)
+            {
+                if (!bFloatConv)
+                    chConv = 'g';
+                chSpec[nSpec++] = chConv;
+                chSpec[nSpec] = '\0';
+                n = snprintf(chOut, sizeof(chOut), chSpec, d);
+            }
+            else if (chTag == LOG_ARG_POINTER || chConv == 'p')
+            {
+                chSpec[nSpec++] = 'p';
+                chSpec[nSpec] = '\0';
+                n = snprintf(chOut, sizeof(chOut), chSpec, chTag == LOG_ARG_POINTER ? v : (void *)(long)i);
+            }
+            else if (chConv == 'c')
+            {
+                chSpec[nSpec++] = 'c';
+                chSpec[nSpec] = '\0';
+                n = snprintf(chOut, sizeof(chOut), chSpec, (int)i);
+            }
+            else if (bFloatConv)
+            {
+                chSpec[nSpec++] = chConv;
+                chSpec[nSpec] = '\0';
+                n = snprintf(chOut, sizeof(chOut), chSpec, (double)i);
+            }
+            else
+            {
+                if (strchr("diouxX", chConv) == NULL)
+                    chConv = 'd';
+                chSpec[nSpec++] = 'l';
+                chSpec[nSpec++] = 'l';
+                chSpec[nSpec++] = chConv;
+                chSpec[nSpec] = '\0';
+                n = snprintf(chOut, sizeof(chOut), chSpec, i);
+            }
+        }
+        if (n > (int)sizeof(chOut) - 1)
+            n = sizeof(chOut) - 1;
+        if (n > 0)
+            append_line(w, r, chOut, n);
+    }
+}
+
+// format everything currently in the rings, returns the records handled
+static int drain(LogWriter *w)
+{
+    int nRecords = 0;
+    for (LogRing *r = __atomic_load_n(&s_pHead, __ATOMIC_ACQUIRE); r != 0; r = r->pNext)
+    {
+        unsigned long long nTail = r->nTail;
+        unsigned long long nHead = __atomic_load_n(&r->nHead, __ATOMIC_ACQUIRE);
+        while (nTail != nHead)
+        {
+            unsigned int nPos = (unsigned int)(nTail & (LOG_RING_SIZE - 1));
+            const LogRecord *pRecord = (const LogRecord *)(r->pData + nPos);
+            if (pRecord->nLength == LOG_WRAP)
+            {
+                nTail += LOG_RING_SIZE - nPos;
+                continue;
+            }
+            format_record(w, r, pRecord);
+            nTail += align8(pRecord->nLength);
+            nRecords++;
+        }
+        __atomic_store_n(&r->nTail, nTail, __ATOMIC_RELEASE);
+        release_lines(w, r, false);
+    }
+    flush_batch(w);
+    return nRecords;
+}
+
+// switch to a new file of the same name after a rotation; the old one
+// stays open when the new one cannot be created
+static void reopen_file(LogWriter *w)
+{
+    if (!w->bOwnFile)
+        return;
+    flush_batch(w);
+    FILE *fp = fopen(w->pPath, "a");
+    if (fp == NULL)
+        return;
+    fclose(w->fp);
+    w->fp = fp;
+}
+
+static void *writer_main(void *pArg)
+{
+    LogWriter *w = (LogWriter *)pArg;
+    ThreadTopology::enter(THREAD_JOURNAL);
+    while (w->bRunning)
+    {
+        if (__atomic_exchange_n(&w->bReopen, false, __ATOMIC_ACQUIRE))
+            reopen_file(w);
+        if (drain(w) == 0)
+            ThreadTopology::idle(THREAD_JOURNAL, 1000);
+    }
+    drain(w);
+    for (LogRing *r = __atomic_load_n(&s_pHead, __ATOMIC_ACQUIRE); r != 0; r = r->pNext)
+        release_lines(w, r, true);
+    flush_batch(w);
+    return NULL;
+}
+
+bool AsyncLogger::start(const char *pFile, int nLevel)
+{
+    if (s_pWriter != 0)
+        return false;
+
+    const char *pEnv = getenv("FC_LOG_LEVEL");
+    if (pEnv != NULL && parseLevel(pEnv) >= 0)
+        nLevel = parseLevel(pEnv);
+    setLevel(nLevel);
+
+    LogWriter *w = new LogWriter;
+    w->fp = stdout;
+    w->bOwnFile = false;
+    w->pPath = NULL;
+    if (pFile != NULL)
+    {
+        w->fp = fopen(pFile, "a");
+        if (w->fp == NULL)
+        {
+            delete w;
+            return false;
+        }
+        w->bOwnFile = true;
+        w->pPath = strdup(pFile);
+    }
+    w->pBatch = new char[LOG_BATCH_SIZE];
+    w->nBatch = 0;
+    w->bRunning = true;
+    w->bReopen = false;
+    if (pthread_create(&w->hThread, NULL, writer_main, w) != 0)
+    {
+        if (w->bOwnFile)
+            fclose(w->fp);
+        free(w->pPath);
+        delete[] w->pBatch;
+        delete w;
+        return false;
+    }
+    s_pWriter = w;
+    return true;
+}
+
+void AsyncLogger::reopen()
+{
+    if (s_pWriter != 0)
+        __atomic_store_n(&s_pWriter->bReopen, true, __ATOMIC_RELEASE);
+}
+
+void AsyncLogger::stop()
+{
+    if (s_pWriter == 0)
+        return;
+    s_pWriter->bRunning = false;
+    pthread_join(s_pWriter->hThread, NULL);
+    if (s_pWriter->bOwnFile)
+        fclose(s_pWriter->fp);
+    free(s_pWriter->pPath);
+    delete[] s_pWriter->pBatch;
+    delete s_pWriter;
+    s_pWriter = 0;
+}
@@ -0,0 +1,114 @@
+#ifndef __ASYNC_LOGGER_H__
+#define __ASYNC_LOGGER_H__
+
+#include <stdio.h>
+#include <string.h>
+
+// Asynchronous binary logger for the api callback threads.
+//
+// FC_LOG(level, fmt, ...) takes printf arguments but does no formatting on
+// the calling thread: it stores the format string pointer (the format id)
+// and the raw argument values, copying strings, as one record in a ring
+// owned by the calling thread. A background thread drains every ring,
+// formats the records and writes complete lines in large batches. When a
+// ring is full the record is dropped and counted, the caller never blocks.
+//
+// The level threshold can be changed at any time with setLevel(); records
+// below it cost one load and a compare.
+
+enum
+{
+    // full depth records, the bulk of the output
+    LOG_LEVEL_TICK,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+#define FC_LOG(level, ...) \
+    do { if (AsyncLogger::enabled(level)) AsyncLogger::log(level, __VA_ARGS__); } while (0)
+
+// largest encoded record, longer argument lists are truncated
+const int LOG_MAX_RECORD = 2048;
+// longest string argument kept, longer strings are cut
+const int LOG_MAX_STRING = 255;
+
+struct LogRing;
+
+class AsyncLogger
+{
+public:
+    // start the writer thread. pFile NULL writes to stdout, otherwise the
+    // file is appended to. The initial level comes from FC_LOG_LEVEL
+    // (tick, debug, info, warn, error, off) when set, else nLevel.
+    static bool start(const char *pFile, int nLevel);
+
+    // drain everything logged so far and stop the writer thread
+    static void stop();
+
+    // reopen the log file on the writer thread, for log rotation
+    static void reopen();
+
+    static void setLevel(int nLevel);
+    static int level() { return __atomic_load_n(&s_nLevel, __ATOMIC_RELAXED); }
+    static bool enabled(int nLevel) { return nLevel >= level(); }
+
+    // level from its name, -1 when unknown
+    static int parseLevel(const char *pName);
+
+    // SIGUSR1 makes the log one level more verbose, SIGUSR2 one level quieter
+    static void installLevelSignals();
+
+    // records lost to full rings since start
+    static unsigned long long dropped();
+
+    template <typename... Args>
+    static void log(int nLevel, const char *pFormat, Args... args)
+    {
+        char buf[LOG_MAX_RECORD];
+        int nLen = beginRecord(buf, nLevel, pFormat);
+        nLen = encodeArgs(buf, nLen, args...);
+        commit(buf, nLen);
+    }
+
+private:
+    static int beginRecord(char *pBuf, int nLevel, const char *pFormat);
+    static void commit(const char *pRecord, int nLen);
+    static LogRing *registerThread();
+
+    static int encodeArgs(char *, int nLen) { return nLen; }
+
+    template <typename T, typename... Rest>
+    static int encodeArgs(char *pBuf, int nLen, T first, Rest... rest)
+    {
+        nLen = encode(pBuf, nLen, first);
+        return encodeArgs(pBuf, nLen, rest...);
+    }
+
+    // argument encodings: a tag byte then the value
+    static int encodeInt(char *pBuf, int nLen, long long v);
+    static int encode(char *pBuf, int nLen, char v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, signed char v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, unsigned char v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, short v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, unsigned short v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, int v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, unsigned int v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, long v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, unsigned long v) { return encodeInt(pBuf, nLen, (long long)v); }
+    static int encode(char *pBuf, int nLen, long long v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, unsigned long long v) { return encodeInt(pBuf, nLen, (long long)v); }
+    static int encode(char *pBuf, int nLen, bool v) { return encodeInt(pBuf, nLen, v); }
+    static int encode(char *pBuf, int nLen, double v);
+    static int encode(char *pBuf, int nLen, float v) { return encode(pBuf, nLen, (double)v); }
+    static int encode(char *pBuf, int nLen, const char *v);
+    static int encode(char *pBuf, int nLen, char *v) { return encode(pBuf, nLen, (const char *)v); }
+    static int encode(char *pBuf, int nLen, const void *v);
+
+    static int s_nLevel;
+    static __thread LogRing *s_pRing;
+};
+
+#endif
@@ -0,0 +1,484 @@
+// CosManager.cpp : flow limited conditional order submission and mirror.
+//
+#include "CosManager.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// copy a fixed size api string, always terminated
+#define COPY_FIELD(dst, src) \
+    do { strncpy(dst, src, sizeof(dst) - 1); dst[sizeof(dst) - 1] = '\0'; } while (0)
+
+// CThostFtdcTraderApi style returns: too many outstanding requests, too
+// many requests this second
+const int COS_FLOW_OUTSTANDING = -2;
+const int COS_FLOW_PER_SECOND = -3;
+
+static long long now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static unsigned int int_hash(int nKey)
+{
+    unsigned int h = (unsigned int)nKey * 2654435761u;
+    return h ^ (h >> 15);
+}
+
+CosManager::CosManager()
+    : m_pCosApi(0), m_nRequests(0), m_nSendCursor(0), m_nConditionals(0), m_nProfitAndLoss(0),
+      m_nNextSendMs(0), m_bRunning(false)
+{
+    pthread_mutex_init(&m_lock, NULL);
+    memset(m_chBrokerID, 0, sizeof(m_chBrokerID));
+    memset(m_chInvestorID, 0, sizeof(m_chInvestorID));
+    m_pRequests = new CosRequest[MAX_COS_REQUESTS];
+    m_pConditionals = new CosOrder[MAX_COS_ORDERS];
+    m_pProfitAndLoss = new PLOrder[MAX_COS_ORDERS];
+    m_pRequestTable = new Bucket[REQUEST_TABLE_SIZE];
+    m_pConditionalTable = new Bucket[ORDER_TABLE_SIZE];
+    m_pProfitAndLossTable = new Bucket[ORDER_TABLE_SIZE];
+    memset(m_pRequestTable, 0xff, sizeof(Bucket) * REQUEST_TABLE_SIZE);
+    memset(m_pConditionalTable, 0xff, sizeof(Bucket) * ORDER_TABLE_SIZE);
+    memset(m_pProfitAndLossTable, 0xff, sizeof(Bucket) * ORDER_TABLE_SIZE);
+    setFlowLimit(5);
+}
+
+CosManager::~CosManager()
+{
+    stop();
+    delete[] m_pRequests;
+    delete[] m_pConditionals;
+    delete[] m_pProfitAndLoss;
+    delete[] m_pRequestTable;
+    delete[] m_pConditionalTable;
+    delete[] m_pProfitAndLossTable;
+    pthread_mutex_destroy(&m_lock);
+}
+
+int CosManager::find(const Bucket *pTable, int nSize, int nKey)
+{
+    unsigned int h = int_hash(nKey) & (nSize - 1);
+    while (pTable[h].nIndex != -1)
+    {
+        if (pTable[h].nKey == nKey)
+            return pTable[h].nIndex;
+        h = (h + 1) & (nSize - 1);
+    }
+    return -1;
+}
+
+void CosManager::insert(Bucket *pTable, int nSize, int nKey, int nIndex)
+{
+    unsigned int h = int_hash(nKey) & (nSize - 1);
+    while (pTable[h].nIndex != -1)
+        h = (h + 1) & (nSize - 1);
+    pTable[h].nKey = nKey;
+    pTable[h].nIndex = nIndex;
+}
+
+void CosManager::setApi(CKSCosApi *pCosApi, const char *pBrokerID, const char *pInvestorID)
+{
+    pthread_mutex_lock(&m_lock);
+    m_pCosApi = pCosApi;
+    COPY_FIELD(m_chBrokerID, pBrokerID);
+    COPY_FIELD(m_chInvestorID, pInvestorID);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void CosManager::setFlowLimit(int nPerSecond)
+{
+    pthread_mutex_lock(&m_lock);
+    m_nIntervalMs = nPerSecond > 0 ? (1000 + nPerSecond - 1) / nPerSecond : 1000;
+    pthread_mutex_unlock(&m_lock);
+}
+
+void *CosManager::sender_main(void *pArg)
+{
+    CosManager *pThis = (CosManager *)pArg;
+    while (__atomic_load_n(&pThis->m_bRunning, __ATOMIC_ACQUIRE))
+    {
+        pThis->pump();
+        usleep(1000);
+    }
+    return NULL;
+}
+
+bool CosManager::start()
+{
+    if (m_bRunning)
+        return true;
+    __atomic_store_n(&m_bRunning, true, __ATOMIC_RELEASE);
+    if (pthread_create(&m_hThread, NULL, sender_main, this) != 0)
+    {
+        m_bRunning = false;
+        return false;
+    }
+    return true;
+}
+
+void CosManager::stop()
+{
+    if (!m_bRunning)
+        return;
+    __atomic_store_n(&m_bRunning, false, __ATOMIC_RELEASE);
+    pthread_join(m_hThread, NULL);
+}
+
+// caller holds the lock
+int CosManager::queue(int nType)
+{
+    if (m_nRequests >= MAX_COS_REQUESTS)
+        return -1;
+    int nIndex = m_nRequests++;
+    CosRequest &r = m_pRequests[nIndex];
+    memset(&r, 0, sizeof(r));
+    r.nRequestID = COS_REQUEST_BASE + nIndex;
+    r.nType = nType;
+    r.nState = COS_QUEUED;
+    insert(m_pRequestTable, REQUEST_TABLE_SIZE, r.nRequestID, nIndex);
+    return nIndex;
+}
+
+int CosManager::queueConditional(const CKSConditionalOrderInitInsert *pInsert)
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = queue(COS_CONDITIONAL);
+    if (nIndex >= 0)
+        m_pRequests[nIndex].conditional = *pInsert;
+    pthread_mutex_unlock(&m_lock);
+    return nIndex >= 0 ? COS_REQUEST_BASE + nIndex : -1;
+}
+
+int CosManager::queueProfitAndLoss(const CKSProfitAndLossOrderInsert *pInsert)
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = queue(COS_PROFIT_AND_LOSS);
+    if (nIndex >= 0)
+        m_pRequests[nIndex].profitAndLoss = *pInsert;
+    pthread_mutex_unlock(&m_lock);
+    return nIndex >= 0 ? COS_REQUEST_BASE + nIndex : -1;
+}
+
+void CosManager::queueQueries()
+{
+    // zero ids select every order of the account
+    pthread_mutex_lock(&m_lock);
+    queue(COS_QUERY_CONDITIONAL);
+    queue(COS_QUERY_PROFIT_AND_LOSS);
+    pthread_mutex_unlock(&m_lock);
+}
+
+// caller holds the lock; requests may be queued before login, the account
+// is filled in when they are sent
+void CosManager::fillAccount(CosRequest *r) const
+{
+    switch (r->nType)
+    {
+    case COS_CONDITIONAL:
+        if (r->conditional.BrokerID[0] == '\0')
+            COPY_FIELD(r->conditional.BrokerID, m_chBrokerID);
+        if (r->conditional.InvestorID[0] == '\0')
+            COPY_FIELD(r->conditional.InvestorID, m_chInvestorID);
+        break;
+    case COS_PROFIT_AND_LOSS:
+        if (r->profitAndLoss.BrokerID[0] == '\0')
+            COPY_FIELD(r->profitAndLoss.BrokerID, m_chBrokerID);
+        if (r->profitAndLoss.InvestorID[0] == '\0')
+            COPY_FIELD(r->profitAndLoss.InvestorID, m_chInvestorID);
+        break;
+    case COS_QUERY_CONDITIONAL:
+        COPY_FIELD(r->queryConditional.BrokerID, m_chBrokerID);
+        COPY_FIELD(r->queryConditional.InvestorID, m_chInvestorID);
+        break;
+    case COS_QUERY_PROFIT_AND_LOSS:
+        COPY_FIELD(r->queryProfitAndLoss.BrokerID, m_chBrokerID);
+        COPY_FIELD(r->queryProfitAndLoss.InvestorID, m_chInvestorID);
+        break;
+    }
+}
+
+int CosManager::pump()
+{
+    int nSent = 0;
+    for (;;)
+    {
+        pthread_mutex_lock(&m_lock);
+        long long nNow = now_ms();
+        if (m_pCosApi == 0 || m_nSendCursor >= m_nRequests || nNow < m_nNextSendMs)
+        {
+            pthread_mutex_unlock(&m_lock);
+            return nSent;
+        }
+        int nIndex = m_nSendCursor++;
+        CosRequest r = m_pRequests[nIndex];
+        fillAccount(&r);
+        m_pRequests[nIndex].nState = COS_SENT;
+        m_nNextSendMs = nNow + m_nIntervalMs;
+        CKSCosApi *pCosApi = m_pCosApi;
+        pthread_mutex_unlock(&m_lock);
+
+        int nRet = -1;
+        switch (r.nType)
+        {
+        case COS_CONDITIONAL:
+            nRet = pCosApi->ReqInitInsertConditionalOrder(&r.conditional, r.nRequestID);
+            break;
+        case COS_PROFIT_AND_LOSS:
+            nRet = pCosApi->ReqInsertProfitAndLossOrder(&r.profitAndLoss, r.nRequestID);
+            break;
+        case COS_QUERY_CONDITIONAL:
+            nRet = pCosApi->ReqQueryConditionalOrder(&r.queryConditional, r.nRequestID);
+            break;
+        case COS_QUERY_PROFIT_AND_LOSS:
+            nRet = pCosApi->ReqQueryProfitAndLossOrder(&r.queryProfitAndLoss, r.nRequestID);
+            break;
+        }
+
+        if (nRet == 0)
+        {
+            nSent++;
+            continue;
+        }
+        pthread_mutex_lock(&m_lock);
+        if (nRet == COS_FLOW_OUTSTANDING || nRet == COS_FLOW_PER_SECOND)
+        {
+            // refused by flow control: back off one interval and retry it
+            m_pRequests[nIndex].nState = COS_QUEUED;
+            m_nSendCursor = nIndex;
+            m_nNextSendMs = now_ms() + m_nIntervalMs;
+            pthread_mutex_unlock(&m_lock);
+            return nSent;
+        }
+        m_pRequests[nIndex].nState = COS_SEND_FAILED;
+        m_pRequests[nIndex].nErrorID = nRet;
+        pthread_mutex_unlock(&m_lock);
+    }
+}
+
+// caller holds the lock; creates the entry on first sight
+CosOrder *CosManager::conditionalOf(int nConditionalOrderID, int nRequestID)
+{
+    int nIndex = find(m_pConditionalTable, ORDER_TABLE_SIZE, nConditionalOrderID);
+    if (nIndex < 0)
+    {
+        if (m_nConditionals >= MAX_COS_ORDERS)
+            return 0;
+        nIndex = m_nConditionals++;
+        memset(&m_pConditionals[nIndex], 0, sizeof(CosOrder));
+        m_pConditionals[nIndex].nConditionalOrderID = nConditionalOrderID;
+        m_pConditionals[nIndex].nRequestID = -1;
+        insert(m_pConditionalTable, ORDER_TABLE_SIZE, nConditionalOrderID, nIndex);
+    }
+    CosOrder *o = &m_pConditionals[nIndex];
+    if (nRequestID >= COS_REQUEST_BASE)
+        o->nRequestID = nRequestID;
+    return o;
+}
+
+PLOrder *CosManager::profitAndLossOf(int nProfitAndLossOrderID, int nRequestID)
+{
+    int nIndex = find(m_pProfitAndLossTable, ORDER_TABLE_SIZE, nProfitAndLossOrderID);
+    if (nIndex < 0)
+    {
+        if (m_nProfitAndLoss >= MAX_COS_ORDERS)
+            return 0;
+        nIndex = m_nProfitAndLoss++;
+        memset(&m_pProfitAndLoss[nIndex], 0, sizeof(PLOrder));
+        m_pProfitAndLoss[nIndex].nProfitAndLossOrderID = nProfitAndLossOrderID;
+        m_pProfitAndLoss[nIndex].nRequestID = -1;
+        insert(m_pProfitAndLossTable, ORDER_TABLE_SIZE, nProfitAndLossOrderID, nIndex);
+    }
+    PLOrder *o = &m_pProfitAndLoss[nIndex];
+    if (nRequestID >= COS_REQUEST_BASE)
+        o->nRequestID = nRequestID;
+    return o;
+}
+
+void CosManager::onRspConditional(const CKSConditionalOrderOperResultField *pResult, const CThostFtdcRspInfoField *pRspInfo, int nRequestID)
+{
+    int nErrorID = pRspInfo != NULL ? pRspInfo->ErrorID : 0;
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pRequestTable, REQUEST_TABLE_SIZE, nRequestID);
+    if (nIndex >= 0 && m_pRequests[nIndex].nType == COS_CONDITIONAL)
+    {
+        CosRequest &r = m_pRequests[nIndex];
+        r.nState = nErrorID != 0 ? COS_REJECTED : COS_ACCEPTED;
+        r.nErrorID = nErrorID;
+        if (pResult != NULL && nErrorID == 0)
+            r.nOrderID = pResult->ConditionalOrderID;
+    }
+    else if (nIndex >= 0 && m_pRequests[nIndex].nState == COS_SENT)
+    {
+        // query, its rows follow in the same chain
+        m_pRequests[nIndex].nState = nErrorID != 0 ? COS_REJECTED : COS_ACCEPTED;
+    }
+
+    CosOrder *o = pResult != NULL && nErrorID == 0 && pResult->ConditionalOrderID > 0
+        ? conditionalOf(pResult->ConditionalOrderID, nIndex >= 0 && m_pRequests[nIndex].nType == COS_CONDITIONAL ? nRequestID : -1) : 0;
+    if (o != 0)
+    {
+        COPY_FIELD(o->chInstrumentID, pResult->InstrumentID);
+        COPY_FIELD(o->chExchangeID, pResult->ExchangeID);
+        o->chDirection = pResult->Direction;
+        o->chOffsetFlag = pResult->CombOffsetFlag;
+        o->chHedgeFlag = pResult->CombHedgeFlag;
+        o->chStatus = pResult->ConditionalOrderStatus;
+        if (pResult->OrderStatus != '\0')
+            o->chOrderStatus = pResult->OrderStatus;
+        o->dLimitPrice = pResult->LimitPrice;
+        o->nVolumeOriginal = pResult->VolumeTotalOriginal;
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+void CosManager::onRspProfitAndLoss(const CKSProfitAndLossOrderOperResultField *pResult, const CThostFtdcRspInfoField *pRspInfo, int nRequestID)
+{
+    int nErrorID = pRspInfo != NULL ? pRspInfo->ErrorID : 0;
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pRequestTable, REQUEST_TABLE_SIZE, nRequestID);
+    if (nIndex >= 0 && m_pRequests[nIndex].nType == COS_PROFIT_AND_LOSS)
+    {
+        CosRequest &r = m_pRequests[nIndex];
+        r.nState = nErrorID != 0 ? COS_REJECTED : COS_ACCEPTED;
+        r.nErrorID = nErrorID;
+        if (pResult != NULL && nErrorID == 0)
+            r.nOrderID = pResult->ProfitAndLossOrderID;
+    }
+    else if (nIndex >= 0 && m_pRequests[nIndex].nState == COS_SENT)
+    {
+        m_pRequests[nIndex].nState = nErrorID != 0 ? COS_REJECTED : COS_ACCEPTED;
+    }
+
+    PLOrder *o = pResult != NULL && nErrorID == 0 && pResult->ProfitAndLossOrderID > 0
+        ? profitAndLossOf(pResult->ProfitAndLossOrderID, nIndex >= 0 && m_pRequests[nIndex].nType == COS_PROFIT_AND_LOSS ? nRequestID : -1) : 0;
+    if (o != 0)
+    {
+        COPY_FIELD(o->chInstrumentID, pResult->InstrumentID);
+        COPY_FIELD(o->chExchangeID, pResult->ExchangeID);
+        COPY_FIELD(o->chOrderLocalID, pResult->OrderLocalID);
+        o->chStatus = pResult->ProfitAndLossOrderStatus;
+        o->dStopLossPrice = pResult->StopLossPrice;
+        o->dTakeProfitPrice = pResult->TakeProfitPrice;
+        o->dOpenTradePrice = pResult->OpenTradePrice;
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+void CosManager::onRemovedConditional(int nConditionalOrderID)
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pConditionalTable, ORDER_TABLE_SIZE, nConditionalOrderID);
+    if (nIndex >= 0)
+        m_pConditionals[nIndex].chStatus = KSCOS_OrderStatus_Deleted;
+    pthread_mutex_unlock(&m_lock);
+}
+
+void CosManager::onRemovedProfitAndLoss(int nProfitAndLossOrderID)
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pProfitAndLossTable, ORDER_TABLE_SIZE, nProfitAndLossOrderID);
+    if (nIndex >= 0)
+        m_pProfitAndLoss[nIndex].chStatus = KSCOS_OrderStatus_Deleted;
+    pthread_mutex_unlock(&m_lock);
+}
+
+void CosManager::onRtnCOSStatus(const CKSCOSStatusField *pStatus)
+{
+    pthread_mutex_lock(&m_lock);
+    CosOrder *o = conditionalOf(pStatus->ConditionalOrderID, -1);
+    if (o != 0 && (o->nSequenceNo == 0 || pStatus->SequenceNo >= o->nSequenceNo))
+    {
+        o->nSequenceNo = pStatus->SequenceNo;
+        COPY_FIELD(o->chInstrumentID, pStatus->InstrumentID);
+        COPY_FIELD(o->chExchangeID, pStatus->ExchangeID);
+        COPY_FIELD(o->chOrderSysID, pStatus->OrderSysID);
+        o->chDirection = pStatus->Direction;
+        o->chOffsetFlag = pStatus->CombOffsetFlag;
+        o->chHedgeFlag = pStatus->CombHedgeFlag;
+        o->chStatus = pStatus->ConditionalOrderStatus;
+        o->chOrderStatus = pStatus->OrderStatus;
+        o->dLimitPrice = pStatus->LimitPrice;
+        o->nVolumeOriginal = pStatus->VolumeTotalOriginal;
+        o->nVolumeTraded = pStatus->VolumeTraded;
+        o->dTradePrice = pStatus->TradePrice;
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+void CosManager::onRtnPLStatus(const CKSPLStatusField *pStatus)
+{
+    pthread_mutex_lock(&m_lock);
+    PLOrder *o = profitAndLossOf(pStatus->ProfitAndLossOrderID, -1);
+    if (o != 0 && (o->nSequenceNo == 0 || pStatus->SequenceNo >= o->nSequenceNo))
+    {
+        o->nSequenceNo = pStatus->SequenceNo;
+        o->nStopLossOrderID = pStatus->StopLossOrderID;
+        o->nTakeProfitOrderID = pStatus->TakeProfitOrderID;
+        COPY_FIELD(o->chInstrumentID, pStatus->InstrumentID);
+        COPY_FIELD(o->chExchangeID, pStatus->ExchangeID);
+        COPY_FIELD(o->chOrderLocalID, pStatus->OrderLocalID);
+        o->chStatus = pStatus->ProfitAndLossOrderStatus;
+        o->chOrderStatus = pStatus->OrderStatus;
+        o->dStopLossPrice = pStatus->StopLossPrice;
+        o->dTakeProfitPrice = pStatus->TakeProfitPrice;
+        o->dOpenTradePrice = pStatus->OpenTradePrice;
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+bool CosManager::request(int nRequestID, CosRequest *pOut) const
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pRequestTable, REQUEST_TABLE_SIZE, nRequestID);
+    if (nIndex >= 0)
+        *pOut = m_pRequests[nIndex];
+    pthread_mutex_unlock(&m_lock);
+    return nIndex >= 0;
+}
+
+bool CosManager::conditional(int nConditionalOrderID, CosOrder *pOut) const
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pConditionalTable, ORDER_TABLE_SIZE, nConditionalOrderID);
+    if (nIndex >= 0)
+        *pOut = m_pConditionals[nIndex];
+    pthread_mutex_unlock(&m_lock);
+    return nIndex >= 0;
+}
+
+bool CosManager::profitAndLoss(int nProfitAndLossOrderID, PLOrder *pOut) const
+{
+    pthread_mutex_lock(&m_lock);
+    int nIndex = find(m_pProfitAndLossTable, ORDER_TABLE_SIZE, nProfitAndLossOrderID);
+    if (nIndex >= 0)
+        *pOut = m_pProfitAndLoss[nIndex];
+    pthread_mutex_unlock(&m_lock);
+    return nIndex >= 0;
+}
+
+int CosManager::queued() const
+{
+    pthread_mutex_lock(&m_lock);
+    int n = m_nRequests - m_nSendCursor;
+    pthread_mutex_unlock(&m_lock);
+    return n;
+}
+
+int CosManager::conditionalCount() const
+{
+    pthread_mutex_lock(&m_lock);
+    int n = m_nConditionals;
+    pthread_mutex_unlock(&m_lock);
+    return n;
+}
+
+int CosManager::profitAndLossCount() const
+{
+    pthread_mutex_lock(&m_lock);
+    int n = m_nProfitAndLoss;
+    pthread_mutex_unlock(&m_lock);
+    return n;
+}
@@ -0,0 +1,201 @@
+#ifndef __COS_MANAGER_H__
+#define __COS_MANAGER_H__
+
+#include "../CTP/KSCosApi.h"
+#include <pthread.h>
+
+using namespace KingstarAPI;
+
+// requests and mirrored orders kept for one trading day
+const int MAX_COS_REQUESTS = 4096;
+const int MAX_COS_ORDERS = 8192;
+// request ids of the conditional order service start here
+const int COS_REQUEST_BASE = 0x20000000;
+
+// CosRequest::nType
+enum
+{
+    COS_CONDITIONAL,
+    COS_PROFIT_AND_LOSS,
+    COS_QUERY_CONDITIONAL,
+    COS_QUERY_PROFIT_AND_LOSS
+};
+
+// CosRequest::nState
+enum
+{
+    // waiting for its turn under the flow limit
+    COS_QUEUED,
+    // passed to the api, no response yet
+    COS_SENT,
+    COS_ACCEPTED,
+    COS_REJECTED,
+    // the api refused it for a reason other than flow control
+    COS_SEND_FAILED
+};
+
+struct CosRequest
+{
+    int nRequestID;
+    int nType;
+    int nState;
+    // ConditionalOrderID or ProfitAndLossOrderID once accepted
+    int nOrderID;
+    int nErrorID;
+    union
+    {
+        CKSConditionalOrderInitInsert conditional;
+        CKSProfitAndLossOrderInsert profitAndLoss;
+        CKSConditionalOrderQuery queryConditional;
+        CKSProfitAndLossOrderQuery queryProfitAndLoss;
+    };
+};
+
+// mirror of one conditional order
+struct CosOrder
+{
+    int nConditionalOrderID;
+    // the request that created it, -1 when placed elsewhere
+    int nRequestID;
+    // of the last OnRtnCOSStatus applied, older ones are ignored
+    int nSequenceNo;
+    TThostFtdcInstrumentIDType chInstrumentID;
+    TThostFtdcExchangeIDType chExchangeID;
+    TThostFtdcOrderSysIDType chOrderSysID;
+    char chDirection;
+    char chOffsetFlag;
+    char chHedgeFlag;
+    // KSCOS_OrderStatus_x
+    char chStatus;
+    // THOST_FTDC_OST_x of the order it sent, '\0' before it triggered
+    char chOrderStatus;
+    double dLimitPrice;
+    int nVolumeOriginal;
+    int nVolumeTraded;
+    double dTradePrice;
+};
+
+// mirror of one stop-loss / take-profit order
+struct PLOrder
+{
+    int nProfitAndLossOrderID;
+    int nRequestID;
+    int nSequenceNo;
+    // the conditional orders carrying each leg
+    int nStopLossOrderID;
+    int nTakeProfitOrderID;
+    TThostFtdcInstrumentIDType chInstrumentID;
+    TThostFtdcExchangeIDType chExchangeID;
+    TThostFtdcOrderLocalIDType chOrderLocalID;
+    char chStatus;
+    char chOrderStatus;
+    double dStopLossPrice;
+    double dTakeProfitPrice;
+    double dOpenTradePrice;
+};
+
+// Bulk submission and state mirror for the broker's conditional order
+// service (CKSCosApi).
+//
+// queue*() append requests to a day-long pool; a sender thread passes them
+// to the api in order, at most nPerSecond a second, and requeues the ones
+// refused by flow control. Responses are matched back by nRequestID and
+// the orders they create are mirrored by ConditionalOrderID and
+// ProfitAndLossOrderID; OnRtnCOSStatus and OnRtnPLStatus keep the mirror
+// current, so after the initial queries nothing needs to be polled.
+//
+// Requests, responses and readers come from different threads (the caller,
+// the sender, the api callback thread). This is the control path, not the
+// tick path, so one mutex guards everything; api calls are made outside it.
+class CosManager
+{
+public:
+    CosManager();
+    ~CosManager();
+
+    // api of the logged in session and the account filled into requests
+    // that leave BrokerID/InvestorID empty; nothing is sent before this
+    void setApi(CKSCosApi *pCosApi, const char *pBrokerID, const char *pInvestorID);
+    void setFlowLimit(int nPerSecond);
+
+    // sender thread
+    bool start();
+    void stop();
+    bool started() const { return m_bRunning; }
+
+    // returns the request id, -1 when the pool is full
+    int queueConditional(const CKSConditionalOrderInitInsert *pInsert);
+    int queueProfitAndLoss(const CKSProfitAndLossOrderInsert *pInsert);
+    // every conditional and P&L order of the account, seeds the mirror;
+    // requests go out in pool order, so queue these before any order
+    void queueQueries();
+
+    // send what the flow limit allows now, returns the number sent; the
+    // sender thread calls it, call it directly only without start()
+    int pump();
+
+    // CKSCosSpi callbacks
+    void onRspConditional(const CKSConditionalOrderOperResultField *pResult, const CThostFtdcRspInfoField *pRspInfo, int nRequestID);
+    void onRspProfitAndLoss(const CKSProfitAndLossOrderOperResultField *pResult, const CThostFtdcRspInfoField *pRspInfo, int nRequestID);
+    void onRemovedConditional(int nConditionalOrderID);
+    void onRemovedProfitAndLoss(int nProfitAndLossOrderID);
+    void onRtnCOSStatus(const CKSCOSStatusField *pStatus);
+    void onRtnPLStatus(const CKSPLStatusField *pStatus);
+
+    // consistent copies, false when unknown
+    bool request(int nRequestID, CosRequest *pOut) const;
+    bool conditional(int nConditionalOrderID, CosOrder *pOut) const;
+    bool profitAndLoss(int nProfitAndLossOrderID, PLOrder *pOut) const;
+
+    int queued() const;
+    int conditionalCount() const;
+    int profitAndLossCount() const;
+
+private:
+    struct Bucket
+    {
+        int nKey;
+        int nIndex;
+    };
+
+    enum
+    {
+        REQUEST_TABLE_SIZE = MAX_COS_REQUESTS * 2,
+        ORDER_TABLE_SIZE = MAX_COS_ORDERS * 2
+    };
+
+    static int find(const Bucket *pTable, int nSize, int nKey);
+    static void insert(Bucket *pTable, int nSize, int nKey, int nIndex);
+    int queue(int nType);
+    void fillAccount(CosRequest *r) const;
+    CosOrder *conditionalOf(int nConditionalOrderID, int nRequestID);
+    PLOrder *profitAndLossOf(int nProfitAndLossOrderID, int nRequestID);
+    static void *sender_main(void *pArg);
+
+    mutable pthread_mutex_t m_lock;
+    CKSCosApi *m_pCosApi;
+    TThostFtdcBrokerIDType m_chBrokerID;
+    TThostFtdcInvestorIDType m_chInvestorID;
+
+    CosRequest *m_pRequests;
+    int m_nRequests;
+    // first request not yet sent; requests go out in pool order
+    int m_nSendCursor;
+    Bucket *m_pRequestTable;
+
+    CosOrder *m_pConditionals;
+    int m_nConditionals;
+    Bucket *m_pConditionalTable;
+    PLOrder *m_pProfitAndLoss;
+    int m_nProfitAndLoss;
+    Bucket *m_pProfitAndLossTable;
+
+    // flow limit: earliest time of the next send, ms
+    int m_nIntervalMs;
+    long long m_nNextSendMs;
+
+    pthread_t m_hThread;
+    bool m_bRunning;
+};
+
+#endif
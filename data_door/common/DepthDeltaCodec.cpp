@@ -0,0 +1,321 @@
+// DepthDeltaCodec.cpp : delta encoding of depth market data per instrument.
+//
+#include "DepthDeltaCodec.h"
+#include <stddef.h>
+#include <string.h>
+
+enum
+{
+    FIELD_DOUBLE,
+    FIELD_INT,
+    FIELD_STRING
+};
+
+struct DepthFieldDesc
+{
+    int nOffset;
+    int nType;
+    // buffer size for strings
+    int nSize;
+};
+
+#define DEPTH_FIELD(name, type) \
+    { (int)offsetof(CThostFtdcDepthMarketDataField, name), type, (int)sizeof(((CThostFtdcDepthMarketDataField *)0)->name) }
+
+// every field except InstrumentID, which keys the frame; at most 64 entries
+static const DepthFieldDesc s_fields[] =
+{
+    DEPTH_FIELD(TradingDay, FIELD_STRING),
+    DEPTH_FIELD(ExchangeID, FIELD_STRING),
+    DEPTH_FIELD(ExchangeInstID, FIELD_STRING),
+    DEPTH_FIELD(LastPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(PreSettlementPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(PreClosePrice, FIELD_DOUBLE),
+    DEPTH_FIELD(PreOpenInterest, FIELD_DOUBLE),
+    DEPTH_FIELD(OpenPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(HighestPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(LowestPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(Volume, FIELD_INT),
+    DEPTH_FIELD(Turnover, FIELD_DOUBLE),
+    DEPTH_FIELD(OpenInterest, FIELD_DOUBLE),
+    DEPTH_FIELD(ClosePrice, FIELD_DOUBLE),
+    DEPTH_FIELD(SettlementPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(UpperLimitPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(LowerLimitPrice, FIELD_DOUBLE),
+    DEPTH_FIELD(PreDelta, FIELD_DOUBLE),
+    DEPTH_FIELD(CurrDelta, FIELD_DOUBLE),
+    DEPTH_FIELD(UpdateTime, FIELD_STRING),
+    DEPTH_FIELD(UpdateMillisec, FIELD_INT),
+    DEPTH_FIELD(BidPrice1, FIELD_DOUBLE),
+    DEPTH_FIELD(BidVolume1, FIELD_INT),
+    DEPTH_FIELD(AskPrice1, FIELD_DOUBLE),
+    DEPTH_FIELD(AskVolume1, FIELD_INT),
+    DEPTH_FIELD(BidPrice2, FIELD_DOUBLE),
+    DEPTH_FIELD(BidVolume2, FIELD_INT),
+    DEPTH_FIELD(AskPrice2, FIELD_DOUBLE),
+    DEPTH_FIELD(AskVolume2, FIELD_INT),
+    DEPTH_FIELD(BidPrice3, FIELD_DOUBLE),
+    DEPTH_FIELD(BidVolume3, FIELD_INT),
+    DEPTH_FIELD(AskPrice3, FIELD_DOUBLE),
+    DEPTH_FIELD(AskVolume3, FIELD_INT),
+    DEPTH_FIELD(BidPrice4, FIELD_DOUBLE),
+    DEPTH_FIELD(BidVolume4, FIELD_INT),
+    DEPTH_FIELD(AskPrice4, FIELD_DOUBLE),
+    DEPTH_FIELD(AskVolume4, FIELD_INT),
+    DEPTH_FIELD(BidPrice5, FIELD_DOUBLE),
+    DEPTH_FIELD(BidVolume5, FIELD_INT),
+    DEPTH_FIELD(AskPrice5, FIELD_DOUBLE),
+    DEPTH_FIELD(AskVolume5, FIELD_INT),
+    DEPTH_FIELD(AveragePrice, FIELD_DOUBLE),
+    DEPTH_FIELD(ActionDay, FIELD_STRING)
+};
+
+static const int s_nFields = sizeof(s_fields) / sizeof(s_fields[0]);
+
+static int field_length(const DepthFieldDesc &f, const char *pField)
+{
+    if (f.nType == FIELD_DOUBLE)
+        return 8;
+    if (f.nType == FIELD_INT)
+        return 4;
+    return 1 + (int)strnlen(pField, f.nSize - 1);
+}
+
+// doubles are compared bitwise so NaN and DBL_MAX sentinels encode stably
+static bool field_equal(const DepthFieldDesc &f, const char *a, const char *b)
+{
+    if (f.nType == FIELD_STRING)
+        return strncmp(a, b, f.nSize) == 0;
+    return memcmp(a, b, f.nType == FIELD_DOUBLE ? 8 : 4) == 0;
+}
+
+DepthDeltaEncoder::DepthDeltaEncoder(int nSnapshotInterval) : m_nSnapshotInterval(nSnapshotInterval)
+{
+    m_pLast = new CThostFtdcDepthMarketDataField[MAX_INSTRUMENTS];
+    m_pSeq = new unsigned int[MAX_INSTRUMENTS];
+    m_pSinceSnapshot = new int[MAX_INSTRUMENTS];
+    memset(m_pLast, 0, sizeof(CThostFtdcDepthMarketDataField) * MAX_INSTRUMENTS);
+    memset(m_pSeq, 0, sizeof(unsigned int) * MAX_INSTRUMENTS);
+    requestSnapshot();
+}
+
+DepthDeltaEncoder::~DepthDeltaEncoder()
+{
+    delete[] m_pLast;
+    delete[] m_pSeq;
+    delete[] m_pSinceSnapshot;
+}
+
+void DepthDeltaEncoder::requestSnapshot()
+{
+    // -1 reads as "never sent", checked before the interval
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+        m_pSinceSnapshot[i] = -1;
+}
+
+int DepthDeltaEncoder::encode(const CThostFtdcDepthMarketDataField *pDepthMarketData, char *pBuf, int nBufSize)
+{
+    int nSlot = m_index.insert(pDepthMarketData->InstrumentID);
+    if (nSlot < 0)
+        return -1;
+
+    const char *pNew = (const char *)pDepthMarketData;
+    const char *pOld = (const char *)&m_pLast[nSlot];
+
+    bool bSnapshot = m_pSinceSnapshot[nSlot] < 0 || m_pSinceSnapshot[nSlot] >= m_nSnapshotInterval;
+
+    unsigned long long nMask = 0;
+    int nIdLength = (int)strnlen(pDepthMarketData->InstrumentID, sizeof(pDepthMarketData->InstrumentID) - 1);
+    int nLength = (int)sizeof(DepthDeltaHeader) + nIdLength;
+    for (int i = 0; i < s_nFields; i++)
+    {
+        const DepthFieldDesc &f = s_fields[i];
+        if (bSnapshot || !field_equal(f, pNew + f.nOffset, pOld + f.nOffset))
+        {
+            nMask |= 1ULL << i;
+            nLength += field_length(f, pNew + f.nOffset);
+        }
+    }
+    if (nLength > nBufSize)
+        return -1;
+
+    DepthDeltaHeader header;
+    header.cType = bSnapshot ? DEPTH_FRAME_SNAPSHOT : DEPTH_FRAME_UPDATE;
+    header.cIdLength = (unsigned char)nIdLength;
+    header.nLength = (unsigned short)nLength;
+    header.nSeq = ++m_pSeq[nSlot];
+    header.nMask = nMask;
+
+    char *p = pBuf;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, pDepthMarketData->InstrumentID, nIdLength);
+    p += nIdLength;
+
+    for (int i = 0; i < s_nFields; i++)
+    {
+        if (!(nMask & (1ULL << i)))
+            continue;
+        const DepthFieldDesc &f = s_fields[i];
+        const char *pField = pNew + f.nOffset;
+        if (f.nType == FIELD_STRING)
+        {
+            int n = field_length(f, pField) - 1;
+            *p++ = (char)n;
+            memcpy(p, pField, n);
+            p += n;
+        }
+        else
+        {
+            int n = f.nType == FIELD_DOUBLE ? 8 : 4;
+            memcpy(p, pField, n);
+            p += n;
+        }
+    }
+
+    memcpy(&m_pLast[nSlot], pDepthMarketData, sizeof(CThostFtdcDepthMarketDataField));
+    m_pSinceSnapshot[nSlot] = bSnapshot ? 1 : m_pSinceSnapshot[nSlot] + 1;
+
+    return nLength;
+}
+
+DepthDeltaDecoder::DepthDeltaDecoder()
+{
+    m_pBook = new CThostFtdcDepthMarketDataField[MAX_INSTRUMENTS];
+    m_pSeq = new unsigned int[MAX_INSTRUMENTS];
+    m_pValid = new bool[MAX_INSTRUMENTS];
+    memset(m_pBook, 0, sizeof(CThostFtdcDepthMarketDataField) * MAX_INSTRUMENTS);
+    memset(m_pSeq, 0, sizeof(unsigned int) * MAX_INSTRUMENTS);
+    memset(m_pValid, 0, sizeof(bool) * MAX_INSTRUMENTS);
+}
+
+DepthDeltaDecoder::~DepthDeltaDecoder()
+{
+    delete[] m_pBook;
+    delete[] m_pSeq;
+    delete[] m_pValid;
+}
+
+int DepthDeltaDecoder::decode(const char *pBuf, int nLen, CThostFtdcDepthMarketDataField *pDepthMarketData, int *pnConsumed)
+{
+    DepthDeltaHeader header;
+    if (nLen < (int)sizeof(header))
+        return -1;
+    memcpy(&header, pBuf, sizeof(header));
+    *pnConsumed = header.nLength;
+
+    if (header.nLength > nLen || header.cIdLength >= sizeof(TThostFtdcInstrumentIDType)
+        || (int)sizeof(header) + header.cIdLength > header.nLength)
+        return -1;
+
+    TThostFtdcInstrumentIDType chInstrumentID;
+    memset(chInstrumentID, 0, sizeof(chInstrumentID));
+    memcpy(chInstrumentID, pBuf + sizeof(header), header.cIdLength);
+
+    int nSlot = m_index.insert(chInstrumentID);
+    if (nSlot < 0)
+        return -1;
+
+    bool bSnapshot = header.cType == DEPTH_FRAME_SNAPSHOT;
+    if (!bSnapshot && (!m_pValid[nSlot] || header.nSeq != m_pSeq[nSlot] + 1))
+    {
+        // lost a frame, the book is unreliable until the next snapshot
+        m_pValid[nSlot] = false;
+        return 1;
+    }
+
+    // apply onto a copy so a truncated frame leaves the book untouched
+    CThostFtdcDepthMarketDataField book;
+    if (bSnapshot)
+    {
+        memset(&book, 0, sizeof(book));
+        strcpy(book.InstrumentID, chInstrumentID);
+    }
+    else
+    {
+        memcpy(&book, &m_pBook[nSlot], sizeof(book));
+    }
+
+    const char *p = pBuf + sizeof(header) + header.cIdLength;
+    const char *pEnd = pBuf + header.nLength;
+    char *pDst = (char *)&book;
+    for (int i = 0; i < s_nFields; i++)
+    {
+        if (!(header.nMask & (1ULL << i)))
+            continue;
+        const DepthFieldDesc &f = s_fields[i];
+        if (f.nType == FIELD_STRING)
+        {
+            if (p >= pEnd)
+                return -1;
+            int n = (unsigned char)*p++;
+            if (n >= f.nSize || p + n > pEnd)
+                return -1;
+            memset(pDst + f.nOffset, 0, f.nSize);
+            memcpy(pDst + f.nOffset, p, n);
+            p += n;
+        }
+        else
+        {
+            int n = f.nType == FIELD_DOUBLE ? 8 : 4;
+            if (p + n > pEnd)
+                return -1;
+            memcpy(pDst + f.nOffset, p, n);
+            p += n;
+        }
+    }
+
+    memcpy(&m_pBook[nSlot], &book, sizeof(book));
+    m_pSeq[nSlot] = header.nSeq;
+    m_pValid[nSlot] = true;
+    memcpy(pDepthMarketData, &book, sizeof(book));
+    return 0;
+}
+
+const CThostFtdcDepthMarketDataField *DepthDeltaDecoder::book(const char *pInstrumentID) const
+{
+    int nSlot = m_index.find(pInstrumentID);
+    if (nSlot < 0 || !m_pValid[nSlot])
+        return NULL;
+    return &m_pBook[nSlot];
+}
+
+int depth_delta_to_hex(const char *pFrame, int nLen, char *pHex, int nHexSize)
+{
+    static const char s_digits[] = "0123456789abcdef";
+    if (nLen * 2 + 1 > nHexSize)
+        return -1;
+    for (int i = 0; i < nLen; i++)
+    {
+        pHex[2 * i] = s_digits[(unsigned char)pFrame[i] >> 4];
+        pHex[2 * i + 1] = s_digits[(unsigned char)pFrame[i] & 0x0f];
+    }
+    pHex[nLen * 2] = '\0';
+    return nLen * 2;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+int depth_delta_from_hex(const char *pHex, int nHexLen, char *pFrame, int nFrameSize)
+{
+    if ((nHexLen & 1) || nHexLen / 2 > nFrameSize)
+        return -1;
+    for (int i = 0; i < nHexLen / 2; i++)
+    {
+        int hi = hex_value(pHex[2 * i]);
+        int lo = hex_value(pHex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return -1;
+        pFrame[i] = (char)((hi << 4) | lo);
+    }
+    return nHexLen / 2;
+}
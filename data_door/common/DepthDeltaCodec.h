@@ -0,0 +1,96 @@
+#ifndef __DEPTH_DELTA_CODEC_H__
+#define __DEPTH_DELTA_CODEC_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "InstrumentIndex.h"
+
+using namespace KingstarAPI;
+
+// Delta encoding of CThostFtdcDepthMarketDataField keyed by instrument.
+//
+// Each frame carries a 64 bit mask of the fields present followed by their
+// values in field table order. An update frame only carries the fields that
+// changed since the previous frame of the same instrument; a snapshot frame
+// carries all of them and is sent on first sight of an instrument, every
+// nSnapshotInterval updates after that and whenever requestSnapshot() is
+// called, so a receiver that joins late is complete after one interval.
+//
+// frame layout (host byte order, unaligned):
+//   DepthDeltaHeader | InstrumentID bytes | values of the masked fields
+// doubles are 8 bytes, ints 4 bytes, strings a length byte plus the bytes.
+
+enum
+{
+    DEPTH_FRAME_SNAPSHOT = 1,
+    DEPTH_FRAME_UPDATE = 2
+};
+
+// room for a snapshot with every string field filled
+const int DEPTH_DELTA_MAX_FRAME = 512;
+
+#pragma pack(push, 1)
+struct DepthDeltaHeader
+{
+    // DEPTH_FRAME_SNAPSHOT or DEPTH_FRAME_UPDATE
+    unsigned char cType;
+    // length of the InstrumentID following the header
+    unsigned char cIdLength;
+    // whole frame length including this header
+    unsigned short nLength;
+    // per instrument frame number, consecutive between snapshots
+    unsigned int nSeq;
+    // bit i set when field i of the field table is present
+    unsigned long long nMask;
+};
+#pragma pack(pop)
+
+class DepthDeltaEncoder
+{
+public:
+    DepthDeltaEncoder(int nSnapshotInterval = 100);
+    ~DepthDeltaEncoder();
+
+    // encode one tick into pBuf, returns the frame length or -1 when the
+    // instrument table is full or pBuf is too small
+    int encode(const CThostFtdcDepthMarketDataField *pDepthMarketData, char *pBuf, int nBufSize);
+
+    // make the next frame of every instrument a snapshot
+    void requestSnapshot();
+
+private:
+    int m_nSnapshotInterval;
+    InstrumentIndex m_index;
+    // previous tick, frame counter and frames since snapshot per slot
+    CThostFtdcDepthMarketDataField *m_pLast;
+    unsigned int *m_pSeq;
+    int *m_pSinceSnapshot;
+};
+
+class DepthDeltaDecoder
+{
+public:
+    DepthDeltaDecoder();
+    ~DepthDeltaDecoder();
+
+    // rebuild the full tick from one frame.
+    // return value 0: pDepthMarketData filled
+    //              1: update skipped, waiting for a snapshot of the instrument
+    //             -1: malformed frame
+    // *pnConsumed is set to the frame length whenever the header was readable
+    int decode(const char *pBuf, int nLen, CThostFtdcDepthMarketDataField *pDepthMarketData, int *pnConsumed);
+
+    // last rebuilt tick of an instrument, NULL when no snapshot seen yet
+    const CThostFtdcDepthMarketDataField *book(const char *pInstrumentID) const;
+
+private:
+    InstrumentIndex m_index;
+    CThostFtdcDepthMarketDataField *m_pBook;
+    unsigned int *m_pSeq;
+    bool *m_pValid;
+};
+
+// frames are carried as hex text on the line based FCMESSAGE protocol
+int depth_delta_to_hex(const char *pFrame, int nLen, char *pHex, int nHexSize);
+int depth_delta_from_hex(const char *pHex, int nHexLen, char *pFrame, int nFrameSize);
+
+#endif
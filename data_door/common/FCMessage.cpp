@@ -0,0 +1,113 @@
+// FCMessage.cpp : in place parsing of FCMESSAGE protocol lines.
+//
+#include "FCMessage.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *s_typeNames[FCMESSAGE_TYPE_COUNT] =
+{
+    "",
+    "FCMESSAGE_TYPE_INSTRUMENT",
+    "FCMESSAGE_TYPE_MARKET",
+    "FCMESSAGE_TYPE_MARKET_DELTA",
+    "FCMESSAGE_TYPE_ORDER",
+    "FCMESSAGE_TYPE_TRADE",
+    "FCMESSAGE_TYPE_OPTION_SURFACE",
+    "FCMESSAGE_TYPE_FOR_QUOTE",
+    "FCQUERY_ALL_INSTRUMENTS",
+    "FCQUERY_LAST_MARKET"
+};
+
+int FCMessage::typeOf(const char *p, int nLength)
+{
+    // the names are long and share prefixes: compare the length first
+    for (int i = 1; i < FCMESSAGE_TYPE_COUNT; i++)
+    {
+        if ((int)strlen(s_typeNames[i]) == nLength && memcmp(s_typeNames[i], p, nLength) == 0)
+            return i;
+    }
+    return FCMESSAGE_INVALID;
+}
+
+const char *FCMessage::typeName(int nType)
+{
+    return nType > FCMESSAGE_INVALID && nType < FCMESSAGE_TYPE_COUNT ? s_typeNames[nType] : "invalid";
+}
+
+bool FCMessage::parse(const char *pLine, int nLength)
+{
+    // tolerate the CR of clients ending lines with "\r\n"
+    if (nLength > 0 && pLine[nLength - 1] == '\r')
+        nLength--;
+    this->pLine = pLine;
+    this->nLength = nLength;
+    nFields = 0;
+
+    const char *p = pLine;
+    const char *pEnd = pLine + nLength;
+    while (p < pEnd && nFields < FCMESSAGE_MAX_FIELDS)
+    {
+        const char *pBar = (const char *)memchr(p, '|', pEnd - p);
+        if (pBar == NULL)
+            pBar = pEnd;
+        pField[nFields] = p;
+        nFieldLength[nFields] = pBar - p;
+        nFields++;
+        p = pBar + 1;
+    }
+
+    nType = nFields > 0 ? typeOf(pField[0], nFieldLength[0]) : FCMESSAGE_INVALID;
+    return nType != FCMESSAGE_INVALID;
+}
+
+const char *FCMessage::field(int n, char *pBuf, int nSize) const
+{
+    pBuf[0] = '\0';
+    if (n < nFields && nFieldLength[n] < nSize)
+    {
+        memcpy(pBuf, pField[n], nFieldLength[n]);
+        pBuf[nFieldLength[n]] = '\0';
+    }
+    return pBuf;
+}
+
+int FCMessage::instrumentField() const
+{
+    switch (nType)
+    {
+    case FCMESSAGE_INSTRUMENT:
+    case FCMESSAGE_MARKET:
+        return 2;
+    case FCMESSAGE_OPTION_SURFACE:
+    case FCMESSAGE_FOR_QUOTE:
+    case FCQUERY_LAST_MARKET:
+        return 1;
+    default:
+        return -1;
+    }
+}
+
+int fc_format_market(const CThostFtdcDepthMarketDataField *p, char *pBuf, int nSize)
+{
+    int n = snprintf(pBuf, nSize, "%s|%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+        "FCMESSAGE_TYPE_MARKET", p->ExchangeID, p->InstrumentID, p->PreClosePrice, p->OpenPrice, p->HighestPrice,
+        p->LowestPrice, p->LastPrice, p->Volume, p->Turnover, p->BidPrice1, p->AskPrice1, p->BidVolume1, p->AskVolume1,
+        p->UpperLimitPrice, p->LowerLimitPrice, p->PreSettlementPrice, p->SettlementPrice, p->OpenInterest, p->TradingDay,
+        p->BidVolume2, p->BidPrice2, p->BidVolume3, p->BidPrice3, p->BidVolume4, p->BidPrice4, p->BidVolume5, p->BidPrice5,
+        p->AskVolume2, p->AskPrice2, p->AskVolume3, p->AskPrice3, p->AskVolume4, p->AskPrice4, p->AskVolume5, p->AskPrice5);
+    return n >= 0 && n < nSize ? n : -1;
+}
+
+int fc_append_fields(const FCMessage &msg, int nFrom, char *pBuf, int nSize)
+{
+    int n = 0;
+    for (int i = nFrom; i < msg.nFields; i++)
+    {
+        if (n + msg.nFieldLength[i] + 1 > nSize)
+            return -1;
+        memcpy(pBuf + n, msg.pField[i], msg.nFieldLength[i]);
+        n += msg.nFieldLength[i];
+        pBuf[n++] = '|';
+    }
+    return n;
+}
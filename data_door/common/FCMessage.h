@@ -0,0 +1,84 @@
+#ifndef __FC_MESSAGE_H__
+#define __FC_MESSAGE_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+
+using namespace KingstarAPI;
+
+// line types of the port 9999 protocol, FCMessage::typeName() gives the
+// wire name
+enum
+{
+    FCMESSAGE_INVALID,
+    FCMESSAGE_INSTRUMENT,
+    FCMESSAGE_MARKET,
+    FCMESSAGE_MARKET_DELTA,
+    FCMESSAGE_ORDER,
+    FCMESSAGE_TRADE,
+    FCMESSAGE_OPTION_SURFACE,
+    FCMESSAGE_FOR_QUOTE,
+    FCQUERY_ALL_INSTRUMENTS,
+    FCQUERY_LAST_MARKET,
+    FCMESSAGE_TYPE_COUNT
+};
+
+// fields kept per line, a MARKET line has 37
+const int FCMESSAGE_MAX_FIELDS = 48;
+
+// reply of the Java listener to a line it could not classify
+#define FCMESSAGE_NO_UUID "NO_UUID"
+
+// One line of the FCMESSAGE protocol, split in place.
+//
+// A line is '|' separated with the type first:
+//   FCMESSAGE_TYPE_INSTRUMENT|ExchangeID|InstrumentID|InstrumentName|...|
+//   FCMESSAGE_TYPE_MARKET|ExchangeID|InstrumentID|PreClosePrice|...|
+//   FCMESSAGE_TYPE_MARKET_DELTA|<hex DepthDeltaCodec frame>
+// either market line may carry the servant's indicators after the tick,
+// IndicatorEngine's "ema|vwap|volatility|imbalance|microprice|":
+//   FCMESSAGE_TYPE_MARKET|...|AskPrice5|ema|vwap|...|
+//   FCMESSAGE_TYPE_MARKET_DELTA|<hex>|ema|vwap|...|
+// the option volatilities and greeks of one underlying and expiry, see
+// OptionSurface::format():
+//   FCMESSAGE_TYPE_OPTION_SURFACE|UnderlyingID|ExpireDate|forward|years|
+//   count|OptionID:vol:delta:gamma:vega:theta|...|
+// a request for quote from the exchange, as OnRtnForQuoteRsp has it:
+//   FCMESSAGE_TYPE_FOR_QUOTE|InstrumentID|ForQuoteSysID|ForQuoteTime|
+//   TradingDay|ActionDay|
+//   FCQUERY_ALL_INSTRUMENTS
+//   FCQUERY_LAST_MARKET|InstrumentID
+// parse() neither copies nor allocates: the fields point into the caller's
+// line, which must outlive the message. The empty field after a trailing
+// '|' is dropped, fields past FCMESSAGE_MAX_FIELDS are ignored.
+struct FCMessage
+{
+    int nType;
+    const char *pLine;
+    int nLength;
+    int nFields;
+    const char *pField[FCMESSAGE_MAX_FIELDS];
+    int nFieldLength[FCMESSAGE_MAX_FIELDS];
+
+    // false, with nType FCMESSAGE_INVALID, for an unknown type
+    bool parse(const char *pLine, int nLength);
+
+    // field n copied NUL terminated into pBuf, "" when absent or too long
+    const char *field(int n, char *pBuf, int nSize) const;
+
+    // the InstrumentID field, -1 for the types without one
+    int instrumentField() const;
+
+    static int typeOf(const char *p, int nLength);
+    static const char *typeName(int nType);
+};
+
+// the FCMESSAGE_TYPE_MARKET line of a tick, as the servants publish it,
+// without the newline; returns the length or -1 when pBuf is too small
+int fc_format_market(const CThostFtdcDepthMarketDataField *pDepthMarketData, char *pBuf, int nSize);
+
+// the fields of msg from nFrom on, each with its '|', e.g. the indicators
+// of a MARKET_DELTA line behind its fc_format_market() form; returns the
+// length, 0 when there are none, or -1 when pBuf is too small
+int fc_append_fields(const FCMessage &msg, int nFrom, char *pBuf, int nSize);
+
+#endif
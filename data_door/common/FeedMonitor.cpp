@@ -0,0 +1,323 @@
+// FeedMonitor.cpp : per instrument staleness, gaps, rate and latency of
+// the market data feed.
+//
+#include "FeedMonitor.h"
+#include "LatencyStats.h"
+#include "ThreadTopology.h"
+#include "AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+// upper bounds of the latency buckets but the last, in milliseconds
+static const int s_nBounds[FEED_LATENCY_BUCKETS - 1] = { 0, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+static const char *s_bucketNames[FEED_LATENCY_BUCKETS] =
+{
+    "<0", "<1", "<2", "<5", "<10", "<20", "<50", "<100", "<200", "<500", "<1000", "<2000", "<5000", ">=5000"
+};
+
+static const double DAY_MS = 24 * 3600 * 1000.0;
+
+FeedMonitor::FeedMonitor(const InstrumentIndex *pIndex) : m_pIndex(pIndex), m_nKnown(0), m_dFeedRate(0), m_nTicking(0), m_nStale(0),
+    m_bSilent(false), m_bLagging(false), m_nAlerts(0), m_nLastScanTsc(0), m_nNewestTsc(0), m_nStaleMs(FEED_STALE_MS),
+    m_nSilentMs(FEED_SILENT_MS), m_nLagMs(0), m_nScanMs(FEED_SCAN_MS), m_nProducts(0), m_bStop(false), m_bRunning(false)
+{
+    m_pExchangeMs = new int[MAX_INSTRUMENTS];
+    m_pRecvTsc = new unsigned long long[MAX_INSTRUMENTS];
+    m_pTicks = new unsigned long long[MAX_INSTRUMENTS];
+    m_pSeen = new unsigned long long[MAX_INSTRUMENTS];
+    m_pRate = new double[MAX_INSTRUMENTS];
+    m_pStaleMs = new int[MAX_INSTRUMENTS];
+    m_pIsStale = new bool[MAX_INSTRUMENTS];
+    m_pAgeMs = new int[MAX_INSTRUMENTS];
+    m_pLatencyMs = new int[MAX_INSTRUMENTS];
+    m_pGaps = new int[MAX_INSTRUMENTS];
+    m_pMaxGapMs = new int[MAX_INSTRUMENTS];
+    m_pLatency = new unsigned int[MAX_INSTRUMENTS * FEED_LATENCY_BUCKETS];
+    memset(m_pExchangeMs, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pRecvTsc, 0, sizeof(unsigned long long) * MAX_INSTRUMENTS);
+    memset(m_pTicks, 0, sizeof(unsigned long long) * MAX_INSTRUMENTS);
+    memset(m_pSeen, 0, sizeof(unsigned long long) * MAX_INSTRUMENTS);
+    memset(m_pRate, 0, sizeof(double) * MAX_INSTRUMENTS);
+    memset(m_pStaleMs, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pIsStale, 0, sizeof(bool) * MAX_INSTRUMENTS);
+    memset(m_pAgeMs, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pLatencyMs, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pGaps, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pMaxGapMs, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pLatency, 0, sizeof(unsigned int) * MAX_INSTRUMENTS * FEED_LATENCY_BUCKETS);
+    memset(m_nFeedLatency, 0, sizeof(m_nFeedLatency));
+    pthread_mutex_init(&m_lock, NULL);
+}
+
+FeedMonitor::~FeedMonitor()
+{
+    // the reporter first: once the section is cleared it is out of
+    // format() and cannot enter it again
+    LatencyStats::setReportSection(NULL, NULL);
+    stop();
+    pthread_mutex_destroy(&m_lock);
+    delete[] m_pExchangeMs;
+    delete[] m_pRecvTsc;
+    delete[] m_pTicks;
+    delete[] m_pSeen;
+    delete[] m_pRate;
+    delete[] m_pStaleMs;
+    delete[] m_pIsStale;
+    delete[] m_pAgeMs;
+    delete[] m_pLatencyMs;
+    delete[] m_pGaps;
+    delete[] m_pMaxGapMs;
+    delete[] m_pLatency;
+}
+
+void FeedMonitor::setThresholds(int nStaleMs, int nSilentMs, int nLagMs)
+{
+    m_nStaleMs = nStaleMs > 0 ? nStaleMs : FEED_STALE_MS;
+    m_nSilentMs = nSilentMs > 0 ? nSilentMs : FEED_SILENT_MS;
+    m_nLagMs = nLagMs > 0 ? nLagMs : 0;
+}
+
+bool FeedMonitor::setProducts(const char *pList)
+{
+    const char *p = pList;
+    while (*p != '\0')
+    {
+        size_t nItem = strcspn(p, ",");
+        size_t nLetters = 0;
+        while (nLetters < nItem && isalpha((unsigned char)p[nLetters]))
+            nLetters++;
+        char *pEnd = NULL;
+        long nMs = nLetters < nItem && p[nLetters] == ':' ? strtol(p + nLetters + 1, &pEnd, 10) : 0;
+        if (m_nProducts >= FEED_MAX_PRODUCTS || nLetters == 0 || nLetters >= sizeof(m_chProducts[0]) || nMs <= 0 ||
+            pEnd != p + nItem)
+            return false;
+        memcpy(m_chProducts[m_nProducts], p, nLetters);
+        m_chProducts[m_nProducts][nLetters] = '\0';
+        m_nProductMs[m_nProducts] = (int)nMs;
+        m_nProducts++;
+        p += p[nItem] == ',' ? nItem + 1 : nItem;
+    }
+    return true;
+}
+
+int FeedMonitor::thresholdOf(const char *pInstrumentID) const
+{
+    size_t nLen = 0;
+    while (isalpha((unsigned char)pInstrumentID[nLen]))
+        nLen++;
+    for (int i = 0; i < m_nProducts; i++)
+    {
+        if (strlen(m_chProducts[i]) == nLen && strncasecmp(m_chProducts[i], pInstrumentID, nLen) == 0)
+            return m_nProductMs[i];
+    }
+    return m_nStaleMs;
+}
+
+void FeedMonitor::sample(int nSlot, int nLatencyMs)
+{
+    int b = 0;
+    while (b < FEED_LATENCY_BUCKETS - 1 && nLatencyMs >= s_nBounds[b])
+        b++;
+    m_pLatency[nSlot * FEED_LATENCY_BUCKETS + b]++;
+    m_nFeedLatency[b]++;
+    m_pLatencyMs[nSlot] = nLatencyMs;
+}
+
+void FeedMonitor::scan()
+{
+    pthread_mutex_lock(&m_lock);
+    unsigned long long nNow = latency_now();
+    double dMsPerCycle = LatencyStats::nsPerCycle() / 1e6;
+    // local time of day, the clock UpdateTime is compared with
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm now;
+    localtime_r(&ts.tv_sec, &now);
+    double dNowMs = (now.tm_hour * 3600 + now.tm_min * 60 + now.tm_sec) * 1000.0 + ts.tv_nsec / 1e6;
+    double dElapsedMs = m_nLastScanTsc != 0 ? (nNow - m_nLastScanTsc) * dMsPerCycle : 0;
+    double dAlpha = dElapsedMs > 0 ? 1 - exp(-dElapsedMs / FEED_RATE_TAU_MS) : 0;
+    m_nLastScanTsc = nNow;
+
+    int nCount = m_pIndex->count();
+    for (; m_nKnown < nCount; m_nKnown++)
+        m_pStaleMs[m_nKnown] = thresholdOf(m_pIndex->name(m_nKnown));
+
+    unsigned long long nNewTotal = 0;
+    int nTicking = 0, nStale = 0, nSampled = 0, nLagged = 0;
+    for (int s = 0; s < nCount; s++)
+    {
+        unsigned long long nTicks = __atomic_load_n(&m_pTicks[s], __ATOMIC_ACQUIRE);
+        unsigned long long nNew = nTicks - m_pSeen[s];
+        m_pSeen[s] = nTicks;
+        nNewTotal += nNew;
+        if (dElapsedMs > 0)
+            m_pRate[s] += dAlpha * (nNew * 1000.0 / dElapsedMs - m_pRate[s]);
+        if (nTicks == 0)
+            continue;
+        // a tick after nNow was read is 0 ms old
+        unsigned long long nRecv = m_pRecvTsc[s];
+        double dAgeMs = nNow > nRecv ? (nNow - nRecv) * dMsPerCycle : 0;
+        if (nRecv > m_nNewestTsc)
+            m_nNewestTsc = nRecv;
+        if (nNew > 0)
+        {
+            int nExchangeMs = m_pExchangeMs[s];
+            if (nExchangeMs >= 0)
+            {
+                double dLatency = dNowMs - dAgeMs - nExchangeMs;
+                // either side of midnight
+                if (dLatency < -DAY_MS / 2)
+                    dLatency += DAY_MS;
+                else if (dLatency > DAY_MS / 2)
+                    dLatency -= DAY_MS;
+                sample(s, (int)floor(dLatency));
+                nSampled++;
+                if (m_nLagMs > 0 && dLatency > m_nLagMs)
+                    nLagged++;
+            }
+            // the silence this tick ended, as of the last scan
+            if (m_pAgeMs[s] > m_pMaxGapMs[s])
+                m_pMaxGapMs[s] = m_pAgeMs[s];
+            if (m_pIsStale[s])
+            {
+                m_pIsStale[s] = false;
+                m_pGaps[s]++;
+                FC_LOG(LOG_LEVEL_INFO, "%s ticking again after %d ms\n", m_pIndex->name(s), m_pAgeMs[s]);
+            }
+        }
+        // stale only while the others kept ticking past its threshold
+        else if (!m_pIsStale[s] && dAgeMs > m_pStaleMs[s] && (m_nNewestTsc - nRecv) * dMsPerCycle > m_pStaleMs[s])
+        {
+            m_pIsStale[s] = true;
+            m_nAlerts++;
+            FC_LOG(LOG_LEVEL_WARN, "%s stale: no tick for %.0f ms while the feed ticks\n", m_pIndex->name(s), dAgeMs);
+        }
+        m_pAgeMs[s] = (int)dAgeMs;
+        if (m_pIsStale[s])
+            nStale++;
+        else if (dAgeMs <= m_pStaleMs[s])
+            nTicking++;
+    }
+    if (dElapsedMs > 0)
+        m_dFeedRate += dAlpha * (nNewTotal * 1000.0 / dElapsedMs - m_dFeedRate);
+    m_nTicking = nTicking;
+    m_nStale = nStale;
+
+    double dSilentMs = m_nNewestTsc != 0 && nNow > m_nNewestTsc ? (nNow - m_nNewestTsc) * dMsPerCycle : 0;
+    if (!m_bSilent && dSilentMs > m_nSilentMs)
+    {
+        m_bSilent = true;
+        m_nAlerts++;
+        FC_LOG(LOG_LEVEL_WARN, "feed silent: no tick for %.0f ms\n", dSilentMs);
+    }
+    else if (m_bSilent && dSilentMs <= m_nSilentMs)
+    {
+        m_bSilent = false;
+        FC_LOG(LOG_LEVEL_INFO, "feed ticking again\n");
+    }
+    if (m_nLagMs > 0 && nSampled > 0)
+    {
+        bool bLagging = 2 * nLagged > nSampled;
+        if (bLagging && !m_bLagging)
+        {
+            m_nAlerts++;
+            FC_LOG(LOG_LEVEL_WARN, "feed lagging: %d of %d instruments more than %d ms behind the exchange\n", nLagged, nSampled, m_nLagMs);
+        }
+        else if (!bLagging && m_bLagging)
+            FC_LOG(LOG_LEVEL_INFO, "feed no longer lagging\n");
+        m_bLagging = bLagging;
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+// the bucket holding quantile q of n samples
+static int bucket_quantile(const unsigned int *pCounts, unsigned long long n, double q)
+{
+    unsigned long long nRank = (unsigned long long)ceil(q * n);
+    unsigned long long nSeen = 0;
+    for (int b = 0; b < FEED_LATENCY_BUCKETS; b++)
+    {
+        nSeen += pCounts[b];
+        if (nSeen >= nRank && nSeen > 0)
+            return b;
+    }
+    return FEED_LATENCY_BUCKETS - 1;
+}
+
+int FeedMonitor::format(char *pBuf, int nSize, bool bDetail)
+{
+    pthread_mutex_lock(&m_lock);
+    int nCount = m_nKnown;
+    int nLen = snprintf(pBuf, nSize, "feed: %d instruments, %d ticking, %d stale, %llu alerts, %.1f ticks/s%s%s\nfeed latency ms:",
+                        nCount, m_nTicking, m_nStale, m_nAlerts, m_dFeedRate, m_bSilent ? ", silent" : "", m_bLagging ? ", lagging" : "");
+    for (int b = 0; b < FEED_LATENCY_BUCKETS && nLen < nSize; b++)
+        nLen += snprintf(pBuf + nLen, nSize - nLen, " %s:%llu", s_bucketNames[b], m_nFeedLatency[b]);
+    if (nLen < nSize)
+        nLen += snprintf(pBuf + nLen, nSize - nLen, "\n");
+    if (bDetail && nLen < nSize)
+    {
+        nLen += snprintf(pBuf + nLen, nSize - nLen, "%-16s %10s %8s %10s %10s %7s %7s %5s %10s  state\n", "instrument", "ticks",
+                         "rate/s", "age_ms", "latency_ms", "p50", "p99", "gaps", "max_gap_ms");
+        unsigned long long nNow = latency_now();
+        double dMsPerCycle = LatencyStats::nsPerCycle() / 1e6;
+        for (int s = 0; s < nCount && nLen < nSize; s++)
+        {
+            const unsigned int *pCounts = &m_pLatency[s * FEED_LATENCY_BUCKETS];
+            unsigned long long nSamples = 0;
+            for (int b = 0; b < FEED_LATENCY_BUCKETS; b++)
+                nSamples += pCounts[b];
+            unsigned long long nTicks = m_pSeen[s];
+            unsigned long long nRecv = m_pRecvTsc[s];
+            double dAgeMs = nTicks > 0 && nNow > nRecv ? (nNow - nRecv) * dMsPerCycle : 0;
+            nLen += snprintf(pBuf + nLen, nSize - nLen, "%-16s %10llu %8.2f %10.0f %10d %7s %7s %5d %10d  %s\n", m_pIndex->name(s), nTicks,
+                             m_pRate[s], dAgeMs, m_pLatencyMs[s], nSamples > 0 ? s_bucketNames[bucket_quantile(pCounts, nSamples, 0.5)] : "-",
+                             nSamples > 0 ? s_bucketNames[bucket_quantile(pCounts, nSamples, 0.99)] : "-", m_pGaps[s], m_pMaxGapMs[s],
+                             nTicks == 0 ? "none" : m_pIsStale[s] ? "stale" : "ok");
+        }
+    }
+    pthread_mutex_unlock(&m_lock);
+    return nLen < nSize ? nLen : nSize - 1;
+}
+
+int FeedMonitor::reportSection(char *pBuf, int nSize, bool bDetail, void *pContext)
+{
+    return ((FeedMonitor *)pContext)->format(pBuf, nSize, bDetail);
+}
+
+void *FeedMonitor::threadMain(void *pArg)
+{
+    FeedMonitor *pThis = (FeedMonitor *)pArg;
+    ThreadTopology::enter(THREAD_MONITOR);
+    while (!pThis->m_bStop)
+    {
+        pThis->scan();
+        // short sleeps, so stop() does not wait out a long interval
+        for (int n = 0; n < pThis->m_nScanMs && !pThis->m_bStop; n += 10)
+            usleep(10000);
+    }
+    return NULL;
+}
+
+bool FeedMonitor::start()
+{
+    m_bStop = false;
+    m_bRunning = pthread_create(&m_thread, NULL, threadMain, this) == 0;
+    if (m_bRunning)
+        LatencyStats::setReportSection(reportSection, this);
+    return m_bRunning;
+}
+
+void FeedMonitor::stop()
+{
+    if (!m_bRunning)
+        return;
+    m_bStop = true;
+    pthread_join(m_thread, NULL);
+    m_bRunning = false;
+}
@@ -0,0 +1,145 @@
+#ifndef __FEED_MONITOR_H__
+#define __FEED_MONITOR_H__
+
+#include "InstrumentIndex.h"
+#include <pthread.h>
+
+// exchange to local latency buckets, upper bounds in milliseconds; the
+// first holds the negative ones (local clock behind the exchange's), the
+// last everything past 5s
+const int FEED_LATENCY_BUCKETS = 14;
+// default silence before an instrument is reported stale
+const int FEED_STALE_MS = 30000;
+// default silence of every instrument before the feed is reported silent
+const int FEED_SILENT_MS = 5000;
+// default time between two scans of the monitor thread
+const int FEED_SCAN_MS = 100;
+// time constant of the tick rate EWMA
+const int FEED_RATE_TAU_MS = 10000;
+// products with a threshold of their own
+const int FEED_MAX_PRODUCTS = 64;
+
+// Market data quality of one feed, per instrument.
+//
+// The thread publishing the ticks calls onTick() for each tick it accepts:
+// the UpdateTime, the receive timestamp and a tick count go to flat arrays
+// by the normalizer's slot, three stores and nothing else. The monitor
+// thread scans those arrays every scan interval and keeps, per instrument,
+// the tick rate (EWMA over FEED_RATE_TAU_MS), the silence since the last
+// tick, the gaps and a histogram of the exchange to local latency, the
+// local receive time less UpdateTime.UpdateMillisec; as it only sees the
+// newest tick of each scan, the latency is sampled once per scan and
+// instrument that ticked, not for every tick.
+//
+// An instrument silent past its product's threshold, while others kept
+// ticking that long after its last tick, is reported stale once
+// (LOG_LEVEL_WARN) and its gap counted when it ticks again; an instrument
+// that never ticked is not. Every instrument silent past the feed threshold
+// is one "feed silent" alert instead, so the close of a session is not an
+// alert per instrument. With a lag threshold, a scan whose sampled
+// latencies are mostly above it raises a "feed lagging" alert, once until
+// a scan is below it again.
+//
+// format() gives the summary and the feed wide latency histogram, and
+// with bDetail a line per instrument; start() hands it to the latency
+// reporter, the summary to its file and everything to its stats port.
+class FeedMonitor
+{
+public:
+    // pIndex: the normalizer's instruments, whose slots onTick() takes;
+    // read by the monitor thread, written by the publishing one
+    FeedMonitor(const InstrumentIndex *pIndex);
+    ~FeedMonitor();
+
+    // before start(): thresholds in milliseconds, 0 turns the lag alert
+    // off; setProducts() takes "cu:3000,IF:1000", the product letters of
+    // the InstrumentID (any case) and their own stale threshold; false
+    // for a malformed list, the entries before the error are kept
+    void setThresholds(int nStaleMs, int nSilentMs, int nLagMs);
+    bool setProducts(const char *pList);
+    void setScanInterval(int nMs) { m_nScanMs = nMs > 0 ? nMs : FEED_SCAN_MS; }
+
+    // publishing thread, per accepted tick; nTimeMs as NormalizedTick,
+    // nRecvTsc the latency_now() of the callback
+    inline void onTick(int nSlot, int nTimeMs, unsigned long long nRecvTsc)
+    {
+        m_pExchangeMs[nSlot] = nTimeMs;
+        m_pRecvTsc[nSlot] = nRecvTsc;
+        __atomic_store_n(&m_pTicks[nSlot], m_pTicks[nSlot] + 1, __ATOMIC_RELEASE);
+    }
+
+    // the monitor thread, and the report section of the latency reporter
+    bool start();
+    void stop();
+
+    // one scan, what the monitor thread runs every interval; for callers
+    // without the thread
+    void scan();
+
+    // returns the length, truncated at nSize - 1
+    int format(char *pBuf, int nSize, bool bDetail);
+
+    unsigned long long alerts() const { return m_nAlerts; }
+    int stale() const { return m_nStale; }
+
+private:
+    FeedMonitor(const FeedMonitor &);
+    FeedMonitor &operator=(const FeedMonitor &);
+
+    static void *threadMain(void *pArg);
+    static int reportSection(char *pBuf, int nSize, bool bDetail, void *pContext);
+    int thresholdOf(const char *pInstrumentID) const;
+    // the latency of a scan's sample into the histograms
+    void sample(int nSlot, int nLatencyMs);
+
+    const InstrumentIndex *m_pIndex;
+    // written by onTick()
+    int *m_pExchangeMs;
+    unsigned long long *m_pRecvTsc;
+    unsigned long long *m_pTicks;
+
+    // the monitor thread's, per slot
+    unsigned long long *m_pSeen;
+    double *m_pRate;
+    int *m_pStaleMs;
+    bool *m_pIsStale;
+    // silence at the last scan, the last sampled latency
+    int *m_pAgeMs;
+    int *m_pLatencyMs;
+    // stale spells ended and the longest silence ended, to the scan
+    // interval
+    int *m_pGaps;
+    int *m_pMaxGapMs;
+    // FEED_LATENCY_BUCKETS per slot
+    unsigned int *m_pLatency;
+    // slots with their threshold resolved
+    int m_nKnown;
+
+    // feed wide
+    unsigned long long m_nFeedLatency[FEED_LATENCY_BUCKETS];
+    double m_dFeedRate;
+    int m_nTicking;
+    int m_nStale;
+    bool m_bSilent;
+    bool m_bLagging;
+    unsigned long long m_nAlerts;
+    unsigned long long m_nLastScanTsc;
+    // the newest receive of any instrument
+    unsigned long long m_nNewestTsc;
+
+    int m_nStaleMs;
+    int m_nSilentMs;
+    int m_nLagMs;
+    int m_nScanMs;
+    int m_nProducts;
+    char m_chProducts[FEED_MAX_PRODUCTS][8];
+    int m_nProductMs[FEED_MAX_PRODUCTS];
+
+    // scan() against format() from the reporter thread
+    pthread_mutex_t m_lock;
+    volatile bool m_bStop;
+    bool m_bRunning;
+    pthread_t m_thread;
+};
+
+#endif
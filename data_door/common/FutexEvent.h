@@ -0,0 +1,136 @@
+#ifndef __FUTEX_EVENT_H__
+#define __FUTEX_EVENT_H__
+
+#include <limits.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// spins before a waiter parks in the kernel, a few microseconds; none on a
+// single cpu, where the setter cannot run while the waiter spins
+const int FUTEX_EVENT_SPIN = 200;
+
+// Windows style event on one futex word.
+//
+// set() is an exchange and a load, it enters the kernel only when some
+// thread is parked. A waiter first spins on the word, then registers in
+// m_nWaiters and parks with FUTEX_WAIT; the setter reads m_nWaiters after
+// publishing the state and the kernel rechecks the state before sleeping,
+// so a wakeup cannot be lost between the two. Timeouts are on the
+// monotonic clock.
+//
+// Manual reset events stay set until reset() and wake every waiter; auto
+// reset events are consumed by the one waiter that returns.
+class FutexEvent
+{
+public:
+    FutexEvent(bool bManualReset, bool bInitialState)
+        : m_nState(bInitialState ? 1 : 0), m_nWaiters(0), m_bManualReset(bManualReset) {}
+
+    void set()
+    {
+        if (__atomic_exchange_n(&m_nState, 1, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&m_nWaiters, __ATOMIC_SEQ_CST) > 0)
+            futex(FUTEX_WAKE_PRIVATE, m_bManualReset ? INT_MAX : 1, 0);
+    }
+
+    void reset() { __atomic_store_n(&m_nState, 0, __ATOMIC_RELEASE); }
+
+    bool isSet() const { return __atomic_load_n(&m_nState, __ATOMIC_ACQUIRE) != 0; }
+
+    void wait() { timedwait(-1); }
+
+    // 0 when set, 1 on timeout; nMilliseconds < 0 waits forever
+    int timedwait(long nMilliseconds)
+    {
+        if (tryConsume())
+            return 0;
+        static const int s_nSpin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? FUTEX_EVENT_SPIN : 0;
+        for (int i = 0; i < s_nSpin; i++)
+        {
+            if (tryConsume())
+                return 0;
+            pause();
+        }
+        if (nMilliseconds == 0)
+            return 1;
+
+        struct timespec deadline;
+        if (nMilliseconds > 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += nMilliseconds / 1000;
+            deadline.tv_nsec += (nMilliseconds % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+        }
+
+        __atomic_fetch_add(&m_nWaiters, 1, __ATOMIC_SEQ_CST);
+        int nResult = 1;
+        for (;;)
+        {
+            if (tryConsume())
+            {
+                nResult = 0;
+                break;
+            }
+            struct timespec remaining;
+            if (nMilliseconds > 0 && !remainingUntil(deadline, &remaining))
+                break;
+            // FUTEX_WAIT's relative timeout runs on CLOCK_MONOTONIC
+            futex(FUTEX_WAIT_PRIVATE, 0, nMilliseconds > 0 ? &remaining : 0);
+        }
+        __atomic_fetch_sub(&m_nWaiters, 1, __ATOMIC_SEQ_CST);
+        return nResult;
+    }
+
+private:
+    FutexEvent(const FutexEvent &);
+    FutexEvent &operator=(const FutexEvent &);
+
+    bool tryConsume()
+    {
+        if (m_bManualReset)
+            return __atomic_load_n(&m_nState, __ATOMIC_ACQUIRE) != 0;
+        int nSet = 1;
+        return __atomic_load_n(&m_nState, __ATOMIC_RELAXED) != 0
+               && __atomic_compare_exchange_n(&m_nState, &nSet, 0, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    }
+
+    static bool remainingUntil(const struct timespec &deadline, struct timespec *pRemaining)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        pRemaining->tv_sec = deadline.tv_sec - now.tv_sec;
+        pRemaining->tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if (pRemaining->tv_nsec < 0)
+        {
+            pRemaining->tv_sec--;
+            pRemaining->tv_nsec += 1000000000L;
+        }
+        return pRemaining->tv_sec >= 0;
+    }
+
+    long futex(int nOp, int nValue, const struct timespec *pTimeout)
+    {
+        return syscall(SYS_futex, &m_nState, nOp, nValue, pTimeout, 0, 0);
+    }
+
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    // 1 set, 0 not set
+    int m_nState;
+    int m_nWaiters;
+    bool m_bManualReset;
+};
+
+#endif
@@ -0,0 +1,371 @@
+// IndicatorEngine.cpp : incremental tick indicators, struct of arrays.
+//
+#include "IndicatorEngine.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INDICATOR_ENGINE_X86
+#endif
+
+// lane arrays of a pass, INDICATOR_LANES doubles each
+enum
+{
+    // inputs; the HAS_ ones are 1 or 0
+    LANE_LAST,
+    LANE_BID,
+    LANE_ASK,
+    LANE_BID_VOLUME,
+    LANE_ASK_VOLUME,
+    LANE_BID_DEPTH,
+    LANE_ASK_DEPTH,
+    LANE_VOLUME_DELTA,
+    LANE_TURNOVER_DELTA,
+    LANE_HAS_LAST,
+    LANE_HAS_BOOK,
+    LANE_HAS_RETURN,
+    // the return leaving the window, 0 while it fills
+    LANE_OLD_RETURN,
+    // returns in the window after this one
+    LANE_RETURNS,
+    LANE_MULTIPLIER,
+    // state, updated in place
+    LANE_EMA,
+    LANE_SUM_TURNOVER,
+    LANE_SUM_VOLUME,
+    LANE_PREV_MID,
+    LANE_SUM_R,
+    LANE_SUM_R2,
+    LANE_IMBALANCE,
+    LANE_MICROPRICE,
+    // outputs
+    LANE_RETURN,
+    LANE_VOLATILITY,
+    LANE_VWAP,
+    LANE_COUNT
+};
+
+// lane arrays one cache line longer than the lanes, so the arrays of a pass
+// do not all fall in the same L1 sets
+const int LANE_STRIDE = INDICATOR_LANES + 8;
+
+int indicator_format(const IndicatorValues &values, char *pBuf, int nSize)
+{
+    int n = snprintf(pBuf, nSize, "%.4f|%.4f|%.4f|%.4f|%.4f|", values.dEma, values.dVwap, values.dVolatility, values.dImbalance,
+                     values.dMicroprice);
+    return n < nSize ? n : -1;
+}
+
+IndicatorEngine::IndicatorEngine(int nEmaTicks, int nWindow) : m_nPass(0)
+{
+#ifdef INDICATOR_ENGINE_X86
+    __builtin_cpu_init();
+    m_bCpuAvx2 = __builtin_cpu_supports("avx2");
+#else
+    m_bCpuAvx2 = false;
+#endif
+    m_bAvx2 = m_bCpuAvx2;
+    m_dAlpha = 2.0 / ((nEmaTicks > 0 ? nEmaTicks : INDICATOR_EMA_TICKS) + 1);
+    m_nWindow = nWindow < 2 ? INDICATOR_WINDOW : nWindow > INDICATOR_MAX_WINDOW ? INDICATOR_MAX_WINDOW : nWindow;
+
+    double **pState[] = { &m_pEma, &m_pSumTurnover, &m_pSumVolume, &m_pMultiplier, &m_pPrevMid, &m_pSumR, &m_pSumR2,
+                          &m_pImbalance, &m_pMicroprice, &m_pVolatility };
+    for (unsigned int i = 0; i < sizeof(pState) / sizeof(pState[0]); i++)
+    {
+        *pState[i] = new double[MAX_INSTRUMENTS];
+        memset(*pState[i], 0, sizeof(double) * MAX_INSTRUMENTS);
+    }
+    m_pReturns = new int[MAX_INSTRUMENTS];
+    m_pRingPos = new int[MAX_INSTRUMENTS];
+    m_pPass = new unsigned int[MAX_INSTRUMENTS];
+    memset(m_pReturns, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pRingPos, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pPass, 0, sizeof(unsigned int) * MAX_INSTRUMENTS);
+    m_pRing = new double[(size_t)MAX_INSTRUMENTS * m_nWindow];
+    m_pLanes = new double[LANE_COUNT * LANE_STRIDE];
+}
+
+IndicatorEngine::~IndicatorEngine()
+{
+    delete[] m_pEma;
+    delete[] m_pSumTurnover;
+    delete[] m_pSumVolume;
+    delete[] m_pMultiplier;
+    delete[] m_pPrevMid;
+    delete[] m_pSumR;
+    delete[] m_pSumR2;
+    delete[] m_pImbalance;
+    delete[] m_pMicroprice;
+    delete[] m_pVolatility;
+    delete[] m_pReturns;
+    delete[] m_pRingPos;
+    delete[] m_pPass;
+    delete[] m_pRing;
+    delete[] m_pLanes;
+}
+
+void IndicatorEngine::setMultiplier(int nSlot, double dMultiplier)
+{
+    if (nSlot >= 0 && nSlot < MAX_INSTRUMENTS && dMultiplier > 0)
+        m_pMultiplier[nSlot] = dMultiplier;
+}
+
+void IndicatorEngine::useAvx2(bool bUse)
+{
+    m_bAvx2 = bUse && m_bCpuAvx2;
+}
+
+void IndicatorEngine::values(int nSlot, IndicatorValues *pOut) const
+{
+    pOut->dEma = m_pEma[nSlot];
+    pOut->dVwap = m_pSumVolume[nSlot] > 0 && m_pMultiplier[nSlot] > 0 ? m_pSumTurnover[nSlot] / (m_pSumVolume[nSlot] * m_pMultiplier[nSlot]) : 0;
+    pOut->dVolatility = m_pVolatility[nSlot];
+    pOut->dImbalance = m_pImbalance[nSlot];
+    pOut->dMicroprice = m_pMicroprice[nSlot];
+}
+
+#define LANE(n) (pLanes + (n) * LANE_STRIDE)
+
+static void run_scalar(double *pLanes, int nLanes, double dAlpha)
+{
+    for (int i = 0; i < nLanes; i++)
+    {
+        if (LANE(LANE_HAS_LAST)[i] > 0.5)
+            LANE(LANE_EMA)[i] += dAlpha * (LANE(LANE_LAST)[i] - LANE(LANE_EMA)[i]);
+
+        double dSumT = LANE(LANE_SUM_TURNOVER)[i] += LANE(LANE_TURNOVER_DELTA)[i];
+        double dSumV = LANE(LANE_SUM_VOLUME)[i] += LANE(LANE_VOLUME_DELTA)[i];
+        double dMultiplier = LANE(LANE_MULTIPLIER)[i];
+        LANE(LANE_VWAP)[i] = dSumV > 0 && dMultiplier > 0 ? dSumT / (dSumV * dMultiplier) : 0;
+
+        double r = 0;
+        if (LANE(LANE_HAS_BOOK)[i] > 0.5)
+        {
+            double dBid = LANE(LANE_BID)[i];
+            double dAsk = LANE(LANE_ASK)[i];
+            double dMid = (dBid + dAsk) * 0.5;
+            double dDepth = LANE(LANE_BID_DEPTH)[i] + LANE(LANE_ASK_DEPTH)[i];
+            if (dDepth > 0)
+                LANE(LANE_IMBALANCE)[i] = (LANE(LANE_BID_DEPTH)[i] - LANE(LANE_ASK_DEPTH)[i]) / dDepth;
+            double dTop = LANE(LANE_BID_VOLUME)[i] + LANE(LANE_ASK_VOLUME)[i];
+            LANE(LANE_MICROPRICE)[i] = dTop > 0 ? (dBid * LANE(LANE_ASK_VOLUME)[i] + dAsk * LANE(LANE_BID_VOLUME)[i]) / dTop : dMid;
+            if (LANE(LANE_HAS_RETURN)[i] > 0.5)
+            {
+                r = dMid / LANE(LANE_PREV_MID)[i] - 1;
+                double dOld = LANE(LANE_OLD_RETURN)[i];
+                LANE(LANE_SUM_R)[i] += r - dOld;
+                LANE(LANE_SUM_R2)[i] += r * r - dOld * dOld;
+            }
+            LANE(LANE_PREV_MID)[i] = dMid;
+        }
+        LANE(LANE_RETURN)[i] = r;
+
+        double n = LANE(LANE_RETURNS)[i];
+        double dSum = LANE(LANE_SUM_R)[i];
+        double dVar = n >= 2 ? (LANE(LANE_SUM_R2)[i] - dSum * dSum / n) / (n - 1) : 0;
+        LANE(LANE_VOLATILITY)[i] = dVar > 0 ? sqrt(dVar) * 1e4 : 0;
+    }
+}
+
+#ifdef INDICATOR_ENGINE_X86
+// the same pass four lanes at a time; the masked out lanes may divide by
+// zero, their results are blended away
+__attribute__((target("avx2")))
+static int run_avx2(double *pLanes, int nLanes, double dAlpha)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d alpha = _mm256_set1_pd(dAlpha);
+    const __m256d bp = _mm256_set1_pd(1e4);
+
+    int i = 0;
+    for (; i + 4 <= nLanes; i += 4)
+    {
+#define LOAD(n) _mm256_loadu_pd(LANE(n) + i)
+#define STORE(n, v) _mm256_storeu_pd(LANE(n) + i, v)
+        __m256d hasLast = _mm256_cmp_pd(LOAD(LANE_HAS_LAST), half, _CMP_GT_OQ);
+        __m256d hasBook = _mm256_cmp_pd(LOAD(LANE_HAS_BOOK), half, _CMP_GT_OQ);
+        __m256d hasReturn = _mm256_and_pd(hasBook, _mm256_cmp_pd(LOAD(LANE_HAS_RETURN), half, _CMP_GT_OQ));
+
+        __m256d ema = LOAD(LANE_EMA);
+        ema = _mm256_blendv_pd(ema, _mm256_add_pd(ema, _mm256_mul_pd(alpha, _mm256_sub_pd(LOAD(LANE_LAST), ema))), hasLast);
+        STORE(LANE_EMA, ema);
+
+        __m256d sumT = _mm256_add_pd(LOAD(LANE_SUM_TURNOVER), LOAD(LANE_TURNOVER_DELTA));
+        __m256d sumV = _mm256_add_pd(LOAD(LANE_SUM_VOLUME), LOAD(LANE_VOLUME_DELTA));
+        __m256d multiplier = LOAD(LANE_MULTIPLIER);
+        STORE(LANE_SUM_TURNOVER, sumT);
+        STORE(LANE_SUM_VOLUME, sumV);
+        __m256d hasVwap = _mm256_and_pd(_mm256_cmp_pd(sumV, zero, _CMP_GT_OQ), _mm256_cmp_pd(multiplier, zero, _CMP_GT_OQ));
+        STORE(LANE_VWAP, _mm256_and_pd(_mm256_div_pd(sumT, _mm256_mul_pd(sumV, multiplier)), hasVwap));
+
+        __m256d bid = LOAD(LANE_BID);
+        __m256d ask = LOAD(LANE_ASK);
+        __m256d mid = _mm256_mul_pd(_mm256_add_pd(bid, ask), half);
+        __m256d bidDepth = LOAD(LANE_BID_DEPTH);
+        __m256d askDepth = LOAD(LANE_ASK_DEPTH);
+        __m256d depth = _mm256_add_pd(bidDepth, askDepth);
+        __m256d imbalance = _mm256_div_pd(_mm256_sub_pd(bidDepth, askDepth), depth);
+        STORE(LANE_IMBALANCE, _mm256_blendv_pd(LOAD(LANE_IMBALANCE), imbalance,
+                                               _mm256_and_pd(hasBook, _mm256_cmp_pd(depth, zero, _CMP_GT_OQ))));
+        __m256d bidVolume = LOAD(LANE_BID_VOLUME);
+        __m256d askVolume = LOAD(LANE_ASK_VOLUME);
+        __m256d top = _mm256_add_pd(bidVolume, askVolume);
+        __m256d micro = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(bid, askVolume), _mm256_mul_pd(ask, bidVolume)), top);
+        micro = _mm256_blendv_pd(mid, micro, _mm256_cmp_pd(top, zero, _CMP_GT_OQ));
+        STORE(LANE_MICROPRICE, _mm256_blendv_pd(LOAD(LANE_MICROPRICE), micro, hasBook));
+
+        __m256d prevMid = LOAD(LANE_PREV_MID);
+        __m256d r = _mm256_and_pd(_mm256_sub_pd(_mm256_div_pd(mid, prevMid), one), hasReturn);
+        __m256d old = _mm256_and_pd(LOAD(LANE_OLD_RETURN), hasReturn);
+        __m256d sumR = _mm256_add_pd(LOAD(LANE_SUM_R), _mm256_and_pd(_mm256_sub_pd(r, old), hasReturn));
+        __m256d sumR2 = _mm256_add_pd(LOAD(LANE_SUM_R2),
+                                      _mm256_and_pd(_mm256_sub_pd(_mm256_mul_pd(r, r), _mm256_mul_pd(old, old)), hasReturn));
+        STORE(LANE_SUM_R, sumR);
+        STORE(LANE_SUM_R2, sumR2);
+        STORE(LANE_PREV_MID, _mm256_blendv_pd(prevMid, mid, hasBook));
+        STORE(LANE_RETURN, r);
+
+        __m256d n = LOAD(LANE_RETURNS);
+        __m256d var = _mm256_div_pd(_mm256_sub_pd(sumR2, _mm256_div_pd(_mm256_mul_pd(sumR, sumR), n)), _mm256_sub_pd(n, one));
+        __m256d hasVar = _mm256_and_pd(_mm256_cmp_pd(n, two, _CMP_GE_OQ), _mm256_cmp_pd(var, zero, _CMP_GT_OQ));
+        STORE(LANE_VOLATILITY, _mm256_and_pd(_mm256_mul_pd(_mm256_sqrt_pd(var), bp), hasVar));
+#undef LOAD
+#undef STORE
+    }
+    return i;
+}
+#endif
+
+void IndicatorEngine::run(int nLanes)
+{
+    int nDone = 0;
+#ifdef INDICATOR_ENGINE_X86
+    if (m_bAvx2)
+        nDone = run_avx2(m_pLanes, nLanes, m_dAlpha);
+#endif
+    // the tail, or everything without AVX2: moving the base skips the lanes
+    // done in every lane array
+    run_scalar(m_pLanes + nDone, nLanes - nDone, m_dAlpha);
+}
+
+void IndicatorEngine::update(const CThostFtdcDepthMarketDataField *pTicks, const NormalizedTick *pNorm, int nCount,
+                             IndicatorValues *pOut, int nStride)
+{
+    double *pLanes = m_pLanes;
+    int i = 0;
+    while (i < nCount)
+    {
+        // gather the lanes of one pass, each slot once
+        m_nPass++;
+        int nLanes = 0;
+        for (; i < nCount && nLanes < INDICATOR_LANES; i++)
+        {
+            const NormalizedTick &t = pNorm[i];
+            memset(&pOut[i], 0, sizeof(pOut[i]));
+            if (t.nFlags & (TICK_STALE | TICK_NO_SLOT))
+                continue;
+            int nSlot = t.nSlot;
+            if (m_pPass[nSlot] == m_nPass)
+                break;
+            m_pPass[nSlot] = m_nPass;
+
+            const CThostFtdcDepthMarketDataField *pIn = (const CThostFtdcDepthMarketDataField *)((const char *)pTicks + (size_t)i * nStride);
+            bool bHasLast = !(t.nInvalidMask & (1u << NP_LAST));
+            bool bHasBook = !(t.nInvalidMask & ((1u << NP_BID1) | (1u << NP_ASK1)));
+            if (t.nFlags & TICK_VOLUME_RESET)
+            {
+                // a new session: the VWAP and the return window start over,
+                // the first mid of the session has no return
+                m_pSumTurnover[nSlot] = 0;
+                m_pSumVolume[nSlot] = 0;
+                m_pPrevMid[nSlot] = 0;
+                m_pSumR[nSlot] = 0;
+                m_pSumR2[nSlot] = 0;
+                m_pReturns[nSlot] = 0;
+                m_pRingPos[nSlot] = 0;
+                memset(&m_pRing[(size_t)nSlot * m_nWindow], 0, sizeof(double) * m_nWindow);
+            }
+            if (m_pMultiplier[nSlot] == 0 && t.nVolumeDelta > 0 && bHasLast)
+            {
+                double dMultiplier = t.dTurnoverDelta / (t.nVolumeDelta * pIn->LastPrice);
+                m_pMultiplier[nSlot] = dMultiplier >= 1 ? nearbyint(dMultiplier) : dMultiplier;
+            }
+            // the first price seeds the EMA
+            if (bHasLast && m_pEma[nSlot] == 0)
+                m_pEma[nSlot] = pIn->LastPrice;
+            bool bHasReturn = bHasBook && m_pPrevMid[nSlot] > 0;
+            double dOld = 0;
+            int nReturns = m_pReturns[nSlot];
+            if (bHasReturn)
+            {
+                if (nReturns == m_nWindow)
+                    dOld = m_pRing[(size_t)nSlot * m_nWindow + m_pRingPos[nSlot]];
+                else
+                    nReturns++;
+            }
+
+            m_nLaneTick[nLanes] = i;
+            m_nLaneSlot[nLanes] = nSlot;
+            LANE(LANE_LAST)[nLanes] = bHasLast ? pIn->LastPrice : 0;
+            LANE(LANE_BID)[nLanes] = bHasBook ? pIn->BidPrice1 : 0;
+            LANE(LANE_ASK)[nLanes] = bHasBook ? pIn->AskPrice1 : 0;
+            LANE(LANE_BID_VOLUME)[nLanes] = pIn->BidVolume1;
+            LANE(LANE_ASK_VOLUME)[nLanes] = pIn->AskVolume1;
+            LANE(LANE_BID_DEPTH)[nLanes] = (double)pIn->BidVolume1 + pIn->BidVolume2 + pIn->BidVolume3 + pIn->BidVolume4 + pIn->BidVolume5;
+            LANE(LANE_ASK_DEPTH)[nLanes] = (double)pIn->AskVolume1 + pIn->AskVolume2 + pIn->AskVolume3 + pIn->AskVolume4 + pIn->AskVolume5;
+            LANE(LANE_VOLUME_DELTA)[nLanes] = t.nVolumeDelta;
+            LANE(LANE_TURNOVER_DELTA)[nLanes] = t.dTurnoverDelta;
+            LANE(LANE_HAS_LAST)[nLanes] = bHasLast;
+            LANE(LANE_HAS_BOOK)[nLanes] = bHasBook;
+            LANE(LANE_HAS_RETURN)[nLanes] = bHasReturn;
+            LANE(LANE_OLD_RETURN)[nLanes] = dOld;
+            LANE(LANE_RETURNS)[nLanes] = nReturns;
+            LANE(LANE_MULTIPLIER)[nLanes] = m_pMultiplier[nSlot];
+            LANE(LANE_EMA)[nLanes] = m_pEma[nSlot];
+            LANE(LANE_SUM_TURNOVER)[nLanes] = m_pSumTurnover[nSlot];
+            LANE(LANE_SUM_VOLUME)[nLanes] = m_pSumVolume[nSlot];
+            LANE(LANE_PREV_MID)[nLanes] = m_pPrevMid[nSlot];
+            LANE(LANE_SUM_R)[nLanes] = m_pSumR[nSlot];
+            LANE(LANE_SUM_R2)[nLanes] = m_pSumR2[nSlot];
+            LANE(LANE_IMBALANCE)[nLanes] = m_pImbalance[nSlot];
+            LANE(LANE_MICROPRICE)[nLanes] = m_pMicroprice[nSlot];
+            m_pReturns[nSlot] = nReturns;
+            nLanes++;
+        }
+        if (nLanes == 0)
+            continue;
+
+        run(nLanes);
+
+        // scatter the state back and hand out the values
+        for (int l = 0; l < nLanes; l++)
+        {
+            int nSlot = m_nLaneSlot[l];
+            m_pEma[nSlot] = LANE(LANE_EMA)[l];
+            m_pSumTurnover[nSlot] = LANE(LANE_SUM_TURNOVER)[l];
+            m_pSumVolume[nSlot] = LANE(LANE_SUM_VOLUME)[l];
+            m_pPrevMid[nSlot] = LANE(LANE_PREV_MID)[l];
+            m_pSumR[nSlot] = LANE(LANE_SUM_R)[l];
+            m_pSumR2[nSlot] = LANE(LANE_SUM_R2)[l];
+            m_pImbalance[nSlot] = LANE(LANE_IMBALANCE)[l];
+            m_pMicroprice[nSlot] = LANE(LANE_MICROPRICE)[l];
+            m_pVolatility[nSlot] = LANE(LANE_VOLATILITY)[l];
+            if (LANE(LANE_HAS_RETURN)[l] > 0.5)
+            {
+                m_pRing[(size_t)nSlot * m_nWindow + m_pRingPos[nSlot]] = LANE(LANE_RETURN)[l];
+                if (++m_pRingPos[nSlot] == m_nWindow)
+                    m_pRingPos[nSlot] = 0;
+            }
+            IndicatorValues &v = pOut[m_nLaneTick[l]];
+            v.dEma = LANE(LANE_EMA)[l];
+            v.dVwap = LANE(LANE_VWAP)[l];
+            v.dVolatility = LANE(LANE_VOLATILITY)[l];
+            v.dImbalance = LANE(LANE_IMBALANCE)[l];
+            v.dMicroprice = LANE(LANE_MICROPRICE)[l];
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef __INDICATOR_ENGINE_H__
+#define __INDICATOR_ENGINE_H__
+
+#include "TickNormalizer.h"
+
+// default EMA period, in ticks
+const int INDICATOR_EMA_TICKS = 20;
+// default and largest number of mid price returns in the volatility window
+const int INDICATOR_WINDOW = 64;
+const int INDICATOR_MAX_WINDOW = 1024;
+// ticks gathered into one vector pass, the lanes of a pass stay in L1
+const int INDICATOR_LANES = 64;
+
+// indicators of one tick, the latest known where the tick lacks the input
+struct IndicatorValues
+{
+    // exponential moving average of LastPrice
+    double dEma;
+    // session VWAP from the Turnover and Volume deltas, 0 before a trade
+    double dVwap;
+    // standard deviation of the mid price returns over the window, in basis
+    // points per tick, 0 before two returns
+    double dVolatility;
+    // (bid - ask) / (bid + ask) of the volumes over the five levels, -1..1
+    double dImbalance;
+    // level one prices weighted by the opposite side's volume
+    double dMicroprice;
+};
+
+// the fields appended to a published tick: "ema|vwap|vol|imbalance|micro|"
+const int INDICATOR_FIELDS = 5;
+const int INDICATOR_TEXT_SIZE = 128;
+int indicator_format(const IndicatorValues &values, char *pBuf, int nSize);
+
+// Incremental tick indicators across instruments.
+//
+// State is a struct of arrays indexed by the TickNormalizer's slot, so the
+// engine shares its instrument table and needs nothing but the batch and
+// its NormalizedTicks. update() costs O(1) per tick: the ticks of a batch
+// are gathered into lanes (scalar), one vector pass updates the EMA, VWAP
+// sums, return window sums, imbalance and microprice of every lane with
+// AVX2 when the cpu has it, and the lanes are scattered back. A slot ticking
+// twice in a batch starts a new pass, so its updates stay in order.
+//
+// VWAP divides the turnover by the volume times the contract multiplier;
+// one not set with setMultiplier() is taken from the first trade,
+// Turnover / (Volume * LastPrice) rounded. A TICK_VOLUME_RESET tick starts
+// a new session, the VWAP sums and the volatility window restart from it.
+// Stale and slotless ticks are skipped.
+//
+// Not thread safe, owned by the thread that owns the normalizer.
+class IndicatorEngine
+{
+public:
+    // nEmaTicks: EMA period; nWindow: returns in the volatility window
+    IndicatorEngine(int nEmaTicks = INDICATOR_EMA_TICKS, int nWindow = INDICATOR_WINDOW);
+    ~IndicatorEngine();
+
+    void setMultiplier(int nSlot, double dMultiplier);
+
+    // values for the nCount ticks into pOut, 0 for the skipped ones; pTicks
+    // and nStride as given to TickNormalizer::normalize()
+    void update(const CThostFtdcDepthMarketDataField *pTicks, const NormalizedTick *pNorm, int nCount, IndicatorValues *pOut,
+                int nStride = sizeof(CThostFtdcDepthMarketDataField));
+
+    // latest values of an instrument
+    void values(int nSlot, IndicatorValues *pOut) const;
+
+    // false forces the scalar pass, for comparison
+    void useAvx2(bool bUse);
+    bool usingAvx2() const { return m_bAvx2; }
+
+private:
+    void run(int nLanes);
+
+    bool m_bAvx2;
+    bool m_bCpuAvx2;
+    double m_dAlpha;
+    int m_nWindow;
+
+    // per slot state
+    double *m_pEma;
+    double *m_pSumTurnover;
+    double *m_pSumVolume;
+    double *m_pMultiplier;
+    double *m_pPrevMid;
+    double *m_pSumR;
+    double *m_pSumR2;
+    double *m_pImbalance;
+    double *m_pMicroprice;
+    double *m_pVolatility;
+    int *m_pReturns;
+    int *m_pRingPos;
+    // m_nWindow returns per slot
+    double *m_pRing;
+    // slot -> pass it was last gathered in
+    unsigned int *m_pPass;
+    unsigned int m_nPass;
+
+    // lanes, struct of arrays: inputs, gathered state, outputs
+    double *m_pLanes;
+    int m_nLaneTick[INDICATOR_LANES];
+    int m_nLaneSlot[INDICATOR_LANES];
+};
+
+#endif
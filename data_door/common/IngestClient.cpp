@@ -0,0 +1,228 @@
+// IngestClient.cpp : publishing connection with locally stamped ids and asynchronous acks.
+//
+#include "IngestClient.h"
+#include "LatencyStats.h"
+#include "AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// longest wait for a connect before it is retried later
+const int INGEST_CONNECT_TIMEOUT_MS = 200;
+
+IngestClient::IngestClient() : m_nPort(0), m_fd(-1), m_nLastAttempt(0), m_nHead(0), m_nTail(0), m_nWritten(0),
+    m_nFirst(0), m_nLines(0), m_nAck(0), m_nSent(0), m_nAcked(0), m_nResent(0), m_nReconnects(0), m_nBadAcks(0), m_nDropped(0)
+{
+    m_chHost[0] = '\0';
+    m_pBuffer = (char *)malloc(INGEST_CLIENT_BUFFER);
+    m_pLength = (int *)malloc(sizeof(int) * INGEST_CLIENT_WINDOW);
+    m_pQueuedAt = (unsigned long long *)malloc(sizeof(unsigned long long) * INGEST_CLIENT_WINDOW);
+}
+
+IngestClient::~IngestClient()
+{
+    disconnect();
+    free(m_pBuffer);
+    free(m_pLength);
+    free(m_pQueuedAt);
+}
+
+void IngestClient::setServer(const char *pHost, int nPort)
+{
+    strncpy(m_chHost, pHost, sizeof(m_chHost) - 1);
+    m_chHost[sizeof(m_chHost) - 1] = '\0';
+    m_nPort = nPort;
+}
+
+void IngestClient::disconnect()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = -1;
+}
+
+bool IngestClient::reconnect()
+{
+    time_t nNow = time(NULL);
+    if (nNow - m_nLastAttempt < INGEST_CLIENT_RETRY)
+        return false;
+    m_nLastAttempt = nNow;
+
+    char chPort[16];
+    snprintf(chPort, sizeof(chPort), "%d", m_nPort);
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *pAddr = NULL;
+    if (getaddrinfo(m_chHost, chPort, &hints, &pAddr) != 0 || pAddr == NULL)
+    {
+        FC_LOG(LOG_LEVEL_ERROR, "cannot resolve ingest server %s\n", m_chHost);
+        return false;
+    }
+
+    // non blocking from the start: the connect is bounded, the
+    // publisher thread must not hang on a dead host
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int nResult = fd >= 0 ? connect(fd, pAddr->ai_addr, pAddr->ai_addrlen) : -1;
+    freeaddrinfo(pAddr);
+    if (nResult != 0 && fd >= 0 && errno == EINPROGRESS)
+    {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        int nError = 0;
+        socklen_t nLen = sizeof(nError);
+        if (::poll(&pfd, 1, INGEST_CONNECT_TIMEOUT_MS) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &nError, &nLen) == 0 && nError == 0)
+            nResult = 0;
+    }
+    if (nResult != 0)
+    {
+        FC_LOG(LOG_LEVEL_WARN, "cannot connect to ingest server %s:%d\n", m_chHost, m_nPort);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    m_fd = fd;
+    m_nAck = 0;
+    // everything unacked goes again, the server drops what it has
+    m_nWritten = m_nHead;
+    if (m_nReconnects++ > 0)
+    {
+        m_nResent += m_nLines;
+        FC_LOG(LOG_LEVEL_INFO, "reconnected to ingest server %s:%d, resending %d lines\n", m_chHost, m_nPort, m_nLines);
+    }
+    return true;
+}
+
+bool IngestClient::send(const char *pLine, int nLength, int nWaitMs)
+{
+    int nRecord = UUID_TEXT_LENGTH + 1 + nLength + 1;
+    for (int nWaited = 0; ; nWaited++)
+    {
+        if (m_nTail + nRecord > INGEST_CLIENT_BUFFER && m_nHead > 0)
+        {
+            // drop the acked bytes in front
+            memmove(m_pBuffer, m_pBuffer + m_nHead, m_nTail - m_nHead);
+            m_nTail -= m_nHead;
+            m_nWritten -= m_nHead;
+            m_nHead = 0;
+        }
+        if (m_nLines < INGEST_CLIENT_WINDOW && m_nTail + nRecord <= INGEST_CLIENT_BUFFER)
+            break;
+        if (nWaited >= nWaitMs)
+        {
+            m_nDropped++;
+            return false;
+        }
+        poll();
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+
+    char *p = m_pBuffer + m_nTail;
+    MessageIdGenerator::next().format(p);
+    p[UUID_TEXT_LENGTH] = '|';
+    memcpy(p + UUID_TEXT_LENGTH + 1, pLine, nLength);
+    p[nRecord - 1] = '\n';
+    m_nTail += nRecord;
+
+    int nSlot = (m_nFirst + m_nLines) % INGEST_CLIENT_WINDOW;
+    m_pLength[nSlot] = nRecord;
+    m_pQueuedAt[nSlot] = latency_now();
+    m_nLines++;
+    m_nSent++;
+    return true;
+}
+
+void IngestClient::writeQueued()
+{
+    while (m_nWritten < m_nTail)
+    {
+        ssize_t n = ::send(m_fd, m_pBuffer + m_nWritten, m_nTail - m_nWritten, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                disconnect();
+            return;
+        }
+        m_nWritten += n;
+    }
+}
+
+void IngestClient::readAcks()
+{
+    char chBuf[4096];
+    for (;;)
+    {
+        ssize_t n = recv(m_fd, chBuf, sizeof(chBuf), MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            disconnect();
+            return;
+        }
+        if (n < 0)
+            return;
+
+        unsigned long long nNow = latency_now();
+        for (ssize_t i = 0; i < n; i++)
+        {
+            if (chBuf[i] != '\n')
+            {
+                if (m_nAck < (int)sizeof(m_chAck))
+                    m_chAck[m_nAck] = chBuf[i];
+                m_nAck++;
+                continue;
+            }
+            if (m_nLines == 0)
+            {
+                m_nAck = 0;
+                continue;
+            }
+            // acks come in order: this one is for the oldest line
+            if (m_nAck != UUID_TEXT_LENGTH || memcmp(m_chAck, m_pBuffer + m_nHead, UUID_TEXT_LENGTH) != 0)
+            {
+                if (m_nBadAcks++ == 0)
+                    FC_LOG(LOG_LEVEL_WARN, "ingest server ack does not echo the message id, is it the Java listener?\n");
+            }
+            m_nAck = 0;
+            LatencyStats::record(LAT_ACK, nNow - m_pQueuedAt[m_nFirst]);
+            m_nHead += m_pLength[m_nFirst];
+            m_nFirst = (m_nFirst + 1) % INGEST_CLIENT_WINDOW;
+            m_nLines--;
+            m_nAcked++;
+        }
+    }
+}
+
+int IngestClient::poll()
+{
+    if (m_fd < 0 && (m_nLines == 0 || !reconnect()))
+        return m_nLines;
+    writeQueued();
+    if (m_fd >= 0)
+        readAcks();
+    return m_nLines;
+}
+
+bool IngestClient::drain(int nTimeoutMs)
+{
+    for (int n = 0; n < nTimeoutMs && poll() > 0; n++)
+    {
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+    return m_nLines == 0;
+}
@@ -0,0 +1,91 @@
+#ifndef __INGEST_CLIENT_H__
+#define __INGEST_CLIENT_H__
+
+#include "MessageId.h"
+
+// lines sent and not yet acknowledged, kept for the resend after a
+// reconnect
+const int INGEST_CLIENT_WINDOW = 8192;
+// bytes of those lines
+const int INGEST_CLIENT_BUFFER = 8 << 20;
+// seconds between reconnect attempts
+const int INGEST_CLIENT_RETRY = 1;
+
+// Publishing connection to the ingest server with asynchronous acks.
+//
+// send() stamps the line with the next MessageId ("id|line\n") and queues
+// it; poll() writes what is queued and consumes the acks that arrived,
+// the server echoing the id, without ever blocking. So the publisher no
+// longer waits a round trip per message.
+//
+// Lines stay queued until acked. When the connection drops, poll()
+// reconnects and sends every unacked line again; the server drops the
+// ones it already took by their ids, so a retry never duplicates a
+// record. Needs ingest_server: the Java listener does not know the id
+// prefix.
+//
+// One thread only, the publisher's.
+class IngestClient
+{
+public:
+    IngestClient();
+    ~IngestClient();
+
+    // host name or address, connected lazily by poll()
+    void setServer(const char *pHost, int nPort);
+
+    // queue one line, without its newline. false, and the line dropped
+    // and counted, when the window is full; by default at once, a caller
+    // that can afford to block passes nWaitMs to poll() that long first
+    bool send(const char *pLine, int nLength, int nWaitMs = 0);
+
+    // write queued lines, read acks, reconnect when due; returns the
+    // number of lines still unacked
+    int poll();
+
+    // poll() until every line is acked or nTimeoutMs passed, true when
+    // none is left
+    bool drain(int nTimeoutMs);
+
+    unsigned long long sent() const { return m_nSent; }
+    unsigned long long acked() const { return m_nAcked; }
+    unsigned long long resent() const { return m_nResent; }
+    unsigned long long reconnects() const { return m_nReconnects; }
+    unsigned long long dropped() const { return m_nDropped; }
+
+private:
+    bool reconnect();
+    void disconnect();
+    void readAcks();
+    void writeQueued();
+
+    char m_chHost[256];
+    int m_nPort;
+    int m_fd;
+    time_t m_nLastAttempt;
+
+    // unacked lines: bytes [m_nHead, m_nTail) of m_pBuffer, the first
+    // m_nWritten of them sent on this connection
+    char *m_pBuffer;
+    int m_nHead;
+    int m_nTail;
+    int m_nWritten;
+    // per unacked line its length and queueing time, a ring
+    int *m_pLength;
+    unsigned long long *m_pQueuedAt;
+    int m_nFirst;
+    int m_nLines;
+
+    // partial ack line read so far
+    char m_chAck[64];
+    int m_nAck;
+
+    unsigned long long m_nSent;
+    unsigned long long m_nAcked;
+    unsigned long long m_nResent;
+    unsigned long long m_nReconnects;
+    unsigned long long m_nBadAcks;
+    unsigned long long m_nDropped;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __INSTRUMENT_INDEX_H__
+#define __INSTRUMENT_INDEX_H__
+
+#include <string.h>
+
+// maximum number of instruments tracked by one process
+const int MAX_INSTRUMENTS = 4096;
+
+// Fixed capacity open addressing map from InstrumentID to a dense slot
+// number in [0, MAX_INSTRUMENTS). Slots are handed out in insertion order
+// and never reused, so per-instrument state can live in flat arrays.
+// Single writer; readers on other threads may call find() once the slot
+// they look for has been published by the writer.
+class InstrumentIndex
+{
+public:
+    InstrumentIndex() : m_nCount(0)
+    {
+        memset(m_keys, 0, sizeof(m_keys));
+        for (int i = 0; i < TABLE_SIZE; i++)
+            m_slots[i] = -1;
+    }
+
+    // slot of the instrument, -1 if unknown
+    int find(const char *pInstrumentID) const
+    {
+        unsigned int h = hash(pInstrumentID) & (TABLE_SIZE - 1);
+        while (m_slots[h] != -1)
+        {
+            if (strncmp(m_keys[h], pInstrumentID, KEY_SIZE - 1) == 0)
+                return m_slots[h];
+            h = (h + 1) & (TABLE_SIZE - 1);
+        }
+        return -1;
+    }
+
+    // slot of the instrument, allocating one on first sight; -1 when full
+    int insert(const char *pInstrumentID)
+    {
+        unsigned int h = hash(pInstrumentID) & (TABLE_SIZE - 1);
+        while (m_slots[h] != -1)
+        {
+            if (strncmp(m_keys[h], pInstrumentID, KEY_SIZE - 1) == 0)
+                return m_slots[h];
+            h = (h + 1) & (TABLE_SIZE - 1);
+        }
+        if (m_nCount >= MAX_INSTRUMENTS)
+            return -1;
+
+        strncpy(m_keys[h], pInstrumentID, KEY_SIZE - 1);
+        strncpy(m_names[m_nCount], pInstrumentID, KEY_SIZE - 1);
+        m_names[m_nCount][KEY_SIZE - 1] = '\0';
+        __sync_synchronize();
+        m_slots[h] = m_nCount;
+        return m_nCount++;
+    }
+
+    // InstrumentID of a slot handed out by insert()
+    const char *name(int nSlot) const { return m_names[nSlot]; }
+
+    int count() const { return m_nCount; }
+
+    static unsigned int hash(const char *p)
+    {
+        // FNV-1a, instrument ids are short
+        unsigned int h = 2166136261u;
+        for (int i = 0; i < KEY_SIZE - 1 && p[i] != '\0'; i++)
+        {
+            h ^= (unsigned char)p[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+private:
+    // matches sizeof(TThostFtdcInstrumentIDType)
+    enum { KEY_SIZE = 31, TABLE_SIZE = MAX_INSTRUMENTS * 2 };
+
+    char m_keys[TABLE_SIZE][KEY_SIZE];
+    volatile int m_slots[TABLE_SIZE];
+    char m_names[MAX_INSTRUMENTS][KEY_SIZE];
+    int m_nCount;
+};
+
+#endif
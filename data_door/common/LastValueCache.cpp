@@ -0,0 +1,42 @@
+// LastValueCache.cpp : latest tick per instrument.
+//
+#include "LastValueCache.h"
+#include <stdlib.h>
+#include <string.h>
+
+LastValueCache::LastValueCache()
+{
+    m_pValues = (LastValue *)aligned_alloc(64, sizeof(LastValue) * MAX_INSTRUMENTS);
+    memset(m_pValues, 0, sizeof(LastValue) * MAX_INSTRUMENTS);
+}
+
+LastValueCache::~LastValueCache()
+{
+    free(m_pValues);
+}
+
+int LastValueCache::update(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    int nSlot = m_index.find(pDepthMarketData->InstrumentID);
+    if (nSlot < 0)
+        return -1;
+
+    const char *t = pDepthMarketData->UpdateTime;
+    int nTimeMs = ((((t[0] - '0') * 10 + t[1] - '0') * 60 + (t[3] - '0') * 10 + t[4] - '0') * 60
+                   + (t[6] - '0') * 10 + t[7] - '0') * 1000 + pDepthMarketData->UpdateMillisec;
+
+    LastValue *p = &m_pValues[nSlot];
+    unsigned int nSeq = p->nSeq;
+    __atomic_store_n(&p->nSeq, nSeq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    p->nVolume = pDepthMarketData->Volume;
+    p->dLastPrice = pDepthMarketData->LastPrice;
+    p->dUpperLimitPrice = pDepthMarketData->UpperLimitPrice;
+    p->dLowerLimitPrice = pDepthMarketData->LowerLimitPrice;
+    p->dBidPrice1 = pDepthMarketData->BidPrice1;
+    p->dAskPrice1 = pDepthMarketData->AskPrice1;
+    p->dPreSettlementPrice = pDepthMarketData->PreSettlementPrice;
+    p->nTimeMs = nTimeMs;
+    __atomic_store_n(&p->nSeq, nSeq + 2, __ATOMIC_RELEASE);
+    return nSlot;
+}
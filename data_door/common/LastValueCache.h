@@ -0,0 +1,74 @@
+#ifndef __LAST_VALUE_CACHE_H__
+#define __LAST_VALUE_CACHE_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "InstrumentIndex.h"
+
+using namespace KingstarAPI;
+
+// the fields of the latest tick other components read, one cache line
+struct LastValue
+{
+    // odd while the writer is updating the entry
+    unsigned int nSeq;
+    // Volume of the tick, cumulative for the day
+    int nVolume;
+    double dLastPrice;
+    double dUpperLimitPrice;
+    double dLowerLimitPrice;
+    double dBidPrice1;
+    double dAskPrice1;
+    double dPreSettlementPrice;
+    // UpdateTime and UpdateMillisec as milliseconds since midnight, 0 before
+    // the first tick
+    int nTimeMs;
+    int nPad;
+} __attribute__((aligned(64)));
+
+// Latest tick per instrument, written by the market data callback thread
+// and read from any thread.
+//
+// Instruments are registered with addInstrument() on one thread (the one
+// receiving OnRspQryInstrument) before they are subscribed; update() only
+// looks them up, ticks of unregistered instruments are ignored. Each entry
+// is protected by a sequence counter, so readers never block the writer and
+// retry if they raced with an update.
+class LastValueCache
+{
+public:
+    LastValueCache();
+    ~LastValueCache();
+
+    // slot of the instrument, -1 when the table is full
+    int addInstrument(const char *pInstrumentID) { return m_index.insert(pInstrumentID); }
+
+    // -1 for an unregistered instrument
+    int slot(const char *pInstrumentID) const { return m_index.find(pInstrumentID); }
+
+    // OnRtnDepthMarketData, returns the slot or -1
+    int update(const CThostFtdcDepthMarketDataField *pDepthMarketData);
+
+    // consistent copy of a slot, false before its first tick
+    bool read(int nSlot, LastValue *pOut) const
+    {
+        const LastValue *p = &m_pValues[nSlot];
+        for (;;)
+        {
+            unsigned int nSeq = __atomic_load_n(&p->nSeq, __ATOMIC_ACQUIRE);
+            if (nSeq & 1)
+                continue;
+            *pOut = *p;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&p->nSeq, __ATOMIC_RELAXED) == nSeq)
+                return nSeq != 0;
+        }
+    }
+
+    const InstrumentIndex &index() const { return m_index; }
+
+private:
+    InstrumentIndex m_index;
+    LastValue *m_pValues;
+};
+
+#endif
@@ -0,0 +1,279 @@
+// LatencyStats.cpp : per thread latency histograms and their reporter.
+//
+#include "LatencyStats.h"
+#include "ThreadTopology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+__thread ThreadLatency *LatencyStats::s_pThread = 0;
+
+// every registered thread block, pushed with CAS and never removed
+static ThreadLatency *s_pHead = 0;
+
+static const char *s_metricNames[LAT_METRIC_COUNT] =
+{
+    "callback_to_enqueue",
+    "queue_wait",
+    "normalize",
+    "serialize",
+    "connect",
+    "socket_write",
+    "ack",
+    "tick_to_wire",
+    "ingest_line",
+    "fanout",
+    "multicast",
+    "spread",
+    "option_chain",
+    "for_quote"
+};
+
+ThreadLatency *LatencyStats::registerThread()
+{
+    ThreadLatency *p = (ThreadLatency *)calloc(1, sizeof(ThreadLatency));
+    ThreadLatency *pHead = __atomic_load_n(&s_pHead, __ATOMIC_ACQUIRE);
+    do
+    {
+        p->pNext = pHead;
+    } while (!__atomic_compare_exchange_n(&s_pHead, &pHead, p, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    s_pThread = p;
+    return p;
+}
+
+const char *LatencyStats::metricName(int nMetric)
+{
+    return s_metricNames[nMetric];
+}
+
+static double calibrate()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    unsigned long long c0 = latency_now();
+    usleep(20000);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    unsigned long long c1 = latency_now();
+    double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    return c1 > c0 ? ns / (double)(c1 - c0) : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+double LatencyStats::nsPerCycle()
+{
+    static double s_dNsPerCycle = calibrate();
+    return s_dNsPerCycle;
+}
+
+// representative value of a bucket, its midpoint
+static unsigned long long bucket_value(int nBucket)
+{
+    const int nHalf = 1 << (LAT_SUB_BITS - 1);
+    if (nBucket < 2 * nHalf)
+        return nBucket;
+    int nShift = (nBucket - 2 * nHalf) / nHalf + 1;
+    unsigned long long nTop = (nBucket - 2 * nHalf) % nHalf + nHalf;
+    return (nTop << nShift) + (1ULL << (nShift - 1));
+}
+
+int LatencyStats::dump(char *pBuf, int nSize)
+{
+    static const double s_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    double dNs = nsPerCycle();
+    unsigned long long *pMerged = new unsigned long long[LAT_BUCKETS];
+
+    int nLen = snprintf(pBuf, nSize, "%-20s %12s %10s %10s %10s %10s %10s  (ns)\n",
+                        "stage", "count", "p50", "p90", "p99", "p99.9", "max");
+    for (int m = 0; m < LAT_METRIC_COUNT && nLen < nSize; m++)
+    {
+        memset(pMerged, 0, sizeof(unsigned long long) * LAT_BUCKETS);
+        unsigned long long nTotal = 0;
+        unsigned long long nMax = 0;
+        for (ThreadLatency *p = __atomic_load_n(&s_pHead, __ATOMIC_ACQUIRE); p != 0; p = p->pNext)
+        {
+            for (int b = 0; b < LAT_BUCKETS; b++)
+            {
+                unsigned long long n = __atomic_load_n(&p->nCounts[m][b], __ATOMIC_RELAXED);
+                pMerged[b] += n;
+                nTotal += n;
+            }
+            unsigned long long nThreadMax = __atomic_load_n(&p->nMax[m], __ATOMIC_RELAXED);
+            if (nThreadMax > nMax)
+                nMax = nThreadMax;
+        }
+        if (nTotal == 0)
+            continue;
+
+        unsigned long long nValues[4];
+        int q = 0;
+        unsigned long long nSeen = 0;
+        for (int b = 0; b < LAT_BUCKETS && q < 4; b++)
+        {
+            nSeen += pMerged[b];
+            while (q < 4 && nSeen >= (unsigned long long)(s_quantiles[q] * nTotal) && nSeen > 0)
+                nValues[q++] = bucket_value(b);
+        }
+        while (q < 4)
+            nValues[q++] = nMax;
+
+        nLen += snprintf(pBuf + nLen, nSize - nLen, "%-20s %12llu %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+                         s_metricNames[m], nTotal, nValues[0] * dNs, nValues[1] * dNs, nValues[2] * dNs,
+                         nValues[3] * dNs, nMax * dNs);
+    }
+    delete[] pMerged;
+    return nLen < nSize ? nLen : nSize - 1;
+}
+
+struct LatencyReporter
+{
+    char chFile[260];
+    int nListen;
+    int nIntervalSec;
+    volatile bool bRunning;
+    pthread_t hThread;
+};
+
+static LatencyReporter *s_pReporter = 0;
+
+// held by the reporter for the whole section call, so a replaced section
+// is no longer running once setReportSection() returns
+static pthread_mutex_t s_sectionLock = PTHREAD_MUTEX_INITIALIZER;
+static LatencyReportSection s_pSection = 0;
+static void *s_pSectionContext = 0;
+
+void LatencyStats::setReportSection(LatencyReportSection pSection, void *pContext)
+{
+    pthread_mutex_lock(&s_sectionLock);
+    s_pSection = pSection;
+    s_pSectionContext = pContext;
+    pthread_mutex_unlock(&s_sectionLock);
+}
+
+// the latency table and the section after it
+static int report(char *pBuf, int nSize, bool bDetail)
+{
+    int n = LatencyStats::dump(pBuf, nSize);
+    pthread_mutex_lock(&s_sectionLock);
+    if (s_pSection != 0 && n < nSize - 1)
+        n += s_pSection(pBuf + n, nSize - n, bDetail, s_pSectionContext);
+    pthread_mutex_unlock(&s_sectionLock);
+    return n;
+}
+
+static void *reporter_main(void *pArg)
+{
+    LatencyReporter *r = (LatencyReporter *)pArg;
+    ThreadTopology::enter(THREAD_STATS);
+    const int nDumpSize = LAT_REPORT_SIZE;
+    char *pDump = new char[nDumpSize];
+    time_t nNext = time(NULL) + r->nIntervalSec;
+
+    while (r->bRunning)
+    {
+        if (r->nListen >= 0)
+        {
+            struct pollfd pfd;
+            pfd.fd = r->nListen;
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, 200) > 0)
+            {
+                int fd = accept(r->nListen, NULL, NULL);
+                if (fd >= 0)
+                {
+                    int n = report(pDump, nDumpSize, true);
+                    // a blocking socket, the whole dump in one call
+                    send(fd, pDump, n, MSG_NOSIGNAL);
+                    close(fd);
+                }
+            }
+        }
+        else
+        {
+            usleep(200000);
+        }
+
+        if (r->chFile[0] != '\0' && time(NULL) >= nNext)
+        {
+            nNext = time(NULL) + r->nIntervalSec;
+            FILE *fp = fopen(r->chFile, "a");
+            if (fp != NULL)
+            {
+                time_t now = time(NULL);
+                char chTime[32];
+                strftime(chTime, sizeof(chTime), "%Y%m%d %H:%M:%S", localtime(&now));
+                report(pDump, nDumpSize, false);
+                fprintf(fp, "== %s\n%s", chTime, pDump);
+                fclose(fp);
+            }
+        }
+    }
+    delete[] pDump;
+    return NULL;
+}
+
+bool LatencyStats::startReporter(const char *pFile, int nPort, int nIntervalSec)
+{
+    if (s_pReporter != 0)
+        return false;
+
+    // calibrate here, not on the first dump request
+    nsPerCycle();
+
+    LatencyReporter *r = new LatencyReporter;
+    memset(r->chFile, 0, sizeof(r->chFile));
+    if (pFile != NULL)
+        strncpy(r->chFile, pFile, sizeof(r->chFile) - 1);
+    r->nIntervalSec = nIntervalSec > 0 ? nIntervalSec : 10;
+    r->nListen = -1;
+
+    if (nPort > 0)
+    {
+        r->nListen = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(r->nListen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(nPort);
+        if (r->nListen < 0 || bind(r->nListen, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(r->nListen, 5) != 0)
+        {
+            if (r->nListen >= 0)
+                close(r->nListen);
+            delete r;
+            return false;
+        }
+    }
+
+    r->bRunning = true;
+    if (pthread_create(&r->hThread, NULL, reporter_main, r) != 0)
+    {
+        if (r->nListen >= 0)
+            close(r->nListen);
+        delete r;
+        return false;
+    }
+    s_pReporter = r;
+    return true;
+}
+
+void LatencyStats::stopReporter()
+{
+    if (s_pReporter == 0)
+        return;
+    s_pReporter->bRunning = false;
+    pthread_join(s_pReporter->hThread, NULL);
+    if (s_pReporter->nListen >= 0)
+        close(s_pReporter->nListen);
+    delete s_pReporter;
+    s_pReporter = 0;
+}
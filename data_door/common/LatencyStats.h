@@ -0,0 +1,147 @@
+#ifndef __LATENCY_STATS_H__
+#define __LATENCY_STATS_H__
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Hot path latency probes.
+//
+// A probe is a timestamp from latency_now(); a stage is recorded as the
+// difference of two probes with LatencyStats::record(). Each thread writes
+// its own histograms (found through a thread local pointer, registered on
+// first use in a lock free list), so recording is a timestamp, a bucket
+// computation and one store. Readers merge all threads without locking.
+
+// measured stages, LatencyStats::metricName() gives the printable name
+enum
+{
+    // OnRtnDepthMarketData entry to the tick being in the ingest ring
+    LAT_CALLBACK_TO_ENQUEUE,
+    // time spent queued in the ingest ring
+    LAT_QUEUE_WAIT,
+    // batch normalization, per tick
+    LAT_NORMALIZE,
+    // building the published message
+    LAT_SERIALIZE,
+    // connecting to the orchestrator
+    LAT_CONNECT,
+    // writing the message to the socket
+    LAT_SOCKET_WRITE,
+    // waiting for the orchestrator's reply
+    LAT_ACK,
+    // OnRtnDepthMarketData entry to the message written
+    LAT_TICK_TO_WIRE,
+    // ingest_server: a line complete in the read buffer to its reply queued
+    LAT_INGEST_LINE,
+    // ingest_server: a tick handed to the fanout to its line written to
+    // the subscribers
+    LAT_FANOUT,
+    // McastReceiver: a packet sent to the group to its messages delivered,
+    // recovery included; on CLOCK_REALTIME, so across hosts as good as
+    // their clock sync
+    LAT_MCAST,
+    // SpreadBook: a tick to the implied ticks of the spreads it is a leg of
+    LAT_SPREAD,
+    // OptionSurface: a batch's dirty chains to their volatilities and
+    // greeks, per chain
+    LAT_OPTION_CHAIN,
+    // OnRtnForQuoteRsp entry to the request's line written, through its
+    // own ring ahead of the ticks
+    LAT_FOR_QUOTE,
+    LAT_METRIC_COUNT
+};
+
+// histogram layout: values below 2^SUB_BITS exact, above that 2^(SUB_BITS-1)
+// buckets per power of two, i.e. about 3% resolution
+const int LAT_SUB_BITS = 6;
+const int LAT_BUCKETS = (64 - LAT_SUB_BITS + 1) * (1 << (LAT_SUB_BITS - 1)) + (1 << (LAT_SUB_BITS - 1));
+
+// timestamp in cycles (TSC) or, off x86, nanoseconds
+inline unsigned long long latency_now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+inline int latency_bucket(unsigned long long v)
+{
+    const int nHalf = 1 << (LAT_SUB_BITS - 1);
+    if (v < (1ULL << LAT_SUB_BITS))
+        return (int)v;
+    int nShift = 63 - __builtin_clzll(v) - (LAT_SUB_BITS - 1);
+    return 2 * nHalf + (nShift - 1) * nHalf + (int)(v >> nShift) - nHalf;
+}
+
+// text the reporter appends to its dumps, e.g. FeedMonitor's; bDetail is
+// true for the stats port, false for the file. Returns the length written
+typedef int (*LatencyReportSection)(char *pBuf, int nSize, bool bDetail, void *pContext);
+
+// largest dump served on the stats port, the section included
+const int LAT_REPORT_SIZE = 512 * 1024;
+
+// histograms owned by one thread
+struct ThreadLatency
+{
+    unsigned long long nCounts[LAT_METRIC_COUNT][LAT_BUCKETS];
+    unsigned long long nMax[LAT_METRIC_COUNT];
+    ThreadLatency *pNext;
+};
+
+class LatencyStats
+{
+public:
+    // record one stage of nCycles (difference of two latency_now() values)
+    static inline void record(int nMetric, unsigned long long nCycles)
+    {
+        ThreadLatency *p = s_pThread;
+        if (p == 0)
+            p = registerThread();
+        // single writer per block: plain increment, published with a
+        // relaxed store so a concurrent reader never sees a torn count
+        unsigned long long *pCount = &p->nCounts[nMetric][latency_bucket(nCycles)];
+        __atomic_store_n(pCount, *pCount + 1, __ATOMIC_RELAXED);
+        if (nCycles > p->nMax[nMetric])
+            __atomic_store_n(&p->nMax[nMetric], nCycles, __ATOMIC_RELAXED);
+    }
+
+    // record the stage from nStart to now, returns now for chaining
+    static inline unsigned long long stamp(int nMetric, unsigned long long nStart)
+    {
+        unsigned long long nNow = latency_now();
+        record(nMetric, nNow - nStart);
+        return nNow;
+    }
+
+    static const char *metricName(int nMetric);
+
+    // nanoseconds per latency_now() unit, calibrated once at startup
+    static double nsPerCycle();
+
+    // merged percentile table of all threads as text, returns its length
+    static int dump(char *pBuf, int nSize);
+
+    // dump every nIntervalSec seconds to pFile (appending, NULL for none)
+    // and serve the current dump to anyone connecting to 127.0.0.1:nPort
+    // (0 for none); returns false when the reporter could not start
+    static bool startReporter(const char *pFile, int nPort, int nIntervalSec);
+    static void stopReporter();
+
+    // append pSection's text to the reporter's dumps, NULL for none; waits
+    // for a report in the previous section, whose context may be freed
+    // once this returns
+    static void setReportSection(LatencyReportSection pSection, void *pContext);
+
+private:
+    static ThreadLatency *registerThread();
+
+    static __thread ThreadLatency *s_pThread;
+};
+
+#endif
@@ -0,0 +1,759 @@
+// McastFeed.cpp : sequenced multicast publisher and receiver with TCP recovery.
+//
+#include "McastFeed.h"
+#include "AsyncLogger.h"
+#include "LatencyStats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// datagrams read per recvmmsg()
+const int MCAST_RECV_BATCH = 32;
+// recovery bytes buffered per connection, a few dozen packets
+const int MCAST_RECOVERY_BUFFER = 64 * 1024;
+// longest wait for a recovery connect
+const int MCAST_CONNECT_TIMEOUT_MS = 100;
+
+unsigned long long mcast_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct McastRecoveryConnection
+{
+    int fd;
+    int nIn;
+    char chIn[sizeof(McastRequest)];
+    // packets [nNext, nEnd) still to be queued
+    unsigned long long nNext;
+    unsigned long long nEnd;
+    // queued bytes pOut[nSent, nOut)
+    char *pOut;
+    int nOut;
+    int nSent;
+};
+
+struct McastStream
+{
+    // the datagrams' source address with the recovery port
+    struct sockaddr_in recovery;
+    unsigned int nSession;
+    // next packet to deliver, 0 before the first
+    unsigned long long nExpected;
+    // a gap is open: requested up to, exclusive, when, and since when
+    unsigned long long nRequestedTo;
+    unsigned long long nRequestedAt;
+    unsigned long long nGapSince;
+    int fd;
+    char *pIn;
+    int nIn;
+    // packets ahead of nExpected by slot seq % MCAST_PENDING, 0 for none
+    char (*pPending)[MCAST_MAX_PACKET];
+    unsigned long long *pPendingSeq;
+    int nPending;
+};
+
+McastPublisher::McastPublisher() : m_fd(-1), m_nListener(-1), m_nSession(0), m_nRecoveryPort(0), m_nSeq(0),
+    m_nLastSend(0), m_nLength(sizeof(McastHeader)), m_nCount(0), m_nHistory(0), m_pHistory(NULL), m_pRecovery(NULL),
+    m_nMessages(0), m_nRetransmitted(0), m_nRequests(0), m_nGone(0)
+{
+}
+
+McastPublisher::~McastPublisher()
+{
+    if (m_pRecovery != NULL)
+    {
+        for (int i = 0; i < MCAST_MAX_RECOVERY; i++)
+        {
+            if (m_pRecovery[i].fd >= 0)
+                close(m_pRecovery[i].fd);
+            free(m_pRecovery[i].pOut);
+        }
+        free(m_pRecovery);
+    }
+    free(m_pHistory);
+    if (m_nListener >= 0)
+        close(m_nListener);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+bool McastPublisher::open(const char *pGroup, int nPort, const char *pInterface, int nTtl, int nRecoveryPort, int nHistory)
+{
+    if (nRecoveryPort == 0)
+        nRecoveryPort = nPort;
+    struct sockaddr_in group;
+    memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_port = htons(nPort);
+    if (inet_pton(AF_INET, pGroup, &group.sin_addr) != 1)
+        return false;
+
+    // a full socket buffer drops the datagram, the receivers recover it:
+    // the publisher never waits for the network
+    m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+        return false;
+    int nSize = 4 << 20;
+    setsockopt(m_fd, SOL_SOCKET, SO_SNDBUF, &nSize, sizeof(nSize));
+    if (pInterface != NULL)
+    {
+        struct in_addr addr;
+        if (inet_pton(AF_INET, pInterface, &addr) != 1 || setsockopt(m_fd, IPPROTO_IP, IP_MULTICAST_IF, &addr, sizeof(addr)) != 0)
+            return false;
+    }
+    unsigned char cTtl = nTtl;
+    unsigned char cLoop = 1;
+    setsockopt(m_fd, IPPROTO_IP, IP_MULTICAST_TTL, &cTtl, sizeof(cTtl));
+    // receivers on this host get the stream too
+    setsockopt(m_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &cLoop, sizeof(cLoop));
+    if (connect(m_fd, (struct sockaddr *)&group, sizeof(group)) != 0)
+        return false;
+
+    m_nListener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    setsockopt(m_nListener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(nRecoveryPort);
+    if (m_nListener < 0 || bind(m_nListener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(m_nListener, MCAST_MAX_RECOVERY) != 0)
+        return false;
+
+    m_nHistory = nHistory > 0 ? nHistory : MCAST_HISTORY;
+    m_pHistory = (char (*)[MCAST_MAX_PACKET])malloc(sizeof(*m_pHistory) * m_nHistory);
+    m_pRecovery = (McastRecoveryConnection *)calloc(MCAST_MAX_RECOVERY, sizeof(McastRecoveryConnection));
+    if (m_pHistory == NULL || m_pRecovery == NULL)
+        return false;
+    for (int i = 0; i < MCAST_MAX_RECOVERY; i++)
+    {
+        m_pRecovery[i].fd = -1;
+        m_pRecovery[i].pOut = (char *)malloc(MCAST_RECOVERY_BUFFER);
+        if (m_pRecovery[i].pOut == NULL)
+            return false;
+    }
+    // the nanosecond clock and the pid folded to 32 bits: two restarts in
+    // the same second, or two publishers started together, differ
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    unsigned long long nStart = ((unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec) ^ (unsigned long long)getpid() << 40;
+    m_nSession = (unsigned int)(nStart ^ nStart >> 32);
+    m_nRecoveryPort = nRecoveryPort;
+    return true;
+}
+
+bool McastPublisher::add(const char *pMessage, int nLength)
+{
+    if (nLength + 2 > MCAST_MAX_PACKET - (int)sizeof(McastHeader))
+        return false;
+    if (m_nLength + 2 + nLength > MCAST_MAX_PACKET || m_nCount == 0xffff)
+        flush();
+    unsigned short nShort = nLength;
+    memcpy(m_chPacket + m_nLength, &nShort, 2);
+    memcpy(m_chPacket + m_nLength + 2, pMessage, nLength);
+    m_nLength += 2 + nLength;
+    m_nCount++;
+    m_nMessages++;
+    return true;
+}
+
+void McastPublisher::flush()
+{
+    if (m_nCount == 0)
+        return;
+    McastHeader *pHeader = (McastHeader *)m_chPacket;
+    pHeader->nMagic = MCAST_MAGIC;
+    pHeader->nSession = m_nSession;
+    pHeader->nSeq = ++m_nSeq;
+    pHeader->nSendTime = mcast_now();
+    pHeader->nCount = m_nCount;
+    pHeader->nLength = m_nLength;
+    pHeader->nFlags = 0;
+    pHeader->nRecoveryPort = m_nRecoveryPort;
+    send(m_chPacket, m_nLength);
+    memcpy(m_pHistory[m_nSeq % m_nHistory], m_chPacket, m_nLength);
+    m_nLength = sizeof(McastHeader);
+    m_nCount = 0;
+}
+
+void McastPublisher::send(const char *pPacket, int nLength)
+{
+    if (::send(m_fd, pPacket, nLength, MSG_DONTWAIT) != nLength && errno != EAGAIN && errno != ENOBUFS)
+        FC_LOG(LOG_LEVEL_WARN, "multicast send failed, errno %d\n", errno);
+    m_nLastSend = ((McastHeader *)pPacket)->nSendTime;
+}
+
+void McastPublisher::poll()
+{
+    if (m_fd < 0)
+        return;
+    unsigned long long nNow = mcast_now();
+    if (nNow - m_nLastSend > MCAST_HEARTBEAT_MS * 1000000ULL)
+    {
+        McastHeader heartbeat;
+        heartbeat.nMagic = MCAST_MAGIC;
+        heartbeat.nSession = m_nSession;
+        heartbeat.nSeq = m_nSeq;
+        heartbeat.nSendTime = nNow;
+        heartbeat.nCount = 0;
+        heartbeat.nLength = sizeof(heartbeat);
+        heartbeat.nFlags = MCAST_FLAG_HEARTBEAT;
+        heartbeat.nRecoveryPort = m_nRecoveryPort;
+        send((const char *)&heartbeat, sizeof(heartbeat));
+    }
+
+    acceptRecovery();
+    for (int i = 0; i < MCAST_MAX_RECOVERY; i++)
+    {
+        McastRecoveryConnection *pConn = &m_pRecovery[i];
+        if (pConn->fd >= 0 && !serveRecovery(pConn))
+        {
+            close(pConn->fd);
+            pConn->fd = -1;
+        }
+    }
+}
+
+void McastPublisher::acceptRecovery()
+{
+    for (;;)
+    {
+        int fd = accept4(m_nListener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        int i = 0;
+        while (i < MCAST_MAX_RECOVERY && m_pRecovery[i].fd >= 0)
+            i++;
+        if (i == MCAST_MAX_RECOVERY)
+        {
+            FC_LOG(LOG_LEVEL_WARN, "%d recovery connections open, refusing another\n", MCAST_MAX_RECOVERY);
+            close(fd);
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        McastRecoveryConnection *pConn = &m_pRecovery[i];
+        pConn->fd = fd;
+        pConn->nIn = 0;
+        pConn->nNext = 0;
+        pConn->nEnd = 0;
+        pConn->nOut = 0;
+        pConn->nSent = 0;
+    }
+}
+
+// read the next request once the previous one is queued; -1 when the
+// connection is to be closed, 0 when none is complete
+int McastPublisher::readRequest(McastRecoveryConnection *pConn)
+{
+    while (pConn->nNext >= pConn->nEnd)
+    {
+        ssize_t n = recv(pConn->fd, pConn->chIn + pConn->nIn, sizeof(pConn->chIn) - pConn->nIn, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            return -1;
+        if (n < 0)
+            return 0;
+        pConn->nIn += n;
+        if (pConn->nIn < (int)sizeof(McastRequest))
+            continue;
+        pConn->nIn = 0;
+        McastRequest request;
+        memcpy(&request, pConn->chIn, sizeof(request));
+        if (request.nMagic != MCAST_MAGIC)
+            return -1;
+        m_nRequests++;
+        // a receiver behind a restart is ignored, the new session's
+        // datagrams reset it
+        if (request.nSession == m_nSession)
+        {
+            pConn->nNext = request.nFrom;
+            pConn->nEnd = request.nFrom + request.nCount;
+            // nothing past the last packet sent
+            if (pConn->nEnd > m_nSeq + 1)
+                pConn->nEnd = m_nSeq + 1;
+        }
+    }
+    return 1;
+}
+
+// answer the requests in order while the socket takes the packets; false
+// when the connection is to be closed
+bool McastPublisher::serveRecovery(McastRecoveryConnection *pConn)
+{
+    unsigned long long nOldest = m_nSeq >= (unsigned long long)m_nHistory ? m_nSeq - m_nHistory + 1 : 1;
+    for (;;)
+    {
+        // the requests left in the socket wait for this one, so a burst
+        // of them is answered in full and in order
+        int nRead = readRequest(pConn);
+        if (nRead < 0)
+            return false;
+        // queue whole packets while they fit
+        while (pConn->nNext < pConn->nEnd && pConn->nNext <= m_nSeq)
+        {
+            if (pConn->nNext < nOldest)
+            {
+                if (pConn->nOut + (int)sizeof(McastHeader) > MCAST_RECOVERY_BUFFER)
+                    break;
+                unsigned long long nTo = pConn->nEnd < nOldest ? pConn->nEnd : nOldest;
+                McastHeader gone;
+                memset(&gone, 0, sizeof(gone));
+                gone.nMagic = MCAST_MAGIC;
+                gone.nSession = m_nSession;
+                gone.nSeq = pConn->nNext;
+                gone.nSendTime = mcast_now();
+                gone.nCount = nTo - pConn->nNext > 0xffff ? 0xffff : nTo - pConn->nNext;
+                gone.nLength = sizeof(gone);
+                gone.nFlags = MCAST_FLAG_GONE;
+                gone.nRecoveryPort = m_nRecoveryPort;
+                memcpy(pConn->pOut + pConn->nOut, &gone, sizeof(gone));
+                pConn->nOut += sizeof(gone);
+                pConn->nNext += gone.nCount;
+                m_nGone += gone.nCount;
+                continue;
+            }
+            const char *pPacket = m_pHistory[pConn->nNext % m_nHistory];
+            int nLength = ((const McastHeader *)pPacket)->nLength;
+            if (pConn->nOut + nLength > MCAST_RECOVERY_BUFFER)
+                break;
+            memcpy(pConn->pOut + pConn->nOut, pPacket, nLength);
+            pConn->nOut += nLength;
+            pConn->nNext++;
+            m_nRetransmitted++;
+        }
+        if (pConn->nSent == pConn->nOut)
+        {
+            if (nRead == 0)
+                return true;
+            continue;
+        }
+
+        ssize_t n = ::send(pConn->fd, pConn->pOut + pConn->nSent, pConn->nOut - pConn->nSent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        pConn->nSent += n;
+        if (pConn->nSent < pConn->nOut)
+            return true;
+        pConn->nOut = 0;
+        pConn->nSent = 0;
+    }
+}
+
+McastReceiver::McastReceiver() : m_fd(-1), m_nStreams(0), m_dLossRate(0), m_nRandom(2463534242u), m_nDelivered(0),
+    m_nPackets(0), m_nRecovered(0), m_nLost(0), m_nDuplicates(0), m_nRequests(0)
+{
+    m_pStreams = (McastStream *)calloc(MCAST_MAX_STREAMS, sizeof(McastStream));
+    m_pBuffers = (char (*)[MCAST_MAX_PACKET])malloc(sizeof(*m_pBuffers) * MCAST_RECV_BATCH);
+}
+
+McastReceiver::~McastReceiver()
+{
+    for (int i = 0; i < m_nStreams; i++)
+    {
+        closeRecovery(&m_pStreams[i]);
+        free(m_pStreams[i].pIn);
+        free(m_pStreams[i].pPending);
+        free(m_pStreams[i].pPendingSeq);
+    }
+    free(m_pStreams);
+    free(m_pBuffers);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+bool McastReceiver::open(const char *pGroup, int nPort, const char *pInterface)
+{
+    struct ip_mreq mreq;
+    if (inet_pton(AF_INET, pGroup, &mreq.imr_multiaddr) != 1)
+        return false;
+    mreq.imr_interface.s_addr = INADDR_ANY;
+    if (pInterface != NULL && inet_pton(AF_INET, pInterface, &mreq.imr_interface) != 1)
+        return false;
+
+    m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0)
+        return false;
+    // several receivers on one host each get every datagram
+    int on = 1;
+    setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    int nSize = 8 << 20;
+    setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &nSize, sizeof(nSize));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr = mreq.imr_multiaddr;
+    addr.sin_port = htons(nPort);
+    if (bind(m_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        return false;
+    return setsockopt(m_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0;
+}
+
+McastStream *McastReceiver::findStream(const struct sockaddr_in &source, const McastHeader &header)
+{
+    for (int i = 0; i < m_nStreams; i++)
+    {
+        McastStream *pStream = &m_pStreams[i];
+        if (pStream->recovery.sin_addr.s_addr != source.sin_addr.s_addr || pStream->recovery.sin_port != htons(header.nRecoveryPort))
+            continue;
+        if (pStream->nSession != header.nSession)
+        {
+            // the publisher restarted: its sequence starts again
+            FC_LOG(LOG_LEVEL_INFO, "multicast stream %d restarted\n", i);
+            closeRecovery(pStream);
+            memset(pStream->pPendingSeq, 0, sizeof(unsigned long long) * MCAST_PENDING);
+            pStream->nPending = 0;
+            pStream->nSession = header.nSession;
+            pStream->nExpected = 0;
+            pStream->nRequestedTo = 0;
+            pStream->nGapSince = 0;
+        }
+        return pStream;
+    }
+    if (m_nStreams == MCAST_MAX_STREAMS)
+        return NULL;
+
+    McastStream *pStream = &m_pStreams[m_nStreams];
+    pStream->pIn = (char *)malloc(MCAST_RECOVERY_BUFFER);
+    pStream->pPending = (char (*)[MCAST_MAX_PACKET])malloc(sizeof(*pStream->pPending) * MCAST_PENDING);
+    pStream->pPendingSeq = (unsigned long long *)calloc(MCAST_PENDING, sizeof(unsigned long long));
+    if (pStream->pIn == NULL || pStream->pPending == NULL || pStream->pPendingSeq == NULL)
+        return NULL;
+    pStream->recovery = source;
+    pStream->recovery.sin_port = htons(header.nRecoveryPort);
+    pStream->nSession = header.nSession;
+    pStream->fd = -1;
+    FC_LOG(LOG_LEVEL_INFO, "multicast stream %d from %s, recovery port %d\n", m_nStreams, inet_ntoa(source.sin_addr),
+           header.nRecoveryPort);
+    m_nStreams++;
+    return pStream;
+}
+
+int McastReceiver::poll(McastHandler *pHandler)
+{
+    m_nDelivered = 0;
+
+    struct mmsghdr msgs[MCAST_RECV_BATCH];
+    struct iovec iov[MCAST_RECV_BATCH];
+    struct sockaddr_in sources[MCAST_RECV_BATCH];
+    for (;;)
+    {
+        for (int i = 0; i < MCAST_RECV_BATCH; i++)
+        {
+            iov[i].iov_base = m_pBuffers[i];
+            iov[i].iov_len = MCAST_MAX_PACKET;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &sources[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+        }
+        int n = recvmmsg(m_fd, msgs, MCAST_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0)
+            break;
+        for (int i = 0; i < n; i++)
+        {
+            const McastHeader *pHeader = (const McastHeader *)m_pBuffers[i];
+            if (msgs[i].msg_len < sizeof(McastHeader) || pHeader->nMagic != MCAST_MAGIC || pHeader->nLength != msgs[i].msg_len)
+                continue;
+            if (m_dLossRate > 0)
+            {
+                m_nRandom ^= m_nRandom << 13;
+                m_nRandom ^= m_nRandom >> 17;
+                m_nRandom ^= m_nRandom << 5;
+                if (m_nRandom < m_dLossRate * 4294967296.0)
+                    continue;
+            }
+            m_nPackets++;
+            McastStream *pStream = findStream(sources[i], *pHeader);
+            if (pStream != NULL)
+                onPacket(pStream, m_pBuffers[i], false, pHandler);
+        }
+        if (n < MCAST_RECV_BATCH)
+            break;
+    }
+
+    unsigned long long nNow = mcast_now();
+    for (int i = 0; i < m_nStreams; i++)
+    {
+        McastStream *pStream = &m_pStreams[i];
+        if (pStream->fd >= 0)
+            readRecovery(pStream, pHandler);
+        if (pStream->nGapSince == 0)
+            continue;
+        if (nNow - pStream->nGapSince > MCAST_GIVE_UP_MS * 1000000ULL)
+        {
+            // skip to the first packet held, or past what was asked for
+            unsigned long long nTo = pStream->nRequestedTo;
+            for (unsigned long long s = pStream->nExpected + 1; s < pStream->nExpected + MCAST_PENDING; s++)
+            {
+                if (pStream->pPendingSeq[s % MCAST_PENDING] == s)
+                {
+                    nTo = s;
+                    break;
+                }
+            }
+            skipTo(pStream, nTo, pHandler);
+        }
+        else if (nNow - pStream->nRequestedAt > MCAST_RETRY_MS * 1000000ULL)
+            request(pStream, pStream->nRequestedTo);
+    }
+    return m_nDelivered;
+}
+
+void McastReceiver::onPacket(McastStream *pStream, const char *pPacket, bool bRecovered, McastHandler *pHandler)
+{
+    const McastHeader *pHeader = (const McastHeader *)pPacket;
+    unsigned long long nSeq = pHeader->nSeq;
+    if (pHeader->nFlags & MCAST_FLAG_GONE)
+    {
+        if (pStream->nExpected >= nSeq && pStream->nExpected < nSeq + pHeader->nCount)
+            skipTo(pStream, nSeq + pHeader->nCount, pHandler);
+        return;
+    }
+    if (pHeader->nFlags & MCAST_FLAG_HEARTBEAT)
+    {
+        if (pStream->nExpected == 0)
+            pStream->nExpected = nSeq + 1;
+        else if (nSeq >= pStream->nExpected)
+            request(pStream, nSeq + 1);
+        return;
+    }
+
+    if (pStream->nExpected == 0)
+        pStream->nExpected = nSeq;
+    if (nSeq < pStream->nExpected || pStream->pPendingSeq[nSeq % MCAST_PENDING] == nSeq)
+    {
+        m_nDuplicates++;
+        return;
+    }
+    if (bRecovered)
+        m_nRecovered++;
+    if (nSeq == pStream->nExpected)
+    {
+        deliver(pStream, pPacket, pHandler);
+        pStream->nExpected++;
+        deliverPending(pStream, pHandler);
+        return;
+    }
+
+    // ahead of a gap: held, and the gap asked for
+    if (nSeq - pStream->nExpected >= (unsigned long long)MCAST_PENDING)
+        skipTo(pStream, nSeq - MCAST_PENDING + 1, pHandler);
+    if (nSeq == pStream->nExpected)
+    {
+        deliver(pStream, pPacket, pHandler);
+        pStream->nExpected++;
+        deliverPending(pStream, pHandler);
+        return;
+    }
+    int nSlot = nSeq % MCAST_PENDING;
+    memcpy(pStream->pPending[nSlot], pPacket, pHeader->nLength);
+    pStream->pPendingSeq[nSlot] = nSeq;
+    pStream->nPending++;
+    if (pStream->nGapSince == 0)
+        pStream->nGapSince = mcast_now();
+    request(pStream, nSeq);
+}
+
+void McastReceiver::deliver(McastStream *pStream, const char *pPacket, McastHandler *pHandler)
+{
+    const McastHeader *pHeader = (const McastHeader *)pPacket;
+    const char *p = pPacket + sizeof(McastHeader);
+    const char *pEnd = pPacket + pHeader->nLength;
+    long long nLatency = (long long)(mcast_now() - pHeader->nSendTime);
+    if (nLatency > 0)
+        LatencyStats::record(LAT_MCAST, (unsigned long long)(nLatency / LatencyStats::nsPerCycle()));
+    for (int i = 0; i < pHeader->nCount && p + 2 <= pEnd; i++)
+    {
+        unsigned short nLength;
+        memcpy(&nLength, p, 2);
+        if (p + 2 + nLength > pEnd)
+            break;
+        pHandler->onMessage(p + 2, nLength, *pHeader);
+        p += 2 + nLength;
+        m_nDelivered++;
+    }
+}
+
+// deliver the held packets that follow on, and close the gap once none
+// is missing
+void McastReceiver::deliverPending(McastStream *pStream, McastHandler *pHandler)
+{
+    while (pStream->nPending > 0)
+    {
+        int nSlot = pStream->nExpected % MCAST_PENDING;
+        if (pStream->pPendingSeq[nSlot] != pStream->nExpected)
+            break;
+        deliver(pStream, pStream->pPending[nSlot], pHandler);
+        pStream->pPendingSeq[nSlot] = 0;
+        pStream->nPending--;
+        pStream->nExpected++;
+    }
+    if (pStream->nPending == 0 && pStream->nExpected >= pStream->nRequestedTo)
+        pStream->nGapSince = 0;
+}
+
+// give up the missing packets before nSeq, delivering those held
+void McastReceiver::skipTo(McastStream *pStream, unsigned long long nSeq, McastHandler *pHandler)
+{
+    unsigned long long nLostFrom = 0;
+    while (pStream->nExpected < nSeq)
+    {
+        int nSlot = pStream->nExpected % MCAST_PENDING;
+        if (pStream->pPendingSeq[nSlot] == pStream->nExpected)
+        {
+            if (nLostFrom != 0)
+            {
+                pHandler->onLoss(pStream - m_pStreams, nLostFrom, pStream->nExpected - nLostFrom);
+                nLostFrom = 0;
+            }
+            deliver(pStream, pStream->pPending[nSlot], pHandler);
+            pStream->pPendingSeq[nSlot] = 0;
+            pStream->nPending--;
+        }
+        else
+        {
+            if (nLostFrom == 0)
+                nLostFrom = pStream->nExpected;
+            m_nLost++;
+        }
+        pStream->nExpected++;
+    }
+    if (nLostFrom != 0)
+    {
+        FC_LOG(LOG_LEVEL_WARN, "multicast stream %d: packets %llu to %llu lost\n", (int)(pStream - m_pStreams), nLostFrom,
+               pStream->nExpected - 1);
+        pHandler->onLoss(pStream - m_pStreams, nLostFrom, pStream->nExpected - nLostFrom);
+    }
+    if (pStream->nRequestedTo < pStream->nExpected)
+        pStream->nRequestedTo = pStream->nExpected;
+    pStream->nGapSince = 0;
+    deliverPending(pStream, pHandler);
+    // still a hole before the packets held
+    if (pStream->nPending > 0)
+        pStream->nGapSince = mcast_now();
+}
+
+// ask for the packets missing from nExpected up to nTo, exclusive, one
+// request per run not held; what was asked less than MCAST_RETRY_MS ago
+// is not asked again
+void McastReceiver::request(McastStream *pStream, unsigned long long nTo)
+{
+    unsigned long long nNow = mcast_now();
+    bool bRetry = nNow - pStream->nRequestedAt > MCAST_RETRY_MS * 1000000ULL;
+    if (nTo <= pStream->nRequestedTo && !bRetry)
+        return;
+    unsigned long long nFrom = pStream->nExpected;
+    if (!bRetry && pStream->nRequestedTo > nFrom)
+        nFrom = pStream->nRequestedTo;
+    if (nTo <= nFrom)
+        return;
+    if (pStream->nGapSince == 0)
+        pStream->nGapSince = nNow;
+    pStream->nRequestedAt = nNow;
+    if (nTo > pStream->nRequestedTo)
+        pStream->nRequestedTo = nTo;
+
+    if (pStream->fd < 0)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int nResult = fd >= 0 ? connect(fd, (struct sockaddr *)&pStream->recovery, sizeof(pStream->recovery)) : -1;
+        if (nResult != 0 && fd >= 0 && errno == EINPROGRESS)
+        {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            int nError = 0;
+            socklen_t nLen = sizeof(nError);
+            if (::poll(&pfd, 1, MCAST_CONNECT_TIMEOUT_MS) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &nError, &nLen) == 0 && nError == 0)
+                nResult = 0;
+        }
+        if (nResult != 0)
+        {
+            FC_LOG(LOG_LEVEL_WARN, "cannot connect to multicast recovery %s:%d\n", inet_ntoa(pStream->recovery.sin_addr),
+                   ntohs(pStream->recovery.sin_port));
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        pStream->fd = fd;
+        pStream->nIn = 0;
+    }
+
+    McastRequest req;
+    req.nMagic = MCAST_MAGIC;
+    req.nSession = pStream->nSession;
+    for (unsigned long long s = nFrom; s < nTo; )
+    {
+        if (pStream->pPendingSeq[s % MCAST_PENDING] == s)
+        {
+            s++;
+            continue;
+        }
+        req.nFrom = s;
+        while (s < nTo && pStream->pPendingSeq[s % MCAST_PENDING] != s)
+            s++;
+        req.nCount = s - req.nFrom;
+        if (::send(pStream->fd, &req, sizeof(req), MSG_NOSIGNAL | MSG_DONTWAIT) != sizeof(req))
+        {
+            closeRecovery(pStream);
+            return;
+        }
+        m_nRequests++;
+    }
+}
+
+void McastReceiver::readRecovery(McastStream *pStream, McastHandler *pHandler)
+{
+    for (;;)
+    {
+        ssize_t n = recv(pStream->fd, pStream->pIn + pStream->nIn, MCAST_RECOVERY_BUFFER - pStream->nIn, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            closeRecovery(pStream);
+            return;
+        }
+        if (n < 0)
+            return;
+        pStream->nIn += n;
+
+        char *p = pStream->pIn;
+        char *pEnd = pStream->pIn + pStream->nIn;
+        while (pEnd - p >= (int)sizeof(McastHeader))
+        {
+            const McastHeader *pHeader = (const McastHeader *)p;
+            if (pHeader->nMagic != MCAST_MAGIC || pHeader->nLength < sizeof(McastHeader) || pHeader->nLength > MCAST_MAX_PACKET)
+            {
+                closeRecovery(pStream);
+                return;
+            }
+            if (pEnd - p < pHeader->nLength)
+                break;
+            if (pHeader->nSession == pStream->nSession)
+                onPacket(pStream, p, true, pHandler);
+            p += pHeader->nLength;
+        }
+        pStream->nIn = pEnd - p;
+        if (p != pStream->pIn && pStream->nIn > 0)
+            memmove(pStream->pIn, p, pStream->nIn);
+    }
+}
+
+void McastReceiver::closeRecovery(McastStream *pStream)
+{
+    if (pStream->fd >= 0)
+        close(pStream->fd);
+    pStream->fd = -1;
+}
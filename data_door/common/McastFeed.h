@@ -0,0 +1,206 @@
+#ifndef __MCAST_FEED_H__
+#define __MCAST_FEED_H__
+
+#include <netinet/in.h>
+
+// UDP payload of one datagram, an Ethernet frame without IP and UDP headers
+const int MCAST_MAX_PACKET = 1472;
+// default packets a publisher keeps for retransmission
+const int MCAST_HISTORY = 16384;
+// out of order packets a receiver holds per stream while a gap is recovered
+const int MCAST_PENDING = 1024;
+// publishers a receiver follows at once
+const int MCAST_MAX_STREAMS = 16;
+// recovery connections a publisher serves at once
+const int MCAST_MAX_RECOVERY = 16;
+// a quiet publisher sends a heartbeat this often, so a lost last packet is
+// noticed
+const int MCAST_HEARTBEAT_MS = 500;
+// a retransmit request not answered is sent again after this
+const int MCAST_RETRY_MS = 100;
+// a gap still open after this is given up and reported lost
+const int MCAST_GIVE_UP_MS = 2000;
+
+const unsigned int MCAST_MAGIC = 0x46434d43;
+
+enum
+{
+    // no payload, nSeq is the last packet sent
+    MCAST_FLAG_HEARTBEAT = 1,
+    // recovery reply: the nCount packets from nSeq left the history
+    MCAST_FLAG_GONE = 2
+};
+
+#pragma pack(push, 1)
+// datagram header, host byte order as the DepthDeltaCodec frames; the
+// payload is nCount messages of a 2 byte length and the bytes
+struct McastHeader
+{
+    unsigned int nMagic;
+    // publisher start time and pid, a new session restarts the sequence
+    unsigned int nSession;
+    // packet number from 1, consecutive
+    unsigned long long nSeq;
+    // CLOCK_REALTIME nanoseconds at send()
+    unsigned long long nSendTime;
+    unsigned short nCount;
+    // header and payload
+    unsigned short nLength;
+    unsigned short nFlags;
+    // TCP port of the publisher's recovery service, on the datagrams'
+    // source address
+    unsigned short nRecoveryPort;
+};
+
+// sent to the recovery port: retransmit nCount packets from nFrom
+struct McastRequest
+{
+    unsigned int nMagic;
+    unsigned int nSession;
+    unsigned long long nFrom;
+    unsigned int nCount;
+};
+#pragma pack(pop)
+
+// CLOCK_REALTIME in nanoseconds, comparable between hosts kept in sync
+unsigned long long mcast_now();
+
+struct McastRecoveryConnection;
+
+// Sequenced multicast of small binary messages, e.g. DepthDeltaCodec
+// frames, with retransmission over TCP.
+//
+// add() packs messages into the current datagram; flush(), once per batch
+// or when the next message does not fit, sends it with the next sequence
+// number and keeps a copy in a ring of the last nHistory packets. poll(),
+// called by the same thread when idle, sends the heartbeats and serves the
+// recovery port: a request is answered with the packets from the ring, in
+// order, and a MCAST_FLAG_GONE header for those already overwritten.
+// Nothing blocks; a slow recovery client is served over several polls.
+//
+// One thread only, the publisher's.
+class McastPublisher
+{
+public:
+    McastPublisher();
+    ~McastPublisher();
+
+    // pInterface: address of the sending interface, NULL for the default
+    // route; nRecoveryPort 0 uses nPort
+    bool open(const char *pGroup, int nPort, const char *pInterface, int nTtl, int nRecoveryPort, int nHistory);
+
+    // false when the message cannot fit a datagram
+    bool add(const char *pMessage, int nLength);
+    void flush();
+    void poll();
+
+    unsigned long long packets() const { return m_nSeq; }
+    unsigned long long messages() const { return m_nMessages; }
+    unsigned long long retransmitted() const { return m_nRetransmitted; }
+    unsigned long long requests() const { return m_nRequests; }
+    unsigned long long gone() const { return m_nGone; }
+
+private:
+    void send(const char *pPacket, int nLength);
+    void acceptRecovery();
+    int readRequest(McastRecoveryConnection *pConn);
+    bool serveRecovery(McastRecoveryConnection *pConn);
+
+    int m_fd;
+    int m_nListener;
+    unsigned int m_nSession;
+    unsigned short m_nRecoveryPort;
+    unsigned long long m_nSeq;
+    unsigned long long m_nLastSend;
+    char m_chPacket[MCAST_MAX_PACKET];
+    int m_nLength;
+    int m_nCount;
+    int m_nHistory;
+    char (*m_pHistory)[MCAST_MAX_PACKET];
+    McastRecoveryConnection *m_pRecovery;
+
+    unsigned long long m_nMessages;
+    unsigned long long m_nRetransmitted;
+    unsigned long long m_nRequests;
+    unsigned long long m_nGone;
+};
+
+// what a receiver hands over
+class McastHandler
+{
+public:
+    virtual ~McastHandler() {}
+
+    // one message, in publication order per publisher
+    virtual void onMessage(const char *pMessage, int nLength, const McastHeader &header) = 0;
+
+    // nCount packets from nSeq could not be recovered and were skipped
+    virtual void onLoss(int nStream, unsigned long long nSeq, unsigned long long nCount) {}
+};
+
+struct McastStream;
+
+// Receiving side of McastPublisher.
+//
+// Follows every publisher sending to the group, told apart by source
+// address and recovery port. Packets are handed to the handler in sequence
+// order: one ahead of a gap waits in a window of MCAST_PENDING packets
+// while the missing ones are requested from the publisher's recovery port,
+// which is connected on the first gap. A request is repeated every
+// MCAST_RETRY_MS; a gap still open after MCAST_GIVE_UP_MS, or one wider
+// than the window, is skipped and reported through onLoss(). A receiver
+// joining mid-session starts at the first packet it sees.
+//
+// One thread; poll() never blocks, fd() can be waited on for readability.
+class McastReceiver
+{
+public:
+    McastReceiver();
+    ~McastReceiver();
+
+    // pInterface: address of the interface to join on, NULL for any
+    bool open(const char *pGroup, int nPort, const char *pInterface);
+
+    // read what arrived and hand it to pHandler; returns the number of
+    // messages delivered
+    int poll(McastHandler *pHandler);
+
+    int fd() const { return m_fd; }
+
+    // drop this share of the datagrams on arrival, to exercise recovery;
+    // after open(), receivers in one process then drop different ones
+    void setLossRate(double dRate) { m_dLossRate = dRate; m_nRandom += m_fd * 2654435761u; }
+
+    unsigned long long packets() const { return m_nPackets; }
+    unsigned long long recovered() const { return m_nRecovered; }
+    unsigned long long lost() const { return m_nLost; }
+    unsigned long long duplicates() const { return m_nDuplicates; }
+    unsigned long long requests() const { return m_nRequests; }
+
+private:
+    McastStream *findStream(const struct sockaddr_in &source, const McastHeader &header);
+    void onPacket(McastStream *pStream, const char *pPacket, bool bRecovered, McastHandler *pHandler);
+    void deliver(McastStream *pStream, const char *pPacket, McastHandler *pHandler);
+    void deliverPending(McastStream *pStream, McastHandler *pHandler);
+    void skipTo(McastStream *pStream, unsigned long long nSeq, McastHandler *pHandler);
+    void request(McastStream *pStream, unsigned long long nTo);
+    void readRecovery(McastStream *pStream, McastHandler *pHandler);
+    void closeRecovery(McastStream *pStream);
+
+    int m_fd;
+    // recvmmsg() batch
+    char (*m_pBuffers)[MCAST_MAX_PACKET];
+    McastStream *m_pStreams;
+    int m_nStreams;
+    double m_dLossRate;
+    unsigned int m_nRandom;
+    int m_nDelivered;
+
+    unsigned long long m_nPackets;
+    unsigned long long m_nRecovered;
+    unsigned long long m_nLost;
+    unsigned long long m_nDuplicates;
+    unsigned long long m_nRequests;
+};
+
+#endif
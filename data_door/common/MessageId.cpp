@@ -0,0 +1,99 @@
+// MessageId.cpp : publisher side message ids and their duplicate filter.
+//
+#include "MessageId.h"
+#include <stdlib.h>
+
+unsigned int MessageIdGenerator::s_nNode = 0;
+unsigned int MessageIdGenerator::s_nThreads = 0;
+__thread MessageIdGenerator::ThreadState MessageIdGenerator::s_state = { 0, 0 };
+
+// open addressing over twice the streams
+const int FILTER_TABLE_SIZE = MESSAGE_ID_STREAMS * 2;
+
+MessageIdFilter::MessageIdFilter() : m_nStreams(0), m_nClock(0), m_nEvicted(0)
+{
+    m_pStreams = (Stream *)calloc(FILTER_TABLE_SIZE, sizeof(Stream));
+}
+
+MessageIdFilter::~MessageIdFilter()
+{
+    free(m_pStreams);
+}
+
+unsigned int MessageIdFilter::home(unsigned long long hi) const
+{
+    unsigned long long h = hi * 0x9e3779b97f4a7c15ULL;
+    return (unsigned int)(h >> 32) & (FILTER_TABLE_SIZE - 1);
+}
+
+// a scan of the table, once per stream past MESSAGE_ID_STREAMS; the slot is
+// emptied by shifting back the entries probed past it
+void MessageIdFilter::evictOldest()
+{
+    unsigned int i = 0;
+    for (unsigned int n = 0; n < (unsigned int)FILTER_TABLE_SIZE; n++)
+    {
+        if (m_pStreams[n].bUsed && (!m_pStreams[i].bUsed || m_pStreams[n].nLastUsed < m_pStreams[i].nLastUsed))
+            i = n;
+    }
+    for (unsigned int j = (i + 1) & (FILTER_TABLE_SIZE - 1); m_pStreams[j].bUsed; j = (j + 1) & (FILTER_TABLE_SIZE - 1))
+    {
+        // j may move to i unless its home lies cyclically in (i, j]
+        unsigned int k = home(m_pStreams[j].hi);
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        m_pStreams[i] = m_pStreams[j];
+        i = j;
+    }
+    m_pStreams[i].bUsed = false;
+    m_nStreams--;
+    m_nEvicted++;
+}
+
+bool MessageIdFilter::seen(const MessageId &id)
+{
+    unsigned int nSlot = home(id.hi);
+    while (m_pStreams[nSlot].bUsed && m_pStreams[nSlot].hi != id.hi)
+        nSlot = (nSlot + 1) & (FILTER_TABLE_SIZE - 1);
+
+    Stream *p = &m_pStreams[nSlot];
+    unsigned long long nSeq = id.sequence();
+    m_nClock++;
+    if (!p->bUsed)
+    {
+        if (m_nStreams == MESSAGE_ID_STREAMS)
+        {
+            // the shift may have moved the free slot found
+            evictOldest();
+            nSlot = home(id.hi);
+            while (m_pStreams[nSlot].bUsed)
+                nSlot = (nSlot + 1) & (FILTER_TABLE_SIZE - 1);
+            p = &m_pStreams[nSlot];
+        }
+        m_nStreams++;
+        p->bUsed = true;
+        p->hi = id.hi;
+        p->nTop = nSeq;
+        p->nWindow = 1;
+        p->nLastUsed = m_nClock;
+        return false;
+    }
+    p->nLastUsed = m_nClock;
+
+    // bit i of the window is sequence nTop - i
+    if (nSeq > p->nTop)
+    {
+        unsigned long long nShift = nSeq - p->nTop;
+        p->nWindow = nShift < 64 ? (p->nWindow << nShift) | 1 : 1;
+        p->nTop = nSeq;
+        return false;
+    }
+    unsigned long long nBack = p->nTop - nSeq;
+    if (nBack >= 64)
+        return true;
+    unsigned long long nBit = 1ULL << nBack;
+    if (p->nWindow & nBit)
+        return true;
+    p->nWindow |= nBit;
+    return false;
+}
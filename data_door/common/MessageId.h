@@ -0,0 +1,169 @@
+#ifndef __MESSAGE_ID_H__
+#define __MESSAGE_ID_H__
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "UuidGenerator.h"
+
+// 128 bit id a publisher stamps on its own messages, written like a uuid
+// (UUID_TEXT_LENGTH characters) so it travels where the listener's uuids
+// did:
+//   hi  node:16 | thread:16 | pid high 16 | version 8:4 | pid low 12
+//   lo  variant 10:2 | sequence:62
+// The sequence of a thread starts at the CLOCK_REALTIME nanosecond of the
+// thread's first id and counts up by one, so ids are unique per node
+// across restarts as long as a thread averages less than one id per
+// nanosecond. Version 8 (custom) tells them from the server's random v4
+// uuids.
+struct MessageId
+{
+    unsigned long long hi;
+    unsigned long long lo;
+
+    bool operator==(const MessageId &o) const { return hi == o.hi && lo == o.lo; }
+
+    // UUID_TEXT_LENGTH characters into pOut, no terminator
+    void format(char *pOut) const
+    {
+        static const char s_chHex[] = "0123456789abcdef";
+        // text offset of each byte's two digits
+        static const unsigned char s_nAt[16] = { 0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34 };
+        pOut[8] = pOut[13] = pOut[18] = pOut[23] = '-';
+        for (int i = 0; i < 16; i++)
+        {
+            unsigned int b = (unsigned int)((i < 8 ? hi : lo) >> (56 - 8 * (i & 7))) & 0xff;
+            pOut[s_nAt[i]] = s_chHex[b >> 4];
+            pOut[s_nAt[i] + 1] = s_chHex[b & 15];
+        }
+    }
+
+    // false unless p is a version 8 id as format() writes it
+    bool parse(const char *p)
+    {
+        static const unsigned char s_nAt[16] = { 0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34 };
+        if (p[8] != '-' || p[13] != '-' || p[18] != '-' || p[23] != '-')
+            return false;
+        unsigned long long v[2] = { 0, 0 };
+        // a non hex digit sets bit 4 of its value, caught once at the end
+        unsigned int nBad = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            unsigned int d1 = hexValue(p[s_nAt[i]]);
+            unsigned int d2 = hexValue(p[s_nAt[i] + 1]);
+            nBad |= d1 | d2;
+            v[i >> 3] = v[i >> 3] << 8 | (d1 << 4 | d2);
+        }
+        if ((nBad & 16) || ((v[0] >> 12) & 15) != 8 || (v[1] >> 62) != 2)
+            return false;
+        hi = v[0];
+        lo = v[1];
+        return true;
+    }
+
+    static unsigned int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return 16;
+    }
+
+    // the stream (node, thread and process) the id belongs to
+    unsigned long long stream() const { return hi; }
+    unsigned long long sequence() const { return lo & 0x3fffffffffffffffULL; }
+};
+
+// Per thread MessageId source. next() is a thread local increment: wait
+// free, no lock, no system call after the thread's first id.
+class MessageIdGenerator
+{
+public:
+    // node id from the node_id setting, before the first next()
+    static void setNode(unsigned int nNode) { s_nNode = nNode & 0xffff; }
+
+    static MessageId next()
+    {
+        ThreadState *p = &s_state;
+        if (p->lo == 0)
+            start(p);
+        MessageId id;
+        id.hi = p->hi;
+        id.lo = p->lo++;
+        return id;
+    }
+
+private:
+    struct ThreadState
+    {
+        unsigned long long hi;
+        unsigned long long lo;
+    };
+
+    static void start(ThreadState *p)
+    {
+        unsigned int nThread = __atomic_fetch_add(&s_nThreads, 1, __ATOMIC_RELAXED) & 0xffff;
+        unsigned long long nPid = (unsigned long long)getpid() & 0x0fffffff;
+        p->hi = (unsigned long long)s_nNode << 48 | (unsigned long long)nThread << 32 |
+                (nPid >> 12) << 16 | 0x8000ULL | (nPid & 0xfff);
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        unsigned long long nNs = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        p->lo = 0x8000000000000000ULL | (nNs & 0x3fffffffffffffffULL);
+    }
+
+    static unsigned int s_nNode;
+    static unsigned int s_nThreads;
+    static __thread ThreadState s_state;
+};
+
+// streams tracked by a MessageIdFilter
+const int MESSAGE_ID_STREAMS = 4096;
+
+// Duplicate detection for ids that may be resent, the ingest server's side
+// of idempotent retries.
+//
+// Ids of one stream arrive mostly in order, so each stream keeps the
+// highest sequence seen and a 64 bit window of the sequences just below
+// it, the IPsec anti-replay scheme: an id at or below the window's bottom,
+// or with its window bit set, has been seen. A new stream arriving at a
+// full table evicts the one idle the longest, in ids seen since its last;
+// the streams of publisher runs that ended, the journal's oldest first,
+// so a resent id of an evicted stream would pass as new.
+class MessageIdFilter
+{
+public:
+    MessageIdFilter();
+    ~MessageIdFilter();
+
+    // true when the id was seen before; marks it seen otherwise
+    bool seen(const MessageId &id);
+
+    int streams() const { return m_nStreams; }
+    unsigned long long evicted() const { return m_nEvicted; }
+
+private:
+    struct Stream
+    {
+        unsigned long long hi;
+        unsigned long long nTop;
+        unsigned long long nWindow;
+        // m_nClock at the stream's last id
+        unsigned long long nLastUsed;
+        bool bUsed;
+    };
+
+    unsigned int home(unsigned long long hi) const;
+    void evictOldest();
+
+    Stream *m_pStreams;
+    int m_nStreams;
+    // ids seen, the age of the streams
+    unsigned long long m_nClock;
+    unsigned long long m_nEvicted;
+};
+
+#endif
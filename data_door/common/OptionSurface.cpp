@@ -0,0 +1,740 @@
+// OptionSurface.cpp : Black-76 implied volatility and greeks of option chains.
+//
+#include "OptionSurface.h"
+#include "AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OPTION_SURFACE_X86
+#endif
+
+// prices at or above this are sentinels (the exchange sends DBL_MAX)
+static const double PRICE_SENTINEL = 1e300;
+// options expire at the close of their ExpireDate
+static const int EXPIRY_SECOND = 15 * 3600;
+static const double YEAR_SECONDS = 365.0 * 86400;
+// search bounds and the step taken as converged, the error after it is
+// of the order of its square
+static const double VOL_MIN = 1e-4;
+static const double VOL_MAX = 5.0;
+static const double VOL_START_MIN = 0.01;
+static const double VOL_TOLERANCE = 1e-6;
+
+// lane arrays of a chain, OPTION_CHAIN_SIZE doubles each
+enum
+{
+    // the option, set once; sign +1 for a call, -1 for a put
+    LANE_STRIKE,
+    LANE_LOG_STRIKE,
+    LANE_SIGN,
+    // premium as quoted, 0 without one
+    LANE_PRICE,
+    // per refresh: the out of the money side solved for, undiscounted, and
+    // whether it has a volatility at all (1 or 0)
+    LANE_TARGET,
+    LANE_TARGET_SIGN,
+    LANE_VALID,
+    // outputs
+    LANE_VOL,
+    LANE_DELTA,
+    LANE_GAMMA,
+    LANE_VEGA,
+    LANE_THETA,
+    LANE_COUNT
+};
+
+// one cache line longer than the chain, as in IndicatorEngine
+const int LANE_STRIDE = OPTION_CHAIN_SIZE + 8;
+
+struct OptionChain
+{
+    TThostFtdcInstrumentIDType chUnderlying;
+    TThostFtdcInstrumentIDType chProduct;
+    TThostFtdcDateType chExpire;
+    // days since 1970
+    int nExpireDay;
+    // next chain of the underlying, -1 for the last
+    int nNext;
+    int nOptions;
+    bool bDirty;
+    // the underlying has ticked, the spot parameters no longer apply
+    bool bTicked;
+    double dForward;
+    // time to expiry of the last refresh
+    double dYears;
+    TThostFtdcInstrumentIDType chOption[OPTION_CHAIN_SIZE];
+    OptionGreeks greeks[OPTION_CHAIN_SIZE];
+    double dLanes[LANE_COUNT * LANE_STRIDE];
+};
+
+// what a pass needs besides the lanes, the same for the whole chain
+struct ChainInputs
+{
+    double dForward;
+    double dLogForward;
+    double dYears;
+    double dSqrtYears;
+    double dDiscount;
+    double dRate;
+};
+
+#define LANE(n) (pLanes + (n) * LANE_STRIDE)
+
+// days since 1970 of "YYYYMMDD", -1 when it is no date
+static int parse_day(const char *p)
+{
+    int y = 0, m = 0, d = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        if (p[i] < '0' || p[i] > '9')
+            return -1;
+        int c = p[i] - '0';
+        if (i < 4)
+            y = y * 10 + c;
+        else if (i < 6)
+            m = m * 10 + c;
+        else
+            d = d * 10 + c;
+    }
+    if (m < 1 || m > 12 || d < 1 || d > 31)
+        return -1;
+    // days from the civil date, counting years from March
+    y -= m <= 2;
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// seconds of the day of "HH:MM:SS", -1 when it is no time
+static int parse_second(const char *p)
+{
+    if (p[0] < '0' || p[0] > '2' || p[2] != ':' || p[5] != ':')
+        return -1;
+    return ((p[0] - '0') * 10 + p[1] - '0') * 3600 + ((p[3] - '0') * 10 + p[4] - '0') * 60 + (p[6] - '0') * 10 + p[7] - '0';
+}
+
+// |v| * 10^nDecimals rounded and written without printf, a chain's surface
+// has over a thousand numbers; at most 32 characters
+static char *append_fixed(char *p, double v, int nDecimals)
+{
+    static const double s_scale[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10 };
+    double s = fabs(v) * s_scale[nDecimals] + 0.5;
+    if (!(s < 9e18))
+        return p + snprintf(p, 32, "%.10g", v);
+    unsigned long long n = (unsigned long long)s;
+    char digits[24];
+    int nDigits = 0;
+    do
+    {
+        digits[nDigits++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n != 0 || nDigits <= nDecimals);
+    bool bZero = true;
+    for (int i = 0; i < nDigits && bZero; i++)
+        bZero = digits[i] == '0';
+    if (v < 0 && !bZero)
+        *p++ = '-';
+    while (nDigits > 0)
+    {
+        if (nDigits == nDecimals)
+            *p++ = '.';
+        *p++ = digits[--nDigits];
+    }
+    return p;
+}
+
+int option_table_line(const CThostFtdcInstrumentField &instrument, char *pBuf, int nSize)
+{
+    if (instrument.ProductClass != THOST_FTDC_PC_Options && instrument.ProductClass != THOST_FTDC_PC_SpotOption)
+        return -1;
+    if (instrument.OptionsType != THOST_FTDC_CP_CallOptions && instrument.OptionsType != THOST_FTDC_CP_PutOptions)
+        return -1;
+    if (instrument.UnderlyingInstrID[0] == '\0' || !(instrument.StrikePrice > 0))
+        return -1;
+    int n = snprintf(pBuf, nSize, "option %s %s %s %c %.4f %s\n", instrument.InstrumentID, instrument.UnderlyingInstrID,
+                     instrument.ProductID[0] != '\0' ? instrument.ProductID : "-",
+                     instrument.OptionsType == THOST_FTDC_CP_CallOptions ? 'C' : 'P', instrument.StrikePrice, instrument.ExpireDate);
+    return n >= 0 && n < nSize ? n : -1;
+}
+
+int option_spot_line(const CKSSpotOptionParamsField &params, char *pBuf, int nSize)
+{
+    if (params.ProductID[0] == '\0' || !(params.StockPreClosePrice > 0) || params.StockPreClosePrice >= PRICE_SENTINEL)
+        return -1;
+    int n = snprintf(pBuf, nSize, "spot %s %.4f\n", params.ProductID, params.StockPreClosePrice);
+    return n >= 0 && n < nSize ? n : -1;
+}
+
+// Numerical Recipes' erfcc, Chebyshev fitted, relative error below 1.2e-7
+// everywhere, tails included
+static inline double erfc_cheb(double x)
+{
+    double z = fabs(x);
+    double t = 1 / (1 + 0.5 * z);
+    double r = t * exp(-z * z - 1.26551223 + t * (1.00002368 + t * (0.37409196 + t * (0.09678418 + t * (-0.18628806 + t * (0.27886807 +
+                      t * (-1.13520398 + t * (1.48851587 + t * (-0.82215223 + t * 0.17087277)))))))));
+    return x >= 0 ? r : 2 - r;
+}
+
+static inline double norm_cdf(double x)
+{
+    return 0.5 * erfc_cheb(-x * M_SQRT1_2);
+}
+
+static inline double norm_pdf(double x)
+{
+    return exp(-0.5 * x * x) * 0.3989422804014327;
+}
+
+static void run_scalar(double *pLanes, int nFrom, int nTo, const ChainInputs &in)
+{
+    const double F = in.dForward;
+    for (int i = nFrom; i < nTo; i++)
+    {
+        if (LANE(LANE_VALID)[i] < 0.5)
+        {
+            LANE(LANE_VOL)[i] = LANE(LANE_DELTA)[i] = LANE(LANE_GAMMA)[i] = LANE(LANE_VEGA)[i] = LANE(LANE_THETA)[i] = 0;
+            continue;
+        }
+        double K = LANE(LANE_STRIKE)[i];
+        double x = in.dLogForward - LANE(LANE_LOG_STRIKE)[i];
+        double p = LANE(LANE_TARGET)[i];
+        double ts = LANE(LANE_TARGET_SIGN)[i];
+
+        // the last refresh's volatility, or Manaster-Koehler: the
+        // inflection point of the price in the volatility, from which the
+        // search converges monotonically
+        double vol = sqrt(2 * fabs(x) / in.dYears);
+        vol = vol > VOL_START_MIN ? vol : VOL_START_MIN;
+        vol = vol < VOL_MAX ? vol : VOL_MAX;
+        vol = LANE(LANE_VOL)[i] > 0 ? LANE(LANE_VOL)[i] : vol;
+        bool bDone = false;
+        for (int k = 0; k < OPTION_MAX_ITERATIONS && !bDone; k++)
+        {
+            double sv = vol * in.dSqrtYears;
+            double d1 = x / sv + 0.5 * sv;
+            double d2 = d1 - sv;
+            double b = ts * (F * norm_cdf(ts * d1) - K * norm_cdf(ts * d2));
+            // Halley: the Newton step over 1 - step * volga / (2 vega),
+            // volga / vega = d1 d2 / vol; kept within twice the Newton step
+            double step = (b - p) / (F * norm_pdf(d1) * in.dSqrtYears);
+            double den = 1 - 0.5 * step * d1 * d2 / vol;
+            step /= den > 0.5 ? den : 0.5;
+            bDone = fabs(step) < VOL_TOLERANCE;
+            vol -= step;
+            // a NaN step lands on VOL_MAX, as in the vector pass
+            vol = vol < VOL_MAX ? vol : VOL_MAX;
+            vol = vol > VOL_MIN ? vol : VOL_MIN;
+        }
+
+        if (!bDone)
+        {
+            LANE(LANE_VOL)[i] = LANE(LANE_DELTA)[i] = LANE(LANE_GAMMA)[i] = LANE(LANE_VEGA)[i] = LANE(LANE_THETA)[i] = 0;
+            continue;
+        }
+        // greeks of the option itself
+        double s = LANE(LANE_SIGN)[i];
+        double sv = vol * in.dSqrtYears;
+        double d1 = x / sv + 0.5 * sv;
+        double d2 = d1 - sv;
+        double pdf = norm_pdf(d1);
+        double nd1 = norm_cdf(s * d1);
+        double value = in.dDiscount * s * (F * nd1 - K * norm_cdf(s * d2));
+        LANE(LANE_VOL)[i] = vol;
+        LANE(LANE_DELTA)[i] = s * in.dDiscount * nd1;
+        LANE(LANE_GAMMA)[i] = in.dDiscount * pdf / (F * sv);
+        LANE(LANE_VEGA)[i] = in.dDiscount * F * pdf * in.dSqrtYears * 0.01;
+        LANE(LANE_THETA)[i] = (-in.dDiscount * F * pdf * vol / (2 * in.dSqrtYears) + in.dRate * value) / 365;
+    }
+}
+
+#ifdef OPTION_SURFACE_X86
+// exp() four at a time: x = n ln2 + r with |r| <= ln2 / 2, exp(r) by its
+// Taylor series to r^11 (relative error near 1e-15) and 2^n built
+// straight in the exponent bits
+__attribute__((target("avx2")))
+static inline __m256d exp_pd(__m256d x)
+{
+    x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(708.0)), _mm256_set1_pd(-708.0));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    // ln2 in two parts, n * the first is exact
+    __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, _mm256_set1_pd(6.93145751953125e-1)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(n, _mm256_set1_pd(1.42860682030941723212e-6)));
+    static const double s_inverse[] = { 1.0 / 39916800, 1.0 / 3628800, 1.0 / 362880, 1.0 / 40320, 1.0 / 5040, 1.0 / 720,
+                                         1.0 / 120, 1.0 / 24, 1.0 / 6, 0.5, 1.0, 1.0 };
+    __m256d e = _mm256_set1_pd(s_inverse[0]);
+    for (int k = 1; k < 12; k++)
+        e = _mm256_add_pd(_mm256_mul_pd(e, r), _mm256_set1_pd(s_inverse[k]));
+    // n + 1023 lands in the low mantissa bits of 2^52 + n + 1023
+    __m256i bits = _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(4503599627370496.0 + 1023)));
+    __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(bits, 52));
+    return _mm256_mul_pd(e, scale);
+}
+
+__attribute__((target("avx2")))
+static inline __m256d norm_cdf_pd(__m256d x)
+{
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    // erfc_cheb(-x / sqrt(2))
+    __m256d y = _mm256_mul_pd(x, _mm256_set1_pd(-M_SQRT1_2));
+    __m256d z = _mm256_andnot_pd(signBit, y);
+    __m256d t = _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_add_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_set1_pd(0.5), z)));
+    static const double s_coef[] = { 0.17087277, -0.82215223, 1.48851587, -1.13520398, 0.27886807, -0.18628806, 0.09678418,
+                                     0.37409196, 1.00002368, -1.26551223 };
+    __m256d poly = _mm256_set1_pd(s_coef[0]);
+    for (int k = 1; k < 10; k++)
+        poly = _mm256_add_pd(_mm256_mul_pd(poly, t), _mm256_set1_pd(s_coef[k]));
+    __m256d r = _mm256_mul_pd(t, exp_pd(_mm256_sub_pd(poly, _mm256_mul_pd(z, z))));
+    r = _mm256_blendv_pd(_mm256_sub_pd(_mm256_set1_pd(2.0), r), r, _mm256_cmp_pd(y, _mm256_setzero_pd(), _CMP_GE_OQ));
+    return _mm256_mul_pd(r, _mm256_set1_pd(0.5));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d norm_pdf_pd(__m256d x)
+{
+    return _mm256_mul_pd(exp_pd(_mm256_mul_pd(_mm256_mul_pd(x, x), _mm256_set1_pd(-0.5))), _mm256_set1_pd(0.3989422804014327));
+}
+
+// the same pass four options at a time; a lane converged, or without a
+// volatility from the start, keeps its value while the others iterate, so
+// every lane takes the steps the scalar pass would. Returns where the
+// scalar tail starts
+__attribute__((target("avx2")))
+static int run_avx2(double *pLanes, int nOptions, const ChainInputs &in)
+{
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    const __m256d F = _mm256_set1_pd(in.dForward);
+    const __m256d logF = _mm256_set1_pd(in.dLogForward);
+    const __m256d sqrtT = _mm256_set1_pd(in.dSqrtYears);
+    const __m256d DF = _mm256_set1_pd(in.dDiscount);
+    const __m256d volMin = _mm256_set1_pd(VOL_MIN);
+    const __m256d volMax = _mm256_set1_pd(VOL_MAX);
+    const __m256d tolerance = _mm256_set1_pd(VOL_TOLERANCE);
+
+    int i = 0;
+    for (; i + 4 <= nOptions; i += 4)
+    {
+#define LOAD(n) _mm256_loadu_pd(LANE(n) + i)
+#define STORE(n, v) _mm256_storeu_pd(LANE(n) + i, v)
+        __m256d K = LOAD(LANE_STRIKE);
+        __m256d x = _mm256_sub_pd(logF, LOAD(LANE_LOG_STRIKE));
+        __m256d p = LOAD(LANE_TARGET);
+        __m256d ts = LOAD(LANE_TARGET_SIGN);
+
+        __m256d vol = _mm256_sqrt_pd(_mm256_div_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), _mm256_andnot_pd(signBit, x)),
+                                                   _mm256_set1_pd(in.dYears)));
+        vol = _mm256_min_pd(_mm256_max_pd(vol, _mm256_set1_pd(VOL_START_MIN)), volMax);
+        __m256d last = LOAD(LANE_VOL);
+        vol = _mm256_blendv_pd(vol, last, _mm256_cmp_pd(last, _mm256_setzero_pd(), _CMP_GT_OQ));
+        __m256d valid = _mm256_cmp_pd(LOAD(LANE_VALID), half, _CMP_GT_OQ);
+        __m256d done = _mm256_andnot_pd(valid, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)));
+        for (int k = 0; k < OPTION_MAX_ITERATIONS && _mm256_movemask_pd(done) != 0xf; k++)
+        {
+            __m256d sv = _mm256_mul_pd(vol, sqrtT);
+            __m256d d1 = _mm256_add_pd(_mm256_div_pd(x, sv), _mm256_mul_pd(half, sv));
+            __m256d d2 = _mm256_sub_pd(d1, sv);
+            __m256d b = _mm256_mul_pd(ts, _mm256_sub_pd(_mm256_mul_pd(F, norm_cdf_pd(_mm256_mul_pd(ts, d1))),
+                                                        _mm256_mul_pd(K, norm_cdf_pd(_mm256_mul_pd(ts, d2)))));
+            __m256d step = _mm256_div_pd(_mm256_sub_pd(b, p), _mm256_mul_pd(_mm256_mul_pd(F, norm_pdf_pd(d1)), sqrtT));
+            __m256d den = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(half, step), _mm256_mul_pd(d1, d2)), vol));
+            step = _mm256_div_pd(step, _mm256_max_pd(den, half));
+            __m256d next = _mm256_sub_pd(vol, step);
+            next = _mm256_max_pd(_mm256_min_pd(next, volMax), volMin);
+            vol = _mm256_blendv_pd(next, vol, done);
+            done = _mm256_or_pd(done, _mm256_cmp_pd(_mm256_andnot_pd(signBit, step), tolerance, _CMP_LT_OQ));
+        }
+
+        __m256d ok = _mm256_and_pd(done, valid);
+        __m256d s = LOAD(LANE_SIGN);
+        __m256d sv = _mm256_mul_pd(vol, sqrtT);
+        __m256d d1 = _mm256_add_pd(_mm256_div_pd(x, sv), _mm256_mul_pd(half, sv));
+        __m256d d2 = _mm256_sub_pd(d1, sv);
+        __m256d pdf = norm_pdf_pd(d1);
+        __m256d nd1 = norm_cdf_pd(_mm256_mul_pd(s, d1));
+        __m256d value = _mm256_mul_pd(_mm256_mul_pd(DF, s),
+                                      _mm256_sub_pd(_mm256_mul_pd(F, nd1), _mm256_mul_pd(K, norm_cdf_pd(_mm256_mul_pd(s, d2)))));
+        __m256d dfPdf = _mm256_mul_pd(DF, pdf);
+        STORE(LANE_VOL, _mm256_and_pd(vol, ok));
+        STORE(LANE_DELTA, _mm256_and_pd(_mm256_mul_pd(_mm256_mul_pd(s, DF), nd1), ok));
+        STORE(LANE_GAMMA, _mm256_and_pd(_mm256_div_pd(dfPdf, _mm256_mul_pd(F, sv)), ok));
+        STORE(LANE_VEGA, _mm256_and_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(dfPdf, F), sqrtT), _mm256_set1_pd(0.01)), ok));
+        __m256d decay = _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(dfPdf, F), vol), _mm256_mul_pd(_mm256_set1_pd(2.0), sqrtT));
+        __m256d theta = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(in.dRate), value), decay), _mm256_set1_pd(365.0));
+        STORE(LANE_THETA, _mm256_and_pd(theta, ok));
+#undef LOAD
+#undef STORE
+    }
+    return i;
+}
+#endif
+
+OptionSurface::OptionSurface() : m_dRate(0), m_nToday(-1), m_nSecond(0), m_nOptions(0), m_nChains(0), m_nDirty(0)
+{
+#ifdef OPTION_SURFACE_X86
+    __builtin_cpu_init();
+    m_bCpuAvx2 = __builtin_cpu_supports("avx2");
+#else
+    m_bCpuAvx2 = false;
+#endif
+    m_bAvx2 = m_bCpuAvx2;
+    memset(m_chDay, 0, sizeof(m_chDay));
+    m_pSlotChain = new int[MAX_INSTRUMENTS];
+    m_pSlotOption = new int[MAX_INSTRUMENTS];
+    m_pFirstChain = new int[MAX_INSTRUMENTS];
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+        m_pSlotChain[i] = m_pSlotOption[i] = m_pFirstChain[i] = -1;
+    // chains are allocated as they are created, most tables have few
+    m_pChains = new OptionChain *[MAX_OPTION_CHAINS];
+    m_pDirty = new int[MAX_OPTION_CHAINS];
+    m_pChanged = new int[MAX_OPTION_CHAINS];
+}
+
+OptionSurface::~OptionSurface()
+{
+    for (int c = 0; c < m_nChains; c++)
+        delete m_pChains[c];
+    delete[] m_pChains;
+    delete[] m_pSlotChain;
+    delete[] m_pSlotOption;
+    delete[] m_pFirstChain;
+    delete[] m_pDirty;
+    delete[] m_pChanged;
+}
+
+void OptionSurface::useAvx2(bool bUse)
+{
+    m_bAvx2 = bUse && m_bCpuAvx2;
+}
+
+int OptionSurface::chainOf(const char *pUnderlyingID, const char *pExpireDate, const char *pProductID)
+{
+    for (int c = 0; c < m_nChains; c++)
+    {
+        if (strcmp(m_pChains[c]->chUnderlying, pUnderlyingID) == 0 && strcmp(m_pChains[c]->chExpire, pExpireDate) == 0)
+            return c;
+    }
+    int nSlot = m_nChains < MAX_OPTION_CHAINS ? m_index.insert(pUnderlyingID) : -1;
+    if (nSlot < 0)
+        return -1;
+    OptionChain *pChain = new OptionChain;
+    memset(pChain, 0, sizeof(OptionChain));
+    strncpy(pChain->chUnderlying, pUnderlyingID, sizeof(pChain->chUnderlying) - 1);
+    strncpy(pChain->chProduct, pProductID, sizeof(pChain->chProduct) - 1);
+    strncpy(pChain->chExpire, pExpireDate, sizeof(pChain->chExpire) - 1);
+    pChain->nExpireDay = parse_day(pExpireDate);
+    pChain->nNext = m_pFirstChain[nSlot];
+    m_pFirstChain[nSlot] = m_nChains;
+    m_pChains[m_nChains] = pChain;
+    return m_nChains++;
+}
+
+bool OptionSurface::addOption(const char *pOptionID, const char *pUnderlyingID, const char *pProductID, char cType, double dStrike,
+                              const char *pExpireDate)
+{
+    if (cType != THOST_FTDC_CP_CallOptions && cType != THOST_FTDC_CP_PutOptions)
+        return false;
+    if (!(dStrike > 0) || !isfinite(dStrike) || parse_day(pExpireDate) < 0 || strlen(pExpireDate) != 8)
+        return false;
+    size_t nMax = sizeof(TThostFtdcInstrumentIDType) - 1;
+    if (*pOptionID == '\0' || *pUnderlyingID == '\0' || strlen(pOptionID) > nMax || strlen(pUnderlyingID) > nMax ||
+        strlen(pProductID) > nMax || strcmp(pOptionID, pUnderlyingID) == 0)
+        return false;
+    int nSlot = m_index.find(pOptionID);
+    if (nSlot >= 0 && (m_pSlotChain[nSlot] >= 0 || m_pFirstChain[nSlot] >= 0))
+        return false;
+
+    int c = chainOf(pUnderlyingID, pExpireDate, pProductID);
+    if (c < 0 || m_pChains[c]->nOptions >= OPTION_CHAIN_SIZE)
+        return false;
+    nSlot = m_index.insert(pOptionID);
+    if (nSlot < 0)
+        return false;
+    OptionChain *pChain = m_pChains[c];
+    int k = pChain->nOptions++;
+    strcpy(pChain->chOption[k], pOptionID);
+    double *pLanes = pChain->dLanes;
+    LANE(LANE_STRIKE)[k] = dStrike;
+    LANE(LANE_LOG_STRIKE)[k] = log(dStrike);
+    LANE(LANE_SIGN)[k] = cType == THOST_FTDC_CP_CallOptions ? 1 : -1;
+    m_pSlotChain[nSlot] = c;
+    m_pSlotOption[nSlot] = k;
+    m_nOptions++;
+    return true;
+}
+
+bool OptionSurface::addInstrument(const CThostFtdcInstrumentField &instrument)
+{
+    if (instrument.ProductClass != THOST_FTDC_PC_Options && instrument.ProductClass != THOST_FTDC_PC_SpotOption)
+        return false;
+    return addOption(instrument.InstrumentID, instrument.UnderlyingInstrID, instrument.ProductID, instrument.OptionsType,
+                     instrument.StrikePrice, instrument.ExpireDate);
+}
+
+void OptionSurface::setSpotParams(const CKSSpotOptionParamsField &params)
+{
+    if (!(params.StockPreClosePrice > 0) || params.StockPreClosePrice >= PRICE_SENTINEL)
+        return;
+    for (int c = 0; c < m_nChains; c++)
+    {
+        OptionChain *pChain = m_pChains[c];
+        if (!pChain->bTicked && strcmp(pChain->chProduct, params.ProductID) == 0)
+        {
+            pChain->dForward = params.StockPreClosePrice;
+            mark(c);
+        }
+    }
+}
+
+int OptionSurface::load(const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+        return -1;
+    char chLine[512];
+    int nAdded = 0;
+    int nLine = 0;
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        nLine++;
+        char *pHash = strchr(chLine, '#');
+        if (pHash != NULL)
+            *pHash = '\0';
+        char *pToken[8];
+        int nTokens = 0;
+        char *pSave;
+        for (char *p = strtok_r(chLine, " \t\r\n", &pSave); p != NULL && nTokens < 8; p = strtok_r(NULL, " \t\r\n", &pSave))
+            pToken[nTokens++] = p;
+        if (nTokens == 0)
+            continue;
+        char *pEnd = NULL;
+        if (strcmp(pToken[0], "option") == 0 && nTokens == 7 && (pToken[4][0] == 'C' || pToken[4][0] == 'P'))
+        {
+            double dStrike = strtod(pToken[5], &pEnd);
+            // "-" for an option without a ProductID
+            const char *pProductID = strcmp(pToken[3], "-") == 0 ? "" : pToken[3];
+            char cType = pToken[4][0] == 'C' ? THOST_FTDC_CP_CallOptions : THOST_FTDC_CP_PutOptions;
+            if (*pEnd == '\0' && addOption(pToken[1], pToken[2], pProductID, cType, dStrike, pToken[6]))
+            {
+                nAdded++;
+                continue;
+            }
+        }
+        else if (strcmp(pToken[0], "spot") == 0 && nTokens == 3 && strlen(pToken[1]) < sizeof(TThostFtdcInstrumentIDType))
+        {
+            CKSSpotOptionParamsField params;
+            memset(&params, 0, sizeof(params));
+            strcpy(params.ProductID, pToken[1]);
+            params.StockPreClosePrice = strtod(pToken[2], &pEnd);
+            if (*pEnd == '\0')
+            {
+                setSpotParams(params);
+                continue;
+            }
+        }
+        FC_LOG(LOG_LEVEL_WARN, "%s:%d: option table line not understood\n", pFile, nLine);
+    }
+    fclose(fp);
+    return nAdded;
+}
+
+void OptionSurface::mark(int nChain)
+{
+    if (!m_pChains[nChain]->bDirty)
+    {
+        m_pChains[nChain]->bDirty = true;
+        m_pDirty[m_nDirty++] = nChain;
+    }
+}
+
+bool OptionSurface::onTick(const CThostFtdcDepthMarketDataField *pTick)
+{
+    int nSlot = m_index.find(pTick->InstrumentID);
+    if (nSlot < 0 || (m_pSlotChain[nSlot] < 0 && m_pFirstChain[nSlot] < 0))
+        return false;
+
+    // the clock the times to expiry run on, the day parsed when it changes
+    const char *pDay = pTick->ActionDay[0] != '\0' ? pTick->ActionDay : pTick->TradingDay;
+    int nDay = memcmp(pDay, m_chDay, sizeof(m_chDay)) == 0 ? m_nToday : parse_day(pDay);
+    int nSecond = parse_second(pTick->UpdateTime);
+    if (nDay >= 0 && nSecond >= 0)
+    {
+        memcpy(m_chDay, pDay, sizeof(m_chDay));
+        m_nToday = nDay;
+        m_nSecond = nSecond;
+    }
+
+    // the mid of a two sided book, else the last trade
+    bool bBid = pTick->BidPrice1 > 0 && pTick->BidPrice1 < PRICE_SENTINEL && pTick->BidVolume1 > 0;
+    bool bAsk = pTick->AskPrice1 > 0 && pTick->AskPrice1 < PRICE_SENTINEL && pTick->AskVolume1 > 0;
+    double dPrice = 0;
+    if (bBid && bAsk)
+        dPrice = (pTick->BidPrice1 + pTick->AskPrice1) * 0.5;
+    else if (pTick->LastPrice > 0 && pTick->LastPrice < PRICE_SENTINEL)
+        dPrice = pTick->LastPrice;
+
+    int c = m_pSlotChain[nSlot];
+    if (c >= 0)
+    {
+        double *pLanes = m_pChains[c]->dLanes;
+        double &dPremium = LANE(LANE_PRICE)[m_pSlotOption[nSlot]];
+        if (dPremium != dPrice)
+        {
+            dPremium = dPrice;
+            mark(c);
+        }
+    }
+    for (c = m_pFirstChain[nSlot]; c >= 0 && dPrice > 0; c = m_pChains[c]->nNext)
+    {
+        OptionChain *pChain = m_pChains[c];
+        pChain->bTicked = true;
+        if (pChain->dForward != dPrice)
+        {
+            pChain->dForward = dPrice;
+            mark(c);
+        }
+    }
+    return true;
+}
+
+void OptionSurface::solve(OptionChain *pChain)
+{
+    double *pLanes = pChain->dLanes;
+    int n = pChain->nOptions;
+    double F = pChain->dForward;
+    double T = m_nToday < 0 ? 0 : ((double)(pChain->nExpireDay - m_nToday) * 86400 + EXPIRY_SECOND - m_nSecond) / YEAR_SECONDS;
+    pChain->dYears = T > 0 ? T : 0;
+    if (!(F > 0) || !(T > 0))
+    {
+        // expired, or nothing to price against yet
+        for (int l = LANE_VOL; l <= LANE_THETA; l++)
+            memset(LANE(l), 0, sizeof(double) * n);
+        memset(pChain->greeks, 0, sizeof(OptionGreeks) * n);
+        return;
+    }
+
+    ChainInputs in;
+    in.dForward = F;
+    in.dLogForward = log(F);
+    in.dYears = T;
+    in.dSqrtYears = sqrt(T);
+    in.dRate = m_dRate;
+    in.dDiscount = exp(-m_dRate * T);
+    for (int i = 0; i < n; i++)
+    {
+        // an option in the money is solved as its out of the money
+        // counterpart through put-call parity, C - P = DF (F - K); its price
+        // is all time value and the search better conditioned
+        double s = LANE(LANE_SIGN)[i];
+        double K = LANE(LANE_STRIKE)[i];
+        double dPremium = LANE(LANE_PRICE)[i] / in.dDiscount;
+        double dIntrinsic = s * (F - K);
+        double p = dIntrinsic > 0 ? dPremium - dIntrinsic : dPremium;
+        double ts = dIntrinsic > 0 ? -s : s;
+        // below intrinsic or above the forward or strike there is no
+        // volatility
+        double dBound = ts > 0 ? F : K;
+        bool bValid = LANE(LANE_PRICE)[i] > 0 && p > 0 && p < dBound;
+        LANE(LANE_TARGET)[i] = bValid ? p : 0;
+        LANE(LANE_TARGET_SIGN)[i] = ts;
+        LANE(LANE_VALID)[i] = bValid ? 1 : 0;
+    }
+
+    int nFrom = 0;
+#ifdef OPTION_SURFACE_X86
+    if (m_bAvx2)
+        nFrom = run_avx2(pLanes, n, in);
+#endif
+    run_scalar(pLanes, nFrom, n, in);
+
+    for (int i = 0; i < n; i++)
+    {
+        OptionGreeks &g = pChain->greeks[i];
+        g.dVol = LANE(LANE_VOL)[i];
+        g.dDelta = LANE(LANE_DELTA)[i];
+        g.dGamma = LANE(LANE_GAMMA)[i];
+        g.dVega = LANE(LANE_VEGA)[i];
+        g.dTheta = LANE(LANE_THETA)[i];
+    }
+}
+
+int OptionSurface::refresh()
+{
+    for (int i = 0; i < m_nDirty; i++)
+    {
+        OptionChain *pChain = m_pChains[m_pDirty[i]];
+        pChain->bDirty = false;
+        solve(pChain);
+    }
+    int *p = m_pChanged;
+    m_pChanged = m_pDirty;
+    m_pDirty = p;
+    int n = m_nDirty;
+    m_nDirty = 0;
+    return n;
+}
+
+int OptionSurface::format(int nChain, int *pFrom, char *pBuf, int nSize) const
+{
+    const OptionChain *pChain = m_pChains[nChain];
+    int nOptions[OPTION_SURFACE_LINE_OPTIONS];
+    int nCount = 0;
+    int k = *pFrom;
+    for (; k < pChain->nOptions && nCount < OPTION_SURFACE_LINE_OPTIONS; k++)
+    {
+        if (pChain->greeks[k].dVol > 0)
+            nOptions[nCount++] = k;
+    }
+    *pFrom = k;
+    if (nCount == 0)
+        return 0;
+
+    int n = snprintf(pBuf, nSize, "FCMESSAGE_TYPE_OPTION_SURFACE|%s|%s|%.4f|%.6f|%d|", pChain->chUnderlying, pChain->chExpire,
+                     pChain->dForward, pChain->dYears, nCount);
+    if (n < 0 || n >= nSize)
+        return -1;
+    char *p = pBuf + n;
+    for (int i = 0; i < nCount; i++)
+    {
+        // the id and five numbers of at most 32 characters each
+        if (pBuf + nSize - p < (int)sizeof(TThostFtdcInstrumentIDType) + 5 * 33 + 2)
+            return -1;
+        const OptionGreeks &g = pChain->greeks[nOptions[i]];
+        size_t nID = strlen(pChain->chOption[nOptions[i]]);
+        memcpy(p, pChain->chOption[nOptions[i]], nID);
+        p += nID;
+        *p++ = ':';
+        p = append_fixed(p, g.dVol, 6);
+        *p++ = ':';
+        p = append_fixed(p, g.dDelta, 6);
+        *p++ = ':';
+        p = append_fixed(p, g.dGamma, 10);
+        *p++ = ':';
+        p = append_fixed(p, g.dVega, 6);
+        *p++ = ':';
+        p = append_fixed(p, g.dTheta, 6);
+        *p++ = '|';
+    }
+    *p = '\0';
+    return (int)(p - pBuf);
+}
+
+int OptionSurface::chainSize(int nChain) const
+{
+    return m_pChains[nChain]->nOptions;
+}
+
+const OptionGreeks *OptionSurface::greeks(int nChain) const
+{
+    return m_pChains[nChain]->greeks;
+}
+
+const char *OptionSurface::underlying(int nChain) const
+{
+    return m_pChains[nChain]->chUnderlying;
+}
@@ -0,0 +1,143 @@
+#ifndef __OPTION_SURFACE_H__
+#define __OPTION_SURFACE_H__
+
+#include "../CTP/KSOptionApiStruct.h"
+#include "InstrumentIndex.h"
+
+using namespace KingstarAPI;
+
+// chains, one per underlying and expiry
+const int MAX_OPTION_CHAINS = 512;
+// calls and puts of one chain
+const int OPTION_CHAIN_SIZE = 256;
+// options per surface line, a chain takes as many lines as it needs; keeps
+// a line within FCMESSAGE_MAX_FIELDS
+const int OPTION_SURFACE_LINE_OPTIONS = 32;
+// longest surface line
+const int OPTION_SURFACE_SIZE = 4096;
+// Newton steps of the implied volatility search, it stops earlier once
+// every option of a vector has converged
+const int OPTION_MAX_ITERATIONS = 16;
+
+// the options table servant_instrument writes and OptionSurface::load()
+// reads, one line per option of the instrument query and per product of
+// the spot option parameters:
+//   option OptionID UnderlyingID ProductID C|P Strike ExpireDate
+//   spot ProductID StockPreClosePrice
+// returns the length, -1 for an instrument that is no option or when pBuf
+// is too small
+int option_table_line(const CThostFtdcInstrumentField &instrument, char *pBuf, int nSize);
+int option_spot_line(const CKSSpotOptionParamsField &params, char *pBuf, int nSize);
+
+// result for one option, 0 throughout when its price has no volatility
+struct OptionGreeks
+{
+    // Black-76 implied volatility, annualized
+    double dVol;
+    double dDelta;
+    double dGamma;
+    // per volatility point
+    double dVega;
+    // per calendar day
+    double dTheta;
+};
+
+struct OptionChain;
+
+// Implied volatility and greeks of option chains on futures (Black-76),
+// every strike of a chain at once.
+//
+// Options are grouped by underlying and ExpireDate. onTick() takes the
+// ticks of both: an underlying's mid price (LastPrice without a two sided
+// book) is the forward of its chains, an option's mid price its premium;
+// either marks the chains concerned. refresh(), once per batch, recomputes
+// the marked chains: the options are laid out struct of arrays and solved
+// four at a time with AVX2 when the cpu has it, scalar otherwise. The
+// search runs Halley steps on the out of the money side, an in the money
+// option priced through put-call parity, from the option's volatility of
+// the last refresh, a step or two away, or else from the Manaster-Koehler
+// start sqrt(2|ln(F/K)|/T). Time to expiry is calendar days to 15:00 of
+// ExpireDate over 365, from the ticks' own ActionDay and UpdateTime.
+//
+// A spot option chain takes its product's StockPreClosePrice until its
+// underlying ticks. Not thread safe, owned by the publisher thread.
+class OptionSurface
+{
+public:
+    OptionSurface();
+    ~OptionSurface();
+
+    // cType THOST_FTDC_CP_CallOptions or THOST_FTDC_CP_PutOptions; false
+    // for a bad or repeated option, or when the chain or table is full
+    bool addOption(const char *pOptionID, const char *pUnderlyingID, const char *pProductID, char cType, double dStrike,
+                   const char *pExpireDate);
+    // an option of the instrument query, false for other instruments
+    bool addInstrument(const CThostFtdcInstrumentField &instrument);
+    // OnRspQrySpotOptionParams
+    void setSpotParams(const CKSSpotOptionParamsField &params);
+
+    // the options table; returns the options added, -1 when the file
+    // cannot be read
+    int load(const char *pFile);
+
+    // continuously compounded rate discounting the premiums
+    void setRate(double dRate) { m_dRate = dRate; }
+
+    // false for a tick of neither an option nor an underlying
+    bool onTick(const CThostFtdcDepthMarketDataField *pTick);
+
+    // recompute the marked chains; returns how many, changed(0..n-1) are
+    // their numbers until the next refresh()
+    int refresh();
+    int changed(int i) const { return m_pChanged[i]; }
+
+    // the next line of a chain's surface, from option *pFrom on:
+    // "FCMESSAGE_TYPE_OPTION_SURFACE|UnderlyingID|ExpireDate|forward|years|
+    // count|" and up to OPTION_SURFACE_LINE_OPTIONS options with a
+    // volatility, "OptionID:vol:delta:gamma:vega:theta|" each. Advances
+    // *pFrom; returns the length, 0 when no option is left, -1 when pBuf is
+    // too small
+    int format(int nChain, int *pFrom, char *pBuf, int nSize) const;
+
+    // results of a chain, in the order the options were added
+    int chainSize(int nChain) const;
+    const OptionGreeks *greeks(int nChain) const;
+
+    const char *underlying(int nChain) const;
+    int chains() const { return m_nChains; }
+    int options() const { return m_nOptions; }
+
+    // false forces the scalar pass, for comparison
+    void useAvx2(bool bUse);
+    bool usingAvx2() const { return m_bAvx2; }
+
+private:
+    int chainOf(const char *pUnderlyingID, const char *pExpireDate, const char *pProductID);
+    void mark(int nChain);
+    void solve(OptionChain *pChain);
+
+    bool m_bAvx2;
+    bool m_bCpuAvx2;
+    double m_dRate;
+    // the latest tick time, days since 1970 and seconds of the day
+    TThostFtdcDateType m_chDay;
+    int m_nToday;
+    int m_nSecond;
+
+    // options and underlyings by slot: an option's chain and place in it,
+    // an underlying's first chain
+    InstrumentIndex m_index;
+    int *m_pSlotChain;
+    int *m_pSlotOption;
+    int *m_pFirstChain;
+    int m_nOptions;
+
+    OptionChain **m_pChains;
+    int m_nChains;
+    // chains marked since the last refresh(), and those it recomputed
+    int *m_pDirty;
+    int m_nDirty;
+    int *m_pChanged;
+};
+
+#endif
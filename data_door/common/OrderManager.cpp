@@ -0,0 +1,272 @@
+// OrderManager.cpp : order pool and its OrderRef, OrderSysID and TradeID indexes.
+//
+#include "OrderManager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FNV-1a over a byte range, strings stop at their terminator
+static unsigned int fnv(unsigned int h, const void *p, int nLen, bool bString)
+{
+    const unsigned char *c = (const unsigned char *)p;
+    for (int i = 0; i < nLen && !(bString && c[i] == '\0'); i++)
+    {
+        h ^= c[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned int ref_hash(int nFrontID, int nSessionID, int nOrderRef)
+{
+    int key[3] = { nFrontID, nSessionID, nOrderRef };
+    return fnv(2166136261u, key, sizeof(key), false);
+}
+
+static unsigned int sys_hash(const char *pExchangeID, const char *pOrderSysID)
+{
+    unsigned int h = fnv(2166136261u, pExchangeID, sizeof(TThostFtdcExchangeIDType), true);
+    return fnv(h ^ 0xff, pOrderSysID, sizeof(TThostFtdcOrderSysIDType), true);
+}
+
+// copy a fixed size api string, always terminated
+#define COPY_FIELD(dst, src) \
+    do { strncpy(dst, src, sizeof(dst) - 1); dst[sizeof(dst) - 1] = '\0'; } while (0)
+
+OrderManager::OrderManager() : m_nFrontID(0), m_nSessionID(0), m_nNextOrderRef(1)
+{
+    m_pOrders = new OrderRecord[MAX_ORDERS];
+    m_pRefTable = new int[ORDER_TABLE_SIZE];
+    m_pSysTable = new int[ORDER_TABLE_SIZE];
+    m_pTradeKeys = new char[TRADE_TABLE_SIZE][TRADE_KEY_SIZE];
+    m_pTradeUsed = new unsigned char[TRADE_TABLE_SIZE];
+    reset();
+}
+
+OrderManager::~OrderManager()
+{
+    delete[] m_pOrders;
+    delete[] m_pRefTable;
+    delete[] m_pSysTable;
+    delete[] m_pTradeKeys;
+    delete[] m_pTradeUsed;
+}
+
+void OrderManager::reset()
+{
+    memset(m_pOrders, 0, sizeof(OrderRecord) * MAX_ORDERS);
+    for (int i = 0; i < ORDER_TABLE_SIZE; i++)
+    {
+        m_pRefTable[i] = -1;
+        m_pSysTable[i] = -1;
+    }
+    memset(m_pTradeUsed, 0, TRADE_TABLE_SIZE);
+    m_nOrders = 0;
+    m_nTrades = 0;
+}
+
+void OrderManager::onLogin(const CThostFtdcRspUserLoginField *pRspUserLogin)
+{
+    m_nFrontID = pRspUserLogin->FrontID;
+    m_nSessionID = pRspUserLogin->SessionID;
+    // a new session restarts from the front's MaxOrderRef
+    __atomic_store_n(&m_nNextOrderRef, atoi(pRspUserLogin->MaxOrderRef) + 1, __ATOMIC_RELEASE);
+}
+
+int OrderManager::nextOrderRef(TThostFtdcOrderRefType pOrderRef)
+{
+    int nRef = __atomic_fetch_add(&m_nNextOrderRef, 1, __ATOMIC_ACQ_REL);
+    // "%012d" by hand, it is on the order path; zero padded so the refs also
+    // increase when compared as strings
+    unsigned int n = nRef;
+    for (int i = 11; i >= 0; i--)
+    {
+        pOrderRef[i] = '0' + n % 10;
+        n /= 10;
+    }
+    pOrderRef[12] = '\0';
+    return nRef;
+}
+
+int OrderManager::find(int nFrontID, int nSessionID, const char *pOrderRef) const
+{
+    int nOrderRef = atoi(pOrderRef);
+    unsigned int h = ref_hash(nFrontID, nSessionID, nOrderRef) & (ORDER_TABLE_SIZE - 1);
+    while (m_pRefTable[h] != -1)
+    {
+        const OrderRecord &o = m_pOrders[m_pRefTable[h]];
+        if (o.nOrderRef == nOrderRef && o.nSessionID == nSessionID && o.nFrontID == nFrontID)
+            return m_pRefTable[h];
+        h = (h + 1) & (ORDER_TABLE_SIZE - 1);
+    }
+    return -1;
+}
+
+int OrderManager::findBySysID(const char *pExchangeID, const char *pOrderSysID) const
+{
+    if (pOrderSysID[0] == '\0')
+        return -1;
+    unsigned int h = sys_hash(pExchangeID, pOrderSysID) & (ORDER_TABLE_SIZE - 1);
+    while (m_pSysTable[h] != -1)
+    {
+        const OrderRecord &o = m_pOrders[m_pSysTable[h]];
+        if (strcmp(o.chOrderSysID, pOrderSysID) == 0 && strcmp(o.chExchangeID, pExchangeID) == 0)
+            return m_pSysTable[h];
+        h = (h + 1) & (ORDER_TABLE_SIZE - 1);
+    }
+    return -1;
+}
+
+int OrderManager::allocate(int nFrontID, int nSessionID, int nOrderRef)
+{
+    if (m_nOrders >= MAX_ORDERS)
+        return -1;
+    int nSlot = m_nOrders++;
+    OrderRecord &o = m_pOrders[nSlot];
+    memset(&o, 0, sizeof(o));
+    o.nFrontID = nFrontID;
+    o.nSessionID = nSessionID;
+    o.nOrderRef = nOrderRef;
+    o.nState = ORDER_PENDING;
+
+    unsigned int h = ref_hash(nFrontID, nSessionID, nOrderRef) & (ORDER_TABLE_SIZE - 1);
+    while (m_pRefTable[h] != -1)
+        h = (h + 1) & (ORDER_TABLE_SIZE - 1);
+    m_pRefTable[h] = nSlot;
+    return nSlot;
+}
+
+void OrderManager::indexSysID(int nSlot)
+{
+    const OrderRecord &o = m_pOrders[nSlot];
+    unsigned int h = sys_hash(o.chExchangeID, o.chOrderSysID) & (ORDER_TABLE_SIZE - 1);
+    while (m_pSysTable[h] != -1)
+        h = (h + 1) & (ORDER_TABLE_SIZE - 1);
+    m_pSysTable[h] = nSlot;
+}
+
+int OrderManager::onInsert(const CThostFtdcInputOrderField *pInputOrder)
+{
+    int nSlot = allocate(m_nFrontID, m_nSessionID, atoi(pInputOrder->OrderRef));
+    if (nSlot < 0)
+        return -1;
+    OrderRecord &o = m_pOrders[nSlot];
+    o.nRequestID = pInputOrder->RequestID;
+    COPY_FIELD(o.chInstrumentID, pInputOrder->InstrumentID);
+    o.chDirection = pInputOrder->Direction;
+    o.chOffsetFlag = pInputOrder->CombOffsetFlag[0];
+    o.chHedgeFlag = pInputOrder->CombHedgeFlag[0];
+    o.dLimitPrice = pInputOrder->LimitPrice;
+    o.nVolumeOriginal = pInputOrder->VolumeTotalOriginal;
+    return nSlot;
+}
+
+int OrderManager::onInsertError(const CThostFtdcInputOrderField *pInputOrder, int nErrorID)
+{
+    int nSlot = find(m_nFrontID, m_nSessionID, pInputOrder->OrderRef);
+    if (nSlot < 0)
+        return -1;
+    OrderRecord &o = m_pOrders[nSlot];
+    o.nState = ORDER_REJECTED;
+    o.nErrorID = nErrorID;
+    return nSlot;
+}
+
+// ORDER_x for an exchange status; terminal states are never left
+static int next_state(int nState, const CThostFtdcOrderField *pOrder)
+{
+    if (nState == ORDER_FILLED || nState == ORDER_CANCELLED || nState == ORDER_REJECTED)
+        return nState;
+    if (pOrder->OrderSubmitStatus == THOST_FTDC_OSS_InsertRejected)
+        return ORDER_REJECTED;
+    switch (pOrder->OrderStatus)
+    {
+    case THOST_FTDC_OST_AllTraded:
+        return ORDER_FILLED;
+    case THOST_FTDC_OST_PartTradedQueueing:
+    case THOST_FTDC_OST_NoTradeQueueing:
+    case THOST_FTDC_OST_NotTouched:
+    case THOST_FTDC_OST_Touched:
+        return ORDER_QUEUEING;
+    case THOST_FTDC_OST_PartTradedNotQueueing:
+    case THOST_FTDC_OST_NoTradeNotQueueing:
+    case THOST_FTDC_OST_Canceled:
+        return ORDER_CANCELLED;
+    default:
+        return nState;
+    }
+}
+
+int OrderManager::onRtnOrder(const CThostFtdcOrderField *pOrder)
+{
+    int nSlot = find(pOrder->FrontID, pOrder->SessionID, pOrder->OrderRef);
+    if (nSlot < 0)
+    {
+        // placed by another session or before our login
+        nSlot = allocate(pOrder->FrontID, pOrder->SessionID, atoi(pOrder->OrderRef));
+        if (nSlot < 0)
+            return -1;
+        OrderRecord &o = m_pOrders[nSlot];
+        o.nRequestID = pOrder->RequestID;
+        COPY_FIELD(o.chInstrumentID, pOrder->InstrumentID);
+        o.chDirection = pOrder->Direction;
+        o.chOffsetFlag = pOrder->CombOffsetFlag[0];
+        o.chHedgeFlag = pOrder->CombHedgeFlag[0];
+        o.dLimitPrice = pOrder->LimitPrice;
+        o.nVolumeOriginal = pOrder->VolumeTotalOriginal;
+    }
+
+    OrderRecord &o = m_pOrders[nSlot];
+    if (o.chOrderSysID[0] == '\0' && pOrder->OrderSysID[0] != '\0')
+    {
+        COPY_FIELD(o.chExchangeID, pOrder->ExchangeID);
+        COPY_FIELD(o.chOrderSysID, pOrder->OrderSysID);
+        indexSysID(nSlot);
+    }
+    else if (o.chExchangeID[0] == '\0')
+    {
+        COPY_FIELD(o.chExchangeID, pOrder->ExchangeID);
+    }
+    o.chOrderStatus = pOrder->OrderStatus;
+    if (pOrder->VolumeTraded > o.nVolumeTraded)
+        o.nVolumeTraded = pOrder->VolumeTraded;
+    o.nState = next_state(o.nState, pOrder);
+    return nSlot;
+}
+
+int OrderManager::onRtnTrade(const CThostFtdcTradeField *pTrade)
+{
+    // remember the TradeID first so a replay is caught even for orders we
+    // do not know
+    char key[TRADE_KEY_SIZE];
+    memset(key, 0, sizeof(key));
+    strncpy(key, pTrade->ExchangeID, sizeof(TThostFtdcExchangeIDType) - 1);
+    strncpy(key + sizeof(TThostFtdcExchangeIDType), pTrade->TradeID, sizeof(TThostFtdcTradeIDType) - 1);
+    key[TRADE_KEY_SIZE - 1] = pTrade->Direction;
+    unsigned int h = fnv(2166136261u, key, sizeof(key), false) & (TRADE_TABLE_SIZE - 1);
+    while (m_pTradeUsed[h])
+    {
+        if (memcmp(m_pTradeKeys[h], key, sizeof(key)) == 0)
+            return ORDER_DUPLICATE_TRADE;
+        h = (h + 1) & (TRADE_TABLE_SIZE - 1);
+    }
+    if (m_nTrades < MAX_TRADES)
+    {
+        memcpy(m_pTradeKeys[h], key, sizeof(key));
+        m_pTradeUsed[h] = 1;
+        m_nTrades++;
+    }
+
+    int nSlot = findBySysID(pTrade->ExchangeID, pTrade->OrderSysID);
+    if (nSlot < 0)
+        return ORDER_UNKNOWN;
+    OrderRecord &o = m_pOrders[nSlot];
+    o.nTradeVolume += pTrade->Volume;
+    o.dTradedValue += pTrade->Price * pTrade->Volume;
+    // OnRtnOrder's VolumeTraded may already include this trade
+    if (o.nTradeVolume > o.nVolumeTraded)
+        o.nVolumeTraded = o.nTradeVolume;
+    if (o.nVolumeOriginal > 0 && o.nVolumeTraded >= o.nVolumeOriginal && o.nState != ORDER_REJECTED)
+        o.nState = ORDER_FILLED;
+    return nSlot;
+}
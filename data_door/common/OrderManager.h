@@ -0,0 +1,139 @@
+#ifndef __ORDER_MANAGER_H__
+#define __ORDER_MANAGER_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+
+using namespace KingstarAPI;
+
+// orders and trades kept for one trading day
+const int MAX_ORDERS = 16384;
+const int MAX_TRADES = 32768;
+
+// OrderRecord::nState
+enum
+{
+    // sent, nothing heard from the front yet
+    ORDER_PENDING,
+    // accepted and working, possibly partially traded
+    ORDER_QUEUEING,
+    ORDER_FILLED,
+    // cancelled, possibly after partial trades
+    ORDER_CANCELLED,
+    ORDER_REJECTED
+};
+
+// onRtnTrade() results besides a slot
+enum
+{
+    // the trade's OrderSysID has not been seen in OnRtnOrder
+    ORDER_UNKNOWN = -1,
+    // the TradeID was applied before on that side (a replay after reconnect)
+    ORDER_DUPLICATE_TRADE = -2
+};
+
+struct OrderRecord
+{
+    int nFrontID;
+    int nSessionID;
+    int nOrderRef;
+    int nRequestID;
+    TThostFtdcInstrumentIDType chInstrumentID;
+    TThostFtdcExchangeIDType chExchangeID;
+    // empty until the exchange accepted the order
+    TThostFtdcOrderSysIDType chOrderSysID;
+    TThostFtdcDirectionType chDirection;
+    TThostFtdcOffsetFlagType chOffsetFlag;
+    TThostFtdcHedgeFlagType chHedgeFlag;
+    // last THOST_FTDC_OST_x seen, '\0' before the first OnRtnOrder
+    TThostFtdcOrderStatusType chOrderStatus;
+    // ORDER_x
+    int nState;
+    double dLimitPrice;
+    int nVolumeOriginal;
+    // traded volume, the larger of OnRtnOrder's count and the trades seen
+    int nVolumeTraded;
+    // volume and sum of price * volume of the trades seen
+    int nTradeVolume;
+    double dTradedValue;
+    int nErrorID;
+};
+
+// In-memory order and trade state of the trading session.
+//
+// Orders live in a pool allocated once; two open addressing tables map
+// (FrontID, SessionID, OrderRef) and (ExchangeID, OrderSysID) to pool
+// slots, a third remembers applied TradeIDs so replayed trades are not
+// counted twice. Slots are never freed during the day, so nothing is
+// allocated per event and slot numbers stay valid for the caller.
+//
+// nextOrderRef() may be called from any thread. Everything else mutates the
+// tables and must be called from one thread, normally the trader api
+// callback thread, which is where OnRtnOrder/OnRtnTrade arrive anyway.
+class OrderManager
+{
+public:
+    OrderManager();
+    ~OrderManager();
+
+    // session of the login, OrderRefs continue after MaxOrderRef
+    void onLogin(const CThostFtdcRspUserLoginField *pRspUserLogin);
+
+    // write the next OrderRef of this session into pOrderRef, returns it
+    int nextOrderRef(TThostFtdcOrderRefType pOrderRef);
+
+    // register an order about to be passed to ReqOrderInsert, returns its
+    // slot or -1 when the pool is full
+    int onInsert(const CThostFtdcInputOrderField *pInputOrder);
+
+    // OnRspOrderInsert / OnErrRtnOrderInsert with an error, returns the slot
+    // or -1 for an order not inserted through this session
+    int onInsertError(const CThostFtdcInputOrderField *pInputOrder, int nErrorID);
+
+    // OnRtnOrder, returns the slot (orders of other sessions get one on
+    // first sight) or -1 when the pool is full
+    int onRtnOrder(const CThostFtdcOrderField *pOrder);
+
+    // OnRtnTrade, returns the slot, ORDER_UNKNOWN or ORDER_DUPLICATE_TRADE
+    int onRtnTrade(const CThostFtdcTradeField *pTrade);
+
+    int find(int nFrontID, int nSessionID, const char *pOrderRef) const;
+    int findBySysID(const char *pExchangeID, const char *pOrderSysID) const;
+
+    const OrderRecord &order(int nSlot) const { return m_pOrders[nSlot]; }
+    int count() const { return m_nOrders; }
+
+    int frontID() const { return m_nFrontID; }
+    int sessionID() const { return m_nSessionID; }
+
+    // forget every order and trade, for a new trading day
+    void reset();
+
+private:
+    enum
+    {
+        ORDER_TABLE_SIZE = MAX_ORDERS * 2,
+        TRADE_TABLE_SIZE = MAX_TRADES * 2,
+        // ExchangeID, TradeID and Direction concatenated: both sides of a
+        // trade between two of our orders share the TradeID
+        TRADE_KEY_SIZE = sizeof(TThostFtdcExchangeIDType) + sizeof(TThostFtdcTradeIDType) + 1
+    };
+
+    int allocate(int nFrontID, int nSessionID, int nOrderRef);
+    void indexSysID(int nSlot);
+
+    int m_nFrontID;
+    int m_nSessionID;
+    int m_nNextOrderRef;
+
+    OrderRecord *m_pOrders;
+    int m_nOrders;
+    // pool slots, -1 for empty
+    int *m_pRefTable;
+    int *m_pSysTable;
+    // applied trades: key bytes per entry, m_pTradeUsed marks taken entries
+    char (*m_pTradeKeys)[TRADE_KEY_SIZE];
+    unsigned char *m_pTradeUsed;
+    int m_nTrades;
+};
+
+#endif
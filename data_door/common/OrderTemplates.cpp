@@ -0,0 +1,89 @@
+// OrderTemplates.cpp : pre-built order insert fields.
+//
+#include "OrderTemplates.h"
+#include <string.h>
+
+OrderTemplates::OrderTemplates(LastValueCache *pCache) : m_pCache(pCache), m_pRetired(0)
+{
+    m_ppTemplates = new CThostFtdcInputOrderField *[MAX_INSTRUMENTS];
+    memset(m_ppTemplates, 0, sizeof(CThostFtdcInputOrderField *) * MAX_INSTRUMENTS);
+    memset(m_chBrokerID, 0, sizeof(m_chBrokerID));
+    memset(m_chInvestorID, 0, sizeof(m_chInvestorID));
+    memset(m_chUserID, 0, sizeof(m_chUserID));
+}
+
+OrderTemplates::~OrderTemplates()
+{
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+        delete[] m_ppTemplates[i];
+    delete[] m_ppTemplates;
+    while (m_pRetired != 0)
+    {
+        Retired *pNext = m_pRetired->pNext;
+        delete[] m_pRetired->pTemplates;
+        delete m_pRetired;
+        m_pRetired = pNext;
+    }
+}
+
+void OrderTemplates::fill(CThostFtdcInputOrderField *pOrder, const char *pInstrumentID, int nCombination) const
+{
+    int nHedge = nCombination % TEMPLATE_HEDGES;
+    int nOffset = nCombination / TEMPLATE_HEDGES % TEMPLATE_OFFSETS;
+    int nDirection = nCombination / (TEMPLATE_HEDGES * TEMPLATE_OFFSETS);
+
+    memset(pOrder, 0, sizeof(CThostFtdcInputOrderField));
+    strncpy(pOrder->BrokerID, m_chBrokerID, sizeof(pOrder->BrokerID) - 1);
+    strncpy(pOrder->InvestorID, m_chInvestorID, sizeof(pOrder->InvestorID) - 1);
+    strncpy(pOrder->InstrumentID, pInstrumentID, sizeof(pOrder->InstrumentID) - 1);
+    strncpy(pOrder->UserID, m_chUserID, sizeof(pOrder->UserID) - 1);
+    pOrder->OrderPriceType = THOST_FTDC_OPT_LimitPrice;
+    pOrder->Direction = THOST_FTDC_D_Buy + nDirection;
+    pOrder->CombOffsetFlag[0] = THOST_FTDC_OF_Open + nOffset;
+    pOrder->CombHedgeFlag[0] = THOST_FTDC_HF_Speculation + nHedge;
+    pOrder->TimeCondition = THOST_FTDC_TC_GFD;
+    pOrder->VolumeCondition = THOST_FTDC_VC_AV;
+    pOrder->MinVolume = 1;
+    pOrder->ContingentCondition = THOST_FTDC_CC_Immediately;
+    pOrder->ForceCloseReason = THOST_FTDC_FCC_NotForceClose;
+    pOrder->IsAutoSuspend = 0;
+    pOrder->UserForceClose = 0;
+}
+
+void OrderTemplates::setAccount(const char *pBrokerID, const char *pInvestorID, const char *pUserID)
+{
+    // the usual relogin: the templates are already right
+    if (strncmp(m_chBrokerID, pBrokerID, sizeof(m_chBrokerID) - 1) == 0
+        && strncmp(m_chInvestorID, pInvestorID, sizeof(m_chInvestorID) - 1) == 0
+        && strncmp(m_chUserID, pUserID, sizeof(m_chUserID) - 1) == 0)
+        return;
+    strncpy(m_chBrokerID, pBrokerID, sizeof(m_chBrokerID) - 1);
+    strncpy(m_chInvestorID, pInvestorID, sizeof(m_chInvestorID) - 1);
+    strncpy(m_chUserID, pUserID, sizeof(m_chUserID) - 1);
+    // new templates built aside and published whole, never rewritten under
+    // a build() on another thread
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+    {
+        if (m_ppTemplates[i] == 0)
+            continue;
+        CThostFtdcInputOrderField *pTemplates = new CThostFtdcInputOrderField[TEMPLATES_PER_INSTRUMENT];
+        for (int n = 0; n < TEMPLATES_PER_INSTRUMENT; n++)
+            fill(&pTemplates[n], m_pCache->index().name(i), n);
+        Retired *pRetired = new Retired;
+        pRetired->pTemplates = __atomic_exchange_n(&m_ppTemplates[i], pTemplates, __ATOMIC_ACQ_REL);
+        pRetired->pNext = m_pRetired;
+        m_pRetired = pRetired;
+    }
+}
+
+int OrderTemplates::addInstrument(const char *pInstrumentID)
+{
+    int nSlot = m_pCache->addInstrument(pInstrumentID);
+    if (nSlot < 0 || m_ppTemplates[nSlot] != 0)
+        return nSlot;
+    CThostFtdcInputOrderField *pTemplates = new CThostFtdcInputOrderField[TEMPLATES_PER_INSTRUMENT];
+    for (int n = 0; n < TEMPLATES_PER_INSTRUMENT; n++)
+        fill(&pTemplates[n], pInstrumentID, n);
+    __atomic_store_n(&m_ppTemplates[nSlot], pTemplates, __ATOMIC_RELEASE);
+    return nSlot;
+}
@@ -0,0 +1,98 @@
+#ifndef __ORDER_TEMPLATES_H__
+#define __ORDER_TEMPLATES_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "LastValueCache.h"
+
+using namespace KingstarAPI;
+
+// combinations kept per instrument: Buy/Sell x Open..CloseYesterday x
+// Speculation/Arbitrage/Hedge
+const int TEMPLATE_DIRECTIONS = 2;
+const int TEMPLATE_OFFSETS = 5;
+const int TEMPLATE_HEDGES = 3;
+const int TEMPLATES_PER_INSTRUMENT = TEMPLATE_DIRECTIONS * TEMPLATE_OFFSETS * TEMPLATE_HEDGES;
+
+// Pre-built CThostFtdcInputOrderField per instrument and flag combination.
+//
+// Everything that does not change between two orders (account, instrument,
+// flags, GFD limit order conditions) is filled in once when the instrument
+// is registered, so sending an order is one struct copy plus the price,
+// volume, OrderRef and RequestID instead of a memset and a dozen strcpy.
+// The templates of an instrument are allocated on registration only, the
+// full table would be MAX_INSTRUMENTS * TEMPLATES_PER_INSTRUMENT entries.
+//
+// Not thread safe: setAccount() and addInstrument() belong to the trader
+// api callback thread; build() may run anywhere once the instrument is in.
+class OrderTemplates
+{
+public:
+    // slots shared with the cache, so the tick path can pass its slot
+    OrderTemplates(LastValueCache *pCache);
+    ~OrderTemplates();
+
+    // BrokerID, InvestorID and UserID of every template; a relogin as
+    // another user builds new templates for the instruments already in and
+    // swaps them in, build() may be copying the old ones meanwhile, so they
+    // are kept until destruction. Nothing changes for the same account.
+    void setAccount(const char *pBrokerID, const char *pInvestorID, const char *pUserID);
+
+    // OnRspQryInstrument, returns the slot or -1
+    int addInstrument(const char *pInstrumentID);
+
+    // the template, NULL for an unknown instrument or an unsupported flag
+    const CThostFtdcInputOrderField *find(int nSlot, char chDirection, char chOffsetFlag, char chHedgeFlag) const;
+
+    // copy the template into pOrder and patch the per order fields, false
+    // when there is no template; OrderRef is left to the caller (the
+    // OrderManager hands them out)
+    bool build(CThostFtdcInputOrderField *pOrder, int nSlot, char chDirection, char chOffsetFlag, char chHedgeFlag,
+               double dLimitPrice, int nVolume, int nRequestID) const
+    {
+        const CThostFtdcInputOrderField *pTemplate = find(nSlot, chDirection, chOffsetFlag, chHedgeFlag);
+        if (pTemplate == 0)
+            return false;
+        *pOrder = *pTemplate;
+        pOrder->LimitPrice = dLimitPrice;
+        pOrder->VolumeTotalOriginal = nVolume;
+        pOrder->RequestID = nRequestID;
+        return true;
+    }
+
+    const InstrumentIndex &index() const { return m_pCache->index(); }
+
+private:
+    // templates replaced by setAccount()
+    struct Retired
+    {
+        CThostFtdcInputOrderField *pTemplates;
+        Retired *pNext;
+    };
+
+    void fill(CThostFtdcInputOrderField *pOrder, const char *pInstrumentID, int nCombination) const;
+
+    LastValueCache *m_pCache;
+    // per slot, NULL until the instrument is added
+    CThostFtdcInputOrderField **m_ppTemplates;
+    Retired *m_pRetired;
+    TThostFtdcBrokerIDType m_chBrokerID;
+    TThostFtdcInvestorIDType m_chInvestorID;
+    TThostFtdcUserIDType m_chUserID;
+};
+
+inline const CThostFtdcInputOrderField *OrderTemplates::find(int nSlot, char chDirection, char chOffsetFlag, char chHedgeFlag) const
+{
+    // flags are consecutive digits: '0'/'1', '0'..'4' and '1'..'3'
+    unsigned int nDirection = chDirection - THOST_FTDC_D_Buy;
+    unsigned int nOffset = chOffsetFlag - THOST_FTDC_OF_Open;
+    unsigned int nHedge = chHedgeFlag - THOST_FTDC_HF_Speculation;
+    if ((unsigned int)nSlot >= (unsigned int)MAX_INSTRUMENTS || nDirection >= (unsigned int)TEMPLATE_DIRECTIONS
+        || nOffset >= (unsigned int)TEMPLATE_OFFSETS || nHedge >= (unsigned int)TEMPLATE_HEDGES)
+        return 0;
+    const CThostFtdcInputOrderField *pTemplates = __atomic_load_n(&m_ppTemplates[nSlot], __ATOMIC_ACQUIRE);
+    if (pTemplates == 0)
+        return 0;
+    return &pTemplates[(nDirection * TEMPLATE_OFFSETS + nOffset) * TEMPLATE_HEDGES + nHedge];
+}
+
+#endif
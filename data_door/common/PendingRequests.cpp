@@ -0,0 +1,247 @@
+// PendingRequests.cpp : preallocated request slots completed from the OnRspXxx callbacks.
+//
+#include "PendingRequests.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+// ids wrap before reaching the COS manager's range
+const int PENDING_ID_SPAN = 0x10000000;
+
+PendingRequests::PendingRequests() : m_nNextID(0)
+{
+    m_pSlots = new Slot[MAX_PENDING_REQUESTS];
+    for (int i = 0; i < MAX_PENDING_REQUESTS; i++)
+    {
+        Slot *s = &m_pSlots[i];
+        s->nRequestID = -1;
+        s->nState = SLOT_FREE;
+        s->bAbandoned = false;
+        s->nRowSize = 0;
+        s->nRows = 0;
+        s->nCapacity = 0;
+        s->pRows = 0;
+        s->nErrorID = 0;
+        s->chErrorMsg[0] = '\0';
+        s->pfnDone = 0;
+        s->pContext = 0;
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->cond, NULL);
+    }
+}
+
+PendingRequests::~PendingRequests()
+{
+    for (int i = 0; i < MAX_PENDING_REQUESTS; i++)
+    {
+        free(m_pSlots[i].pRows);
+        pthread_mutex_destroy(&m_pSlots[i].lock);
+        pthread_cond_destroy(&m_pSlots[i].cond);
+    }
+    delete[] m_pSlots;
+}
+
+int PendingRequests::begin(int nRowSize, RequestCallback pfnDone, void *pContext)
+{
+    // a slot still in use is skipped, its id is simply not handed out
+    for (int nTry = 0; nTry < MAX_PENDING_REQUESTS; nTry++)
+    {
+        int n = __atomic_fetch_add(&m_nNextID, 1, __ATOMIC_RELAXED);
+        int nRequestID = PENDING_REQUEST_BASE + (int)((unsigned int)n % PENDING_ID_SPAN);
+        Slot *s = slotOf(nRequestID);
+        pthread_mutex_lock(&s->lock);
+        if (s->nState != SLOT_FREE)
+        {
+            pthread_mutex_unlock(&s->lock);
+            continue;
+        }
+        s->nState = SLOT_PENDING;
+        s->bAbandoned = false;
+        s->nRowSize = nRowSize;
+        s->nRows = 0;
+        s->nErrorID = 0;
+        s->chErrorMsg[0] = '\0';
+        s->pfnDone = pfnDone;
+        s->pContext = pContext;
+        __atomic_store_n(&s->nRequestID, nRequestID, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&s->lock);
+        return nRequestID;
+    }
+    return -1;
+}
+
+void PendingRequests::fail(int nRequestID, int nResult)
+{
+    CThostFtdcRspInfoField info;
+    memset(&info, 0, sizeof(info));
+    info.ErrorID = nResult;
+    strcpy(info.ErrorMsg, "request not sent");
+    onError(&info, nRequestID);
+}
+
+bool PendingRequests::onError(const CThostFtdcRspInfoField *pRspInfo, int nRequestID)
+{
+    return onRow(0, 0, pRspInfo, nRequestID, true);
+}
+
+bool PendingRequests::onRow(const void *pRow, int nRowSize, const CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+{
+    if (nRequestID < PENDING_REQUEST_BASE)
+        return false;
+    Slot *s = slotOf(nRequestID);
+    if (__atomic_load_n(&s->nRequestID, __ATOMIC_ACQUIRE) != nRequestID
+        || __atomic_load_n(&s->nState, __ATOMIC_RELAXED) != SLOT_PENDING)
+        return false;
+
+    // only the api thread appends; a row of another type is dropped
+    if (pRow != 0 && nRowSize == s->nRowSize)
+    {
+        if (s->nRows == s->nCapacity)
+        {
+            int nCapacity = s->nCapacity > 0 ? s->nCapacity * 2 : 16;
+            char *pRows = (char *)realloc(s->pRows, (size_t)nCapacity * nRowSize);
+            if (pRows != 0)
+            {
+                s->pRows = pRows;
+                s->nCapacity = nCapacity;
+            }
+        }
+        if (s->nRows < s->nCapacity)
+            memcpy(s->pRows + (size_t)s->nRows++ * nRowSize, pRow, nRowSize);
+    }
+    if (pRspInfo != 0 && pRspInfo->ErrorID != 0 && s->nErrorID == 0)
+    {
+        s->nErrorID = pRspInfo->ErrorID;
+        strncpy(s->chErrorMsg, pRspInfo->ErrorMsg, sizeof(s->chErrorMsg) - 1);
+        s->chErrorMsg[sizeof(s->chErrorMsg) - 1] = '\0';
+    }
+    if (bIsLast)
+        complete(s);
+    return true;
+}
+
+void PendingRequests::complete(Slot *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->nState = SLOT_DONE;
+    int nRequestID = s->nRequestID;
+    bool bFree = s->bAbandoned;
+    RequestCallback pfnDone = s->pfnDone;
+    void *pContext = s->pContext;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+
+    if (pfnDone != 0)
+    {
+        pfnDone(nRequestID, pContext);
+        bFree = true;
+    }
+    if (bFree)
+    {
+        pthread_mutex_lock(&s->lock);
+        __atomic_store_n(&s->nRequestID, -1, __ATOMIC_RELEASE);
+        s->nState = SLOT_FREE;
+        pthread_mutex_unlock(&s->lock);
+    }
+}
+
+bool PendingRequests::wait(int nRequestID, int nTimeoutMs)
+{
+    if (nRequestID < PENDING_REQUEST_BASE)
+        return false;
+    Slot *s = slotOf(nRequestID);
+    struct timespec deadline;
+    if (nTimeoutMs >= 0)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += nTimeoutMs / 1000;
+        deadline.tv_nsec += (nTimeoutMs % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    pthread_mutex_lock(&s->lock);
+    while (s->nRequestID == nRequestID && s->nState == SLOT_PENDING)
+    {
+        if (nTimeoutMs < 0)
+            pthread_cond_wait(&s->cond, &s->lock);
+        else if (pthread_cond_timedwait(&s->cond, &s->lock, &deadline) == ETIMEDOUT)
+            break;
+    }
+    bool bDone = s->nRequestID == nRequestID && s->nState == SLOT_DONE;
+    pthread_mutex_unlock(&s->lock);
+    return bDone;
+}
+
+bool PendingRequests::done(int nRequestID) const
+{
+    return doneSlot(nRequestID) != 0;
+}
+
+const PendingRequests::Slot *PendingRequests::doneSlot(int nRequestID) const
+{
+    if (nRequestID < PENDING_REQUEST_BASE)
+        return 0;
+    Slot *s = slotOf(nRequestID);
+    pthread_mutex_lock(&s->lock);
+    bool bDone = s->nRequestID == nRequestID && s->nState == SLOT_DONE;
+    pthread_mutex_unlock(&s->lock);
+    return bDone ? s : 0;
+}
+
+int PendingRequests::errorID(int nRequestID) const
+{
+    const Slot *s = doneSlot(nRequestID);
+    return s != 0 ? s->nErrorID : 0;
+}
+
+const char *PendingRequests::errorMsg(int nRequestID) const
+{
+    const Slot *s = doneSlot(nRequestID);
+    return s != 0 ? s->chErrorMsg : "";
+}
+
+int PendingRequests::rows(int nRequestID) const
+{
+    const Slot *s = doneSlot(nRequestID);
+    return s != 0 ? s->nRows : 0;
+}
+
+const void *PendingRequests::row(int nRequestID, int nRow) const
+{
+    const Slot *s = doneSlot(nRequestID);
+    if (s == 0 || nRow < 0 || nRow >= s->nRows)
+        return 0;
+    return s->pRows + (size_t)nRow * s->nRowSize;
+}
+
+void PendingRequests::release(int nRequestID)
+{
+    if (nRequestID < PENDING_REQUEST_BASE)
+        return;
+    Slot *s = slotOf(nRequestID);
+    pthread_mutex_lock(&s->lock);
+    if (s->nRequestID == nRequestID)
+    {
+        if (s->nState == SLOT_PENDING)
+            s->bAbandoned = true;
+        else if (s->nState == SLOT_DONE)
+        {
+            __atomic_store_n(&s->nRequestID, -1, __ATOMIC_RELEASE);
+            s->nState = SLOT_FREE;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+int PendingRequests::pending() const
+{
+    int n = 0;
+    for (int i = 0; i < MAX_PENDING_REQUESTS; i++)
+        if (__atomic_load_n(&m_pSlots[i].nState, __ATOMIC_RELAXED) == SLOT_PENDING)
+            n++;
+    return n;
+}
@@ -0,0 +1,170 @@
+#ifndef __PENDING_REQUESTS_H__
+#define __PENDING_REQUESTS_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include <pthread.h>
+
+using namespace KingstarAPI;
+
+// requests in flight at once
+const int MAX_PENDING_REQUESTS = 256;
+// request ids handed out by the table start here, below the ids of the
+// COS manager and the trigger engine
+const int PENDING_REQUEST_BASE = 0x10000000;
+
+// called on the api callback thread once the last row is in (on the
+// sender's when the Req call itself failed); the request is released when
+// it returns
+typedef void (*RequestCallback)(int nRequestID, void *pContext);
+
+// Requests whose responses are collected by request id.
+//
+// begin() hands out a request id and claims its slot, the OnRspXxx
+// callbacks give every row to onRsp() until bIsLast, and the request is
+// then complete: wait() returns on the thread that asked, or the callback
+// passed to begin() runs on the api thread. Slots are preallocated and
+// found by id, (id - PENDING_REQUEST_BASE) % MAX_PENDING_REQUESTS, so the
+// callback path takes no table lock; each slot has its own mutex and
+// condition only for waking a waiter.
+//
+// Never wait() on the api callback thread, its responses could not arrive.
+class PendingRequests
+{
+public:
+    PendingRequests();
+    ~PendingRequests();
+
+    // claim a slot for rows of nRowSize bytes, returns the request id to
+    // pass to the api, -1 when every slot is in use
+    int begin(int nRowSize, RequestCallback pfnDone = 0, void *pContext = 0);
+    // the Req call returned nResult != 0 (-1 network, -2 outstanding, -3
+    // per second): complete without rows, ErrorID nResult
+    void fail(int nRequestID, int nResult);
+
+    // OnRspXxx, false when the id is not a pending request of this table;
+    // pRow may be NULL when the query has no rows
+    template <class Field>
+    bool onRsp(const Field *pRow, const CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+    {
+        return onRow(pRow, sizeof(Field), pRspInfo, nRequestID, bIsLast);
+    }
+    // OnRspError and OnErrRtnXxx, completes the request without rows
+    bool onError(const CThostFtdcRspInfoField *pRspInfo, int nRequestID);
+
+    bool ours(int nRequestID) const
+    {
+        return nRequestID >= PENDING_REQUEST_BASE && slotOf(nRequestID)->nRequestID == nRequestID;
+    }
+
+    // block until complete, nTimeoutMs < 0 waits forever; false on timeout
+    bool wait(int nRequestID, int nTimeoutMs);
+    bool done(int nRequestID) const;
+
+    // results, valid between completion and release()
+    int errorID(int nRequestID) const;
+    const char *errorMsg(int nRequestID) const;
+    int rows(int nRequestID) const;
+    const void *row(int nRequestID, int nRow) const;
+
+    // give the slot back; a request still in flight is freed when it
+    // completes
+    void release(int nRequestID);
+
+    int pending() const;
+
+private:
+    enum
+    {
+        SLOT_FREE,
+        SLOT_PENDING,
+        SLOT_DONE
+    };
+
+    struct Slot
+    {
+        int nRequestID;
+        int nState;
+        // released while pending, free it on completion
+        bool bAbandoned;
+        int nRowSize;
+        int nRows;
+        int nCapacity;
+        // kept across requests, grown on the api thread
+        char *pRows;
+        int nErrorID;
+        TThostFtdcErrorMsgType chErrorMsg;
+        RequestCallback pfnDone;
+        void *pContext;
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+    };
+
+    PendingRequests(const PendingRequests &);
+    PendingRequests &operator=(const PendingRequests &);
+
+    Slot *slotOf(int nRequestID) const
+    {
+        return &m_pSlots[(unsigned int)(nRequestID - PENDING_REQUEST_BASE) % MAX_PENDING_REQUESTS];
+    }
+    const Slot *doneSlot(int nRequestID) const;
+    bool onRow(const void *pRow, int nRowSize, const CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast);
+    void complete(Slot *s);
+
+    Slot *m_pSlots;
+    int m_nNextID;
+};
+
+// Typed view of one request of a PendingRequests table.
+//
+// A plain handle: copies refer to the same request, and the owner calls
+// release() once the rows have been read.
+template <class Field>
+class RequestFuture
+{
+public:
+    RequestFuture() : m_pTable(0), m_nRequestID(-1) {}
+    RequestFuture(PendingRequests *pTable, int nRequestID) : m_pTable(pTable), m_nRequestID(nRequestID) {}
+
+    // false when no slot was free
+    bool valid() const { return m_nRequestID >= 0; }
+    int requestID() const { return m_nRequestID; }
+
+    bool wait(int nTimeoutMs = -1) const { return valid() && m_pTable->wait(m_nRequestID, nTimeoutMs); }
+    bool done() const { return valid() && m_pTable->done(m_nRequestID); }
+
+    int errorID() const { return m_pTable->errorID(m_nRequestID); }
+    const char *errorMsg() const { return m_pTable->errorMsg(m_nRequestID); }
+    int size() const { return m_pTable->rows(m_nRequestID); }
+    const Field &operator[](int i) const { return *(const Field *)m_pTable->row(m_nRequestID, i); }
+
+    void release()
+    {
+        if (valid())
+            m_pTable->release(m_nRequestID);
+        m_nRequestID = -1;
+    }
+
+private:
+    PendingRequests *m_pTable;
+    int m_nRequestID;
+};
+
+// send one request through the table: the id comes from it and a failed
+// Req call completes the future at once, e.g.
+//   RequestFuture<CThostFtdcInstrumentField> f = sendRequest<CThostFtdcInstrumentField>(
+//       &pending, pUserApi, &CThostFtdcTraderApi::ReqQryInstrument, &qry);
+template <class Field, class Api, class Req>
+RequestFuture<Field> sendRequest(PendingRequests *pTable, Api *pApi, int (Api::*pfnReq)(Req *, int), Req *pReq,
+                                 RequestCallback pfnDone = 0, void *pContext = 0)
+{
+    int nRequestID = pTable->begin(sizeof(Field), pfnDone, pContext);
+    if (nRequestID >= 0)
+    {
+        int nResult = (pApi->*pfnReq)(pReq, nRequestID);
+        if (nResult != 0)
+            pTable->fail(nRequestID, nResult);
+    }
+    return RequestFuture<Field>(pTable, nRequestID);
+}
+
+#endif
@@ -0,0 +1,258 @@
+// PositionKeeper.cpp : positions from the detail query and trades, PnL in ticks.
+//
+#include "PositionKeeper.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+PositionKeeper::PositionKeeper(LastValueCache *pCache) : m_pCache(pCache), m_bSeeded(false), m_bSeeding(false)
+{
+    m_pPositions = new Position[MAX_INSTRUMENTS];
+    m_pUnrealized = new long long[MAX_INSTRUMENTS];
+    memset(m_pPositions, 0, sizeof(Position) * MAX_INSTRUMENTS);
+    memset(m_pUnrealized, 0, sizeof(long long) * MAX_INSTRUMENTS);
+}
+
+PositionKeeper::~PositionKeeper()
+{
+    delete[] m_pPositions;
+    delete[] m_pUnrealized;
+}
+
+int PositionKeeper::addInstrument(const CThostFtdcInstrumentField *pInstrument)
+{
+    int nSlot = m_pCache->addInstrument(pInstrument->InstrumentID);
+    if (nSlot < 0)
+        return -1;
+    Position *p = &m_pPositions[nSlot];
+    beginWrite(p);
+    p->nVolumeMultiple = pInstrument->VolumeMultiple > 0 ? pInstrument->VolumeMultiple : 1;
+    p->dPriceTick = pInstrument->PriceTick;
+    p->bCloseTodayRules = strcmp(pInstrument->ExchangeID, "SHFE") == 0 || strcmp(pInstrument->ExchangeID, "INE") == 0;
+    endWrite(p);
+    return nSlot;
+}
+
+long long PositionKeeper::toTicks(const Position &p, double dPrice) const
+{
+    return llround(dPrice / p.dPriceTick);
+}
+
+void PositionKeeper::onPositionDetail(const CThostFtdcInvestorPositionDetailField *pDetail, bool bIsLast)
+{
+    if (!m_bSeeding)
+    {
+        // a new snapshot replaces everything, trades wait until it is done
+        __atomic_store_n(&m_bSeeded, false, __ATOMIC_RELEASE);
+        m_bSeeding = true;
+        for (int i = 0; i < m_pCache->index().count(); i++)
+        {
+            Position *p = &m_pPositions[i];
+            beginWrite(p);
+            p->nLongToday = p->nLongYesterday = p->nShortToday = p->nShortYesterday = 0;
+            p->nLongTodayCost = p->nLongYesterdayCost = p->nShortTodayCost = p->nShortYesterdayCost = 0;
+            p->nRealized = 0;
+            endWrite(p);
+        }
+    }
+
+    if (pDetail != NULL && pDetail->Volume > 0)
+    {
+        int nSlot = m_pCache->slot(pDetail->InstrumentID);
+        if (nSlot >= 0 && m_pPositions[nSlot].dPriceTick > 0)
+        {
+            Position *p = &m_pPositions[nSlot];
+            bool bToday = strcmp(pDetail->OpenDate, pDetail->TradingDay) == 0;
+            double dPrice = bToday || pDetail->LastSettlementPrice <= 0 ? pDetail->OpenPrice : pDetail->LastSettlementPrice;
+            long long nCost = toTicks(*p, dPrice) * pDetail->Volume;
+            beginWrite(p);
+            if (pDetail->Direction == THOST_FTDC_D_Buy)
+            {
+                if (bToday)
+                {
+                    p->nLongToday += pDetail->Volume;
+                    p->nLongTodayCost += nCost;
+                }
+                else
+                {
+                    p->nLongYesterday += pDetail->Volume;
+                    p->nLongYesterdayCost += nCost;
+                }
+            }
+            else
+            {
+                if (bToday)
+                {
+                    p->nShortToday += pDetail->Volume;
+                    p->nShortTodayCost += nCost;
+                }
+                else
+                {
+                    p->nShortYesterday += pDetail->Volume;
+                    p->nShortYesterdayCost += nCost;
+                }
+            }
+            endWrite(p);
+        }
+    }
+
+    if (bIsLast)
+    {
+        m_bSeeding = false;
+        markSeeded();
+    }
+}
+
+// take nVolume lots out of a bucket at its average cost, returns the cost
+// removed; never takes more than the bucket holds
+long long PositionKeeper::closeBucket(int *pVolume, long long *pCost, int nVolume)
+{
+    if (nVolume > *pVolume)
+        nVolume = *pVolume;
+    if (nVolume <= 0)
+        return 0;
+    long long nRemoved = nVolume == *pVolume ? *pCost : *pCost * nVolume / *pVolume;
+    *pVolume -= nVolume;
+    *pCost -= nRemoved;
+    return nRemoved;
+}
+
+bool PositionKeeper::onRtnTrade(const CThostFtdcTradeField *pTrade)
+{
+    if (!seeded())
+        return false;
+    int nSlot = m_pCache->slot(pTrade->InstrumentID);
+    if (nSlot < 0 || m_pPositions[nSlot].dPriceTick <= 0)
+        return false;
+
+    Position *p = &m_pPositions[nSlot];
+    long long nPrice = toTicks(*p, pTrade->Price);
+    int nVolume = pTrade->Volume;
+    bool bBuy = pTrade->Direction == THOST_FTDC_D_Buy;
+
+    beginWrite(p);
+    if (pTrade->OffsetFlag == THOST_FTDC_OF_Open)
+    {
+        if (bBuy)
+        {
+            p->nLongToday += nVolume;
+            p->nLongTodayCost += nPrice * nVolume;
+        }
+        else
+        {
+            p->nShortToday += nVolume;
+            p->nShortTodayCost += nPrice * nVolume;
+        }
+    }
+    else
+    {
+        // a buy closes the short side, a sell the long side
+        int *pToday = bBuy ? &p->nShortToday : &p->nLongToday;
+        int *pYesterday = bBuy ? &p->nShortYesterday : &p->nLongYesterday;
+        long long *pTodayCost = bBuy ? &p->nShortTodayCost : &p->nLongTodayCost;
+        long long *pYesterdayCost = bBuy ? &p->nShortYesterdayCost : &p->nLongYesterdayCost;
+
+        int nFromToday = 0;
+        if (pTrade->OffsetFlag == THOST_FTDC_OF_CloseToday)
+            nFromToday = nVolume;
+        else if (pTrade->OffsetFlag == THOST_FTDC_OF_CloseYesterday || p->bCloseTodayRules)
+            nFromToday = 0;
+        else
+            nFromToday = nVolume > *pYesterday ? nVolume - *pYesterday : 0;
+        // whatever the chosen bucket lacks comes from the other one
+        if (nFromToday > *pToday)
+            nFromToday = *pToday;
+        if (nVolume - nFromToday > *pYesterday)
+            nFromToday = nVolume - *pYesterday < *pToday ? nVolume - *pYesterday : *pToday;
+
+        long long nCost = closeBucket(pToday, pTodayCost, nFromToday);
+        nCost += closeBucket(pYesterday, pYesterdayCost, nVolume - nFromToday);
+        long long nProceeds = nPrice * nVolume;
+        p->nRealized += bBuy ? nCost - nProceeds : nProceeds - nCost;
+    }
+    endWrite(p);
+    markToMarket(nSlot);
+    return true;
+}
+
+bool PositionKeeper::position(int nSlot, Position *pOut) const
+{
+    if (nSlot < 0 || nSlot >= m_pCache->index().count())
+        return false;
+    const Position *p = &m_pPositions[nSlot];
+    for (;;)
+    {
+        unsigned int nSeq = __atomic_load_n(&p->nSeq, __ATOMIC_ACQUIRE);
+        if (nSeq & 1)
+            continue;
+        *pOut = *p;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&p->nSeq, __ATOMIC_RELAXED) == nSeq)
+            return true;
+    }
+}
+
+void PositionKeeper::onTick(int nSlot)
+{
+    markToMarket(nSlot);
+}
+
+// runs on both threads: valued again when a trade changed the position
+// while it was being valued, so the last store is of the newest position;
+// the price may be a tick old until the next one
+void PositionKeeper::markToMarket(int nSlot)
+{
+    Position pos;
+    LastValue last;
+    do
+    {
+        if (!position(nSlot, &pos) || pos.dPriceTick <= 0 || !m_pCache->read(nSlot, &last))
+            return;
+        if (!(last.dLastPrice > 0 && last.dLastPrice < 1e300))
+            return;
+        long long nLast = toTicks(pos, last.dLastPrice);
+        long long nUnrealized = nLast * (pos.nLongToday + pos.nLongYesterday) - pos.nLongTodayCost - pos.nLongYesterdayCost
+                                + pos.nShortTodayCost + pos.nShortYesterdayCost - nLast * (pos.nShortToday + pos.nShortYesterday);
+        __atomic_store_n(&m_pUnrealized[nSlot], nUnrealized, __ATOMIC_SEQ_CST);
+    }
+    while (__atomic_load_n(&m_pPositions[nSlot].nSeq, __ATOMIC_SEQ_CST) != pos.nSeq);
+}
+
+char PositionKeeper::closeOffsetFlag(const char *pInstrumentID, char chDirection, int nVolume) const
+{
+    Position pos;
+    if (!position(m_pCache->slot(pInstrumentID), &pos))
+        return 0;
+    bool bBuy = chDirection == THOST_FTDC_D_Buy;
+    int nToday = bBuy ? pos.nShortToday : pos.nLongToday;
+    int nYesterday = bBuy ? pos.nShortYesterday : pos.nLongYesterday;
+    if (!pos.bCloseTodayRules)
+        return nToday + nYesterday >= nVolume ? THOST_FTDC_OF_Close : 0;
+    if (nYesterday >= nVolume)
+        return THOST_FTDC_OF_Close;
+    if (nToday >= nVolume)
+        return THOST_FTDC_OF_CloseToday;
+    return 0;
+}
+
+double PositionKeeper::unrealizedPnl(int nSlot) const
+{
+    const Position &p = m_pPositions[nSlot];
+    return __atomic_load_n(&m_pUnrealized[nSlot], __ATOMIC_RELAXED) * p.dPriceTick * p.nVolumeMultiple;
+}
+
+double PositionKeeper::realizedPnl(int nSlot) const
+{
+    Position pos;
+    if (!position(nSlot, &pos))
+        return 0;
+    return pos.nRealized * pos.dPriceTick * pos.nVolumeMultiple;
+}
+
+double PositionKeeper::totalPnl() const
+{
+    double dTotal = 0;
+    for (int i = 0; i < m_pCache->index().count(); i++)
+        dTotal += unrealizedPnl(i) + realizedPnl(i);
+    return dTotal;
+}
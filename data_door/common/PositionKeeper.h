@@ -0,0 +1,100 @@
+#ifndef __POSITION_KEEPER_H__
+#define __POSITION_KEEPER_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "LastValueCache.h"
+
+using namespace KingstarAPI;
+
+// position of one instrument, prices and costs in PriceTick units
+struct Position
+{
+    // odd while the trader thread is updating the entry
+    unsigned int nSeq;
+    int nVolumeMultiple;
+    double dPriceTick;
+    // SHFE and INE: Close closes yesterday's position, today's needs
+    // CloseToday; elsewhere Close takes yesterday's first, then today's
+    bool bCloseTodayRules;
+    int nLongToday;
+    int nLongYesterday;
+    int nShortToday;
+    int nShortYesterday;
+    // sum of open price * volume per bucket; yesterday's positions are
+    // carried at the last settlement price
+    long long nLongTodayCost;
+    long long nLongYesterdayCost;
+    long long nShortTodayCost;
+    long long nShortYesterdayCost;
+    // closed profit since the seed, ticks * lots
+    long long nRealized;
+};
+
+// Real-time positions and PnL.
+//
+// Seeded once from the position detail query, then kept up to date from
+// OnRtnTrade. Trades received before the query completed are covered by
+// it and ignored. Mark to market runs on the market data thread: onTick()
+// values the position against the tick just stored in the LastValueCache
+// and keeps the unrealized profit per instrument, all in integer ticks;
+// money is only computed when a result is read. onRtnTrade() marks the
+// changed position against the cached price too, so the unrealized profit
+// does not wait for the next tick.
+//
+// addInstrument(), onPositionDetail() and onRtnTrade() belong to the
+// trader api callback thread, onTick() to the market data thread; the
+// position entries are published with a sequence counter in between.
+class PositionKeeper
+{
+public:
+    PositionKeeper(LastValueCache *pCache);
+    ~PositionKeeper();
+
+    // OnRspQryInstrument: VolumeMultiple, PriceTick and the close rules
+    int addInstrument(const CThostFtdcInstrumentField *pInstrument);
+
+    // OnRspQryInvestorPositionDetail; the first row after a completed seed
+    // starts a new one. pDetail may be NULL when there is no position.
+    void onPositionDetail(const CThostFtdcInvestorPositionDetailField *pDetail, bool bIsLast);
+
+    // start from flat positions without querying
+    void markSeeded() { __atomic_store_n(&m_bSeeded, true, __ATOMIC_RELEASE); }
+    bool seeded() const { return __atomic_load_n(&m_bSeeded, __ATOMIC_ACQUIRE); }
+
+    // OnRtnTrade, false when ignored (before the seed or unknown instrument)
+    bool onRtnTrade(const CThostFtdcTradeField *pTrade);
+
+    // after LastValueCache::update() returned nSlot
+    void onTick(int nSlot);
+
+    // offset flag closing nVolume lots with an order in chDirection, 0 when
+    // the position on the other side is too small for one order
+    char closeOffsetFlag(const char *pInstrumentID, char chDirection, int nVolume) const;
+
+    // consistent copy of an instrument's position, false if unknown
+    bool position(int nSlot, Position *pOut) const;
+
+    // money, using VolumeMultiple and PriceTick
+    double unrealizedPnl(int nSlot) const;
+    double realizedPnl(int nSlot) const;
+    // over every instrument
+    double totalPnl() const;
+
+    const InstrumentIndex &index() const { return m_pCache->index(); }
+
+private:
+    void beginWrite(Position *p) { __atomic_store_n(&p->nSeq, p->nSeq + 1, __ATOMIC_RELAXED); __atomic_thread_fence(__ATOMIC_RELEASE); }
+    void endWrite(Position *p) { __atomic_store_n(&p->nSeq, p->nSeq + 1, __ATOMIC_RELEASE); }
+    long long toTicks(const Position &p, double dPrice) const;
+    long long closeBucket(int *pVolume, long long *pCost, int nVolume);
+    void markToMarket(int nSlot);
+
+    LastValueCache *m_pCache;
+    Position *m_pPositions;
+    // written by markToMarket(), from either thread
+    long long *m_pUnrealized;
+    bool m_bSeeded;
+    bool m_bSeeding;
+};
+
+#endif
@@ -0,0 +1,305 @@
+// RiskEngine.cpp : inline pre-trade checks.
+//
+#include "RiskEngine.h"
+#include "AsyncLogger.h"
+#include <string.h>
+#include <float.h>
+
+static const char *s_reasons[RISK_RESULT_COUNT] =
+{
+    "ok",
+    "unknown instrument",
+    "order volume",
+    "no market data",
+    "price band",
+    "position limit",
+    "notional limit",
+    "self trade",
+    "too many working orders"
+};
+
+RiskEngine::RiskEngine(LastValueCache *pCache) : m_pCache(pCache)
+{
+    // permissive until configured, only the exchange band applies
+    m_defaults.nMaxOrderVolume = 1000;
+    m_defaults.nMaxPosition = 1000000;
+    m_defaults.dMaxNotional = 1e15;
+    m_pSlots = new Slot[MAX_INSTRUMENTS];
+    m_pViews = new View[MAX_INSTRUMENTS];
+    m_pPassed = new int[MAX_INSTRUMENTS * 2];
+    memset(m_pSlots, 0, sizeof(Slot) * MAX_INSTRUMENTS);
+    memset(m_pViews, 0, sizeof(View) * MAX_INSTRUMENTS);
+    memset(m_pPassed, 0, sizeof(int) * MAX_INSTRUMENTS * 2);
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+    {
+        m_pSlots[i].limits = m_defaults;
+        publish(i);
+    }
+}
+
+RiskEngine::~RiskEngine()
+{
+    delete[] m_pSlots;
+    delete[] m_pViews;
+    delete[] m_pPassed;
+}
+
+const char *RiskEngine::reason(int nResult)
+{
+    return nResult >= 0 && nResult < RISK_RESULT_COUNT ? s_reasons[nResult] : "?";
+}
+
+// after every change of a slot, on the trader thread
+void RiskEngine::publish(int nSlot)
+{
+    const Slot &s = m_pSlots[nSlot];
+    View &v = m_pViews[nSlot];
+    int nPending[2] = { 0, 0 };
+    double dOwnBid = 0, dOwnAsk = DBL_MAX;
+    for (int i = 0; i < s.nWorking; i++)
+    {
+        const Working &w = s.working[i];
+        bool bBuy = w.chDirection == THOST_FTDC_D_Buy;
+        if (w.bOpen)
+            nPending[bBuy ? 0 : 1] += w.nRemaining;
+        if (bBuy && w.dPrice > dOwnBid)
+            dOwnBid = w.dPrice;
+        else if (!bBuy && w.dPrice < dOwnAsk)
+            dOwnAsk = w.dPrice;
+    }
+    __atomic_store_n(&v.nMaxOrderVolume, s.limits.nMaxOrderVolume, __ATOMIC_RELAXED);
+    __atomic_store_n(&v.nMaxPosition, s.limits.nMaxPosition, __ATOMIC_RELAXED);
+    __atomic_store(&v.dMaxNotional, &s.limits.dMaxNotional, __ATOMIC_RELAXED);
+    __atomic_store_n(&v.nVolumeMultiple, s.nVolumeMultiple > 0 ? s.nVolumeMultiple : 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&v.nWorking, s.nWorking, __ATOMIC_RELAXED);
+    __atomic_store(&v.dOwnBid, &dOwnBid, __ATOMIC_RELAXED);
+    __atomic_store(&v.dOwnAsk, &dOwnAsk, __ATOMIC_RELAXED);
+    // before nRegistered: a preCheck() that sees a registration sees its
+    // exposure too, at worst it counts the order twice
+    __atomic_store_n(&v.nExposure[0], s.nLong + nPending[0], __ATOMIC_RELEASE);
+    __atomic_store_n(&v.nExposure[1], s.nShort + nPending[1], __ATOMIC_RELEASE);
+}
+
+void RiskEngine::setDefaultLimits(const RiskLimits &limits)
+{
+    m_defaults = limits;
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+    {
+        if (!m_pSlots[i].bOwnLimits)
+        {
+            m_pSlots[i].limits = limits;
+            publish(i);
+        }
+    }
+}
+
+void RiskEngine::setLimits(const char *pInstrumentID, const RiskLimits &limits)
+{
+    int nSlot = m_pCache->addInstrument(pInstrumentID);
+    if (nSlot < 0)
+        return;
+    m_pSlots[nSlot].limits = limits;
+    m_pSlots[nSlot].bOwnLimits = true;
+    publish(nSlot);
+}
+
+int RiskEngine::addInstrument(const CThostFtdcInstrumentField *pInstrument)
+{
+    int nSlot = m_pCache->addInstrument(pInstrument->InstrumentID);
+    if (nSlot >= 0)
+    {
+        m_pSlots[nSlot].nVolumeMultiple = pInstrument->VolumeMultiple > 0 ? pInstrument->VolumeMultiple : 1;
+        publish(nSlot);
+    }
+    return nSlot;
+}
+
+void RiskEngine::setPosition(const char *pInstrumentID, int nLong, int nShort)
+{
+    int nSlot = m_pCache->addInstrument(pInstrumentID);
+    if (nSlot < 0)
+        return;
+    m_pSlots[nSlot].nLong = nLong;
+    m_pSlots[nSlot].nShort = nShort;
+    publish(nSlot);
+}
+
+int RiskEngine::check(const CThostFtdcInputOrderField *pInputOrder, bool bBand) const
+{
+    int nSlot = m_pCache->slot(pInputOrder->InstrumentID);
+    if (nSlot < 0)
+        return RISK_UNKNOWN_INSTRUMENT;
+    const Slot &s = m_pSlots[nSlot];
+
+    int nVolume = pInputOrder->VolumeTotalOriginal;
+    if (nVolume <= 0 || nVolume > s.limits.nMaxOrderVolume)
+        return RISK_ORDER_VOLUME;
+
+    double dPrice = pInputOrder->LimitPrice;
+    if (bBand)
+    {
+        LastValue last;
+        if (!m_pCache->read(nSlot, &last))
+            return RISK_NO_MARKET_DATA;
+        if (dPrice > last.dUpperLimitPrice || dPrice < last.dLowerLimitPrice)
+            return RISK_PRICE_BAND;
+    }
+
+    // one pass over the working orders: pending opening volume on our side
+    // and the best opposite price we would trade against
+    bool bBuy = pInputOrder->Direction == THOST_FTDC_D_Buy;
+    int nPending = 0;
+    for (int i = 0; i < s.nWorking; i++)
+    {
+        const Working &w = s.working[i];
+        if ((w.chDirection == THOST_FTDC_D_Buy) == bBuy)
+        {
+            if (w.bOpen)
+                nPending += w.nRemaining;
+        }
+        else if (bBuy ? dPrice >= w.dPrice : dPrice <= w.dPrice)
+        {
+            return RISK_SELF_TRADE;
+        }
+    }
+    if (s.nWorking >= RISK_MAX_WORKING)
+        return RISK_TOO_MANY_ORDERS;
+
+    if (pInputOrder->CombOffsetFlag[0] == THOST_FTDC_OF_Open)
+    {
+        int nExposure = (bBuy ? s.nLong : s.nShort) + nPending + nVolume;
+        if (nExposure > s.limits.nMaxPosition)
+            return RISK_POSITION;
+        if (nExposure * dPrice * s.nVolumeMultiple > s.limits.dMaxNotional)
+            return RISK_NOTIONAL;
+    }
+    return RISK_OK;
+}
+
+int RiskEngine::preCheck(int nSlot, char chDirection, char chOffsetFlag, double dPrice, int nVolume)
+{
+    const View &v = m_pViews[nSlot];
+    if (nVolume <= 0 || nVolume > __atomic_load_n(&v.nMaxOrderVolume, __ATOMIC_RELAXED))
+        return RISK_ORDER_VOLUME;
+
+    bool bBuy = chDirection == THOST_FTDC_D_Buy;
+    double dOwn;
+    if (bBuy)
+        __atomic_load(&v.dOwnAsk, &dOwn, __ATOMIC_RELAXED);
+    else
+        __atomic_load(&v.dOwnBid, &dOwn, __ATOMIC_RELAXED);
+    if (bBuy ? dPrice >= dOwn : dPrice <= dOwn)
+        return RISK_SELF_TRADE;
+    if (__atomic_load_n(&v.nWorking, __ATOMIC_RELAXED) >= RISK_MAX_WORKING)
+        return RISK_TOO_MANY_ORDERS;
+
+    if (chOffsetFlag == THOST_FTDC_OF_Open)
+    {
+        int nSide = bBuy ? 0 : 1;
+        int &nPassed = m_pPassed[nSlot * 2 + nSide];
+        int nRegistered = __atomic_load_n(&v.nRegistered[nSide], __ATOMIC_ACQUIRE);
+        int nExposure = __atomic_load_n(&v.nExposure[nSide], __ATOMIC_ACQUIRE) + nPassed - nRegistered + nVolume;
+        if (nExposure > __atomic_load_n(&v.nMaxPosition, __ATOMIC_RELAXED))
+            return RISK_POSITION;
+        double dMaxNotional;
+        __atomic_load(&v.dMaxNotional, &dMaxNotional, __ATOMIC_RELAXED);
+        if (nExposure * dPrice * __atomic_load_n(&v.nVolumeMultiple, __ATOMIC_RELAXED) > dMaxNotional)
+            return RISK_NOTIONAL;
+        nPassed += nVolume;
+    }
+    return RISK_OK;
+}
+
+void RiskEngine::onInsert(const CThostFtdcInputOrderField *pInputOrder, int nOrderID)
+{
+    int nSlot = m_pCache->slot(pInputOrder->InstrumentID);
+    if (nSlot < 0)
+        return;
+    Slot *s = &m_pSlots[nSlot];
+    if (s->nWorking >= RISK_MAX_WORKING)
+    {
+        // check() refuses these; a triggered order can get here when the
+        // view preCheck() read was behind
+        FC_LOG(LOG_LEVEL_WARN, "risk: %s has %d working orders, order %d not tracked\n", pInputOrder->InstrumentID,
+               s->nWorking, nOrderID);
+        return;
+    }
+    Working &w = s->working[s->nWorking++];
+    w.nOrderID = nOrderID;
+    w.nRemaining = pInputOrder->VolumeTotalOriginal;
+    w.dPrice = pInputOrder->LimitPrice;
+    w.chDirection = pInputOrder->Direction;
+    w.bOpen = pInputOrder->CombOffsetFlag[0] == THOST_FTDC_OF_Open;
+    publish(nSlot);
+}
+
+void RiskEngine::onTriggered(const CThostFtdcInputOrderField *pInputOrder, int nOrderID)
+{
+    onInsert(pInputOrder, nOrderID);
+    int nSlot = m_pCache->slot(pInputOrder->InstrumentID);
+    if (nSlot < 0 || pInputOrder->CombOffsetFlag[0] != THOST_FTDC_OF_Open)
+        return;
+    int *pRegistered = &m_pViews[nSlot].nRegistered[pInputOrder->Direction == THOST_FTDC_D_Buy ? 0 : 1];
+    __atomic_store_n(pRegistered, *pRegistered + pInputOrder->VolumeTotalOriginal, __ATOMIC_RELEASE);
+}
+
+void RiskEngine::removeWorking(Slot *s, int i)
+{
+    s->working[i] = s->working[--s->nWorking];
+}
+
+void RiskEngine::onOrderUpdate(const char *pInstrumentID, int nOrderID, int nVolumeTotal, bool bDone)
+{
+    int nSlot = m_pCache->slot(pInstrumentID);
+    if (nSlot < 0)
+        return;
+    Slot *s = &m_pSlots[nSlot];
+    for (int i = 0; i < s->nWorking; i++)
+    {
+        if (s->working[i].nOrderID != nOrderID)
+            continue;
+        if (bDone || nVolumeTotal <= 0)
+            removeWorking(s, i);
+        else if (nVolumeTotal < s->working[i].nRemaining)
+            s->working[i].nRemaining = nVolumeTotal;
+        publish(nSlot);
+        return;
+    }
+}
+
+void RiskEngine::onRtnTrade(const CThostFtdcTradeField *pTrade, int nOrderID)
+{
+    int nSlot = m_pCache->slot(pTrade->InstrumentID);
+    if (nSlot < 0)
+        return;
+    Slot *s = &m_pSlots[nSlot];
+    bool bBuy = pTrade->Direction == THOST_FTDC_D_Buy;
+    if (pTrade->OffsetFlag == THOST_FTDC_OF_Open)
+    {
+        if (bBuy)
+            s->nLong += pTrade->Volume;
+        else
+            s->nShort += pTrade->Volume;
+    }
+    // at least zero: closing a position the seed did not cover must not
+    // free opening headroom
+    else if (bBuy)
+    {
+        s->nShort = s->nShort > pTrade->Volume ? s->nShort - pTrade->Volume : 0;
+    }
+    else
+    {
+        s->nLong = s->nLong > pTrade->Volume ? s->nLong - pTrade->Volume : 0;
+    }
+
+    for (int i = 0; nOrderID >= 0 && i < s->nWorking; i++)
+    {
+        if (s->working[i].nOrderID != nOrderID)
+            continue;
+        s->working[i].nRemaining -= pTrade->Volume;
+        if (s->working[i].nRemaining <= 0)
+            removeWorking(s, i);
+        break;
+    }
+    publish(nSlot);
+}
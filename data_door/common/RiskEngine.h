@@ -0,0 +1,157 @@
+#ifndef __RISK_ENGINE_H__
+#define __RISK_ENGINE_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "LastValueCache.h"
+
+using namespace KingstarAPI;
+
+// check() results
+enum
+{
+    RISK_OK,
+    // instrument never registered with addInstrument()
+    RISK_UNKNOWN_INSTRUMENT,
+    // volume not positive or above the instrument's max order volume
+    RISK_ORDER_VOLUME,
+    // no tick received yet, the price band is unknown
+    RISK_NO_MARKET_DATA,
+    // limit price outside [LowerLimitPrice, UpperLimitPrice]
+    RISK_PRICE_BAND,
+    // position plus working orders on that side would exceed the limit
+    RISK_POSITION,
+    // notional of position plus working orders would exceed the limit
+    RISK_NOTIONAL,
+    // would cross one of our own working orders
+    RISK_SELF_TRADE,
+    // too many working orders on the instrument to track
+    RISK_TOO_MANY_ORDERS,
+    RISK_RESULT_COUNT
+};
+
+struct RiskLimits
+{
+    // largest VolumeTotalOriginal of one order
+    int nMaxOrderVolume;
+    // largest long or short position including working orders, lots
+    int nMaxPosition;
+    // largest notional of one side including working orders, price *
+    // volume * VolumeMultiple
+    double dMaxNotional;
+};
+
+// working orders tracked per instrument for the pending volume and self
+// trade checks
+const int RISK_MAX_WORKING = 16;
+
+// Inline pre-trade risk gate for ReqOrderInsert.
+//
+// All state is flat, per instrument and indexed by the slot of the shared
+// LastValueCache, so a check is one hash lookup, one seqlock read of the
+// last tick and a scan of at most RISK_MAX_WORKING working orders. Positions
+// and working orders are updated incrementally from the order and trade
+// returns. Not thread safe: check(), onInsert(), onRtnOrder() and
+// onRtnTrade() belong to the trader api callback thread.
+//
+// Orders sent from the market data thread (TriggerEngine) go through
+// preCheck() instead. Every update of the trader thread also publishes the
+// slot's limits, exposure and best own prices to a view read with atomic
+// loads; preCheck() applies the same limits to it, adding the opening
+// volume it passed that the trader thread has not registered yet through
+// onTriggered(). The fields are read one by one, so a check racing an
+// update may mix the old and new values of the slot.
+class RiskEngine
+{
+public:
+    // pCache supplies the instrument slots and the price band
+    RiskEngine(LastValueCache *pCache);
+    ~RiskEngine();
+
+    // limits for instruments without their own, and for one instrument
+    void setDefaultLimits(const RiskLimits &limits);
+    void setLimits(const char *pInstrumentID, const RiskLimits &limits);
+
+    // OnRspQryInstrument: registers the instrument with the cache too
+    int addInstrument(const CThostFtdcInstrumentField *pInstrument);
+
+    // seed a position, from the PositionKeeper once the position query
+    // completed
+    void setPosition(const char *pInstrumentID, int nLong, int nShort);
+
+    // RISK_OK or the first check that failed; bBand false skips the market
+    // data and price band checks, for orders priced before the first tick
+    int check(const CThostFtdcInputOrderField *pInputOrder, bool bBand = true) const;
+
+    // market data thread: check() against the published view, the price
+    // band left to the caller; a passed opening order counts towards the
+    // exposure until onTriggered() registers it
+    int preCheck(int nSlot, char chDirection, char chOffsetFlag, double dPrice, int nVolume);
+
+    // an order passed check() and is being sent; nOrderID identifies it in
+    // the later returns (the OrderManager slot)
+    void onInsert(const CThostFtdcInputOrderField *pInputOrder, int nOrderID);
+    // onInsert() for an order preCheck() passed and the market data thread
+    // sent
+    void onTriggered(const CThostFtdcInputOrderField *pInputOrder, int nOrderID);
+
+    // OnRtnOrder / rejected insert: remaining volume, nVolumeTotal 0 or
+    // bDone when the order stopped working
+    void onOrderUpdate(const char *pInstrumentID, int nOrderID, int nVolumeTotal, bool bDone);
+
+    // OnRtnTrade, nOrderID -1 when the order is unknown
+    void onRtnTrade(const CThostFtdcTradeField *pTrade, int nOrderID);
+
+    static const char *reason(int nResult);
+
+private:
+    struct Working
+    {
+        int nOrderID;
+        int nRemaining;
+        double dPrice;
+        char chDirection;
+        // opening orders count towards the position limits
+        bool bOpen;
+    };
+
+    struct Slot
+    {
+        RiskLimits limits;
+        bool bOwnLimits;
+        int nVolumeMultiple;
+        int nLong;
+        int nShort;
+        int nWorking;
+        Working working[RISK_MAX_WORKING];
+    };
+
+    // the view preCheck() reads, per slot; index 0 buy, 1 sell
+    struct View
+    {
+        int nMaxOrderVolume;
+        int nMaxPosition;
+        double dMaxNotional;
+        int nVolumeMultiple;
+        int nWorking;
+        // position plus working opening volume
+        int nExposure[2];
+        // opening volume passed by preCheck() and registered by onTriggered()
+        int nRegistered[2];
+        // highest working buy and lowest working sell, 0 and DBL_MAX for none
+        double dOwnBid;
+        double dOwnAsk;
+    };
+
+    void removeWorking(Slot *s, int i);
+    void publish(int nSlot);
+
+    LastValueCache *m_pCache;
+    RiskLimits m_defaults;
+    Slot *m_pSlots;
+    View *m_pViews;
+    // market data thread: opening volume passed by preCheck(), per slot and
+    // side
+    int *m_pPassed;
+};
+
+#endif
@@ -0,0 +1,159 @@
+// ServiceConfig.cpp : key = value settings with environment and per instance overrides.
+//
+#include "ServiceConfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+ServiceConfig::Entry ServiceConfig::s_entries[CONFIG_MAX_ENTRIES];
+int ServiceConfig::s_nEntries = 0;
+char ServiceConfig::s_chInstance[CONFIG_KEY_SIZE] = "";
+
+// trim leading and trailing blanks in place
+static char *trim(char *p)
+{
+    while (isspace((unsigned char)*p))
+        p++;
+    int n = strlen(p);
+    while (n > 0 && isspace((unsigned char)p[n - 1]))
+        p[--n] = '\0';
+    return p;
+}
+
+bool ServiceConfig::load(const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+        return false;
+    char chLine[CONFIG_KEY_SIZE + CONFIG_VALUE_SIZE + 16];
+    int nLine = 0;
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        nLine++;
+        for (char *p = chLine; *p != '\0'; p++)
+        {
+            if (*p == '#' && (p == chLine || isspace((unsigned char)p[-1])))
+            {
+                *p = '\0';
+                break;
+            }
+        }
+        char *pEqual = strchr(chLine, '=');
+        if (pEqual == NULL)
+        {
+            if (*trim(chLine) != '\0')
+                printf("%s:%d: no '=', line ignored\n", pFile, nLine);
+            continue;
+        }
+        *pEqual = '\0';
+        char *pKey = trim(chLine);
+        char *pValue = trim(pEqual + 1);
+        if (*pKey == '\0' || strlen(pKey) >= (size_t)CONFIG_KEY_SIZE || strlen(pValue) >= (size_t)CONFIG_VALUE_SIZE)
+        {
+            printf("%s:%d: bad key or value too long, line ignored\n", pFile, nLine);
+            continue;
+        }
+
+        // a repeated key replaces the earlier value
+        int i = 0;
+        while (i < s_nEntries && strcmp(s_entries[i].chKey, pKey) != 0)
+            i++;
+        if (i == CONFIG_MAX_ENTRIES)
+        {
+            printf("%s:%d: more than %d keys, line ignored\n", pFile, nLine, CONFIG_MAX_ENTRIES);
+            continue;
+        }
+        if (i == s_nEntries)
+            s_nEntries++;
+        strcpy(s_entries[i].chKey, pKey);
+        strcpy(s_entries[i].chValue, pValue);
+    }
+    fclose(fp);
+    return true;
+}
+
+void ServiceConfig::setInstance(const char *pName)
+{
+    if (pName == NULL)
+        pName = getenv("FC_INSTANCE");
+    if (pName == NULL)
+        return;
+    strncpy(s_chInstance, pName, sizeof(s_chInstance) - 1);
+    s_chInstance[sizeof(s_chInstance) - 1] = '\0';
+}
+
+const char *ServiceConfig::find(const char *pKey)
+{
+    for (int i = 0; i < s_nEntries; i++)
+    {
+        if (strcmp(s_entries[i].chKey, pKey) == 0)
+            return s_entries[i].chValue;
+    }
+    return NULL;
+}
+
+const char *ServiceConfig::get(const char *pKey, const char *pDefault)
+{
+    char chName[CONFIG_KEY_SIZE * 2 + 4];
+    snprintf(chName, sizeof(chName), "FC_%s", pKey);
+    for (char *p = chName + 3; *p != '\0'; p++)
+        *p = *p == '.' ? '_' : toupper((unsigned char)*p);
+    const char *pValue = getenv(chName);
+    if (pValue != NULL)
+        return pValue;
+
+    if (s_chInstance[0] != '\0')
+    {
+        snprintf(chName, sizeof(chName), "%s.%s", s_chInstance, pKey);
+        pValue = find(chName);
+        if (pValue != NULL)
+            return pValue;
+    }
+    pValue = find(pKey);
+    return pValue != NULL ? pValue : pDefault;
+}
+
+int ServiceConfig::getInt(const char *pKey, int nDefault)
+{
+    const char *pValue = get(pKey);
+    if (pValue == NULL)
+        return nDefault;
+    char *pEnd;
+    long n = strtol(pValue, &pEnd, 0);
+    if (pEnd == pValue || *pEnd != '\0')
+    {
+        printf("config %s: '%s' is not a number, using %d\n", pKey, pValue, nDefault);
+        return nDefault;
+    }
+    return (int)n;
+}
+
+bool ServiceConfig::copy(const char *pKey, char *pDest, int nSize)
+{
+    const char *pValue = get(pKey);
+    if (pValue == NULL || strlen(pValue) >= (size_t)nSize)
+        return false;
+    strcpy(pDest, pValue);
+    return true;
+}
+
+bool ServiceConfig::require(const char *pKeys)
+{
+    bool bAll = true;
+    char chKeys[512];
+    strncpy(chKeys, pKeys, sizeof(chKeys) - 1);
+    chKeys[sizeof(chKeys) - 1] = '\0';
+    for (char *pKey = strtok(chKeys, ","); pKey != NULL; pKey = strtok(NULL, ","))
+    {
+        if (get(pKey) != NULL)
+            continue;
+        char chEnv[CONFIG_KEY_SIZE];
+        snprintf(chEnv, sizeof(chEnv), "FC_%s", pKey);
+        for (char *p = chEnv + 3; *p != '\0'; p++)
+            *p = *p == '.' ? '_' : toupper((unsigned char)*p);
+        printf("%s is not set, add it to the -config file or set %s\n", pKey, chEnv);
+        bAll = false;
+    }
+    return bAll;
+}
@@ -0,0 +1,122 @@
+#ifndef __SERVICE_CONFIG_H__
+#define __SERVICE_CONFIG_H__
+
+const int CONFIG_MAX_ENTRIES = 256;
+const int CONFIG_KEY_SIZE = 64;
+const int CONFIG_VALUE_SIZE = 256;
+
+// Settings of the data_door binaries: accounts, fronts, shard layout,
+// queue sizes and the publisher endpoint.
+//
+// load() reads "key = value" lines, # at the start of a line or after a
+// blank starts a comment, so a value like a password may hold one. A value
+// is looked up in this order:
+//   FC_<KEY> in the environment, the key upper cased with . as _
+//   "<instance>.<key>" in the file, the instance from -instance or
+//   FC_INSTANCE, so one file can describe every shard
+//   "<key>" in the file
+//   the caller's default
+// so one build runs any number of differently tuned instances.
+//
+// Keys read by the binaries:
+//   broker_id, user_id, password   account, required
+//   front                          trader front, required
+//   md_front                       market data front, default front
+//   publisher_host, publisher_port ingest server, default localhost 9999
+//   ingest_ring_size               servant_market ring entries, 16384
+//   publish_async                  servant_market: 1 stamps MessageIds and
+//                                  takes acks asynchronously, as -async
+//   node_id                        16 bit node of the MessageIds, default
+//                                  from gethostid()
+//   shard_count, shard_index       servant_market: subscribe only the
+//                                  instruments hashing to this shard
+//   shard_products                 servant_market: only these products,
+//                                  a comma list like cu,al,zn
+//   topology                       thread topology file, as -topology
+//   ingest_port                    ingest_server: listening port, 9999
+//   journal                        ingest_server: record journal, as -journal
+//   fanout_port                    ingest_server: tick fanout port, as -fanout,
+//                                  none when unset
+//   fanout_queue                   ingest_server: ticks queued for the fanout
+//                                  thread, 16384
+//   fanout_client_buffer           ingest_server: output bytes per subscriber,
+//                                  262144
+//   fanout_slow                    ingest_server: conflate (default) or
+//                                  disconnect a subscriber that falls behind
+//   mcast_group, mcast_port        servant_market: multicast the delta frames
+//                                  to this group, as -mcast group:port; port
+//                                  31001, none when unset
+//   mcast_interface                servant_market: sending interface address
+//   mcast_ttl                      servant_market: hops, 1 keeps it on the LAN
+//   mcast_recovery_port            servant_market: TCP retransmit port,
+//                                  default mcast_port, one per instance
+//   mcast_history                  servant_market: packets kept for
+//                                  retransmission, 16384
+//   mcast_snapshot                 servant_market: full frame every this many
+//                                  updates of an instrument, 100
+//   indicators                     servant_market: 1 appends the indicators
+//                                  to every published tick, as -indicators
+//   indicator_ema                  servant_market: EMA period in ticks, 20
+//   indicator_window               servant_market: mid price returns in the
+//                                  volatility window, 64
+//   spreads                        servant_market: file of synthetic spreads
+//                                  to publish, as -spreads; see SpreadBook.h
+//   options                        option table, see OptionSurface.h:
+//                                  servant_instrument writes it and
+//                                  servant_market publishes the volatilities
+//                                  and greeks of its chains, as -options
+//   option_rate                    servant_market: continuously compounded
+//                                  rate discounting option premiums, 0
+//   for_quote                      servant_market: 1 subscribes the requests
+//                                  for quote and publishes them ahead of the
+//                                  ticks, as -forquote
+//   feed_monitor                   servant_market: 1 tracks staleness, gaps,
+//                                  tick rate and latency per instrument, as
+//                                  -monitor; see FeedMonitor.h
+//   feed_stale_ms                  silence before an instrument is stale,
+//                                  30000
+//   feed_stale                     products with their own, cu:3000,IF:1000
+//   feed_silent_ms                 silence of the whole feed before its
+//                                  alert, 5000
+//   feed_lag_ms                    alert when most instruments are further
+//                                  behind the exchange clock, 0 for none
+//   feed_scan_ms                   monitor scan interval, 100
+//
+// Loaded once in main() before any thread starts, read only afterwards.
+class ServiceConfig
+{
+public:
+    // false when the file cannot be read; a later load() adds to and
+    // overrides the earlier ones
+    static bool load(const char *pFile);
+
+    // NULL takes FC_INSTANCE from the environment, if set
+    static void setInstance(const char *pName);
+    static const char *instance() { return s_chInstance; }
+
+    // the value or pDefault
+    static const char *get(const char *pKey, const char *pDefault = 0);
+    static int getInt(const char *pKey, int nDefault);
+
+    // copy into a fixed size api field, false and left alone when unset
+    // or too long
+    static bool copy(const char *pKey, char *pDest, int nSize);
+
+    // every key of the comma list pKeys set, the missing ones printed
+    static bool require(const char *pKeys);
+
+private:
+    struct Entry
+    {
+        char chKey[CONFIG_KEY_SIZE];
+        char chValue[CONFIG_VALUE_SIZE];
+    };
+
+    static const char *find(const char *pKey);
+
+    static Entry s_entries[CONFIG_MAX_ENTRIES];
+    static int s_nEntries;
+    static char s_chInstance[CONFIG_KEY_SIZE];
+};
+
+#endif
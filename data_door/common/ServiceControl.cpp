@@ -0,0 +1,145 @@
+// ServiceControl.cpp : daemon mode, control signals and the bounded shutdown.
+//
+#include "ServiceControl.h"
+#include "AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+
+int ServiceControl::s_nSignalFd = -1;
+char *ServiceControl::s_pPidFile = NULL;
+
+// set by exit(), checked by the stop watchdog
+static volatile bool s_bStopped = false;
+
+bool ServiceControl::daemonize(const char *pPidFile)
+{
+    pid_t nPid = fork();
+    if (nPid < 0)
+        return false;
+    if (nPid > 0)
+        _exit(0);
+    setsid();
+
+    int fd = open("/dev/null", O_RDWR);
+    if (fd >= 0)
+    {
+        dup2(fd, STDIN_FILENO);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        if (fd > STDERR_FILENO)
+            close(fd);
+    }
+
+    if (pPidFile == NULL)
+        return true;
+    FILE *fp = fopen(pPidFile, "w");
+    if (fp == NULL)
+        return false;
+    fprintf(fp, "%d\n", (int)getpid());
+    fclose(fp);
+    s_pPidFile = strdup(pPidFile);
+    return true;
+}
+
+bool ServiceControl::install()
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGHUP);
+    // threads created from here on inherit the mask
+    if (pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0)
+        return false;
+    s_nSignalFd = signalfd(-1, &mask, SFD_CLOEXEC);
+    return s_nSignalFd >= 0;
+}
+
+int ServiceControl::wait(bool bConsole)
+{
+    for (;;)
+    {
+        struct pollfd fds[2];
+        fds[0].fd = s_nSignalFd;
+        fds[0].events = POLLIN;
+        fds[1].fd = STDIN_FILENO;
+        fds[1].events = POLLIN;
+        if (poll(fds, bConsole ? 2 : 1, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return SERVICE_STOP;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            struct signalfd_siginfo info;
+            if (read(s_nSignalFd, &info, sizeof(info)) == (ssize_t)sizeof(info))
+            {
+                FC_LOG(LOG_LEVEL_INFO, "received signal %u from pid %u\n", info.ssi_signo, info.ssi_pid);
+                return info.ssi_signo == SIGHUP ? SERVICE_RELOAD : SERVICE_STOP;
+            }
+        }
+        if (bConsole && (fds[1].revents & (POLLIN | POLLHUP)))
+        {
+            char chLine[256];
+            if (fgets(chLine, sizeof(chLine), stdin) != NULL)
+                return SERVICE_STOP;
+            // stdin closed, signals only from now on
+            bConsole = false;
+        }
+    }
+}
+
+int ServiceControl::check()
+{
+    struct pollfd pfd;
+    pfd.fd = s_nSignalFd;
+    pfd.events = POLLIN;
+    struct signalfd_siginfo info;
+    if (poll(&pfd, 1, 0) != 1 || read(s_nSignalFd, &info, sizeof(info)) != (ssize_t)sizeof(info))
+        return -1;
+    FC_LOG(LOG_LEVEL_INFO, "received signal %u from pid %u\n", info.ssi_signo, info.ssi_pid);
+    return info.ssi_signo == SIGHUP ? SERVICE_RELOAD : SERVICE_STOP;
+}
+
+static void *stop_watchdog(void *)
+{
+    for (int n = 0; n < SERVICE_STOP_TIMEOUT * 10; n++)
+    {
+        if (s_bStopped)
+            return NULL;
+        usleep(100000);
+    }
+    FC_LOG(LOG_LEVEL_ERROR, "shutdown did not finish within %d seconds, exiting\n", SERVICE_STOP_TIMEOUT);
+    // give the writer thread a moment to get the line out
+    usleep(200000);
+    _exit(1);
+    return NULL;
+}
+
+void ServiceControl::beginStop()
+{
+    pthread_t hThread;
+    if (pthread_create(&hThread, NULL, stop_watchdog, NULL) == 0)
+        pthread_detach(hThread);
+}
+
+void ServiceControl::exit()
+{
+    s_bStopped = true;
+    if (s_pPidFile != NULL)
+    {
+        unlink(s_pPidFile);
+        free(s_pPidFile);
+        s_pPidFile = NULL;
+    }
+}
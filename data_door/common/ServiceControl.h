@@ -0,0 +1,59 @@
+#ifndef __SERVICE_CONTROL_H__
+#define __SERVICE_CONTROL_H__
+
+// ServiceControl::wait() results
+enum
+{
+    // SIGTERM, SIGINT or a line on the console: drain, log out and exit
+    SERVICE_STOP,
+    // SIGHUP: reopen the log and reload the tables read at startup
+    SERVICE_RELOAD
+};
+
+// seconds the shutdown may take before the process exits regardless
+const int SERVICE_STOP_TIMEOUT = 15;
+
+// Process lifecycle of the data_door binaries.
+//
+// main() calls install() before any thread exists, so SIGTERM, SIGINT and
+// SIGHUP stay blocked in every thread, the vendor's included, and are only
+// received by wait() through a signalfd. With bConsole wait() also returns
+// on a line from stdin, the old "press return" behaviour; an stdin at EOF,
+// as under a supervisor, is ignored.
+//
+// daemonize() forks into the background for runs without a supervisor.
+// The working directory is kept: the vendor apis write their flow and
+// licence files there.
+class ServiceControl
+{
+public:
+    // fork, setsid and point stdin, stdout and stderr at /dev/null; the
+    // parent exits. pPidFile, when not NULL, gets the daemon's pid and is
+    // removed by exit(). false when the fork or the pid file fails
+    static bool daemonize(const char *pPidFile);
+
+    // block the control signals and open the signalfd, before any thread
+    static bool install();
+
+    // SERVICE_STOP or SERVICE_RELOAD
+    static int wait(bool bConsole);
+
+    // for a main thread running its own poll or epoll loop: the signalfd
+    // to watch, and check() to call when it is readable, SERVICE_STOP,
+    // SERVICE_RELOAD or -1 when no signal is pending
+    static int fd() { return s_nSignalFd; }
+    static int check();
+
+    // start counting SERVICE_STOP_TIMEOUT: a shutdown still running then
+    // is logged and ended with _exit(1)
+    static void beginStop();
+
+    // shutdown finished, remove the pid file
+    static void exit();
+
+private:
+    static int s_nSignalFd;
+    static char *s_pPidFile;
+};
+
+#endif
@@ -0,0 +1,254 @@
+// SpreadBook.cpp : implied top of book of spreads from their legs.
+//
+#include "SpreadBook.h"
+#include "AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// prices at or above this are sentinels (the exchange sends DBL_MAX)
+static const double PRICE_SENTINEL = 1e300;
+
+// a leg's level one, 0 for a missing side
+struct SpreadLegQuote
+{
+    double dBid;
+    double dAsk;
+    int nBidVolume;
+    int nAskVolume;
+};
+
+// one spread, read whole on every recompute
+struct SpreadState
+{
+    int nLegs;
+    int nLegSlot[SPREAD_MAX_LEGS];
+    double dRatio[SPREAD_MAX_LEGS];
+    // 1 / |dRatio|, the leg volume to spread volume
+    double dPerUnit[SPREAD_MAX_LEGS];
+    // last implied top
+    double dBid;
+    double dAsk;
+    int nBidVolume;
+    int nAskVolume;
+    TThostFtdcInstrumentIDType chName;
+};
+
+SpreadBook::SpreadBook() : m_nSpreads(0), m_bDirty(false), m_pOut(NULL), m_nOutSize(0)
+{
+    m_pQuotes = new SpreadLegQuote[MAX_INSTRUMENTS];
+    memset(m_pQuotes, 0, sizeof(SpreadLegQuote) * MAX_INSTRUMENTS);
+    m_pSpreads = new SpreadState[MAX_SPREADS];
+    m_pFirst = new int[MAX_INSTRUMENTS + 1];
+    m_pDependents = new int[MAX_SPREADS * SPREAD_MAX_LEGS];
+    memset(m_pFirst, 0, sizeof(int) * (MAX_INSTRUMENTS + 1));
+}
+
+SpreadBook::~SpreadBook()
+{
+    delete[] m_pQuotes;
+    delete[] m_pSpreads;
+    delete[] m_pFirst;
+    delete[] m_pDependents;
+    delete[] m_pOut;
+}
+
+bool SpreadBook::define(const char *pSpreadID, const char *const *pLegs, const double *pRatios, int nLegs)
+{
+    if (m_nSpreads >= MAX_SPREADS || nLegs < 1 || nLegs > SPREAD_MAX_LEGS || strlen(pSpreadID) >= sizeof(m_pSpreads[0].chName))
+        return false;
+    for (int s = 0; s < m_nSpreads; s++)
+    {
+        if (strcmp(m_pSpreads[s].chName, pSpreadID) == 0)
+            return false;
+    }
+    // every leg is checked before any goes into m_legs, so a rejected
+    // spread leaves no slot behind
+    int nNew = 0;
+    for (int i = 0; i < nLegs; i++)
+    {
+        if (strlen(pLegs[i]) >= sizeof(TThostFtdcInstrumentIDType) || pRatios[i] == 0 || !isfinite(pRatios[i]))
+            return false;
+        // a leg twice would be counted in the graph twice
+        for (int j = 0; j < i; j++)
+        {
+            if (strcmp(pLegs[j], pLegs[i]) == 0)
+                return false;
+        }
+        if (m_legs.find(pLegs[i]) < 0)
+            nNew++;
+    }
+    if (m_legs.count() + nNew > MAX_INSTRUMENTS)
+        return false;
+
+    SpreadState &spread = m_pSpreads[m_nSpreads];
+    memset(&spread, 0, sizeof(spread));
+    for (int i = 0; i < nLegs; i++)
+    {
+        spread.nLegSlot[i] = m_legs.insert(pLegs[i]);
+        spread.dRatio[i] = pRatios[i];
+        spread.dPerUnit[i] = 1 / fabs(pRatios[i]);
+    }
+    spread.nLegs = nLegs;
+    strcpy(spread.chName, pSpreadID);
+    m_nSpreads++;
+    m_bDirty = true;
+    return true;
+}
+
+int SpreadBook::load(const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+        return -1;
+    char chLine[512];
+    int nDefined = 0;
+    int nLine = 0;
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        nLine++;
+        char *pHash = strchr(chLine, '#');
+        if (pHash != NULL)
+            *pHash = '\0';
+        char *pSave;
+        char *pSpreadID = strtok_r(chLine, " \t\r\n", &pSave);
+        if (pSpreadID == NULL)
+            continue;
+        const char *pLegs[SPREAD_MAX_LEGS];
+        double dRatios[SPREAD_MAX_LEGS];
+        int nLegs = 0;
+        bool bOk = true;
+        char *pLeg;
+        while (bOk && (pLeg = strtok_r(NULL, " \t\r\n", &pSave)) != NULL)
+        {
+            char *pRatio = strtok_r(NULL, " \t\r\n", &pSave);
+            char *pEnd;
+            bOk = nLegs < SPREAD_MAX_LEGS && pRatio != NULL;
+            if (bOk)
+            {
+                pLegs[nLegs] = pLeg;
+                dRatios[nLegs] = strtod(pRatio, &pEnd);
+                bOk = *pEnd == '\0';
+                nLegs++;
+            }
+        }
+        if (bOk && define(pSpreadID, pLegs, dRatios, nLegs))
+            nDefined++;
+        else
+            FC_LOG(LOG_LEVEL_WARN, "%s:%d: spread %s not defined\n", pFile, nLine, pSpreadID);
+    }
+    fclose(fp);
+    return nDefined;
+}
+
+void SpreadBook::build()
+{
+    // counting sort of the (leg, spread) pairs by leg
+    int nLegs = m_legs.count();
+    memset(m_pFirst, 0, sizeof(int) * (nLegs + 1));
+    for (int s = 0; s < m_nSpreads; s++)
+    {
+        for (int i = 0; i < m_pSpreads[s].nLegs; i++)
+            m_pFirst[m_pSpreads[s].nLegSlot[i] + 1]++;
+    }
+    int nBusiest = 0;
+    for (int l = 0; l < nLegs; l++)
+    {
+        if (m_pFirst[l + 1] > nBusiest)
+            nBusiest = m_pFirst[l + 1];
+        m_pFirst[l + 1] += m_pFirst[l];
+    }
+    int *pNext = new int[nLegs];
+    memcpy(pNext, m_pFirst, sizeof(int) * nLegs);
+    for (int s = 0; s < m_nSpreads; s++)
+    {
+        for (int i = 0; i < m_pSpreads[s].nLegs; i++)
+            m_pDependents[pNext[m_pSpreads[s].nLegSlot[i]]++] = s;
+    }
+    delete[] pNext;
+
+    if (nBusiest > m_nOutSize)
+    {
+        // zeroed once: compute() only writes the fields a spread has
+        delete[] m_pOut;
+        m_pOut = new CThostFtdcDepthMarketDataField[nBusiest];
+        memset(m_pOut, 0, sizeof(CThostFtdcDepthMarketDataField) * nBusiest);
+        m_nOutSize = nBusiest;
+    }
+    m_bDirty = false;
+}
+
+bool SpreadBook::compute(int nSpread, const CThostFtdcDepthMarketDataField *pTick, CThostFtdcDepthMarketDataField *pOut)
+{
+    SpreadState &spread = m_pSpreads[nSpread];
+    double dBid = 0, dAsk = 0;
+    int nBidVolume = 0x7fffffff, nAskVolume = 0x7fffffff;
+    for (int i = 0; i < spread.nLegs; i++)
+    {
+        const SpreadLegQuote &leg = m_pQuotes[spread.nLegSlot[i]];
+        double r = spread.dRatio[i];
+        // selling the spread sells the positive legs at their bid; a
+        // missing side has volume 0
+        bool bLong = r > 0;
+        dBid += r * (bLong ? leg.dBid : leg.dAsk);
+        dAsk += r * (bLong ? leg.dAsk : leg.dBid);
+        int nSell = (int)((bLong ? leg.nBidVolume : leg.nAskVolume) * spread.dPerUnit[i]);
+        int nBuy = (int)((bLong ? leg.nAskVolume : leg.nBidVolume) * spread.dPerUnit[i]);
+        nBidVolume = nSell < nBidVolume ? nSell : nBidVolume;
+        nAskVolume = nBuy < nAskVolume ? nBuy : nAskVolume;
+    }
+    if (nBidVolume == 0)
+        dBid = 0;
+    if (nAskVolume == 0)
+        dAsk = 0;
+    if (dBid == spread.dBid && dAsk == spread.dAsk && nBidVolume == spread.nBidVolume && nAskVolume == spread.nAskVolume)
+        return false;
+    spread.dBid = dBid;
+    spread.dAsk = dAsk;
+    spread.nBidVolume = nBidVolume;
+    spread.nAskVolume = nAskVolume;
+
+    // the time and day of the leg tick that moved it
+    memcpy(pOut->InstrumentID, spread.chName, sizeof(pOut->InstrumentID));
+    memcpy(pOut->ExchangeID, pTick->ExchangeID, sizeof(pOut->ExchangeID));
+    memcpy(pOut->TradingDay, pTick->TradingDay, sizeof(pOut->TradingDay));
+    memcpy(pOut->ActionDay, pTick->ActionDay, sizeof(pOut->ActionDay));
+    memcpy(pOut->UpdateTime, pTick->UpdateTime, sizeof(pOut->UpdateTime));
+    pOut->UpdateMillisec = pTick->UpdateMillisec;
+    pOut->BidPrice1 = dBid;
+    pOut->AskPrice1 = dAsk;
+    pOut->BidVolume1 = nBidVolume;
+    pOut->AskVolume1 = nAskVolume;
+    return true;
+}
+
+int SpreadBook::onTick(const CThostFtdcDepthMarketDataField *pTick)
+{
+    if (m_bDirty)
+        build();
+    int l = m_legs.find(pTick->InstrumentID);
+    if (l < 0)
+        return 0;
+
+    // a missing side counts as 0, so the spreads using it go empty
+    double dBid = pTick->BidPrice1 > 0 && pTick->BidPrice1 < PRICE_SENTINEL && pTick->BidVolume1 > 0 ? pTick->BidPrice1 : 0;
+    double dAsk = pTick->AskPrice1 > 0 && pTick->AskPrice1 < PRICE_SENTINEL && pTick->AskVolume1 > 0 ? pTick->AskPrice1 : 0;
+    int nBidVolume = dBid != 0 ? pTick->BidVolume1 : 0;
+    int nAskVolume = dAsk != 0 ? pTick->AskVolume1 : 0;
+    SpreadLegQuote &leg = m_pQuotes[l];
+    if (dBid == leg.dBid && dAsk == leg.dAsk && nBidVolume == leg.nBidVolume && nAskVolume == leg.nAskVolume)
+        return 0;
+    leg.dBid = dBid;
+    leg.dAsk = dAsk;
+    leg.nBidVolume = nBidVolume;
+    leg.nAskVolume = nAskVolume;
+
+    int nOut = 0;
+    for (int d = m_pFirst[l]; d < m_pFirst[l + 1]; d++)
+    {
+        if (compute(m_pDependents[d], pTick, &m_pOut[nOut]))
+            nOut++;
+    }
+    return nOut;
+}
@@ -0,0 +1,85 @@
+#ifndef __SPREAD_BOOK_H__
+#define __SPREAD_BOOK_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "InstrumentIndex.h"
+
+using namespace KingstarAPI;
+
+// legs of one synthetic instrument
+const int SPREAD_MAX_LEGS = 4;
+// synthetic instruments defined at once
+const int MAX_SPREADS = 8192;
+
+struct SpreadLegQuote;
+struct SpreadState;
+
+// Implied top of book of synthetic instruments, calendar spreads such as
+// al1412-al1501 or ratio spreads across products, from their legs' depth.
+//
+// A spread is a sum of legs times signed ratios. Its implied bid sells the
+// legs of positive ratio at their bid and buys the negative ones at their
+// ask, the ask the other way round; each side's size is the smallest leg
+// volume on the side used divided by the leg's ratio, rounded down. A side
+// with a leg missing its price or volume has price and volume 0; a spread
+// may well be priced 0, the volume tells them apart.
+//
+// Legs map to the spreads using them through a dependency graph, leg slot
+// to a contiguous run of spread numbers, built on the first tick after the
+// definitions change. onTick() compares the leg's level one with what it
+// had and, only when it moved, recomputes the spreads of that leg and
+// returns those whose implied top changed as depth ticks, ready for the
+// publishing path. The cost is the leg lookup plus the leg's own spreads,
+// whatever the total defined.
+//
+// Not thread safe, owned by the publisher thread.
+class SpreadBook
+{
+public:
+    SpreadBook();
+    ~SpreadBook();
+
+    // pSpreadID = sum of dRatio[i] * pLegs[i]; false for a bad or repeated
+    // definition, or when full
+    bool define(const char *pSpreadID, const char *const *pLegs, const double *pRatios, int nLegs);
+
+    // one definition per line, "SpreadID Leg Ratio Leg Ratio...", e.g.
+    // "al1412-al1501 al1412 1 al1501 -1"; '#' starts a comment. Returns
+    // the number defined, -1 when the file cannot be read
+    int load(const char *pFile);
+
+    // a tick of any instrument; returns the number of synthetic ticks
+    // written to ticks(), 0 for an instrument that is no leg or whose
+    // level one did not move
+    int onTick(const CThostFtdcDepthMarketDataField *pTick);
+
+    // the synthetic ticks of the last onTick(), valid until the next call
+    const CThostFtdcDepthMarketDataField *ticks() const { return m_pOut; }
+
+    int count() const { return m_nSpreads; }
+    int legs() const { return m_legs.count(); }
+
+private:
+    void build();
+    bool compute(int nSpread, const CThostFtdcDepthMarketDataField *pTick, CThostFtdcDepthMarketDataField *pOut);
+
+    // legs by their own slot, level one as last seen
+    InstrumentIndex m_legs;
+    SpreadLegQuote *m_pQuotes;
+
+    // spreads, definition and last implied top
+    int m_nSpreads;
+    SpreadState *m_pSpreads;
+
+    // dependency graph: the spreads of leg slot s are
+    // m_pDependents[m_pFirst[s]] .. m_pDependents[m_pFirst[s + 1] - 1]
+    bool m_bDirty;
+    int *m_pFirst;
+    int *m_pDependents;
+
+    // synthetic ticks of one onTick(), as many as the busiest leg has spreads
+    CThostFtdcDepthMarketDataField *m_pOut;
+    int m_nOutSize;
+};
+
+#endif
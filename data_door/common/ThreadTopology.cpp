@@ -0,0 +1,212 @@
+// ThreadTopology.cpp : cpu pinning and scheduling of the data_door threads.
+//
+#include "ThreadTopology.h"
+#include "AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+ThreadPlacement ThreadTopology::s_placement[THREAD_ROLE_COUNT];
+__thread int ThreadTopology::s_nRole = 0;
+
+static const char *s_roleNames[THREAD_ROLE_COUNT] = { "main", "md", "trader", "publisher", "journal", "stats", "fanout", "monitor" };
+
+const char *ThreadTopology::roleName(int nRole)
+{
+    return nRole >= 0 && nRole < THREAD_ROLE_COUNT ? s_roleNames[nRole] : "?";
+}
+
+// "2", "2,3", "4-7,12" into pSet; false on anything else
+static bool parse_cpus(const char *pList, cpu_set_t *pSet)
+{
+    CPU_ZERO(pSet);
+    const char *p = pList;
+    while (*p != '\0' && *p != '\n')
+    {
+        char *pEnd;
+        long nFirst = strtol(p, &pEnd, 10);
+        if (pEnd == p || nFirst < 0 || nFirst >= CPU_SETSIZE)
+            return false;
+        long nLast = nFirst;
+        p = pEnd;
+        if (*p == '-')
+        {
+            nLast = strtol(p + 1, &pEnd, 10);
+            if (pEnd == p + 1 || nLast < nFirst || nLast >= CPU_SETSIZE)
+                return false;
+            p = pEnd;
+        }
+        for (long c = nFirst; c <= nLast; c++)
+            CPU_SET(c, pSet);
+        if (*p == ',')
+            p++;
+        else if (*p != '\0' && *p != '\n')
+            return false;
+    }
+    return CPU_COUNT(pSet) > 0;
+}
+
+// cpus of NUMA node nNode from sysfs
+static bool node_cpus(int nNode, cpu_set_t *pSet)
+{
+    char chPath[128];
+    snprintf(chPath, sizeof(chPath), "/sys/devices/system/node/node%d/cpulist", nNode);
+    FILE *fp = fopen(chPath, "r");
+    if (fp == NULL)
+        return false;
+    char chList[512];
+    bool bOk = fgets(chList, sizeof(chList), fp) != NULL && parse_cpus(chList, pSet);
+    fclose(fp);
+    return bOk;
+}
+
+bool ThreadTopology::load(const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+        return false;
+    char chLine[256];
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        char chRole[32], chCpus[128];
+        int nPriority = 0;
+        if (sscanf(chLine, "%31s %127s", chRole, chCpus) != 2 || chRole[0] == '#')
+            continue;
+        int nRole = 0;
+        while (nRole < THREAD_ROLE_COUNT && strcmp(chRole, s_roleNames[nRole]) != 0)
+            nRole++;
+        if (nRole == THREAD_ROLE_COUNT)
+            continue;
+
+        ThreadPlacement &p = s_placement[nRole];
+        if (strncmp(chCpus, "node", 4) == 0)
+            p.bPinned = node_cpus(atoi(chCpus + 4), &p.cpus);
+        else
+            p.bPinned = parse_cpus(chCpus, &p.cpus);
+        // the options follow in any order
+        const char *pFifo = strstr(chLine, " fifo ");
+        if (pFifo != NULL && sscanf(pFifo + 6, "%d", &nPriority) == 1)
+            p.nFifoPriority = nPriority;
+        p.bBusyPoll = strstr(chLine, "busypoll") != NULL;
+    }
+    fclose(fp);
+    return true;
+}
+
+void ThreadTopology::apply(int nRole)
+{
+    s_nRole = nRole + 1;
+    ThreadPlacement &p = s_placement[nRole];
+    pid_t nTid = (pid_t)syscall(SYS_gettid);
+    bool bAffinitySet = false, bFifoSet = false;
+
+    if (p.bPinned)
+        bAffinitySet = pthread_setaffinity_np(pthread_self(), sizeof(p.cpus), &p.cpus) == 0;
+    if (p.nFifoPriority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = p.nFifoPriority;
+        bFifoSet = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    }
+
+    cpu_set_t allowed;
+    int nAllowed = 0;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) == 0)
+        nAllowed = CPU_COUNT(&allowed);
+    int nCpu = sched_getcpu();
+
+    __atomic_fetch_add(&p.nThreads, 1, __ATOMIC_RELAXED);
+    p.nTid = nTid;
+    p.bAffinitySet = bAffinitySet;
+    p.bFifoSet = bFifoSet;
+    p.nAllowedCpus = nAllowed;
+    p.nCpu = nCpu;
+
+    if ((p.bPinned && !bAffinitySet) || (p.nFifoPriority > 0 && !bFifoSet))
+        FC_LOG(LOG_LEVEL_WARN, "thread %s (tid %d) not placed as configured: affinity %s, fifo %s\n", roleName(nRole),
+               (int)nTid, p.bPinned ? (bAffinitySet ? "set" : "failed") : "default",
+               p.nFifoPriority > 0 ? (bFifoSet ? "set" : "failed") : "default");
+    FC_LOG(LOG_LEVEL_INFO, "thread %s (tid %d) on cpu %d of %d allowed%s%s\n", roleName(nRole), (int)nTid, nCpu, nAllowed,
+           bFifoSet ? ", SCHED_FIFO" : "", p.bBusyPoll ? ", busy-poll" : "");
+}
+
+void ThreadTopology::idle(int nRole, int nMicroseconds)
+{
+    if (!s_placement[nRole].bBusyPoll)
+    {
+        usleep(nMicroseconds);
+        return;
+    }
+    for (int i = 0; i < 64; i++)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+// "2,4-7" for a cpu set
+static int format_cpus(char *pBuf, int nSize, const cpu_set_t *pSet)
+{
+    int nLen = 0;
+    for (int c = 0; c < CPU_SETSIZE && nLen < nSize; c++)
+    {
+        if (!CPU_ISSET(c, pSet))
+            continue;
+        int nLast = c;
+        while (nLast + 1 < CPU_SETSIZE && CPU_ISSET(nLast + 1, pSet))
+            nLast++;
+        if (nLast == c)
+            nLen += snprintf(pBuf + nLen, nSize - nLen, nLen > 0 ? ",%d" : "%d", c);
+        else
+            nLen += snprintf(pBuf + nLen, nSize - nLen, nLen > 0 ? ",%d-%d" : "%d-%d", c, nLast);
+        c = nLast;
+    }
+    if (nLen == 0 && nSize > 0)
+        pBuf[0] = '\0';
+    return nLen < nSize ? nLen : nSize - 1;
+}
+
+bool ThreadTopology::waitStarted(int nRole, int nTimeoutMs)
+{
+    for (int nWaited = 0; __atomic_load_n(&s_placement[nRole].nThreads, __ATOMIC_RELAXED) == 0; nWaited += 10)
+    {
+        if (nWaited >= nTimeoutMs)
+            return false;
+        usleep(10000);
+    }
+    return true;
+}
+
+int ThreadTopology::report(char *pBuf, int nSize)
+{
+    int nLen = snprintf(pBuf, nSize, "%-10s %-12s %-5s %-9s %-8s %-7s %s\n", "role", "cpus", "fifo", "busypoll", "threads",
+                        "tid", "achieved");
+    for (int i = 0; i < THREAD_ROLE_COUNT && nLen < nSize; i++)
+    {
+        const ThreadPlacement &p = s_placement[i];
+        char chCpus[64] = "any";
+        if (p.bPinned)
+            format_cpus(chCpus, sizeof(chCpus), &p.cpus);
+        char chFifo[16] = "-";
+        if (p.nFifoPriority > 0)
+            snprintf(chFifo, sizeof(chFifo), "%d", p.nFifoPriority);
+        int nThreads = __atomic_load_n(&p.nThreads, __ATOMIC_RELAXED);
+        if (nThreads == 0)
+        {
+            nLen += snprintf(pBuf + nLen, nSize - nLen, "%-10s %-12s %-5s %-9s %-8d %-7s not started\n", roleName(i),
+                             chCpus, chFifo, p.bBusyPoll ? "yes" : "no", 0, "-");
+            continue;
+        }
+        nLen += snprintf(pBuf + nLen, nSize - nLen, "%-10s %-12s %-5s %-9s %-8d %-7d cpu %d of %d allowed%s%s%s\n",
+                         roleName(i), chCpus, chFifo, p.bBusyPoll ? "yes" : "no", nThreads, (int)p.nTid, p.nCpu,
+                         p.nAllowedCpus, p.bFifoSet ? ", SCHED_FIFO" : "",
+                         p.bPinned && !p.bAffinitySet ? ", pinning failed" : "",
+                         p.nFifoPriority > 0 && !p.bFifoSet ? ", fifo failed" : "");
+    }
+    return nLen < nSize ? nLen : nSize - 1;
+}
@@ -0,0 +1,96 @@
+#ifndef __THREAD_TOPOLOGY_H__
+#define __THREAD_TOPOLOGY_H__
+
+#include <sched.h>
+#include <sys/types.h>
+
+// thread roles, ThreadTopology::roleName() gives the name used in the file
+enum
+{
+    THREAD_MAIN,
+    // market data api callback thread, seen at its first callback
+    THREAD_MD_CALLBACK,
+    // trader api callback thread, seen at its first callback
+    THREAD_TRADER_CALLBACK,
+    // ingest ring drain and publish
+    THREAD_PUBLISHER,
+    // AsyncLogger writer
+    THREAD_JOURNAL,
+    // LatencyStats reporter
+    THREAD_STATS,
+    // ingest_server tick fanout to the subscribers
+    THREAD_FANOUT,
+    // servant_market FeedMonitor scans
+    THREAD_MONITOR,
+    THREAD_ROLE_COUNT
+};
+
+// configured and achieved placement of one role
+struct ThreadPlacement
+{
+    // configuration
+    bool bPinned;
+    cpu_set_t cpus;
+    // SCHED_FIFO priority, 0 keeps the default policy
+    int nFifoPriority;
+    // spin instead of sleeping when idle
+    bool bBusyPoll;
+
+    // what the last thread entering the role got
+    int nThreads;
+    pid_t nTid;
+    bool bAffinitySet;
+    bool bFifoSet;
+    int nAllowedCpus;
+    int nCpu;
+};
+
+// Thread placement for the data_door binaries.
+//
+// load() reads one line per role:
+//   role cpus|nodeN [fifo priority] [busypoll]
+// where role is main, md, trader, publisher, journal, stats, fanout or
+// monitor, cpus a list like 2 or 2,3 or 4-7, and nodeN every cpu of a NUMA
+// node.
+// Roles not in the file keep the default placement.
+//
+// Each thread places itself with enter(): our own threads when they start,
+// the vendor's callback threads at their first callback (enter() is a
+// thread local compare after that). Placement failures, e.g. SCHED_FIFO
+// without the privilege, are logged and reported, never fatal.
+class ThreadTopology
+{
+public:
+    // false when the file cannot be read; bad lines are skipped
+    static bool load(const char *pFile);
+
+    // place the calling thread as nRole, once per thread
+    static inline void enter(int nRole)
+    {
+        if (s_nRole != nRole + 1)
+            apply(nRole);
+    }
+
+    static bool busyPoll(int nRole) { return s_placement[nRole].bBusyPoll; }
+    // idle wait of a polling loop: spin when the role busy-polls, sleep
+    // nMicroseconds otherwise
+    static void idle(int nRole, int nMicroseconds);
+
+    static const char *roleName(int nRole);
+
+    // placement of every role as text, returns its length
+    static int report(char *pBuf, int nSize);
+
+    // wait until a thread entered nRole, false after nTimeoutMs; for the
+    // callback threads, which only enter at their first callback
+    static bool waitStarted(int nRole, int nTimeoutMs);
+
+private:
+    static void apply(int nRole);
+
+    static ThreadPlacement s_placement[THREAD_ROLE_COUNT];
+    // role + 1 of the calling thread, 0 before enter()
+    static __thread int s_nRole;
+};
+
+#endif
@@ -0,0 +1,258 @@
+// TickNormalizer.cpp : batch validation and normalization of depth ticks.
+//
+#include "TickNormalizer.h"
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TICK_NORMALIZER_X86
+#endif
+
+// prices at or above this are sentinels (the exchange sends DBL_MAX)
+static const double PRICE_SENTINEL = 1e300;
+// distance from the tick grid still accepted, in ticks
+static const double GRID_TOLERANCE = 1e-4;
+// largest price in ticks that fits the int conversion
+static const double MAX_TICKS = 2e9;
+
+// field offsets in NP_x order
+static const int s_priceOffset[NP_COUNT] =
+{
+    (int)offsetof(CThostFtdcDepthMarketDataField, LastPrice),
+    (int)offsetof(CThostFtdcDepthMarketDataField, OpenPrice),
+    (int)offsetof(CThostFtdcDepthMarketDataField, HighestPrice),
+    (int)offsetof(CThostFtdcDepthMarketDataField, LowestPrice),
+    (int)offsetof(CThostFtdcDepthMarketDataField, UpperLimitPrice),
+    (int)offsetof(CThostFtdcDepthMarketDataField, LowerLimitPrice),
+    (int)offsetof(CThostFtdcDepthMarketDataField, BidPrice1),
+    (int)offsetof(CThostFtdcDepthMarketDataField, BidPrice2),
+    (int)offsetof(CThostFtdcDepthMarketDataField, BidPrice3),
+    (int)offsetof(CThostFtdcDepthMarketDataField, BidPrice4),
+    (int)offsetof(CThostFtdcDepthMarketDataField, BidPrice5),
+    (int)offsetof(CThostFtdcDepthMarketDataField, AskPrice1),
+    (int)offsetof(CThostFtdcDepthMarketDataField, AskPrice2),
+    (int)offsetof(CThostFtdcDepthMarketDataField, AskPrice3),
+    (int)offsetof(CThostFtdcDepthMarketDataField, AskPrice4),
+    (int)offsetof(CThostFtdcDepthMarketDataField, AskPrice5)
+};
+
+// "HH:MM:SS" plus milliseconds, -1 when malformed
+static int time_ms(const char *pTime, int nMillisec)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        if (i == 2 || i == 5)
+        {
+            if (pTime[i] != ':')
+                return -1;
+        }
+        else if (pTime[i] < '0' || pTime[i] > '9')
+        {
+            return -1;
+        }
+    }
+    int h = (pTime[0] - '0') * 10 + pTime[1] - '0';
+    int m = (pTime[3] - '0') * 10 + pTime[4] - '0';
+    int s = (pTime[6] - '0') * 10 + pTime[7] - '0';
+    return ((h * 60 + m) * 60 + s) * 1000 + nMillisec;
+}
+
+TickNormalizer::TickNormalizer()
+{
+#ifdef TICK_NORMALIZER_X86
+    __builtin_cpu_init();
+    m_bAvx2 = __builtin_cpu_supports("avx2");
+#else
+    m_bAvx2 = false;
+#endif
+    m_pInvTick = new double[MAX_INSTRUMENTS];
+    m_pLastVolume = new int[MAX_INSTRUMENTS];
+    m_pLastTurnover = new double[MAX_INSTRUMENTS];
+    m_pLastTimeMs = new int[MAX_INSTRUMENTS];
+    m_pPrices = new double[NP_COUNT * MAX_BATCH];
+    m_pBatchInv = new double[MAX_BATCH];
+    memset(m_pInvTick, 0, sizeof(double) * MAX_INSTRUMENTS);
+    memset(m_pLastVolume, 0, sizeof(int) * MAX_INSTRUMENTS);
+    memset(m_pLastTurnover, 0, sizeof(double) * MAX_INSTRUMENTS);
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+        m_pLastTimeMs[i] = -1;
+}
+
+TickNormalizer::~TickNormalizer()
+{
+    delete[] m_pInvTick;
+    delete[] m_pLastVolume;
+    delete[] m_pLastTurnover;
+    delete[] m_pLastTimeMs;
+    delete[] m_pPrices;
+    delete[] m_pBatchInv;
+}
+
+void TickNormalizer::setPriceTick(const char *pInstrumentID, double dPriceTick)
+{
+    int nSlot = m_index.insert(pInstrumentID);
+    if (nSlot < 0 || !(dPriceTick > 0 && dPriceTick < PRICE_SENTINEL))
+        return;
+    m_pInvTick[nSlot] = 1.0 / dPriceTick;
+}
+
+static void convert_scalar(const double *pPrices, const double *pInv, int nCount, int nField, NormalizedTick *pOut)
+{
+    for (int i = 0; i < nCount; i++)
+    {
+        double p = pPrices[i];
+        double inv = pInv[i];
+        double x = p * inv;
+        double r = nearbyint(x);
+        bool bSentinel = !(p > 0 && p < PRICE_SENTINEL);
+        bool bOffGrid = inv > 0 && !(fabs(x - r) <= GRID_TOLERANCE && r < MAX_TICKS);
+        if (bSentinel || bOffGrid)
+        {
+            pOut[i].nPrice[nField] = 0;
+            pOut[i].nInvalidMask |= 1u << nField;
+        }
+        else
+        {
+            pOut[i].nPrice[nField] = inv > 0 ? (int)r : 0;
+        }
+    }
+}
+
+#ifdef TICK_NORMALIZER_X86
+__attribute__((target("avx2")))
+static void convert_avx2(const double *pPrices, const double *pInv, int nCount, int nField, NormalizedTick *pOut)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sentinel = _mm256_set1_pd(PRICE_SENTINEL);
+    const __m256d tolerance = _mm256_set1_pd(GRID_TOLERANCE);
+    const __m256d maxTicks = _mm256_set1_pd(MAX_TICKS);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d allOnes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+    int i = 0;
+    for (; i + 4 <= nCount; i += 4)
+    {
+        __m256d p = _mm256_loadu_pd(pPrices + i);
+        __m256d inv = _mm256_loadu_pd(pInv + i);
+        __m256d x = _mm256_mul_pd(p, inv);
+        __m256d r = _mm256_round_pd(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+
+        // ordered compares are false for NaN, so NaN counts as a sentinel
+        __m256d inRange = _mm256_and_pd(_mm256_cmp_pd(p, zero, _CMP_GT_OQ), _mm256_cmp_pd(p, sentinel, _CMP_LT_OQ));
+        __m256d onGrid = _mm256_and_pd(_mm256_cmp_pd(_mm256_and_pd(_mm256_sub_pd(x, r), absMask), tolerance, _CMP_LE_OQ),
+                                       _mm256_cmp_pd(r, maxTicks, _CMP_LT_OQ));
+        __m256d hasTick = _mm256_cmp_pd(inv, zero, _CMP_GT_OQ);
+        __m256d valid = _mm256_and_pd(inRange, _mm256_or_pd(onGrid, _mm256_andnot_pd(hasTick, allOnes)));
+
+        // invalid lanes and lanes without a tick size convert to 0
+        __m256d keep = _mm256_and_pd(valid, hasTick);
+        __m128i n = _mm256_cvtpd_epi32(_mm256_and_pd(r, keep));
+        int bad = ~_mm256_movemask_pd(valid) & 0xf;
+
+        int v[4];
+        _mm_storeu_si128((__m128i *)v, n);
+        for (int k = 0; k < 4; k++)
+        {
+            pOut[i + k].nPrice[nField] = v[k];
+            if (bad & (1 << k))
+                pOut[i + k].nInvalidMask |= 1u << nField;
+        }
+    }
+    convert_scalar(pPrices + i, pInv + i, nCount - i, nField, pOut + i);
+}
+#endif
+
+void TickNormalizer::convertPrices(int nCount, NormalizedTick *pOut)
+{
+    for (int f = 0; f < NP_COUNT; f++)
+    {
+#ifdef TICK_NORMALIZER_X86
+        if (m_bAvx2)
+        {
+            convert_avx2(m_pPrices + f * MAX_BATCH, m_pBatchInv, nCount, f, pOut);
+            continue;
+        }
+#endif
+        convert_scalar(m_pPrices + f * MAX_BATCH, m_pBatchInv, nCount, f, pOut);
+    }
+}
+
+int TickNormalizer::normalize(const CThostFtdcDepthMarketDataField *pTicks, int nCount, NormalizedTick *pOut, int nStride)
+{
+    int nAccepted = 0;
+    for (int nBase = 0; nBase < nCount; nBase += MAX_BATCH)
+    {
+        int n = nCount - nBase < MAX_BATCH ? nCount - nBase : MAX_BATCH;
+        const char *pBatch = (const char *)pTicks + (size_t)nBase * nStride;
+        NormalizedTick *pNorm = pOut + nBase;
+
+        // transpose the prices into struct of arrays for the vector pass
+        for (int i = 0; i < n; i++)
+        {
+            const CThostFtdcDepthMarketDataField *pIn = (const CThostFtdcDepthMarketDataField *)(pBatch + (size_t)i * nStride);
+            int nSlot = m_index.insert(pIn->InstrumentID);
+            pNorm[i].nSlot = nSlot;
+            pNorm[i].nFlags = 0;
+            pNorm[i].nInvalidMask = 0;
+            m_pBatchInv[i] = nSlot >= 0 ? m_pInvTick[nSlot] : 0;
+            const char *p = (const char *)pIn;
+            for (int f = 0; f < NP_COUNT; f++)
+                m_pPrices[f * MAX_BATCH + i] = *(const double *)(p + s_priceOffset[f]);
+        }
+
+        convertPrices(n, pNorm);
+
+        // sequential per instrument bookkeeping
+        for (int i = 0; i < n; i++)
+        {
+            const CThostFtdcDepthMarketDataField *pIn = (const CThostFtdcDepthMarketDataField *)(pBatch + (size_t)i * nStride);
+            NormalizedTick &t = pNorm[i];
+            int nSlot = t.nSlot;
+            if (t.nInvalidMask != 0)
+                t.nFlags |= TICK_INVALID_PRICE;
+            t.nTimeMs = time_ms(pIn->UpdateTime, pIn->UpdateMillisec);
+            t.nVolumeDelta = 0;
+            t.dTurnoverDelta = 0;
+            if (nSlot < 0)
+            {
+                t.nFlags |= TICK_NO_SLOT;
+                continue;
+            }
+            if (m_pInvTick[nSlot] == 0)
+                t.nFlags |= TICK_NO_PRICETICK;
+
+            // a tick behind the previous one, except across midnight in
+            // the night session, is a replay after reconnect
+            int nLastMs = m_pLastTimeMs[nSlot];
+            bool bFirst = nLastMs < 0 && m_pLastVolume[nSlot] == 0;
+            if (t.nTimeMs >= 0 && nLastMs >= 0 && t.nTimeMs < nLastMs && nLastMs - t.nTimeMs < 12 * 3600 * 1000)
+            {
+                t.nFlags |= TICK_STALE;
+                continue;
+            }
+
+            int nVolume = pIn->Volume;
+            double dTurnover = pIn->Turnover;
+            if (bFirst)
+            {
+                // no baseline yet, the cumulative values only seed it
+            }
+            else if (nVolume < m_pLastVolume[nSlot] || dTurnover < m_pLastTurnover[nSlot] || !(dTurnover < PRICE_SENTINEL))
+            {
+                t.nFlags |= TICK_VOLUME_RESET;
+            }
+            else
+            {
+                t.nVolumeDelta = nVolume - m_pLastVolume[nSlot];
+                t.dTurnoverDelta = dTurnover - m_pLastTurnover[nSlot];
+            }
+            m_pLastVolume[nSlot] = nVolume;
+            m_pLastTurnover[nSlot] = dTurnover < PRICE_SENTINEL ? dTurnover : 0;
+            if (t.nTimeMs >= 0)
+                m_pLastTimeMs[nSlot] = t.nTimeMs;
+            nAccepted++;
+        }
+    }
+    return nAccepted;
+}
@@ -0,0 +1,101 @@
+#ifndef __TICK_NORMALIZER_H__
+#define __TICK_NORMALIZER_H__
+
+#include "../CTP/KSUserApiStructEx.h"
+#include "InstrumentIndex.h"
+
+using namespace KingstarAPI;
+
+// price fields converted to integer ticks, in NormalizedTick::nPrice order
+enum
+{
+    NP_LAST,
+    NP_OPEN,
+    NP_HIGH,
+    NP_LOW,
+    NP_UPPER_LIMIT,
+    NP_LOWER_LIMIT,
+    NP_BID1, NP_BID2, NP_BID3, NP_BID4, NP_BID5,
+    NP_ASK1, NP_ASK2, NP_ASK3, NP_ASK4, NP_ASK5,
+    NP_COUNT
+};
+
+// NormalizedTick::nFlags
+enum
+{
+    // UpdateTime older than the previous tick of the instrument, rejected
+    TICK_STALE = 0x01,
+    // cumulative Volume or Turnover went backwards, deltas restart from here
+    TICK_VOLUME_RESET = 0x02,
+    // at least one bit set in nInvalidMask
+    TICK_INVALID_PRICE = 0x04,
+    // no PriceTick known for the instrument, nPrice is not filled
+    TICK_NO_PRICETICK = 0x08,
+    // instrument table full
+    TICK_NO_SLOT = 0x10
+};
+
+struct NormalizedTick
+{
+    // InstrumentIndex slot, -1 with TICK_NO_SLOT
+    int nSlot;
+    // TICK_* flags
+    unsigned int nFlags;
+    // bit NP_x set when the price was a DBL_MAX sentinel, not finite, not
+    // positive or off the PriceTick grid; its nPrice entry is 0
+    unsigned int nInvalidMask;
+    // prices in PriceTick units
+    int nPrice[NP_COUNT];
+    // traded since the previous tick of the instrument
+    int nVolumeDelta;
+    double dTurnoverDelta;
+    // UpdateTime and UpdateMillisec as milliseconds since midnight
+    int nTimeMs;
+};
+
+// Batch validation and normalization of depth ticks.
+//
+// The price conversion and sentinel checks run four ticks at a time with
+// AVX2 when the cpu has it and fall back to a scalar loop otherwise; the
+// per instrument volume, turnover and time bookkeeping is sequential by
+// nature and done in a scalar pass. Not thread safe, owned by the thread
+// draining the ingest ring.
+class TickNormalizer
+{
+public:
+    TickNormalizer();
+    ~TickNormalizer();
+
+    // PriceTick from the instrument query; ticks for unknown instruments
+    // are still checked but carry TICK_NO_PRICETICK
+    void setPriceTick(const char *pInstrumentID, double dPriceTick);
+
+    // normalize nCount ticks into pOut, returns the number not rejected
+    // (without TICK_STALE or TICK_NO_SLOT); nStride is the distance between
+    // ticks when they are embedded in larger ring entries
+    int normalize(const CThostFtdcDepthMarketDataField *pTicks, int nCount, NormalizedTick *pOut,
+                  int nStride = sizeof(CThostFtdcDepthMarketDataField));
+
+    bool usingAvx2() const { return m_bAvx2; }
+
+    const InstrumentIndex &index() const { return m_index; }
+
+private:
+    // largest batch converted in one pass, longer inputs are split
+    enum { MAX_BATCH = 256 };
+
+    void convertPrices(int nCount, NormalizedTick *pOut);
+
+    bool m_bAvx2;
+    InstrumentIndex m_index;
+    // per slot state
+    double *m_pInvTick;
+    int *m_pLastVolume;
+    double *m_pLastTurnover;
+    int *m_pLastTimeMs;
+    // struct of arrays scratch for the vector pass
+    double *m_pPrices;
+    double *m_pBatchInv;
+};
+
+#endif
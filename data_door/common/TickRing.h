@@ -0,0 +1,76 @@
+#ifndef __TICK_RING_H__
+#define __TICK_RING_H__
+
+// Bounded single producer / single consumer ring.
+//
+// The producer is the vendor callback thread, which must never block, so
+// push() fails when the ring is full and the caller decides what to drop.
+// The consumer drains in batches so the per element cost of the shared
+// index updates is amortised.
+template <class T>
+class TickRing
+{
+public:
+    // nCapacity is rounded up to a power of two
+    TickRing(unsigned int nCapacity) : m_nHead(0), m_nTail(0)
+    {
+        m_nSize = 1;
+        while (m_nSize < nCapacity)
+            m_nSize <<= 1;
+        m_nMask = m_nSize - 1;
+        m_pItems = new T[m_nSize];
+    }
+
+    ~TickRing() { delete[] m_pItems; }
+
+    // producer side, false when full
+    bool push(const T &item)
+    {
+        unsigned long long nHead = m_nHead;
+        if (nHead - __atomic_load_n(&m_nTail, __ATOMIC_ACQUIRE) >= m_nSize)
+            return false;
+        m_pItems[nHead & m_nMask] = item;
+        __atomic_store_n(&m_nHead, nHead + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // consumer side, copies up to nMax items into pOut and returns the count
+    unsigned int pop(T *pOut, unsigned int nMax)
+    {
+        unsigned long long nTail = m_nTail;
+        unsigned long long nAvail = __atomic_load_n(&m_nHead, __ATOMIC_ACQUIRE) - nTail;
+        unsigned int n = nAvail < nMax ? (unsigned int)nAvail : nMax;
+        for (unsigned int i = 0; i < n; i++)
+            pOut[i] = m_pItems[(nTail + i) & m_nMask];
+        __atomic_store_n(&m_nTail, nTail + n, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    bool empty() const
+    {
+        return __atomic_load_n(&m_nHead, __ATOMIC_ACQUIRE) == __atomic_load_n(&m_nTail, __ATOMIC_ACQUIRE);
+    }
+
+    unsigned int capacity() const { return m_nSize; }
+
+    // producer side: items push() can take now, at least; the consumer
+    // only adds room
+    unsigned int room() const
+    {
+        return m_nSize - (unsigned int)(m_nHead - __atomic_load_n(&m_nTail, __ATOMIC_ACQUIRE));
+    }
+
+private:
+    TickRing(const TickRing &);
+    TickRing &operator=(const TickRing &);
+
+    // head and tail on their own cache lines, producer and consumer
+    // each write only one of them
+    unsigned long long m_nHead __attribute__((aligned(64)));
+    unsigned long long m_nTail __attribute__((aligned(64)));
+    T *m_pItems __attribute__((aligned(64)));
+    unsigned int m_nSize;
+    unsigned int m_nMask;
+};
+
+#endif
@@ -0,0 +1,266 @@
+// TriggerEngine.cpp : local conditional orders fired by the tick stream.
+//
+#include "TriggerEngine.h"
+#include "AsyncLogger.h"
+#include <string.h>
+#include <float.h>
+
+TriggerEngine::TriggerEngine(LastValueCache *pCache, OrderTemplates *pTemplates, OrderManager *pOrders, RiskEngine *pRisk)
+    : m_pCache(pCache), m_pTemplates(pTemplates), m_pOrders(pOrders), m_pRisk(pRisk), m_pUserApi(0), m_nTriggers(0),
+      m_nRequestID(TRIGGER_REQUEST_BASE), m_fired(4096), m_nDeferred(0), m_bFiredFull(false)
+{
+    m_pTriggers = new Trigger[MAX_TRIGGERS];
+    m_pAbove = new Ladder[MAX_INSTRUMENTS];
+    m_pBelow = new Ladder[MAX_INSTRUMENTS];
+    m_pNextAbove = new double[MAX_INSTRUMENTS];
+    m_pNextBelow = new double[MAX_INSTRUMENTS];
+    m_pLocks = new char[MAX_INSTRUMENTS];
+    memset(m_pAbove, 0, sizeof(Ladder) * MAX_INSTRUMENTS);
+    memset(m_pBelow, 0, sizeof(Ladder) * MAX_INSTRUMENTS);
+    memset(m_pLocks, 0, MAX_INSTRUMENTS);
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+    {
+        m_pNextAbove[i] = DBL_MAX;
+        m_pNextBelow[i] = -DBL_MAX;
+    }
+}
+
+TriggerEngine::~TriggerEngine()
+{
+    for (int i = 0; i < MAX_INSTRUMENTS; i++)
+    {
+        delete[] m_pAbove[i].pRungs;
+        delete[] m_pBelow[i].pRungs;
+    }
+    delete[] m_pTriggers;
+    delete[] m_pAbove;
+    delete[] m_pBelow;
+    delete[] m_pNextAbove;
+    delete[] m_pNextBelow;
+    delete[] m_pLocks;
+}
+
+// keeps the rung to fire next at the end: descending prices for the
+// AT_OR_ABOVE ladder, ascending for AT_OR_BELOW
+void TriggerEngine::insertRung(Ladder *pLadder, double dPrice, int nID, bool bDescending)
+{
+    if (pLadder->nCount == pLadder->nCapacity)
+    {
+        int nCapacity = pLadder->nCapacity ? pLadder->nCapacity * 2 : 16;
+        Rung *pRungs = new Rung[nCapacity];
+        if (pLadder->nCount > 0)
+            memcpy(pRungs, pLadder->pRungs, sizeof(Rung) * pLadder->nCount);
+        delete[] pLadder->pRungs;
+        pLadder->pRungs = pRungs;
+        pLadder->nCapacity = nCapacity;
+    }
+    // binary search for the first rung that fires after the new one
+    int lo = 0, hi = pLadder->nCount;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        double d = pLadder->pRungs[mid].dPrice;
+        if (bDescending ? d > dPrice : d < dPrice)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    memmove(&pLadder->pRungs[lo + 1], &pLadder->pRungs[lo], sizeof(Rung) * (pLadder->nCount - lo));
+    pLadder->pRungs[lo].dPrice = dPrice;
+    pLadder->pRungs[lo].nID = nID;
+    pLadder->nCount++;
+}
+
+void TriggerEngine::publishBounds(int nSlot)
+{
+    const Ladder &above = m_pAbove[nSlot];
+    const Ladder &below = m_pBelow[nSlot];
+    double dAbove = above.nCount ? above.pRungs[above.nCount - 1].dPrice : DBL_MAX;
+    double dBelow = below.nCount ? below.pRungs[below.nCount - 1].dPrice : -DBL_MAX;
+    __atomic_store(&m_pNextAbove[nSlot], &dAbove, __ATOMIC_RELEASE);
+    __atomic_store(&m_pNextBelow[nSlot], &dBelow, __ATOMIC_RELEASE);
+}
+
+int TriggerEngine::addTrigger(const char *pInstrumentID, int nCondition, double dTriggerPrice, const TriggerOrder &order)
+{
+    int nSlot = m_pCache->slot(pInstrumentID);
+    if (nSlot < 0 || m_nTriggers >= MAX_TRIGGERS || order.nVolume <= 0)
+        return -1;
+    if (nCondition != TRIGGER_AT_OR_ABOVE && nCondition != TRIGGER_AT_OR_BELOW)
+        return -1;
+    int nID = m_nTriggers++;
+    Trigger &t = m_pTriggers[nID];
+    t.nSlot = nSlot;
+    t.nCondition = nCondition;
+    t.nState = TRIGGER_ARMED;
+    t.dTriggerPrice = dTriggerPrice;
+    t.order = order;
+    t.nOrderRef = 0;
+    t.nRisk = RISK_OK;
+
+    lock(nSlot);
+    if (nCondition == TRIGGER_AT_OR_ABOVE)
+        insertRung(&m_pAbove[nSlot], dTriggerPrice, nID, true);
+    else
+        insertRung(&m_pBelow[nSlot], dTriggerPrice, nID, false);
+    publishBounds(nSlot);
+    unlock(nSlot);
+    return nID;
+}
+
+int TriggerEngine::stopLoss(const char *pInstrumentID, bool bLong, double dStopPrice, int nVolume, char chOffsetFlag)
+{
+    TriggerOrder order;
+    order.chDirection = bLong ? THOST_FTDC_D_Sell : THOST_FTDC_D_Buy;
+    order.chOffsetFlag = chOffsetFlag;
+    order.chHedgeFlag = THOST_FTDC_HF_Speculation;
+    order.nVolume = nVolume;
+    order.dLimitPrice = 0;
+    return addTrigger(pInstrumentID, bLong ? TRIGGER_AT_OR_BELOW : TRIGGER_AT_OR_ABOVE, dStopPrice, order);
+}
+
+int TriggerEngine::takeProfit(const char *pInstrumentID, bool bLong, double dTargetPrice, int nVolume, char chOffsetFlag)
+{
+    TriggerOrder order;
+    order.chDirection = bLong ? THOST_FTDC_D_Sell : THOST_FTDC_D_Buy;
+    order.chOffsetFlag = chOffsetFlag;
+    order.chHedgeFlag = THOST_FTDC_HF_Speculation;
+    order.nVolume = nVolume;
+    order.dLimitPrice = 0;
+    return addTrigger(pInstrumentID, bLong ? TRIGGER_AT_OR_ABOVE : TRIGGER_AT_OR_BELOW, dTargetPrice, order);
+}
+
+bool TriggerEngine::cancelTrigger(int nID)
+{
+    if (nID < 0 || nID >= m_nTriggers)
+        return false;
+    Trigger &t = m_pTriggers[nID];
+    int nSlot = t.nSlot;
+    bool bCancelled = false;
+    lock(nSlot);
+    if (t.nState == TRIGGER_ARMED)
+    {
+        Ladder *pLadder = t.nCondition == TRIGGER_AT_OR_ABOVE ? &m_pAbove[nSlot] : &m_pBelow[nSlot];
+        for (int i = 0; i < pLadder->nCount; i++)
+        {
+            if (pLadder->pRungs[i].nID != nID)
+                continue;
+            memmove(&pLadder->pRungs[i], &pLadder->pRungs[i + 1], sizeof(Rung) * (pLadder->nCount - i - 1));
+            pLadder->nCount--;
+            break;
+        }
+        t.nState = TRIGGER_CANCELLED;
+        publishBounds(nSlot);
+        bCancelled = true;
+    }
+    unlock(nSlot);
+    return bCancelled;
+}
+
+int TriggerEngine::onTick(int nSlot, const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    double dLast = pDepthMarketData->LastPrice;
+    double dAbove, dBelow;
+    __atomic_load(&m_pNextAbove[nSlot], &dAbove, __ATOMIC_ACQUIRE);
+    __atomic_load(&m_pNextBelow[nSlot], &dBelow, __ATOMIC_ACQUIRE);
+    // nothing crossed: the common case, no lock taken
+    if (dLast < dAbove && dLast > dBelow)
+        return 0;
+    if (!(dLast > 0 && dLast < DBL_MAX))
+        return 0;
+
+    // each fired order needs its place in the queue to the trader thread,
+    // a trigger without one stays armed
+    unsigned int nRoom = m_fired.room();
+    int nMax = nRoom < (unsigned int)TRIGGER_MAX_FIRE ? (int)nRoom : TRIGGER_MAX_FIRE;
+    int nFired[TRIGGER_MAX_FIRE];
+    int n = 0;
+    lock(nSlot);
+    Ladder *pAbove = &m_pAbove[nSlot];
+    while (n < nMax && pAbove->nCount > 0 && pAbove->pRungs[pAbove->nCount - 1].dPrice <= dLast)
+        nFired[n++] = pAbove->pRungs[--pAbove->nCount].nID;
+    Ladder *pBelow = &m_pBelow[nSlot];
+    while (n < nMax && pBelow->nCount > 0 && pBelow->pRungs[pBelow->nCount - 1].dPrice >= dLast)
+        nFired[n++] = pBelow->pRungs[--pBelow->nCount].nID;
+    int nLeft = 0;
+    if (n == nMax && nMax < TRIGGER_MAX_FIRE)
+    {
+        for (int i = pAbove->nCount - 1; i >= 0 && pAbove->pRungs[i].dPrice <= dLast; i--)
+            nLeft++;
+        for (int i = pBelow->nCount - 1; i >= 0 && pBelow->pRungs[i].dPrice >= dLast; i--)
+            nLeft++;
+    }
+    for (int i = 0; i < n; i++)
+        m_pTriggers[nFired[i]].nState = TRIGGER_FIRED;
+    publishBounds(nSlot);
+    unlock(nSlot);
+
+    if (nLeft > 0)
+    {
+        __atomic_fetch_add(&m_nDeferred, nLeft, __ATOMIC_RELAXED);
+        if (!m_bFiredFull)
+            FC_LOG(LOG_LEVEL_WARN, "fired order queue full, %d triggers on %s left armed\n", nLeft, pDepthMarketData->InstrumentID);
+        m_bFiredFull = true;
+    }
+    else if (nRoom == m_fired.capacity())
+    {
+        m_bFiredFull = false;
+    }
+
+    // orders go out after the lock is released
+    for (int i = 0; i < n; i++)
+        fire(nFired[i], pDepthMarketData);
+    return n;
+}
+
+void TriggerEngine::fire(int nID, const CThostFtdcDepthMarketDataField *pDepthMarketData)
+{
+    Trigger &t = m_pTriggers[nID];
+    const TriggerOrder &o = t.order;
+    bool bBuy = o.chDirection == THOST_FTDC_D_Buy;
+
+    double dPrice = o.dLimitPrice;
+    if (dPrice == 0)
+    {
+        // cross the spread; without that side of the book, the limit
+        dPrice = bBuy ? pDepthMarketData->AskPrice1 : pDepthMarketData->BidPrice1;
+        if (!(dPrice > 0 && dPrice < DBL_MAX))
+            dPrice = bBuy ? pDepthMarketData->UpperLimitPrice : pDepthMarketData->LowerLimitPrice;
+    }
+    if (dPrice > pDepthMarketData->UpperLimitPrice || dPrice < pDepthMarketData->LowerLimitPrice)
+    {
+        t.nRisk = RISK_PRICE_BAND;
+        t.nState = TRIGGER_FAILED;
+        return;
+    }
+    if (m_pUserApi == 0)
+    {
+        t.nState = TRIGGER_FAILED;
+        return;
+    }
+
+    CThostFtdcInputOrderField ord;
+    int nRequestID = __atomic_fetch_add(&m_nRequestID, 1, __ATOMIC_RELAXED);
+    if (!m_pTemplates->build(&ord, t.nSlot, o.chDirection, o.chOffsetFlag, o.chHedgeFlag, dPrice, o.nVolume, nRequestID))
+    {
+        t.nState = TRIGGER_FAILED;
+        return;
+    }
+    // last, an opening order that passes counts towards the exposure
+    t.nRisk = m_pRisk->preCheck(t.nSlot, o.chDirection, o.chOffsetFlag, dPrice, o.nVolume);
+    if (t.nRisk != RISK_OK)
+    {
+        t.nState = TRIGGER_FAILED;
+        return;
+    }
+    t.nOrderRef = m_pOrders->nextOrderRef(ord.OrderRef);
+    // onTick() made room; an order the trader thread cannot register is
+    // not sent
+    if (!m_fired.push(ord))
+    {
+        FC_LOG(LOG_LEVEL_ERROR, "trigger %d on %s: fired order queue full, not sent\n", nID, ord.InstrumentID);
+        t.nState = TRIGGER_FAILED;
+        return;
+    }
+    m_pUserApi->ReqOrderInsert(&ord, nRequestID);
+}
@@ -0,0 +1,163 @@
+#ifndef __TRIGGER_ENGINE_H__
+#define __TRIGGER_ENGINE_H__
+
+#include "../CTP/KSTraderApiEx.h"
+#include "LastValueCache.h"
+#include "OrderTemplates.h"
+#include "OrderManager.h"
+#include "RiskEngine.h"
+#include "TickRing.h"
+
+using namespace KingstarAPI;
+
+// conditions on the last price
+enum
+{
+    // fires on the first tick with LastPrice >= the trigger price
+    TRIGGER_AT_OR_ABOVE,
+    // fires on the first tick with LastPrice <= the trigger price
+    TRIGGER_AT_OR_BELOW
+};
+
+// states of a trigger
+enum
+{
+    TRIGGER_ARMED,
+    TRIGGER_FIRED,
+    TRIGGER_CANCELLED,
+    // fired but no order could be built, passed the risk checks or was sent
+    TRIGGER_FAILED
+};
+
+// triggers of the day, ids are never reused
+const int MAX_TRIGGERS = 65536;
+// triggers fired by one tick, the rest fire on the next one; fewer when
+// the fired order queue is short of room
+const int TRIGGER_MAX_FIRE = 64;
+// request ids of fired orders start here, away from the handler's
+const int TRIGGER_REQUEST_BASE = 0x40000000;
+
+// the order sent when a trigger fires
+struct TriggerOrder
+{
+    char chDirection;
+    char chOffsetFlag;
+    char chHedgeFlag;
+    int nVolume;
+    // limit price, 0 for the opposite best price of the firing tick
+    double dLimitPrice;
+};
+
+struct Trigger
+{
+    int nSlot;
+    int nCondition;
+    int nState;
+    double dTriggerPrice;
+    TriggerOrder order;
+    // OrderRef of the fired order
+    int nOrderRef;
+    // RISK_OK, or the check that failed it when fired
+    int nRisk;
+};
+
+// Local stop-loss, take-profit and price-cross orders.
+//
+// Conditions are kept per instrument in two sorted price ladders, one per
+// condition, ordered so the next trigger to fire is at the end. Each side's
+// nearest trigger price is also published on its own, so a tick that
+// crosses nothing costs two loads and two compares; one that does pops only
+// the crossed rungs. Fired triggers build their order from the
+// OrderTemplates and call ReqOrderInsert right on the market data thread,
+// without the broker's conditional order round trip.
+//
+// addTrigger()/cancelTrigger() run on the trader thread, onTick() on the
+// market data thread; a ladder is guarded by a per-instrument spin lock
+// held only while rungs are added or popped. The OrderManager and the
+// RiskEngine belong to the trader thread, so fired orders are also queued
+// and popFired() hands them back there to be registered; they are queued
+// before ReqOrderInsert, so the trader thread sees them before any return.
+// A tick fires no more triggers than the queue has room for, the others
+// stay armed for a later tick, so every order sent gets registered.
+// Callers run RiskEngine::check() on the order when arming; when it fires,
+// the order is checked against the price band of the firing tick and
+// RiskEngine::preCheck(); the caller registers what popFired() returns with
+// RiskEngine::onTriggered().
+class TriggerEngine
+{
+public:
+    TriggerEngine(LastValueCache *pCache, OrderTemplates *pTemplates, OrderManager *pOrders, RiskEngine *pRisk);
+    ~TriggerEngine();
+
+    void setTraderApi(CThostFtdcTraderApi *pUserApi) { m_pUserApi = pUserApi; }
+
+    // returns the trigger id, -1 for an unknown instrument or a full pool
+    int addTrigger(const char *pInstrumentID, int nCondition, double dTriggerPrice, const TriggerOrder &order);
+
+    // stop on a long (sell at or below) or short (buy at or above) position
+    int stopLoss(const char *pInstrumentID, bool bLong, double dStopPrice, int nVolume, char chOffsetFlag);
+    // profit target on a long (sell at or above) or short (buy at or below)
+    int takeProfit(const char *pInstrumentID, bool bLong, double dTargetPrice, int nVolume, char chOffsetFlag);
+
+    // false when the trigger already fired or is unknown
+    bool cancelTrigger(int nID);
+
+    // after LastValueCache::update() returned nSlot, returns the number of
+    // triggers fired
+    int onTick(int nSlot, const CThostFtdcDepthMarketDataField *pDepthMarketData);
+
+    // trader thread: orders sent by fired triggers since the last call
+    unsigned int popFired(CThostFtdcInputOrderField *pOut, unsigned int nMax) { return m_fired.pop(pOut, nMax); }
+
+    const Trigger &trigger(int nID) const { return m_pTriggers[nID]; }
+    int count() const { return m_nTriggers; }
+    // crossed triggers left armed because the fired order queue was full,
+    // once per tick they waited
+    unsigned long long deferred() const { return __atomic_load_n(&m_nDeferred, __ATOMIC_RELAXED); }
+
+private:
+    struct Rung
+    {
+        double dPrice;
+        int nID;
+    };
+
+    struct Ladder
+    {
+        Rung *pRungs;
+        int nCount;
+        int nCapacity;
+    };
+
+    void lock(int nSlot) { while (__atomic_test_and_set(&m_pLocks[nSlot], __ATOMIC_ACQUIRE)) ; }
+    void unlock(int nSlot) { __atomic_clear(&m_pLocks[nSlot], __ATOMIC_RELEASE); }
+    void insertRung(Ladder *pLadder, double dPrice, int nID, bool bDescending);
+    void publishBounds(int nSlot);
+    void fire(int nID, const CThostFtdcDepthMarketDataField *pDepthMarketData);
+
+    LastValueCache *m_pCache;
+    OrderTemplates *m_pTemplates;
+    OrderManager *m_pOrders;
+    RiskEngine *m_pRisk;
+    CThostFtdcTraderApi *m_pUserApi;
+
+    Trigger *m_pTriggers;
+    int m_nTriggers;
+
+    // per slot: AT_OR_ABOVE ladder sorted descending, AT_OR_BELOW ascending
+    Ladder *m_pAbove;
+    Ladder *m_pBelow;
+    // lowest armed AT_OR_ABOVE and highest AT_OR_BELOW price, +-DBL_MAX
+    // when there is none
+    double *m_pNextAbove;
+    double *m_pNextBelow;
+    char *m_pLocks;
+
+    int m_nRequestID;
+    TickRing<CThostFtdcInputOrderField> m_fired;
+    unsigned long long m_nDeferred;
+    // market data thread: the queue full warning is logged once per spell
+    bool m_bFiredFull;
+};
+
+#endif
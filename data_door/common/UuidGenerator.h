@@ -0,0 +1,96 @@
+#ifndef __UUID_GENERATOR_H__
+#define __UUID_GENERATOR_H__
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// "xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx", without a terminator
+const int UUID_TEXT_LENGTH = 36;
+
+// Version 4 (random) UUIDs as the Java listener's UUID.randomUUID() gives,
+// without its SecureRandom lock: a xorshift128+ stream seeded once from
+// /dev/urandom, formatted through a byte to hex table. The ids only have to
+// be unique, not unpredictable.
+//
+// One generator per thread; next() neither locks nor allocates.
+class UuidGenerator
+{
+public:
+    UuidGenerator()
+    {
+        m_s[0] = m_s[1] = 0;
+        int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            if (read(fd, m_s, sizeof(m_s)) != (ssize_t)sizeof(m_s))
+                m_s[0] = m_s[1] = 0;
+            close(fd);
+        }
+        // no urandom: the clock and pid, mixed below
+        if (m_s[0] == 0 && m_s[1] == 0)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            m_s[0] = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+            m_s[1] = (unsigned long long)getpid() << 32 | (unsigned int)ts.tv_nsec;
+        }
+        m_s[0] = splitmix(m_s[0]);
+        m_s[1] = splitmix(m_s[1] ^ 0x9e3779b97f4a7c15ULL);
+        if (m_s[0] == 0 && m_s[1] == 0)
+            m_s[1] = 1;
+
+        static const char s_chHex[] = "0123456789abcdef";
+        for (int i = 0; i < 256; i++)
+        {
+            m_chHex[i][0] = s_chHex[i >> 4];
+            m_chHex[i][1] = s_chHex[i & 15];
+        }
+    }
+
+    // write the next id into pOut, UUID_TEXT_LENGTH characters
+    void next(char *pOut)
+    {
+        unsigned char b[16];
+        unsigned long long hi = random();
+        unsigned long long lo = random();
+        memcpy(b, &hi, 8);
+        memcpy(b + 8, &lo, 8);
+        // version 4, variant 10xx
+        b[6] = (b[6] & 0x0f) | 0x40;
+        b[8] = (b[8] & 0x3f) | 0x80;
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (i == 4 || i == 6 || i == 8 || i == 10)
+                *pOut++ = '-';
+            memcpy(pOut, m_chHex[b[i]], 2);
+            pOut += 2;
+        }
+    }
+
+private:
+    unsigned long long random()
+    {
+        unsigned long long s1 = m_s[0];
+        const unsigned long long s0 = m_s[1];
+        m_s[0] = s0;
+        s1 ^= s1 << 23;
+        m_s[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+        return m_s[1] + s0;
+    }
+
+    static unsigned long long splitmix(unsigned long long x)
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    unsigned long long m_s[2];
+    char m_chHex[256][2];
+};
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ *@file event.h
+ *windowslinuxͨõ¼¼Ľӿ
+ *@author xdhu
+ *ϵͳAPIԳ
+ *˾ʤƽ˴
+ *޸ʷ
+ *20121106  
+ */
+#ifndef _HIK_EVENT_H_
+#define _HIK_EVENT_H_
+
+// header only: the windows event, or FutexEvent on linux; the timed wait
+// runs on the monotonic clock
+#ifdef _MSC_VER
+#include <Windows.h>
+#define event_handle HANDLE
+#else
+#include <new>
+#include "FutexEvent.h"
+#define event_handle FutexEvent*
+#endif
+
+//ֵ NULL  
+inline event_handle event_create(bool manual_reset, bool init_state)
+{
+#ifdef _MSC_VER
+    return CreateEvent(NULL, manual_reset, init_state, NULL);
+#else
+    return new(std::nothrow) FutexEvent(manual_reset, init_state);
+#endif
+}
+
+//ֵ0 ȵ¼  -1   
+inline int event_wait(event_handle hevent)
+{
+#ifdef _MSC_VER
+    return WaitForSingleObject(hevent, INFINITE) == WAIT_OBJECT_0 ? 0 : -1;
+#else
+    hevent->wait();
+    return 0;
+#endif
+}
+
+//ֵ0ȵ¼ 1ʱ -1
+inline int event_timedwait(event_handle hevent, long milliseconds)
+{
+#ifdef _MSC_VER
+    DWORD ret = WaitForSingleObject(hevent, milliseconds);
+    if (ret == WAIT_OBJECT_0)
+        return 0;
+    return ret == WAIT_TIMEOUT ? 1 : -1;
+#else
+    return hevent->timedwait(milliseconds);
+#endif
+}
+
+//ֵ0ɹ -1 
+inline int event_set(event_handle hevent)
+{
+#ifdef _MSC_VER
+    return !SetEvent(hevent);
+#else
+    hevent->set();
+    return 0;
+#endif
+}
+
+//ֵ0 ȵ¼1 ʱ-1
+inline int event_reset(event_handle hevent)
+{
+#ifdef _MSC_VER
+    return ResetEvent(hevent) ? 0 : -1;
+#else
+    hevent->reset();
+    return 0;
+#endif
+}
+
+//ֵ 
+inline void event_destroy(event_handle hevent)
+{
+#ifdef _MSC_VER
+    CloseHandle(hevent);
+#else
+    delete hevent;
+#endif
+}
+
+#endif
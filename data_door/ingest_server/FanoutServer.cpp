@@ -0,0 +1,759 @@
+// FanoutServer.cpp : tick fanout to strategy subscribers.
+//
+#include "FanoutServer.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include "../common/ThreadTopology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// epoll tags below the subscriber numbers
+enum
+{
+    TAG_LISTENER,
+    TAG_WAKE,
+    TAG_CLIENT
+};
+
+// records taken from the ring at a time
+const int FANOUT_BATCH = 64;
+const int FANOUT_MAX_EVENTS = 256;
+const int FANOUT_DIRTY_WORDS = MAX_INSTRUMENTS / 64;
+
+// "*" "?" "[" make a glob, letters only a product, else one InstrumentID
+static bool pattern_matches(const char *pPattern, const char *pInstrumentID)
+{
+    if (strpbrk(pPattern, "*?[") != NULL)
+        return fnmatch(pPattern, pInstrumentID, 0) == 0;
+    int nLen = 0;
+    while (isalpha((unsigned char)pPattern[nLen]))
+        nLen++;
+    if (pPattern[nLen] != '\0')
+        return strcmp(pPattern, pInstrumentID) == 0;
+    return nLen > 0 && strncasecmp(pPattern, pInstrumentID, nLen) == 0 && !isalpha((unsigned char)pInstrumentID[nLen]);
+}
+
+FanoutServer::FanoutServer() : m_pRing(NULL), m_bPushed(false), m_nEpoll(-1), m_nWake(-1), m_bRunning(false),
+    m_bStop(false), m_nClientBuffer(0), m_bConflate(true), m_pClients(NULL), m_pFree(NULL), m_nFree(0),
+    m_nSeq(0), m_nAccepted(0), m_nLines(0), m_nConflated(0), m_nSlowClosed(0), m_nDropped(0), m_nSnapshots(0),
+    m_nForQuoteDropped(0)
+{
+    memset(m_nActive, 0, sizeof(m_nActive));
+    m_pMasks = (unsigned long long (*)[FANOUT_MASK_WORDS])calloc(MAX_INSTRUMENTS, sizeof(*m_pMasks));
+    m_pLines = (char (*)[LAST_MARKET_LINE_SIZE])malloc(sizeof(*m_pLines) * MAX_INSTRUMENTS);
+    m_pLength = (int *)calloc(MAX_INSTRUMENTS, sizeof(int));
+    m_pJoined = (int *)malloc(sizeof(int) * MAX_INSTRUMENTS);
+}
+
+FanoutServer::~FanoutServer()
+{
+    stop();
+    if (m_pClients != NULL)
+    {
+        for (int i = 0; i < FANOUT_MAX_CLIENTS; i++)
+        {
+            if (m_pClients[i].fd >= 0)
+                close(m_pClients[i].fd);
+            free(m_pClients[i].pOut);
+            free(m_pClients[i].pDirty);
+            free(m_pClients[i].pSnapshot);
+        }
+        free(m_pClients);
+    }
+    free(m_pFree);
+    if (m_nWake >= 0)
+        close(m_nWake);
+    if (m_nEpoll >= 0)
+        close(m_nEpoll);
+    delete m_pRing;
+    free(m_pMasks);
+    free(m_pLines);
+    free(m_pLength);
+    free(m_pJoined);
+}
+
+bool FanoutServer::listen(int nPort, int nQueue, int nClientBuffer, bool bConflate)
+{
+    if (!m_listener.create() || !m_listener.bind(nPort) || !m_listener.listen(FANOUT_MAX_CLIENTS))
+        return false;
+    m_listener.set_non_blocking(true);
+
+    m_nEpoll = epoll_create1(EPOLL_CLOEXEC);
+    m_nWake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_nEpoll < 0 || m_nWake < 0)
+        return false;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = TAG_LISTENER;
+    if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_listener.handle(), &ev) != 0)
+        return false;
+    ev.data.u64 = TAG_WAKE;
+    if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_nWake, &ev) != 0)
+        return false;
+
+    // room for at least one line
+    if (nClientBuffer < LAST_MARKET_LINE_SIZE)
+        nClientBuffer = LAST_MARKET_LINE_SIZE;
+    m_nClientBuffer = nClientBuffer;
+    m_bConflate = bConflate;
+    m_pRing = new TickRing<FanoutRecord>(nQueue);
+    m_pClients = (FanoutClient *)calloc(FANOUT_MAX_CLIENTS, sizeof(FanoutClient));
+    m_pFree = (int *)malloc(sizeof(int) * FANOUT_MAX_CLIENTS);
+    if (m_pClients == NULL || m_pFree == NULL || m_pMasks == NULL || m_pLines == NULL || m_pLength == NULL || m_pJoined == NULL)
+        return false;
+    for (int i = 0; i < FANOUT_MAX_CLIENTS; i++)
+    {
+        FanoutClient *pClient = &m_pClients[i];
+        pClient->fd = -1;
+        // untouched pages of an idle buffer cost no memory
+        pClient->pOut = (char *)malloc(nClientBuffer);
+        pClient->pDirty = (unsigned long long *)calloc(FANOUT_DIRTY_WORDS, sizeof(unsigned long long));
+        if (pClient->pOut == NULL || pClient->pDirty == NULL)
+            return false;
+        m_pFree[i] = FANOUT_MAX_CLIENTS - 1 - i;
+    }
+    m_nFree = FANOUT_MAX_CLIENTS;
+    return true;
+}
+
+bool FanoutServer::start()
+{
+    m_bStop = false;
+    m_bRunning = pthread_create(&m_thread, NULL, threadMain, this) == 0;
+    return m_bRunning;
+}
+
+void FanoutServer::stop()
+{
+    if (!m_bRunning)
+        return;
+    m_bStop = true;
+    unsigned long long nOne = 1;
+    if (write(m_nWake, &nOne, sizeof(nOne)) < 0)
+        FC_LOG(LOG_LEVEL_WARN, "cannot wake the fanout thread, errno %d\n", errno);
+    pthread_join(m_thread, NULL);
+    m_bRunning = false;
+}
+
+void FanoutServer::onRecord(const FCMessage &msg, const char *pUuid)
+{
+    if (msg.nType != FCMESSAGE_MARKET && msg.nType != FCMESSAGE_MARKET_DELTA && msg.nType != FCMESSAGE_FOR_QUOTE)
+        return;
+    if (m_pRing == NULL || msg.nLength >= FANOUT_LINE_SIZE)
+    {
+        m_nDropped++;
+        return;
+    }
+    m_record.nQueuedAt = latency_now();
+    m_record.nLength = msg.nLength;
+    memcpy(m_record.chLine, msg.pLine, msg.nLength);
+    if (!m_pRing->push(m_record))
+    {
+        if (m_nDropped++ == 0)
+            FC_LOG(LOG_LEVEL_WARN, "fanout queue full, dropping ticks\n");
+        return;
+    }
+    m_bPushed = true;
+}
+
+void FanoutServer::flush()
+{
+    // one wake up per ingest batch
+    if (!m_bPushed)
+        return;
+    m_bPushed = false;
+    unsigned long long nOne = 1;
+    if (write(m_nWake, &nOne, sizeof(nOne)) < 0 && errno != EAGAIN)
+        FC_LOG(LOG_LEVEL_WARN, "cannot wake the fanout thread, errno %d\n", errno);
+}
+
+void *FanoutServer::threadMain(void *pArg)
+{
+    ThreadTopology::enter(THREAD_FANOUT);
+    ((FanoutServer *)pArg)->serve();
+    return NULL;
+}
+
+void FanoutServer::serve()
+{
+    // a busy polling fanout never sleeps in epoll_wait
+    int nTimeout = ThreadTopology::busyPoll(THREAD_FANOUT) ? 0 : -1;
+    FanoutRecord *pBatch = new FanoutRecord[FANOUT_BATCH];
+    struct epoll_event events[FANOUT_MAX_EVENTS];
+    while (!m_bStop)
+    {
+        int n = epoll_wait(m_nEpoll, events, FANOUT_MAX_EVENTS, nTimeout);
+        if (n < 0 && errno != EINTR)
+        {
+            FC_LOG(LOG_LEVEL_ERROR, "fanout epoll_wait failed, errno %d\n", errno);
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            unsigned long long nTag = events[i].data.u64;
+            if (nTag == TAG_LISTENER)
+                acceptAll();
+            else if (nTag == TAG_WAKE)
+            {
+                unsigned long long nCount;
+                if (read(m_nWake, &nCount, sizeof(nCount)) < 0 && errno != EAGAIN)
+                    FC_LOG(LOG_LEVEL_WARN, "fanout wake read failed, errno %d\n", errno);
+            }
+            else
+            {
+                FanoutClient *pClient = &m_pClients[nTag - TAG_CLIENT];
+                if (pClient->fd < 0)
+                    continue;
+                if (events[i].events & EPOLLOUT)
+                {
+                    writeTo(pClient);
+                    if (pClient->fd < 0)
+                        continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    readFrom(pClient);
+            }
+        }
+
+        unsigned int nRecords;
+        while ((nRecords = m_pRing->pop(pBatch, FANOUT_BATCH)) > 0)
+        {
+            for (unsigned int r = 0; r < nRecords; r++)
+                publish(pBatch[r]);
+            // one send per subscriber for the whole batch
+            for (int w = 0; w < FANOUT_MASK_WORDS; w++)
+            {
+                unsigned long long nBits = m_nActive[w];
+                m_nActive[w] = 0;
+                while (nBits != 0)
+                {
+                    FanoutClient *pClient = &m_pClients[w * 64 + __builtin_ctzll(nBits)];
+                    nBits &= nBits - 1;
+                    // a blocked subscriber is written when epoll says so
+                    if (pClient->fd >= 0 && !pClient->bWriting)
+                        writeTo(pClient);
+                }
+            }
+            unsigned long long nNow = latency_now();
+            for (unsigned int r = 0; r < nRecords; r++)
+                LatencyStats::record(LAT_FANOUT, nNow - pBatch[r].nQueuedAt);
+        }
+    }
+    delete[] pBatch;
+}
+
+void FanoutServer::acceptAll()
+{
+    for (;;)
+    {
+        int fd = accept4(m_listener.handle(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                FC_LOG(LOG_LEVEL_WARN, "fanout accept failed, errno %d\n", errno);
+            return;
+        }
+        if (m_nFree == 0)
+        {
+            FC_LOG(LOG_LEVEL_WARN, "%d subscribers connected, refusing another\n", FANOUT_MAX_CLIENTS);
+            close(fd);
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        int nIndex = m_pFree[--m_nFree];
+        FanoutClient *pClient = &m_pClients[nIndex];
+        pClient->fd = fd;
+        pClient->bConflate = m_bConflate;
+        pClient->bWriting = false;
+        pClient->nOut = 0;
+        pClient->nSent = 0;
+        pClient->nDirty = 0;
+        pClient->nPatterns = 0;
+        pClient->nIn = 0;
+        pClient->nLines = 0;
+        pClient->nConflated = 0;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = TAG_CLIENT + nIndex;
+        if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            closeClient(pClient);
+            continue;
+        }
+        m_nAccepted++;
+    }
+}
+
+void FanoutServer::closeClient(FanoutClient *pClient)
+{
+    int nIndex = pClient - m_pClients;
+    unsigned long long nBit = 1ULL << (nIndex & 63);
+    int nWord = nIndex >> 6;
+    for (int s = 0; s < m_index.count(); s++)
+        m_pMasks[s][nWord] &= ~nBit;
+    if (pClient->nDirty > 0)
+        memset(pClient->pDirty, 0, sizeof(unsigned long long) * FANOUT_DIRTY_WORDS);
+    free(pClient->pSnapshot);
+    pClient->pSnapshot = NULL;
+    pClient->nSnapshot = 0;
+    pClient->nSnapshotSent = 0;
+    if (pClient->nLines > 0)
+        FC_LOG(LOG_LEVEL_INFO, "subscriber %d closed after %llu lines, %llu conflated\n", nIndex, pClient->nLines,
+               pClient->nConflated);
+    // close() drops the descriptor from the epoll set
+    close(pClient->fd);
+    pClient->fd = -1;
+    m_pFree[m_nFree++] = nIndex;
+}
+
+void FanoutServer::readFrom(FanoutClient *pClient)
+{
+    for (;;)
+    {
+        ssize_t n = recv(pClient->fd, pClient->chIn + pClient->nIn, sizeof(pClient->chIn) - pClient->nIn, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0)
+        {
+            closeClient(pClient);
+            return;
+        }
+        pClient->nIn += n;
+
+        char *p = pClient->chIn;
+        char *pEnd = pClient->chIn + pClient->nIn;
+        char *pNewline;
+        while ((pNewline = (char *)memchr(p, '\n', pEnd - p)) != NULL)
+        {
+            handleCommand(pClient, p, pNewline - p);
+            // a snapshot it could not be given closes it
+            if (pClient->fd < 0)
+                return;
+            p = pNewline + 1;
+        }
+        pClient->nIn = pEnd - p;
+        if (p != pClient->chIn && pClient->nIn > 0)
+            memmove(pClient->chIn, p, pClient->nIn);
+        if (pClient->nIn == (int)sizeof(pClient->chIn))
+        {
+            FC_LOG(LOG_LEVEL_WARN, "subscriber command longer than %d bytes, closing it\n", (int)sizeof(pClient->chIn));
+            closeClient(pClient);
+            return;
+        }
+    }
+}
+
+void FanoutServer::handleCommand(FanoutClient *pClient, char *pLine, int nLength)
+{
+    if (nLength > 0 && pLine[nLength - 1] == '\r')
+        nLength--;
+    pLine[nLength] = '\0';
+    char *pArgs = strchr(pLine, '|');
+    if (pArgs != NULL)
+        *pArgs++ = '\0';
+
+    if (strcmp(pLine, "FCSLOW") == 0 && pArgs != NULL)
+    {
+        pClient->bConflate = strcmp(pArgs, "disconnect") != 0;
+        return;
+    }
+    bool bSubscribe = strcmp(pLine, "FCSUBSCRIBE") == 0;
+    if (!bSubscribe && strcmp(pLine, "FCUNSUBSCRIBE") != 0)
+    {
+        FC_LOG(LOG_LEVEL_WARN, "unknown subscriber command %s\n", pLine);
+        return;
+    }
+    if (!bSubscribe && pArgs == NULL)
+        pClient->nPatterns = 0;
+    while (pArgs != NULL)
+    {
+        char *pPattern = pArgs;
+        pArgs = strchr(pArgs, '|');
+        if (pArgs != NULL)
+            *pArgs++ = '\0';
+        if (*pPattern == '\0' || strlen(pPattern) >= FANOUT_PATTERN_SIZE)
+            continue;
+        int nFound = 0;
+        while (nFound < pClient->nPatterns && strcmp(pClient->chPatterns[nFound], pPattern) != 0)
+            nFound++;
+        if (!bSubscribe && nFound < pClient->nPatterns)
+        {
+            memmove(pClient->chPatterns[nFound], pClient->chPatterns[nFound + 1],
+                    FANOUT_PATTERN_SIZE * (pClient->nPatterns - nFound - 1));
+            pClient->nPatterns--;
+        }
+        else if (bSubscribe && nFound == pClient->nPatterns)
+        {
+            if (pClient->nPatterns == FANOUT_MAX_PATTERNS)
+            {
+                FC_LOG(LOG_LEVEL_WARN, "subscriber %d has %d patterns, ignoring %s\n", (int)(pClient - m_pClients),
+                       FANOUT_MAX_PATTERNS, pPattern);
+                continue;
+            }
+            strcpy(pClient->chPatterns[pClient->nPatterns++], pPattern);
+        }
+    }
+    int nJoined = updateMasks(pClient);
+    if (nJoined > 0)
+        sendSnapshot(pClient, nJoined);
+}
+
+// the subscriber's bit in the mask of every instrument known so far;
+// returns how many it gained that have a line, listed in m_pJoined
+int FanoutServer::updateMasks(FanoutClient *pClient)
+{
+    int nIndex = pClient - m_pClients;
+    unsigned long long nBit = 1ULL << (nIndex & 63);
+    int nWord = nIndex >> 6;
+    int nJoined = 0;
+    for (int s = 0; s < m_index.count(); s++)
+    {
+        bool bMatch = false;
+        for (int p = 0; p < pClient->nPatterns && !bMatch; p++)
+            bMatch = pattern_matches(pClient->chPatterns[p], m_index.name(s));
+        if (bMatch)
+        {
+            if (!(m_pMasks[s][nWord] & nBit) && m_pLength[s] > 0)
+                m_pJoined[nJoined++] = s;
+            m_pMasks[s][nWord] |= nBit;
+        }
+        else
+        {
+            m_pMasks[s][nWord] &= ~nBit;
+            // nothing owed for an instrument no longer subscribed
+            if (pClient->pDirty[s >> 6] & (1ULL << (s & 63)))
+            {
+                pClient->pDirty[s >> 6] &= ~(1ULL << (s & 63));
+                pClient->nDirty--;
+            }
+        }
+    }
+    return nJoined;
+}
+
+// the latest lines of the instruments just subscribed, framed with the
+// sequence they stand at; queued after the unsent part of pOut, which may
+// end a partly sent line, and ahead of anything published later
+void FanoutServer::sendSnapshot(FanoutClient *pClient, int nJoined)
+{
+    const int nMarker = 64;
+    int nPending = pClient->nOut - pClient->nSent;
+    int nBytes = 2 * nMarker + nPending;
+    for (int j = 0; j < nJoined; j++)
+        nBytes += m_pLength[m_pJoined[j]];
+    // a snapshot still going out is kept, this one follows it
+    if (pClient->nSnapshotSent > 0)
+    {
+        memmove(pClient->pSnapshot, pClient->pSnapshot + pClient->nSnapshotSent, pClient->nSnapshot - pClient->nSnapshotSent);
+        pClient->nSnapshot -= pClient->nSnapshotSent;
+        pClient->nSnapshotSent = 0;
+    }
+    char *pSnapshot = (char *)realloc(pClient->pSnapshot, pClient->nSnapshot + nBytes);
+    if (pSnapshot == NULL)
+    {
+        FC_LOG(LOG_LEVEL_ERROR, "no memory for a snapshot of %d instruments, closing subscriber %d\n", nJoined,
+               (int)(pClient - m_pClients));
+        closeClient(pClient);
+        return;
+    }
+    pClient->pSnapshot = pSnapshot;
+    char *p = pSnapshot + pClient->nSnapshot;
+    memcpy(p, pClient->pOut + pClient->nSent, nPending);
+    p += nPending;
+    pClient->nOut = 0;
+    pClient->nSent = 0;
+    p += snprintf(p, nMarker, "FCMESSAGE_TYPE_SNAPSHOT|%llu|%d\n", m_nSeq, nJoined);
+    for (int j = 0; j < nJoined; j++)
+    {
+        memcpy(p, m_pLines[m_pJoined[j]], m_pLength[m_pJoined[j]]);
+        p += m_pLength[m_pJoined[j]];
+    }
+    p += snprintf(p, nMarker, "FCMESSAGE_TYPE_SNAPSHOT_END|%llu\n", m_nSeq);
+    pClient->nSnapshot = p - pSnapshot;
+    pClient->nLines += nJoined;
+    m_nLines += nJoined;
+    m_nSnapshots++;
+    if (!pClient->bWriting)
+        writeTo(pClient);
+}
+
+// first tick of an instrument: its subscribers
+void FanoutServer::addInstrument(int nSlot)
+{
+    const char *pInstrumentID = m_index.name(nSlot);
+    for (int c = 0; c < FANOUT_MAX_CLIENTS; c++)
+    {
+        FanoutClient *pClient = &m_pClients[c];
+        if (pClient->fd < 0)
+            continue;
+        for (int p = 0; p < pClient->nPatterns; p++)
+        {
+            if (pattern_matches(pClient->chPatterns[p], pInstrumentID))
+            {
+                m_pMasks[nSlot][c >> 6] |= 1ULL << (c & 63);
+                break;
+            }
+        }
+    }
+}
+
+void FanoutServer::publish(const FanoutRecord &record)
+{
+    FCMessage msg;
+    if (!msg.parse(record.chLine, record.nLength))
+        return;
+
+    CThostFtdcDepthMarketDataField tick;
+    char chID[32];
+    const char *pInstrumentID;
+    if (msg.nType == FCMESSAGE_MARKET_DELTA)
+    {
+        char frame[DEPTH_DELTA_MAX_FRAME];
+        int nFrame = msg.nFields > 1 ? depth_delta_from_hex(msg.pField[1], msg.nFieldLength[1], frame, sizeof(frame)) : -1;
+        int nConsumed;
+        // an update before the instrument's first snapshot is skipped
+        if (nFrame <= 0 || m_decoder.decode(frame, nFrame, &tick, &nConsumed) != 0)
+            return;
+        pInstrumentID = tick.InstrumentID;
+    }
+    else
+        pInstrumentID = msg.field(msg.instrumentField(), chID, sizeof(chID));
+    if (*pInstrumentID == '\0')
+        return;
+
+    int nSlot = m_index.find(pInstrumentID);
+    if (nSlot < 0)
+    {
+        nSlot = m_index.insert(pInstrumentID);
+        if (nSlot < 0)
+            return;
+        addInstrument(nSlot);
+    }
+
+    // a request for quote leaves the latest line and the sequence alone
+    if (msg.nType == FCMESSAGE_FOR_QUOTE)
+    {
+        for (int w = 0; w < FANOUT_MASK_WORDS; w++)
+        {
+            unsigned long long nBits = m_pMasks[nSlot][w];
+            while (nBits != 0)
+            {
+                appendForQuote(&m_pClients[w * 64 + __builtin_ctzll(nBits)], record.chLine, record.nLength);
+                nBits &= nBits - 1;
+            }
+        }
+        return;
+    }
+
+    // the latest line of the instrument, what a conflated subscriber gets
+    char *pLine = m_pLines[nSlot];
+    int nLength;
+    if (msg.nType == FCMESSAGE_MARKET_DELTA)
+    {
+        // the indicators after the frame go after the tick
+        nLength = fc_format_market(&tick, pLine, LAST_MARKET_LINE_SIZE - 1);
+        if (nLength > 0)
+        {
+            int nMore = fc_append_fields(msg, 2, pLine + nLength, LAST_MARKET_LINE_SIZE - 1 - nLength);
+            nLength = nMore < 0 ? -1 : nLength + nMore;
+        }
+    }
+    else if (record.nLength < LAST_MARKET_LINE_SIZE)
+    {
+        memcpy(pLine, record.chLine, record.nLength);
+        nLength = record.nLength;
+    }
+    else
+        nLength = -1;
+    if (nLength < 0)
+    {
+        m_pLength[nSlot] = 0;
+        return;
+    }
+    pLine[nLength] = '\n';
+    m_pLength[nSlot] = nLength + 1;
+    m_nSeq++;
+
+    for (int w = 0; w < FANOUT_MASK_WORDS; w++)
+    {
+        unsigned long long nBits = m_pMasks[nSlot][w];
+        while (nBits != 0)
+        {
+            append(&m_pClients[w * 64 + __builtin_ctzll(nBits)], nSlot);
+            nBits &= nBits - 1;
+        }
+    }
+}
+
+// queue the instrument's latest line for the subscriber; false when that
+// closed it
+bool FanoutServer::append(FanoutClient *pClient, int nSlot)
+{
+    unsigned long long nBit = 1ULL << (nSlot & 63);
+    unsigned long long &nDirty = pClient->pDirty[nSlot >> 6];
+    // already owed: the line it was owed for is replaced by this one
+    if (nDirty & nBit)
+    {
+        pClient->nConflated++;
+        m_nConflated++;
+        return true;
+    }
+    int nLength = m_pLength[nSlot];
+    if (room(pClient, nLength))
+    {
+        memcpy(pClient->pOut + pClient->nOut, m_pLines[nSlot], nLength);
+        pClient->nOut += nLength;
+        pClient->nLines++;
+        m_nLines++;
+        int nIndex = pClient - m_pClients;
+        m_nActive[nIndex >> 6] |= 1ULL << (nIndex & 63);
+        return true;
+    }
+    if (!pClient->bConflate)
+    {
+        closeSlow(pClient);
+        return false;
+    }
+    nDirty |= nBit;
+    pClient->nDirty++;
+    return true;
+}
+
+// pLine without its '\n', which is added
+bool FanoutServer::appendForQuote(FanoutClient *pClient, const char *pLine, int nLength)
+{
+    if (room(pClient, nLength + 1))
+    {
+        memcpy(pClient->pOut + pClient->nOut, pLine, nLength);
+        pClient->pOut[pClient->nOut + nLength] = '\n';
+        pClient->nOut += nLength + 1;
+        pClient->nLines++;
+        m_nLines++;
+        int nIndex = pClient - m_pClients;
+        m_nActive[nIndex >> 6] |= 1ULL << (nIndex & 63);
+        return true;
+    }
+    if (!pClient->bConflate)
+    {
+        closeSlow(pClient);
+        return false;
+    }
+    m_nForQuoteDropped++;
+    return true;
+}
+
+// true when nLength more bytes fit pOut, moving the unsent part to its
+// start if that makes room
+bool FanoutServer::room(FanoutClient *pClient, int nLength)
+{
+    if (pClient->nOut + nLength > m_nClientBuffer && pClient->nSent > 0)
+    {
+        memmove(pClient->pOut, pClient->pOut + pClient->nSent, pClient->nOut - pClient->nSent);
+        pClient->nOut -= pClient->nSent;
+        pClient->nSent = 0;
+    }
+    return pClient->nOut + nLength <= m_nClientBuffer;
+}
+
+void FanoutServer::closeSlow(FanoutClient *pClient)
+{
+    FC_LOG(LOG_LEVEL_WARN, "subscriber %d is %d bytes behind, disconnecting it\n", (int)(pClient - m_pClients),
+           pClient->nOut - pClient->nSent);
+    m_nSlowClosed++;
+    closeClient(pClient);
+}
+
+// the owed lines, as many as fit
+void FanoutServer::refill(FanoutClient *pClient)
+{
+    for (int w = 0; w < FANOUT_DIRTY_WORDS && pClient->nDirty > 0; w++)
+    {
+        while (pClient->pDirty[w] != 0)
+        {
+            int nSlot = w * 64 + __builtin_ctzll(pClient->pDirty[w]);
+            int nLength = m_pLength[nSlot];
+            if (pClient->nOut + nLength > m_nClientBuffer)
+                return;
+            memcpy(pClient->pOut + pClient->nOut, m_pLines[nSlot], nLength);
+            pClient->nOut += nLength;
+            pClient->nLines++;
+            m_nLines++;
+            pClient->pDirty[w] &= pClient->pDirty[w] - 1;
+            pClient->nDirty--;
+        }
+    }
+}
+
+// send pBuf[nSent, nEnd); false when the socket is full, to be written
+// again on EPOLLOUT, or the subscriber was closed
+bool FanoutServer::sendAll(FanoutClient *pClient, const char *pBuf, int &nSent, int nEnd)
+{
+    while (nSent < nEnd)
+    {
+        ssize_t n = send(pClient->fd, pBuf + nSent, nEnd - nSent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                closeClient(pClient);
+            else
+                setWriting(pClient, true);
+            return false;
+        }
+        nSent += n;
+    }
+    return true;
+}
+
+void FanoutServer::writeTo(FanoutClient *pClient)
+{
+    if (pClient->pSnapshot != NULL)
+    {
+        if (!sendAll(pClient, pClient->pSnapshot, pClient->nSnapshotSent, pClient->nSnapshot))
+            return;
+        free(pClient->pSnapshot);
+        pClient->pSnapshot = NULL;
+        pClient->nSnapshot = 0;
+        pClient->nSnapshotSent = 0;
+    }
+    for (;;)
+    {
+        if (!sendAll(pClient, pClient->pOut, pClient->nSent, pClient->nOut))
+            return;
+        pClient->nOut = 0;
+        pClient->nSent = 0;
+        if (pClient->nDirty == 0)
+            break;
+        refill(pClient);
+    }
+    setWriting(pClient, false);
+}
+
+void FanoutServer::setWriting(FanoutClient *pClient, bool bWriting)
+{
+    if (pClient->bWriting == bWriting)
+        return;
+    struct epoll_event ev;
+    ev.events = bWriting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.u64 = TAG_CLIENT + (pClient - m_pClients);
+    epoll_ctl(m_nEpoll, EPOLL_CTL_MOD, pClient->fd, &ev);
+    pClient->bWriting = bWriting;
+}
@@ -0,0 +1,187 @@
+#ifndef __FANOUT_SERVER_H__
+#define __FANOUT_SERVER_H__
+
+#include "Socket.h"
+#include "IngestSinks.h"
+#include "../common/TickRing.h"
+#include <pthread.h>
+
+// subscribers served at once, one bit each in the per instrument masks
+const int FANOUT_MAX_CLIENTS = 256;
+const int FANOUT_MASK_WORDS = FANOUT_MAX_CLIENTS / 64;
+// patterns kept per subscriber
+const int FANOUT_MAX_PATTERNS = 32;
+const int FANOUT_PATTERN_SIZE = 32;
+// longest line handed to the fanout thread, a MARKET_DELTA snapshot in hex
+// with the indicators after it
+const int FANOUT_LINE_SIZE = 2 * DEPTH_DELTA_MAX_FRAME + 192;
+// default records queued between the ingest and the fanout thread
+const int FANOUT_QUEUE_SIZE = 16384;
+// default output buffer per subscriber
+const int FANOUT_CLIENT_BUFFER = 256 * 1024;
+
+// one MARKET, MARKET_DELTA or FOR_QUOTE line on its way to the fanout
+// thread
+struct FanoutRecord
+{
+    unsigned long long nQueuedAt;
+    int nLength;
+    char chLine[FANOUT_LINE_SIZE];
+};
+
+struct FanoutClient
+{
+    int fd;
+    // a full buffer conflates to the latest line per instrument, or
+    // disconnects the subscriber
+    bool bConflate;
+    bool bWriting;
+    // lines not yet sent: pOut[nSent, nOut), the buffer never grows
+    char *pOut;
+    int nOut;
+    int nSent;
+    // late join snapshot, sent ahead of pOut: pSnapshot[nSnapshotSent,
+    // nSnapshot), allocated per subscribe and freed once sent; it starts
+    // with what pOut still held when it was taken
+    char *pSnapshot;
+    int nSnapshot;
+    int nSnapshotSent;
+    // instruments whose latest line is owed, one bit per slot
+    unsigned long long *pDirty;
+    int nDirty;
+    int nPatterns;
+    char chPatterns[FANOUT_MAX_PATTERNS][FANOUT_PATTERN_SIZE];
+    // partial command line
+    int nIn;
+    char chIn[256];
+    unsigned long long nLines;
+    unsigned long long nConflated;
+};
+
+// TCP tick stream for strategy clients, fed by the ingest server.
+//
+// A subscriber connects to the fanout port and sends '\n' terminated
+// commands, nothing is answered:
+//   FCSUBSCRIBE|pattern[|pattern...]
+//   FCUNSUBSCRIBE[|pattern...]      every pattern when none is given
+//   FCSLOW|conflate or FCSLOW|disconnect
+// A pattern with * ? or [ is a glob on the InstrumentID, letters only are
+// a product (cu matches cu1501, any case, as shard_products), anything
+// else is one InstrumentID. It then reads FCMESSAGE_TYPE_MARKET lines of
+// the instruments subscribed; MARKET_DELTA records are decoded and sent
+// as the MARKET line they stand for, with the indicators they carry.
+// FCMESSAGE_TYPE_FOR_QUOTE lines, requests for quote, go to the same
+// subscribers of their instrument, in order with its ticks.
+//
+// A subscribe that adds instruments which have ticked is answered with
+// their latest lines first, so a late joiner is complete at once:
+//   FCMESSAGE_TYPE_SNAPSHOT|seq|count
+//   count MARKET lines
+//   FCMESSAGE_TYPE_SNAPSHOT_END|seq
+// seq numbers the ticks the fanout has taken in; the snapshot is the
+// state after tick seq and the live lines that follow are the ticks after
+// it, none missing or repeated, as both come from the fanout thread.
+// Conflation, below, can still merge them for a slow subscriber.
+//
+// As a sink, onRecord() only copies the tick line into a ring and flush()
+// wakes the fanout thread, so the ingest thread never waits for a
+// subscriber; a full ring drops the tick and counts it.
+//
+// The fanout thread owns everything else. Each instrument slot has a mask
+// of its subscribers, built when a subscription or a new instrument comes
+// in, so a tick costs one copy per subscriber in the mask and nothing for
+// the others. Every subscriber has a fixed output buffer; when a slow one
+// fills it the default is to conflate: the instrument is marked owed and
+// its latest line is sent once there is room, so the subscriber sees every
+// instrument's last state without its backlog growing. With
+// FCSLOW|disconnect it is closed instead. A request for quote is an event,
+// not the instrument's state: it is neither conflated nor in a snapshot,
+// and a full buffer drops it for a conflating subscriber. Lines of a batch
+// go out with one send() per subscriber.
+class FanoutServer : public IngestSink
+{
+public:
+    FanoutServer();
+    virtual ~FanoutServer();
+
+    // open the port and allocate the subscribers; nQueue records between
+    // the threads, nClientBuffer bytes per subscriber, bConflate the slow
+    // subscriber default
+    bool listen(int nPort, int nQueue, int nClientBuffer, bool bConflate);
+
+    // the fanout thread, after listen() and ServiceControl::install()
+    bool start();
+    void stop();
+
+    virtual void onRecord(const FCMessage &msg, const char *pUuid);
+    virtual void flush();
+
+    unsigned long long accepted() const { return m_nAccepted; }
+    unsigned long long lines() const { return m_nLines; }
+    unsigned long long conflated() const { return m_nConflated; }
+    unsigned long long slowClosed() const { return m_nSlowClosed; }
+    unsigned long long dropped() const { return m_nDropped; }
+    unsigned long long snapshots() const { return m_nSnapshots; }
+    unsigned long long forQuoteDropped() const { return m_nForQuoteDropped; }
+
+private:
+    static void *threadMain(void *pArg);
+    void serve();
+    void acceptAll();
+    void readFrom(FanoutClient *pClient);
+    void handleCommand(FanoutClient *pClient, char *pLine, int nLength);
+    int updateMasks(FanoutClient *pClient);
+    void sendSnapshot(FanoutClient *pClient, int nJoined);
+    void addInstrument(int nSlot);
+    void publish(const FanoutRecord &record);
+    bool append(FanoutClient *pClient, int nSlot);
+    bool appendForQuote(FanoutClient *pClient, const char *pLine, int nLength);
+    bool room(FanoutClient *pClient, int nLength);
+    void closeSlow(FanoutClient *pClient);
+    void refill(FanoutClient *pClient);
+    bool sendAll(FanoutClient *pClient, const char *pBuf, int &nSent, int nEnd);
+    void writeTo(FanoutClient *pClient);
+    void setWriting(FanoutClient *pClient, bool bWriting);
+    void closeClient(FanoutClient *pClient);
+
+    // ingest thread
+    TickRing<FanoutRecord> *m_pRing;
+    FanoutRecord m_record;
+    bool m_bPushed;
+
+    // fanout thread
+    Socket m_listener;
+    int m_nEpoll;
+    int m_nWake;
+    pthread_t m_thread;
+    bool m_bRunning;
+    volatile bool m_bStop;
+    int m_nClientBuffer;
+    bool m_bConflate;
+    FanoutClient *m_pClients;
+    int *m_pFree;
+    int m_nFree;
+    // subscribers with lines added in the current batch
+    unsigned long long m_nActive[FANOUT_MASK_WORDS];
+    InstrumentIndex m_index;
+    DepthDeltaDecoder m_decoder;
+    // per instrument slot: subscriber mask and latest MARKET line
+    unsigned long long (*m_pMasks)[FANOUT_MASK_WORDS];
+    char (*m_pLines)[LAST_MARKET_LINE_SIZE];
+    int *m_pLength;
+    // ticks taken in, the snapshots' sequence
+    unsigned long long m_nSeq;
+    // slots a subscribe has just added
+    int *m_pJoined;
+
+    unsigned long long m_nAccepted;
+    unsigned long long m_nLines;
+    unsigned long long m_nConflated;
+    unsigned long long m_nSlowClosed;
+    unsigned long long m_nDropped;
+    unsigned long long m_nSnapshots;
+    // requests for quote a full subscriber buffer dropped
+    unsigned long long m_nForQuoteDropped;
+};
+
+#endif
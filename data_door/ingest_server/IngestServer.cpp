@@ -0,0 +1,411 @@
+// IngestServer.cpp : epoll server for the FCMESSAGE protocol.
+//
+#include "IngestServer.h"
+#include "../common/ServiceControl.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// epoll tags below the connection numbers
+enum
+{
+    TAG_LISTENER,
+    TAG_SIGNAL,
+    TAG_CONSOLE,
+    TAG_CONNECTION
+};
+
+// initial reply buffer per connection, a record's reply is 37 bytes
+const int INGEST_OUT_BUFFER = 4096;
+
+// events handled per epoll_wait()
+const int INGEST_MAX_EVENTS = 256;
+
+IngestServer::IngestServer() : m_nEpoll(-1), m_pConnections(NULL), m_pFree(NULL), m_nFree(0), m_nSinks(0),
+    m_nRecords(0), m_nQueries(0), m_nInvalid(0), m_nAccepted(0), m_nDuplicates(0)
+{
+}
+
+IngestServer::~IngestServer()
+{
+    if (m_pConnections != NULL)
+    {
+        for (int i = 0; i < INGEST_MAX_CONNECTIONS; i++)
+        {
+            if (m_pConnections[i].fd >= 0)
+                close(m_pConnections[i].fd);
+            free(m_pConnections[i].pOut);
+        }
+        free(m_pConnections);
+    }
+    free(m_pFree);
+    if (m_nEpoll >= 0)
+        close(m_nEpoll);
+}
+
+bool IngestServer::addSink(IngestSink *pSink)
+{
+    if (m_nSinks == INGEST_MAX_SINKS)
+        return false;
+    m_sinks[m_nSinks++] = pSink;
+    return true;
+}
+
+bool IngestServer::listen(int nPort)
+{
+    if (!m_listener.create() || !m_listener.bind(nPort) || !m_listener.listen(INGEST_LISTEN_BACKLOG))
+        return false;
+    m_listener.set_non_blocking(true);
+
+    m_nEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (m_nEpoll < 0)
+        return false;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = TAG_LISTENER;
+    if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_listener.handle(), &ev) != 0)
+        return false;
+
+    m_pConnections = (IngestConnection *)calloc(INGEST_MAX_CONNECTIONS, sizeof(IngestConnection));
+    m_pFree = (int *)malloc(sizeof(int) * INGEST_MAX_CONNECTIONS);
+    if (m_pConnections == NULL || m_pFree == NULL)
+        return false;
+    for (int i = 0; i < INGEST_MAX_CONNECTIONS; i++)
+    {
+        IngestConnection *pConn = &m_pConnections[i];
+        pConn->fd = -1;
+        pConn->pOut = (char *)malloc(INGEST_OUT_BUFFER);
+        pConn->nOutSize = pConn->pOut != NULL ? INGEST_OUT_BUFFER : 0;
+        // handed out lowest first
+        m_pFree[i] = INGEST_MAX_CONNECTIONS - 1 - i;
+    }
+    m_nFree = INGEST_MAX_CONNECTIONS;
+    return true;
+}
+
+int IngestServer::replay(const char *pJournal)
+{
+    FILE *fp = fopen(pJournal, "r");
+    if (fp == NULL)
+        return -1;
+    int nRecords = 0;
+    char *pLine = NULL;
+    size_t nSize = 0;
+    ssize_t nLength;
+    while ((nLength = getline(&pLine, &nSize, fp)) > 0)
+    {
+        // "uuid|line\n", a torn last line is skipped
+        if (pLine[nLength - 1] != '\n' || nLength < UUID_TEXT_LENGTH + 2 || pLine[UUID_TEXT_LENGTH] != '|')
+            continue;
+        FCMessage msg;
+        if (!msg.parse(pLine + UUID_TEXT_LENGTH + 1, nLength - UUID_TEXT_LENGTH - 2))
+            continue;
+        MessageId id;
+        if (id.parse(pLine))
+            m_filter.seen(id);
+        for (int i = 0; i < m_nSinks; i++)
+            m_sinks[i]->onRecord(msg, pLine);
+        nRecords++;
+    }
+    free(pLine);
+    fclose(fp);
+    for (int i = 0; i < m_nSinks; i++)
+        m_sinks[i]->flush();
+    return nRecords;
+}
+
+void IngestServer::reopen()
+{
+    for (int i = 0; i < m_nSinks; i++)
+        m_sinks[i]->reopen();
+}
+
+int IngestServer::run(bool bConsole)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = TAG_SIGNAL;
+    epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, ServiceControl::fd(), &ev);
+    ev.data.u64 = TAG_CONSOLE;
+    // stdin redirected from a file cannot be polled, signals only then
+    if (bConsole && epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, STDIN_FILENO, &ev) != 0)
+        bConsole = false;
+
+    int nResult = -1;
+    struct epoll_event events[INGEST_MAX_EVENTS];
+    while (nResult < 0)
+    {
+        int n = epoll_wait(m_nEpoll, events, INGEST_MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            FC_LOG(LOG_LEVEL_ERROR, "epoll_wait failed, errno %d\n", errno);
+            nResult = SERVICE_STOP;
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            unsigned long long nTag = events[i].data.u64;
+            if (nTag == TAG_LISTENER)
+                acceptAll();
+            else if (nTag == TAG_SIGNAL)
+                nResult = ServiceControl::check();
+            else if (nTag == TAG_CONSOLE)
+            {
+                char chLine[256];
+                if (fgets(chLine, sizeof(chLine), stdin) != NULL)
+                    nResult = SERVICE_STOP;
+                else
+                    epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+            }
+            else
+            {
+                IngestConnection *pConn = &m_pConnections[nTag - TAG_CONNECTION];
+                if (pConn->fd < 0)
+                    continue;
+                if (events[i].events & EPOLLOUT)
+                {
+                    if (!writeTo(pConn))
+                        continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    readFrom(pConn);
+            }
+        }
+        for (int i = 0; i < m_nSinks; i++)
+            m_sinks[i]->flush();
+    }
+
+    epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, ServiceControl::fd(), NULL);
+    if (bConsole)
+        epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+    return nResult;
+}
+
+void IngestServer::acceptAll()
+{
+    for (;;)
+    {
+        int fd = accept4(m_listener.handle(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                FC_LOG(LOG_LEVEL_WARN, "accept failed, errno %d\n", errno);
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (m_nFree == 0)
+        {
+            FC_LOG(LOG_LEVEL_WARN, "%d connections open, refusing another\n", INGEST_MAX_CONNECTIONS);
+            close(fd);
+            continue;
+        }
+        // replies are small and must not wait for Nagle
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        int nIndex = m_pFree[--m_nFree];
+        IngestConnection *pConn = &m_pConnections[nIndex];
+        pConn->fd = fd;
+        pConn->nIn = 0;
+        pConn->nOut = 0;
+        pConn->nSent = 0;
+        pConn->bWriting = false;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = TAG_CONNECTION + nIndex;
+        if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            closeConnection(pConn);
+            continue;
+        }
+        m_nAccepted++;
+    }
+}
+
+void IngestServer::closeConnection(IngestConnection *pConn)
+{
+    // close() drops the descriptor from the epoll set
+    close(pConn->fd);
+    pConn->fd = -1;
+    m_pFree[m_nFree++] = pConn - m_pConnections;
+}
+
+bool IngestServer::reserve(IngestConnection *pConn, int nBytes)
+{
+    if (pConn->nOut + nBytes <= pConn->nOutSize)
+        return true;
+    if (pConn->nSent > 0)
+    {
+        memmove(pConn->pOut, pConn->pOut + pConn->nSent, pConn->nOut - pConn->nSent);
+        pConn->nOut -= pConn->nSent;
+        pConn->nSent = 0;
+        if (pConn->nOut + nBytes <= pConn->nOutSize)
+            return true;
+    }
+    int nSize = pConn->nOutSize * 2;
+    while (nSize < pConn->nOut + nBytes)
+        nSize *= 2;
+    char *p = (char *)realloc(pConn->pOut, nSize);
+    if (p == NULL)
+        return false;
+    pConn->pOut = p;
+    pConn->nOutSize = nSize;
+    return true;
+}
+
+void IngestServer::handleLine(IngestConnection *pConn, const char *pLine, int nLength)
+{
+    // "id|line" from a publisher stamping its own ids
+    MessageId id;
+    const char *pClientId = NULL;
+    if (nLength > UUID_TEXT_LENGTH && pLine[UUID_TEXT_LENGTH] == '|' && id.parse(pLine))
+    {
+        pClientId = pLine;
+        pLine += UUID_TEXT_LENGTH + 1;
+        nLength -= UUID_TEXT_LENGTH + 1;
+    }
+
+    FCMessage msg;
+    if (!msg.parse(pLine, nLength))
+    {
+        // the Java listener sent nothing and closed, which leaves a
+        // pipelining client unable to pair its replies
+        m_nInvalid++;
+        if (reserve(pConn, sizeof(FCMESSAGE_NO_UUID)))
+        {
+            memcpy(pConn->pOut + pConn->nOut, FCMESSAGE_NO_UUID "\n", sizeof(FCMESSAGE_NO_UUID));
+            pConn->nOut += sizeof(FCMESSAGE_NO_UUID);
+        }
+        return;
+    }
+
+    if (msg.nType == FCQUERY_ALL_INSTRUMENTS || msg.nType == FCQUERY_LAST_MARKET)
+    {
+        m_nQueries++;
+        if (!reserve(pConn, INGEST_MAX_REPLY + 1))
+            return;
+        char *pReply = pConn->pOut + pConn->nOut;
+        int nReply = -1;
+        for (int i = 0; i < m_nSinks && nReply < 0; i++)
+            nReply = m_sinks[i]->answer(msg, pReply);
+        // no sink knows the query: an empty line
+        if (nReply < 0)
+            nReply = 0;
+        pReply[nReply] = '\n';
+        pConn->nOut += nReply + 1;
+        return;
+    }
+
+    if (!reserve(pConn, UUID_TEXT_LENGTH + 1))
+        return;
+    char *pUuid = pConn->pOut + pConn->nOut;
+    if (pClientId != NULL)
+        memcpy(pUuid, pClientId, UUID_TEXT_LENGTH);
+    else
+        m_uuid.next(pUuid);
+    pUuid[UUID_TEXT_LENGTH] = '\n';
+    pConn->nOut += UUID_TEXT_LENGTH + 1;
+    // a resend of a record already taken: acknowledged, not stored twice
+    if (pClientId != NULL && m_filter.seen(id))
+    {
+        m_nDuplicates++;
+        return;
+    }
+    for (int i = 0; i < m_nSinks; i++)
+        m_sinks[i]->onRecord(msg, pUuid);
+    m_nRecords++;
+}
+
+void IngestServer::readFrom(IngestConnection *pConn)
+{
+    ssize_t n = recv(pConn->fd, pConn->chIn + pConn->nIn, INGEST_LINE_BUFFER - pConn->nIn, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    unsigned long long t = latency_now();
+    bool bEof = n <= 0;
+    if (n > 0)
+        pConn->nIn += n;
+
+    char *p = pConn->chIn;
+    char *pEnd = pConn->chIn + pConn->nIn;
+    char *pNewline;
+    while ((pNewline = (char *)memchr(p, '\n', pEnd - p)) != NULL)
+    {
+        handleLine(pConn, p, pNewline - p);
+        LatencyStats::record(LAT_INGEST_LINE, latency_now() - t);
+        p = pNewline + 1;
+    }
+    pConn->nIn = pEnd - p;
+    if (p != pConn->chIn && pConn->nIn > 0)
+        memmove(pConn->chIn, p, pConn->nIn);
+
+    if (bEof)
+    {
+        // a last line without its newline counts, as readLine() had it
+        if (n == 0 && pConn->nIn > 0)
+            handleLine(pConn, pConn->chIn, pConn->nIn);
+        if (pConn->nOut > pConn->nSent)
+            send(pConn->fd, pConn->pOut + pConn->nSent, pConn->nOut - pConn->nSent, MSG_NOSIGNAL);
+        closeConnection(pConn);
+        return;
+    }
+    if (pConn->nIn == INGEST_LINE_BUFFER)
+    {
+        FC_LOG(LOG_LEVEL_WARN, "line longer than %d bytes, closing the connection\n", INGEST_LINE_BUFFER);
+        closeConnection(pConn);
+        return;
+    }
+    writeTo(pConn);
+}
+
+bool IngestServer::writeTo(IngestConnection *pConn)
+{
+    while (pConn->nSent < pConn->nOut)
+    {
+        ssize_t n = send(pConn->fd, pConn->pOut + pConn->nSent, pConn->nOut - pConn->nSent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                closeConnection(pConn);
+                return false;
+            }
+            // the client reads slower than it sends: stop reading from it
+            // until its replies are out, its buffer does not grow
+            if (!pConn->bWriting)
+            {
+                struct epoll_event ev;
+                ev.events = EPOLLOUT;
+                ev.data.u64 = TAG_CONNECTION + (pConn - m_pConnections);
+                epoll_ctl(m_nEpoll, EPOLL_CTL_MOD, pConn->fd, &ev);
+                pConn->bWriting = true;
+            }
+            return true;
+        }
+        pConn->nSent += n;
+    }
+    pConn->nOut = 0;
+    pConn->nSent = 0;
+    if (pConn->bWriting)
+    {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = TAG_CONNECTION + (pConn - m_pConnections);
+        epoll_ctl(m_nEpoll, EPOLL_CTL_MOD, pConn->fd, &ev);
+        pConn->bWriting = false;
+    }
+    return true;
+}
@@ -0,0 +1,104 @@
+#ifndef __INGEST_SERVER_H__
+#define __INGEST_SERVER_H__
+
+#include "Socket.h"
+#include "IngestSinks.h"
+#include "../common/UuidGenerator.h"
+#include "../common/MessageId.h"
+
+// connections served at once, the pool is allocated up front
+const int INGEST_MAX_CONNECTIONS = 1024;
+// read buffer per connection, a longer line closes the connection
+const int INGEST_LINE_BUFFER = 16384;
+const int INGEST_MAX_SINKS = 8;
+// pending connections the kernel queues for accept()
+const int INGEST_LISTEN_BACKLOG = 1024;
+
+struct IngestConnection
+{
+    int fd;
+    // bytes in chIn, a partial line after a read
+    int nIn;
+    // replies not yet sent: pOut[nSent, nOut), grown when a query needs it
+    char *pOut;
+    int nOut;
+    int nSent;
+    int nOutSize;
+    bool bWriting;
+    char chIn[INGEST_LINE_BUFFER];
+};
+
+// Native replacement of the Java FCRequestListener on port 9999.
+//
+// The wire protocol is unchanged: a client sends '\n' terminated FCMESSAGE
+// lines and gets one reply line per line, in order: a fresh uuid for a
+// record, the answer for a query, "NO_UUID" for an unknown type. Both
+// kinds of client are served: the servants' connect, send one line, read
+// the reply and close, and persistent connections pipelining any number
+// of lines.
+//
+// A publisher may stamp its own ids, sending "id|line" with a version 8
+// MessageId (see IngestClient). The reply echoes the id, and a record
+// whose id was seen before is acknowledged again but not handed to the
+// sinks, so resending after a lost connection is safe.
+//
+// One thread, one epoll set: the listening socket, every connection and
+// the ServiceControl signalfd. All lines read from a connection in one
+// round are parsed in place, handed to the sinks and answered with a
+// single send; the sinks flush once per round. Connections come from a
+// pool preallocated at listen(), so steady state serving does not touch
+// the heap.
+class IngestServer
+{
+public:
+    IngestServer();
+    ~IngestServer();
+
+    // sinks are called in the order added and not owned
+    bool addSink(IngestSink *pSink);
+
+    bool listen(int nPort);
+
+    // feed the records of a journal written by JournalSink to the sinks
+    // added so far, and their client ids to the duplicate filter; returns
+    // their count or -1 when the file cannot be read
+    int replay(const char *pJournal);
+
+    // serve until a control signal arrives or, with bConsole, a line is
+    // read from stdin; SERVICE_STOP or SERVICE_RELOAD
+    int run(bool bConsole);
+
+    // SIGHUP: reopen the sinks' files
+    void reopen();
+
+    unsigned long long records() const { return m_nRecords; }
+    unsigned long long queries() const { return m_nQueries; }
+    unsigned long long invalid() const { return m_nInvalid; }
+    unsigned long long accepted() const { return m_nAccepted; }
+    unsigned long long duplicates() const { return m_nDuplicates; }
+
+private:
+    void acceptAll();
+    void readFrom(IngestConnection *pConn);
+    bool writeTo(IngestConnection *pConn);
+    void closeConnection(IngestConnection *pConn);
+    void handleLine(IngestConnection *pConn, const char *pLine, int nLength);
+    bool reserve(IngestConnection *pConn, int nBytes);
+
+    Socket m_listener;
+    int m_nEpoll;
+    IngestConnection *m_pConnections;
+    int *m_pFree;
+    int m_nFree;
+    IngestSink *m_sinks[INGEST_MAX_SINKS];
+    int m_nSinks;
+    UuidGenerator m_uuid;
+    MessageIdFilter m_filter;
+    unsigned long long m_nRecords;
+    unsigned long long m_nQueries;
+    unsigned long long m_nInvalid;
+    unsigned long long m_nAccepted;
+    unsigned long long m_nDuplicates;
+};
+
+#endif
@@ -0,0 +1,170 @@
+// IngestSinks.cpp : journal, instrument table and last value sinks of the ingest server.
+//
+#include "IngestSinks.h"
+#include "../common/UuidGenerator.h"
+#include "../common/AsyncLogger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+JournalSink::JournalSink() : m_fd(-1), m_pFile(NULL), m_nBuffered(0), m_nWritten(0)
+{
+    m_pBuffer = (char *)malloc(JOURNAL_BUFFER_SIZE);
+}
+
+JournalSink::~JournalSink()
+{
+    flush();
+    if (m_fd >= 0)
+        close(m_fd);
+    free(m_pFile);
+    free(m_pBuffer);
+}
+
+bool JournalSink::open(const char *pFile)
+{
+    int fd = ::open(pFile, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = fd;
+    if (m_pFile != pFile)
+    {
+        free(m_pFile);
+        m_pFile = strdup(pFile);
+    }
+    return true;
+}
+
+void JournalSink::onRecord(const FCMessage &msg, const char *pUuid)
+{
+    int nRecord = UUID_TEXT_LENGTH + 1 + msg.nLength + 1;
+    if (m_nBuffered + nRecord > JOURNAL_BUFFER_SIZE)
+        flush();
+    if (nRecord > JOURNAL_BUFFER_SIZE)
+        return;
+    char *p = m_pBuffer + m_nBuffered;
+    memcpy(p, pUuid, UUID_TEXT_LENGTH);
+    p[UUID_TEXT_LENGTH] = '|';
+    memcpy(p + UUID_TEXT_LENGTH + 1, msg.pLine, msg.nLength);
+    p[nRecord - 1] = '\n';
+    m_nBuffered += nRecord;
+}
+
+void JournalSink::flush()
+{
+    int nDone = 0;
+    while (nDone < m_nBuffered && m_fd >= 0)
+    {
+        ssize_t n = write(m_fd, m_pBuffer + nDone, m_nBuffered - nDone);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // the replies are already out, losing the journal is logged
+            FC_LOG(LOG_LEVEL_ERROR, "journal write failed, errno %d, %d bytes dropped\n", errno, m_nBuffered - nDone);
+            break;
+        }
+        nDone += n;
+    }
+    m_nWritten += nDone;
+    m_nBuffered = 0;
+}
+
+void JournalSink::reopen()
+{
+    flush();
+    if (m_pFile != NULL && !open(m_pFile))
+        FC_LOG(LOG_LEVEL_ERROR, "cannot reopen journal %s, errno %d\n", m_pFile, errno);
+}
+
+void InstrumentTableSink::onRecord(const FCMessage &msg, const char *pUuid)
+{
+    if (msg.nType != FCMESSAGE_INSTRUMENT)
+        return;
+    char chID[32];
+    if (*msg.field(msg.instrumentField(), chID, sizeof(chID)) != '\0')
+        m_index.insert(chID);
+}
+
+int InstrumentTableSink::answer(const FCMessage &msg, char *pBuf)
+{
+    if (msg.nType != FCQUERY_ALL_INSTRUMENTS)
+        return -1;
+    // "id id id ", the trailing blank as the Java listener sent it
+    int nLength = 0;
+    for (int i = 0; i < m_index.count(); i++)
+    {
+        const char *pID = m_index.name(i);
+        int n = strlen(pID);
+        memcpy(pBuf + nLength, pID, n);
+        pBuf[nLength + n] = ' ';
+        nLength += n + 1;
+    }
+    return nLength;
+}
+
+LastValueSink::LastValueSink()
+{
+    m_pLines = (char (*)[LAST_MARKET_LINE_SIZE])malloc(sizeof(*m_pLines) * MAX_INSTRUMENTS);
+    m_pLength = (int *)calloc(MAX_INSTRUMENTS, sizeof(int));
+}
+
+LastValueSink::~LastValueSink()
+{
+    free(m_pLines);
+    free(m_pLength);
+}
+
+void LastValueSink::store(const char *pInstrumentID, const char *pLine, int nLength)
+{
+    int nSlot = m_index.insert(pInstrumentID);
+    if (nSlot < 0 || nLength > LAST_MARKET_LINE_SIZE)
+        return;
+    memcpy(m_pLines[nSlot], pLine, nLength);
+    m_pLength[nSlot] = nLength;
+}
+
+void LastValueSink::onRecord(const FCMessage &msg, const char *pUuid)
+{
+    if (msg.nType == FCMESSAGE_MARKET)
+    {
+        char chID[32];
+        if (*msg.field(msg.instrumentField(), chID, sizeof(chID)) != '\0')
+            store(chID, msg.pLine, msg.nLength);
+    }
+    else if (msg.nType == FCMESSAGE_MARKET_DELTA && msg.nFields > 1)
+    {
+        char frame[DEPTH_DELTA_MAX_FRAME];
+        int nFrame = depth_delta_from_hex(msg.pField[1], msg.nFieldLength[1], frame, sizeof(frame));
+        CThostFtdcDepthMarketDataField tick;
+        int nConsumed;
+        if (nFrame <= 0 || m_decoder.decode(frame, nFrame, &tick, &nConsumed) != 0)
+            return;
+        char chLine[LAST_MARKET_LINE_SIZE];
+        int nLength = fc_format_market(&tick, chLine, sizeof(chLine));
+        if (nLength > 0)
+        {
+            int nMore = fc_append_fields(msg, 2, chLine + nLength, sizeof(chLine) - nLength);
+            nLength = nMore < 0 ? -1 : nLength + nMore;
+        }
+        if (nLength > 0)
+            store(tick.InstrumentID, chLine, nLength);
+    }
+}
+
+int LastValueSink::answer(const FCMessage &msg, char *pBuf)
+{
+    if (msg.nType != FCQUERY_LAST_MARKET)
+        return -1;
+    char chID[32];
+    int nSlot = m_index.find(msg.field(msg.instrumentField(), chID, sizeof(chID)));
+    // an instrument not seen yet gets an empty line
+    if (nSlot < 0)
+        return 0;
+    memcpy(pBuf, m_pLines[nSlot], m_pLength[nSlot]);
+    return m_pLength[nSlot];
+}
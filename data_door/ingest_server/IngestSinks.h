@@ -0,0 +1,106 @@
+#ifndef __INGEST_SINKS_H__
+#define __INGEST_SINKS_H__
+
+#include "../common/FCMessage.h"
+#include "../common/InstrumentIndex.h"
+#include "../common/DepthDeltaCodec.h"
+
+// A consumer of the records the ingest server accepts.
+//
+// Every sink is called on the server's thread: onRecord() for each
+// INSTRUMENT, MARKET, MARKET_DELTA, ORDER and TRADE line, with the id the
+// client is sent back, then flush() once the batch read in one epoll round
+// is done. answer() is offered the query lines; the first sink returning a
+// length answers it.
+class IngestSink
+{
+public:
+    virtual ~IngestSink() {}
+
+    // pUuid is UUID_TEXT_LENGTH characters, not terminated
+    virtual void onRecord(const FCMessage &msg, const char *pUuid) = 0;
+
+    // end of a batch
+    virtual void flush() {}
+
+    // SIGHUP, e.g. after the journal was rotated
+    virtual void reopen() {}
+
+    // reply to a query into pBuf, INGEST_MAX_REPLY bytes, without the
+    // newline: its length, -1 when the query is not this sink's
+    virtual int answer(const FCMessage &msg, char *pBuf) { return -1; }
+};
+
+// room for the longest query reply, every InstrumentID and a blank
+const int INGEST_MAX_REPLY = MAX_INSTRUMENTS * 32;
+
+// journal write buffer; a batch larger than this is written in pieces
+const int JOURNAL_BUFFER_SIZE = 1 << 20;
+
+// Appends "uuid|line" per record to a file, the replacement of the Mongo
+// collections: one write() per batch instead of one insert per message.
+// IngestServer::replay() reads it back into the other sinks at startup.
+class JournalSink : public IngestSink
+{
+public:
+    JournalSink();
+    virtual ~JournalSink();
+
+    // append to pFile, created when missing
+    bool open(const char *pFile);
+
+    virtual void onRecord(const FCMessage &msg, const char *pUuid);
+    virtual void flush();
+    virtual void reopen();
+
+    unsigned long long bytesWritten() const { return m_nWritten; }
+
+private:
+    int m_fd;
+    char *m_pFile;
+    char *m_pBuffer;
+    int m_nBuffered;
+    unsigned long long m_nWritten;
+};
+
+// InstrumentIDs seen in INSTRUMENT records, answering
+// FCQUERY_ALL_INSTRUMENTS with them separated by blanks, the list
+// servant_market subscribes.
+class InstrumentTableSink : public IngestSink
+{
+public:
+    virtual void onRecord(const FCMessage &msg, const char *pUuid);
+    virtual int answer(const FCMessage &msg, char *pBuf);
+
+    int count() const { return m_index.count(); }
+
+private:
+    InstrumentIndex m_index;
+};
+
+// longest MARKET line kept per instrument
+const int LAST_MARKET_LINE_SIZE = 512;
+
+// Latest MARKET line per instrument, answering
+// "FCQUERY_LAST_MARKET|InstrumentID" with it, an empty line when the
+// instrument has not ticked. MARKET_DELTA frames are decoded and stored as
+// the MARKET line they stand for, the indicators kept.
+class LastValueSink : public IngestSink
+{
+public:
+    LastValueSink();
+    virtual ~LastValueSink();
+
+    virtual void onRecord(const FCMessage &msg, const char *pUuid);
+    virtual int answer(const FCMessage &msg, char *pBuf);
+
+private:
+    void store(const char *pInstrumentID, const char *pLine, int nLength);
+
+    InstrumentIndex m_index;
+    DepthDeltaDecoder m_decoder;
+    char (*m_pLines)[LAST_MARKET_LINE_SIZE];
+    int *m_pLength;
+};
+
+#endif
@@ -0,0 +1,54 @@
+// Definition of the Socket class
+#ifndef Socket_class
+#define Socket_class
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <string>
+#include <arpa/inet.h>
+
+const int MAXHOSTNAME = 200;
+const int MAXCONNECTIONS = 5;
+const int MAXRECV = 500;
+
+class Socket
+{
+ public:
+  Socket();
+  virtual ~Socket();
+
+  // Server initialization
+  bool create();
+  bool bind ( const int port );
+  bool listen() const;
+  bool listen ( const int backlog ) const;
+  bool accept ( Socket& ) const;
+
+  // Client initialization
+  bool connect ( const std::string host, const int port );
+
+  // Data Transimission
+  bool send ( const std::string ) const;
+  int recv ( std::string& ) const;
+
+
+  void set_non_blocking ( const bool );
+
+  bool is_valid() const { return m_sock != -1; }
+
+  // descriptor for poll/epoll, the socket keeps owning it
+  int handle() const { return m_sock; }
+
+ private:
+
+  int m_sock;
+  sockaddr_in m_addr;
+
+
+};
+
+
+#endif
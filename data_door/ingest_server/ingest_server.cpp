@@ -0,0 +1,186 @@
+// ingest_server.cpp : FCMESSAGE ingest server, the native FCRequestListener.
+//
+#include "IngestServer.h"
+#include "IngestSinks.h"
+#include "FanoutServer.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include "../common/ThreadTopology.h"
+#include "../common/ServiceControl.h"
+#include "../common/ServiceConfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char* argv[])
+{
+    // -port port: listen there, default the ingest_port key or 9999
+    // -journal file: append every record there and read it back at
+    // startup, default the journal key, none when unset
+    // -fanout port: serve the ticks to subscribers there, default the
+    // fanout_port key, none when unset
+    // -stats file / -statsport port: latency histograms every 10s to the
+    // file and on request on 127.0.0.1:port
+    // -topology file: cpu and scheduling placement of the threads
+    // -config file, -instance name: settings, see ServiceConfig.h
+    // -daemon: detach and run in the background, -pidfile file: its pid
+    // -log file: log there instead of stdout
+    // SIGTERM or SIGINT exit, SIGHUP reopens the log and the journal
+    int nPort = 0;
+    const char *pJournal = NULL;
+    int nFanoutPort = 0;
+    const char *pStatsFile = NULL;
+    int nStatsPort = 0;
+    bool bDaemon = false;
+    const char *pPidFile = NULL;
+    const char *pLogFile = NULL;
+    const char *pTopologyFile = NULL;
+    const char *pInstance = NULL;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-port") == 0 && a + 1 < argc)
+            nPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-journal") == 0 && a + 1 < argc)
+            pJournal = argv[++a];
+        else if (strcmp(argv[a], "-fanout") == 0 && a + 1 < argc)
+            nFanoutPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-stats") == 0 && a + 1 < argc)
+            pStatsFile = argv[++a];
+        else if (strcmp(argv[a], "-statsport") == 0 && a + 1 < argc)
+            nStatsPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-topology") == 0 && a + 1 < argc)
+            pTopologyFile = argv[++a];
+        else if (strcmp(argv[a], "-config") == 0 && a + 1 < argc && !ServiceConfig::load(argv[++a]))
+            printf("cannot read config %s\n", argv[a]);
+        else if (strcmp(argv[a], "-instance") == 0 && a + 1 < argc)
+            pInstance = argv[++a];
+        else if (strcmp(argv[a], "-daemon") == 0)
+            bDaemon = true;
+        else if (strcmp(argv[a], "-pidfile") == 0 && a + 1 < argc)
+            pPidFile = argv[++a];
+        else if (strcmp(argv[a], "-log") == 0 && a + 1 < argc)
+            pLogFile = argv[++a];
+    }
+    ServiceConfig::setInstance(pInstance);
+    if (nPort == 0)
+        nPort = ServiceConfig::getInt("ingest_port", 9999);
+    if (pJournal == NULL)
+        pJournal = ServiceConfig::get("journal");
+    if (nFanoutPort == 0)
+        nFanoutPort = ServiceConfig::getInt("fanout_port", 0);
+    if (pTopologyFile == NULL)
+        pTopologyFile = ServiceConfig::get("topology");
+    if (pTopologyFile != NULL && !ThreadTopology::load(pTopologyFile))
+        printf("cannot read thread topology %s\n", pTopologyFile);
+
+    // the sinks and the instrument table replayed from the journal before
+    // the port is opened, the first FCQUERY_ALL_INSTRUMENTS sees them all
+    IngestServer server;
+    InstrumentTableSink *pInstruments = new InstrumentTableSink();
+    LastValueSink *pLastValues = new LastValueSink();
+    JournalSink *pJournalSink = NULL;
+    server.addSink(pInstruments);
+    server.addSink(pLastValues);
+    if (pJournal != NULL)
+    {
+        int nReplayed = server.replay(pJournal);
+        if (nReplayed >= 0)
+            printf("journal %s: %d records, %d instruments\n", pJournal, nReplayed, pInstruments->count());
+        pJournalSink = new JournalSink();
+        if (!pJournalSink->open(pJournal))
+        {
+            printf("cannot open journal %s\n", pJournal);
+            return 1;
+        }
+        server.addSink(pJournalSink);
+    }
+    if (!server.listen(nPort))
+    {
+        printf("cannot listen on port %d\n", nPort);
+        return 1;
+    }
+    FanoutServer *pFanout = NULL;
+    if (nFanoutPort > 0)
+    {
+        const char *pSlow = ServiceConfig::get("fanout_slow");
+        pFanout = new FanoutServer();
+        if (!pFanout->listen(nFanoutPort, ServiceConfig::getInt("fanout_queue", FANOUT_QUEUE_SIZE),
+                             ServiceConfig::getInt("fanout_client_buffer", FANOUT_CLIENT_BUFFER),
+                             pSlow == NULL || strcmp(pSlow, "disconnect") != 0))
+        {
+            printf("cannot listen on fanout port %d\n", nFanoutPort);
+            return 1;
+        }
+    }
+
+    if (bDaemon && !ServiceControl::daemonize(pPidFile))
+    {
+        printf("cannot start as a daemon\n");
+        return 1;
+    }
+    // before the first thread, every thread inherits the blocked signals
+    ServiceControl::install();
+    ThreadTopology::enter(THREAD_MAIN);
+
+    if (!AsyncLogger::start(pLogFile, LOG_LEVEL_INFO))
+    {
+        printf("cannot open log file %s\n", pLogFile);
+        return 1;
+    }
+    AsyncLogger::installLevelSignals();
+
+    if ((pStatsFile != NULL || nStatsPort > 0) && !LatencyStats::startReporter(pStatsFile, nStatsPort, 10))
+        printf("cannot start latency reporter on port %d\n", nStatsPort);
+
+    // the fanout sees the records from here on, not the journal's
+    if (pFanout != NULL)
+    {
+        if (!pFanout->start())
+        {
+            printf("cannot start the fanout thread\n");
+            return 1;
+        }
+        server.addSink(pFanout);
+    }
+
+    // the fanout thread enters as it starts running
+    if (pFanout != NULL)
+        ThreadTopology::waitStarted(THREAD_FANOUT, 1000);
+    char chTopology[2048];
+    ThreadTopology::report(chTopology, sizeof(chTopology));
+    printf("\n%s", chTopology);
+
+    printf("\nlistening on port %d, press return to quit...\n", nPort);
+    FC_LOG(LOG_LEVEL_INFO, "listening on port %d\n", nPort);
+    if (pFanout != NULL)
+        FC_LOG(LOG_LEVEL_INFO, "fanout on port %d\n", nFanoutPort);
+    while (server.run(!bDaemon) == SERVICE_RELOAD)
+    {
+        AsyncLogger::reopen();
+        server.reopen();
+    }
+    ServiceControl::beginStop();
+
+    FC_LOG(LOG_LEVEL_INFO, "%llu connections, %llu records, %llu duplicates, %llu queries, %llu invalid lines\n",
+           server.accepted(), server.records(), server.duplicates(), server.queries(), server.invalid());
+    if (pFanout != NULL)
+    {
+        pFanout->stop();
+        FC_LOG(LOG_LEVEL_INFO, "fanout: %llu subscribers, %llu snapshots, %llu lines, %llu conflated, %llu slow subscribers closed, "
+               "%llu ticks dropped, %llu requests for quote dropped\n", pFanout->accepted(), pFanout->snapshots(), pFanout->lines(),
+               pFanout->conflated(), pFanout->slowClosed(), pFanout->dropped(), pFanout->forQuoteDropped());
+        delete pFanout;
+    }
+    // the journal's last batch is flushed by its destructor
+    delete pJournalSink;
+    delete pLastValues;
+    delete pInstruments;
+
+    LatencyStats::stopReporter();
+
+    // drain the log before exiting
+    AsyncLogger::stop();
+    ServiceControl::exit();
+
+    return 0;
+}
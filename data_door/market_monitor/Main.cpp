@@ -2,9 +2,20 @@
 
 #include "Main.h"
 #include "MarketSubscriber.h"
-#include "event.h"
+#include "../common/event.h"
 #include "ClientSocket.h"
 #include "SocketException.h"
+#include "../common/AsyncLogger.h"
+#include "../common/OrderManager.h"
+#include "../common/LastValueCache.h"
+#include "../common/RiskEngine.h"
+#include "../common/PositionKeeper.h"
+#include "../common/OrderTemplates.h"
+#include "../common/TriggerEngine.h"
+#include "../common/CosManager.h"
+#include "../common/ThreadTopology.h"
+#include "../common/ServiceControl.h"
+#include "../common/ServiceConfig.h"
 #include "../KSTradeAPI/KSTradeAPI.h"
 #include "../KSMarketDataAPI/KSMarketDataAPI.h"
 #include "../CTP/KSCosApiDataType.h"
@@ -31,6 +42,9 @@ using namespace std;
 
 using namespace KingstarAPI;
 
+class CTraderHandler;
+static void loadRiskLimits(CTraderHandler *pSpi, const char *pFile);
+
 class CTraderHandler : public CThostFtdcTraderSpi
 {
 public:
@@ -54,13 +68,176 @@ public:
     // finish event
     HANDLE m_hEvent;
 
+    // orders and trades of the session
+    OrderManager m_orders;
+
+    // latest ticks, fed by the market handler, and the pre-trade checks
+    LastValueCache m_cache;
+    RiskEngine m_risk;
+
+    // positions and PnL, seeded by the position detail query
+    PositionKeeper m_positions;
+    bool m_bPositionQueried;
+
+    // pre-built order insert fields per instrument and flags
+    OrderTemplates m_templates;
+
+    // local stop and price-cross orders, armed from m_pTriggerFile once the
+    // instruments are known
+    TriggerEngine m_triggers;
+    const char *m_pTriggerFile;
+
+    // conditional and stop-loss/take-profit orders held by the broker;
+    // the COS api is loaded at login when m_pCosSpi is set
+    CosManager m_cos;
+    CKSCosSpi *m_pCosSpi;
+
+    // risk limit file waiting to be reloaded; RiskEngine belongs to the
+    // trader callback thread, which applies it in its next
+    // registerTriggered()
+    const char *m_pRiskReloadFile;
+    bool m_bReloadRisk;
+
 
 public: 
     // constructorwhich need a valid pointer to a CThostFtdcMduserApi instance 
-    CTraderHandler(CThostFtdcTraderApi *pUserApi, MarketSubscriber *subscriber) : m_pUserApi(pUserApi), marketSubscriber(subscriber), m_nRequestID(0) { }
+    CTraderHandler(CThostFtdcTraderApi *pUserApi, MarketSubscriber *subscriber) : m_pUserApi(pUserApi), marketSubscriber(subscriber), m_nRequestID(0), m_risk(&m_cache), m_positions(&m_cache), m_bPositionQueried(false), m_templates(&m_cache),
+        m_triggers(&m_cache, &m_templates, &m_orders, &m_risk), m_pTriggerFile(NULL), m_pCosSpi(NULL),
+        m_pRiskReloadFile(NULL), m_bReloadRisk(false)
+    {
+        marketSubscriber->handler->m_pCache = &m_cache;
+        marketSubscriber->handler->m_pPositions = &m_positions;
+        marketSubscriber->handler->m_pTriggers = &m_triggers;
+        m_triggers.setTraderApi(pUserApi);
+    }
 
     ~CTraderHandler() {}
 
+    // one trigger per line: instrument above|below price buy|sell
+    // open|close|closetoday|closeyesterday volume [limit price, 0 crosses];
+    // the order must pass the risk checks, at the trigger price when it
+    // crosses, before it is armed. No tick is in yet, the price band is
+    // checked when it fires
+    void loadTriggers()
+    {
+        FILE *fp = fopen(m_pTriggerFile, "r");
+        if (fp == NULL)
+        {
+            FC_LOG(LOG_LEVEL_ERROR, "cannot open trigger file %s\n", m_pTriggerFile);
+            return;
+        }
+        char chLine[256];
+        char chInstrumentID[64], chCondition[16], chDirection[16], chOffset[16];
+        double dTriggerPrice;
+        int nArmed = 0;
+        int nLine = 0;
+        while (fgets(chLine, sizeof(chLine), fp) != NULL)
+        {
+            nLine++;
+            TriggerOrder order;
+            order.chHedgeFlag = THOST_FTDC_HF_Speculation;
+            order.dLimitPrice = 0;
+            int nFields = sscanf(chLine, "%63s %15s %lf %15s %15s %d %lf", chInstrumentID, chCondition, &dTriggerPrice,
+                                 chDirection, chOffset, &order.nVolume, &order.dLimitPrice);
+            if (nFields < 6 || chInstrumentID[0] == '#')
+                continue;
+            int nCondition;
+            if (strcmp(chCondition, "above") == 0)
+                nCondition = TRIGGER_AT_OR_ABOVE;
+            else if (strcmp(chCondition, "below") == 0)
+                nCondition = TRIGGER_AT_OR_BELOW;
+            else
+            {
+                FC_LOG(LOG_LEVEL_WARN, "%s:%d: unknown condition %s, trigger not armed\n", m_pTriggerFile, nLine, chCondition);
+                continue;
+            }
+            if (strcmp(chDirection, "buy") == 0)
+                order.chDirection = THOST_FTDC_D_Buy;
+            else if (strcmp(chDirection, "sell") == 0)
+                order.chDirection = THOST_FTDC_D_Sell;
+            else
+            {
+                FC_LOG(LOG_LEVEL_WARN, "%s:%d: unknown direction %s, trigger not armed\n", m_pTriggerFile, nLine, chDirection);
+                continue;
+            }
+            if (strcmp(chOffset, "open") == 0)
+                order.chOffsetFlag = THOST_FTDC_OF_Open;
+            else if (strcmp(chOffset, "close") == 0)
+                order.chOffsetFlag = THOST_FTDC_OF_Close;
+            else if (strcmp(chOffset, "closetoday") == 0)
+                order.chOffsetFlag = THOST_FTDC_OF_CloseToday;
+            else if (strcmp(chOffset, "closeyesterday") == 0)
+                order.chOffsetFlag = THOST_FTDC_OF_CloseYesterday;
+            else
+            {
+                FC_LOG(LOG_LEVEL_WARN, "%s:%d: unknown offset %s, trigger not armed\n", m_pTriggerFile, nLine, chOffset);
+                continue;
+            }
+
+            CThostFtdcInputOrderField ord;
+            int nSlot = m_cache.slot(chInstrumentID);
+            double dPrice = order.dLimitPrice != 0 ? order.dLimitPrice : dTriggerPrice;
+            if (nSlot < 0 || !m_templates.build(&ord, nSlot, order.chDirection, order.chOffsetFlag, order.chHedgeFlag, dPrice, order.nVolume, 0))
+            {
+                FC_LOG(LOG_LEVEL_WARN, "%s:%d: unknown instrument %s, trigger not armed\n", m_pTriggerFile, nLine, chInstrumentID);
+                continue;
+            }
+            int nRisk = m_risk.check(&ord, false);
+            if (nRisk != RISK_OK)
+            {
+                FC_LOG(LOG_LEVEL_WARN, "%s:%d: trigger on %s refused by risk: %s\n", m_pTriggerFile, nLine, chInstrumentID, RiskEngine::reason(nRisk));
+                continue;
+            }
+            int nID = m_triggers.addTrigger(chInstrumentID, nCondition, dTriggerPrice, order);
+            if (nID < 0)
+                FC_LOG(LOG_LEVEL_WARN, "trigger on %s not armed\n", chInstrumentID);
+            else
+                nArmed++;
+        }
+        fclose(fp);
+        FC_LOG(LOG_LEVEL_INFO, "armed %d triggers from %s\n", nArmed, m_pTriggerFile);
+    }
+
+    void reloadRiskLimits(const char *pFile)
+    {
+        m_pRiskReloadFile = pFile;
+        __atomic_store_n(&m_bReloadRisk, true, __ATOMIC_RELEASE);
+    }
+
+    // carried positions into the risk engine, so the position limits count
+    // them and not only today's fills; both share m_cache's slots
+    void seedRiskPositions()
+    {
+        const InstrumentIndex &index = m_positions.index();
+        for (int i = 0; i < index.count(); i++)
+        {
+            Position p;
+            if (m_positions.position(i, &p))
+                m_risk.setPosition(index.name(i), p.nLongToday + p.nLongYesterday, p.nShortToday + p.nShortYesterday);
+        }
+    }
+
+    // orders sent by triggers on the market data thread, into the order
+    // and risk books before their returns are handled; a pending SIGHUP
+    // reload of the risk limits is applied here too, on the trader thread
+    // that owns the risk engine
+    void registerTriggered()
+    {
+        if (__atomic_exchange_n(&m_bReloadRisk, false, __ATOMIC_ACQUIRE))
+            loadRiskLimits(this, m_pRiskReloadFile);
+        CThostFtdcInputOrderField orders[16];
+        unsigned int n;
+        while ((n = m_triggers.popFired(orders, 16)) > 0)
+        {
+            for (unsigned int i = 0; i < n; i++)
+            {
+                FC_LOG(LOG_LEVEL_INFO, "trigger sent %s %c %d@%.04f ref %s\n", orders[i].InstrumentID, orders[i].Direction,
+                    orders[i].VolumeTotalOriginal, orders[i].LimitPrice, orders[i].OrderRef);
+                m_risk.onTriggered(&orders[i], m_orders.onInsert(&orders[i]));
+            }
+        }
+    }
+
     //missing string printf
     //this is safe and convenient but not exactly efficient
     std::string format(const char* fmt, ...){
@@ -87,7 +264,9 @@ public:
 	std::string reply = "No Uuid Received"; 
 	try
 	{
-	      ClientSocket client_socket ( "localhost", 9999 );
+	      static std::string s_host = ServiceConfig::get("publisher_host", "localhost");
+	      static int s_nPort = ServiceConfig::getInt("publisher_port", 9999);
+	      ClientSocket client_socket ( s_host, s_nPort );
 
 	      try
 		{
@@ -96,12 +275,12 @@ public:
 		}
 	      catch ( SocketException& ) {}
 
-	      std::cout << "Received uuid for the message:\n\"" << reply << "\"\n";;
+	      FC_LOG(LOG_LEVEL_INFO, "Received uuid for the message:\n\"%s\"\n", reply.c_str());
 
 	}
 	catch ( SocketException& e )
 	{
-	      std::cout << "Exception was caught:" << e.description() << "\n";
+	      FC_LOG(LOG_LEVEL_ERROR, "Exception was caught:%s\n", e.description().c_str());
 	}
 
 	return reply;
@@ -111,20 +290,21 @@ public:
     // After making a succeed connection with the CTP server, the client should send the login request to the CTP server.
     virtual void OnFrontConnected()
     {
-        printf("OnFrontConnected:\n");
+        ThreadTopology::enter(THREAD_TRADER_CALLBACK);
+        FC_LOG(LOG_LEVEL_INFO, "OnFrontConnected:\n");
 
         CThostFtdcReqUserLoginField reqUserLogin;
         memset(&reqUserLogin, 0, sizeof(reqUserLogin));
         // set BrokerID
-        printf("BrokerID:%s\n", m_chBrokerID);
+        FC_LOG(LOG_LEVEL_INFO, "BrokerID:%s\n", m_chBrokerID);
         strcpy(reqUserLogin. BrokerID, m_chBrokerID);
 
         // set user id
-        printf("userid:%s\n", m_chUserID);
+        FC_LOG(LOG_LEVEL_INFO, "userid:%s\n", m_chUserID);
         strcpy(reqUserLogin.UserID, m_chUserID);
 
         // set password
-        printf("password:%s\n",m_chPassword);
+        FC_LOG(LOG_LEVEL_INFO, "password:%s\n",m_chPassword);
         strcpy(reqUserLogin.Password, m_chPassword);
 
         // send the login request
@@ -135,39 +315,42 @@ public:
     virtual void OnFrontDisconnected(int nReason)
     { 
         //  Inthis  case,  API  willreconnectthe  client  application can ignore this.
-        printf("OnFrontDisconnected.\n");
+        FC_LOG(LOG_LEVEL_INFO, "OnFrontDisconnected.\n");
     } 
 
     virtual void OnRtnInstrumentStatus(CThostFtdcInstrumentStatusField *pInstrumentStatus)
     {
-        printf("OnRtnInstrumentStatus:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRtnInstrumentStatus:");
         if (NULL != pInstrumentStatus)
         {
-            printf("%s-%c-%c",pInstrumentStatus->ExchangeID, pInstrumentStatus->InstrumentStatus, pInstrumentStatus->EnterReason);
+            FC_LOG(LOG_LEVEL_INFO, "%s-%c-%c",pInstrumentStatus->ExchangeID, pInstrumentStatus->InstrumentStatus, pInstrumentStatus->EnterReason);
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_INFO, "\n");
     }
 
     ///¼ر
     virtual void OnErrRtnOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo)
     {
-        printf("OnErrRtnOrderInsert:\n");
+        FC_LOG(LOG_LEVEL_INFO, "OnErrRtnOrderInsert:\n");
+        registerTriggered();
+        if (pInputOrder != NULL && pRspInfo != NULL && pRspInfo->ErrorID != 0)
+            m_risk.onOrderUpdate(pInputOrder->InstrumentID, m_orders.onInsertError(pInputOrder, pRspInfo->ErrorID), 0, true);
 
     }
 
     ///ر
     virtual void OnErrRtnOrderAction(CThostFtdcOrderActionField *pOrderAction, CThostFtdcRspInfoField *pRspInfo)
     {
-        printf("OnErrRtnOrderAction:\n");
+        FC_LOG(LOG_LEVEL_INFO, "OnErrRtnOrderAction:\n");
     }
 
     // After receiving the login request from the clientthe CTP server will send the following response to notify the client whether the login success or not.
     virtual void OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspUserLogin:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogin:");
         if (pRspUserLogin != NULL)
         {
-            printf("%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
                 pRspUserLogin->BrokerID,					// ͹˾
                 pRspUserLogin->UserID,						// û
                 pRspUserLogin->TradingDay,					// 
@@ -182,18 +365,28 @@ public:
                 pRspUserLogin->MaxOrderRef					// 󱨵
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
         if (pRspInfo->ErrorID != 0)
         {
             // in case any login failure, the client should handle this error.
-            printf("Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
+            FC_LOG(LOG_LEVEL_ERROR, "Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
             return;
         }
+        if (pRspUserLogin != NULL)
+            m_orders.onLogin(pRspUserLogin);
+        m_templates.setAccount(m_chBrokerID, m_chUserID, m_chUserID);
+        if (m_pCosSpi != NULL && !m_cos.started())
+        {
+            // queued requests go out from here on in pool order, the
+            // queries main() queued first ahead of the startup orders
+            m_cos.setApi((CKSCosApi *)m_pUserApi->LoadExtApi(m_pCosSpi, "KSCosApi"), m_chBrokerID, m_chUserID);
+            m_cos.start();
+        }
 	/*
         //get trading day
-        printf("%s\n",m_pUserApi->GetTradingDay());
+        FC_LOG(LOG_LEVEL_INFO, "%s\n",m_pUserApi->GetTradingDay());
 	*/
 
 	/*
@@ -221,10 +414,10 @@ public:
     // investor response
     virtual void OnRspQryInvestor(CThostFtdcInvestorField *pInvestor, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestor:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestor:");
         if (NULL != pInvestor)
         {
-            printf("%s|%s|%s|%s|%s|%s|%c|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%s|%c|%s|%s|",
                 pInvestor->InvestorID,						// Ͷߴ
                 pInvestor->InvestorName,					// Ͷ
                 pInvestor->IdentifiedCardNo,				// ֤
@@ -235,9 +428,9 @@ public:
                 pInvestor->Mobile,							// ֻ
                 pInvestor->OpenDate);						// 
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg); 
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg); 
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -256,10 +449,10 @@ public:
     // tradeaccount response
     virtual void OnRspQryTradingAccount(CThostFtdcTradingAccountField *pTradingAccount, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTradingAccount:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTradingAccount:");
         if (NULL != pTradingAccount)
         {
-            printf(":%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, ":%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
                 pTradingAccount->AccountID,					// ˺
                 pTradingAccount->PreBalance,				// ϴν׼
                 pTradingAccount->Available,					// ʽ
@@ -273,9 +466,9 @@ public:
                 pTradingAccount->Mortgage,					// Ѻ
                 pTradingAccount->Credit);					// ö
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // QryExchange
         CThostFtdcQryExchangeField QryExchange;
@@ -289,16 +482,16 @@ public:
     // RspQryExchange
     virtual void OnRspQryExchange(CThostFtdcExchangeField *pExchange, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryExchange:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryExchange:");
         if (NULL != pExchange)
         {
-            printf("%s|%s", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s", 
                 pExchange->ExchangeID,					// 
                 pExchange->ExchangeName);				// 
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -315,10 +508,10 @@ public:
     // RspQryInstrument
     virtual void OnRspQryInstrument(CThostFtdcInstrumentField *pInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInstrument:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInstrument:");
         if (NULL != pInstrument)
         {
-            printf("%s|%s|%s|%d|%s|%s|%.04f|%d|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%d|%s|%s|%.04f|%d|", 
                 pInstrument->ExchangeID,						// 
                 pInstrument->InstrumentID,						// Լ
                 pInstrument->InstrumentName,						// Լ
@@ -338,12 +531,30 @@ public:
                 pInstrument->PriceTick,                                                 // С䶯λ
                 nRequestID);
 	    std::string uuid = publish(mystr);
+
+	    // known to the risk checks and the tick cache before its first tick
+	    m_risk.addInstrument(pInstrument);
+	    m_positions.addInstrument(pInstrument);
+	    m_templates.addInstrument(pInstrument->InstrumentID);
+	    marketSubscriber->subscribe(pInstrument->InstrumentID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
-	marketSubscriber->subscribe(pInstrument->InstrumentID);
+	// every instrument known: seed the positions once
+	if (bIsLast == true && !m_bPositionQueried)
+	{
+	    m_bPositionQueried = true;
+	    CThostFtdcQryInvestorPositionDetailField QryPositionDetail;
+	    memset(&QryPositionDetail, 0, sizeof(QryPositionDetail));
+	    strcpy(QryPositionDetail.BrokerID, m_chBrokerID);
+	    strcpy(QryPositionDetail.InvestorID, m_chUserID);
+	    m_pUserApi->ReqQryInvestorPositionDetail(&QryPositionDetail, m_nRequestID++ );
+
+	    if (m_pTriggerFile != NULL)
+	        loadTriggers();
+	}
 
 	/*
     	CThostFtdcMdApi marketApi = CThostFtdcMdApi::CreateFtdcMdApi();
@@ -357,8 +568,8 @@ public:
 	///RspSubMarketData return
 	virtual void OnRspSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-		printf("OnRspSubMarketData:%s\n", pSpecificInstrument->InstrumentID);
-		printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+		FC_LOG(LOG_LEVEL_INFO, "OnRspSubMarketData:%s\n", pSpecificInstrument->InstrumentID);
+		FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
 
 /*		if (bIsLast == true)
 		{
@@ -374,8 +585,8 @@ public:
 	///OnRspUnSubMarketData return
 	virtual void OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-		printf("OnRspUnSubMarketData:\n");
-		printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+		FC_LOG(LOG_LEVEL_INFO, "OnRspUnSubMarketData:\n");
+		FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
 
 		// logout
 /*		CThostFtdcUserLogoutField UserLogout;
@@ -391,10 +602,10 @@ public:
 	///OnRtnDepthMarketData
 	virtual void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData)
 	{
-        printf("OnRtnDepthMarketData:");
+        FC_LOG(LOG_LEVEL_TICK, "OnRtnDepthMarketData:");
         if(pDepthMarketData != NULL)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_TICK, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
                 pDepthMarketData->ExchangeID,					// 
                 pDepthMarketData->InstrumentID,					// Լ
                 pDepthMarketData->PreClosePrice,				// 
@@ -472,17 +683,17 @@ public:
 	    std::string uuid = publish(mystr);
  
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_TICK, "\n");
 	}
 
 
     // QryInvestorPositionDetail response
     virtual void OnRspQryInvestorPositionDetail(CThostFtdcInvestorPositionDetailField *pInvestorPositionDetail, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestorPositionDetail:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestorPositionDetail:");
         if (NULL != pInvestorPositionDetail)
         {
-            printf("%s|%s|%s|%s|%s|%c|%c|%d|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%c|%c|%d|%.04f|%.04f|%.04f|",
                 pInvestorPositionDetail->TradingDay,			// 
                 pInvestorPositionDetail->OpenDate,				// 
                 pInvestorPositionDetail->TradeID,				// ɽ
@@ -496,9 +707,16 @@ public:
                 pInvestorPositionDetail->ExchMargin				// ֤
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+
+        m_positions.onPositionDetail(pInvestorPositionDetail, bIsLast);
+        if (bIsLast == true)
+        {
+            FC_LOG(LOG_LEVEL_INFO, "positions seeded, PnL %.02f\n", m_positions.totalPnl());
+            seedRiskPositions();
+        }
 
         if (bIsLast == true)
         {
@@ -519,10 +737,10 @@ public:
     // QryInstrumentMarginRate response
     virtual void OnRspQryInstrumentMarginRate(CThostFtdcInstrumentMarginRateField *pInstrumentMarginRate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInstrumentMarginRate:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInstrumentMarginRate:");
         if (NULL != pInstrumentMarginRate)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%.04f|%.04f|%.04f|%.04f|",
                 pInstrumentMarginRate->InvestorID,						// Ͷߴ
                 pInstrumentMarginRate->InstrumentID,					// Լ
                 pInstrumentMarginRate->LongMarginRatioByMoney,			// ͷ֤
@@ -530,9 +748,9 @@ public:
                 pInstrumentMarginRate->ShortMarginRatioByMoney,			// ͷ֤
                 pInstrumentMarginRate->ShortMarginRatioByVolume);		// ͷ֤
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -554,10 +772,10 @@ public:
     // QryInstrumentCommissionRate response
     virtual void OnRspQryInstrumentCommissionRate(CThostFtdcInstrumentCommissionRateField *pInstrumentCommissionRate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInstrumentCommissionRate:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInstrumentCommissionRate:");
         if (NULL != pInstrumentCommissionRate)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
                 pInstrumentCommissionRate->InvestorID,						// Ͷߴ
                 pInstrumentCommissionRate->InstrumentID,					// Լ
                 pInstrumentCommissionRate->OpenRatioByMoney,				// 
@@ -567,9 +785,9 @@ public:
                 pInstrumentCommissionRate->CloseTodayRatioByMoney,			// ƽ
                 pInstrumentCommissionRate->CloseTodayRatioByVolume);		// ƽ
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -586,10 +804,10 @@ public:
     // output the DepthMarketData result 
     virtual void OnRspQryDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryDepthMarketData:");
+        FC_LOG(LOG_LEVEL_TICK, "OnRspQryDepthMarketData:");
         if(pDepthMarketData != NULL)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_TICK, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
                 pDepthMarketData->ExchangeID,					// 
                 pDepthMarketData->InstrumentID,					// Լ
                 pDepthMarketData->PreClosePrice,				// 
@@ -668,102 +886,37 @@ public:
             std::string uuid = publish(mystr);
 
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-        return;
-
-        if (bIsLast == true)
-        {
-            // send order insertion request.
-            CThostFtdcInputOrderField ord;
-            memset(&ord, 0, sizeof(ord));
-            // broker id 
-            strcpy(ord.BrokerID, m_chBrokerID); 
-            // investor ID 
-            strcpy(ord.InvestorID, m_chUserID); 
-            // instrument ID 
-            strcpy(ord.InstrumentID, m_chContract);
-            ///order reference 
-            strcpy(ord.OrderRef, "9");  
-            // user id 
-            strcpy(ord.UserID, m_chUserID); 
-            // order price type 
-            ord.OrderPriceType = THOST_FTDC_OPT_LimitPrice; 
-            // direction 
-            ord.Direction = THOST_FTDC_D_Buy; 
-            // combination orders offset flag 
-            ord.CombOffsetFlag[0] = THOST_FTDC_OF_Open;
-            //strcpy(ord.CombOffsetFlag, "0"); 
-            // combination or hedge flag 
-            ord.CombHedgeFlag[0] = THOST_FTDC_HF_Speculation;
-            //strcpy(ord.CombHedgeFlag, "0");
-            // price 
-            ord.LimitPrice = 4220; 
-            // volume 
-            ord.VolumeTotalOriginal = 1; 
-            // valid date 
-            ord.TimeCondition = THOST_FTDC_TC_GFD; 
-            // GTD DATE 
-            strcpy(ord.GTDDate, ""); 
-            // volume condition 
-            ord.VolumeCondition = THOST_FTDC_VC_AV; 
-            // min volume 
-            ord.MinVolume = 0; 
-            // trigger condition 
-            ord.ContingentCondition = THOST_FTDC_CC_Immediately; 
-            // stop price 
-            ord.StopPrice = 0; 
-            // force close reason 
-            ord.ForceCloseReason = THOST_FTDC_FCC_NotForceClose; 
-            // auto suspend flag 
-            ord.IsAutoSuspend = 0;
-            // request id
-            ord.RequestID = m_nRequestID;
-
-            m_pUserApi->ReqOrderInsert(&ord, m_nRequestID++ );
-        }
-
-        if (bIsLast == true)
-        {
-            // qryorder
-            CThostFtdcQryOrderField QryOrder;
-            memset(&QryOrder, 0, sizeof(QryOrder));
-            // broker id 
-            strcpy(QryOrder.BrokerID, m_chBrokerID);
-            // investor ID 
-            strcpy(QryOrder.InvestorID, m_chUserID);
-            // start time
-            strcpy(QryOrder.InsertTimeStart, "20110623");
-            // end time
-            strcpy(QryOrder.InsertTimeEnd, "20110623");
-
-            m_pUserApi->ReqQryOrder(&QryOrder, m_nRequestID++ );
-        }
+        FC_LOG(LOG_LEVEL_TICK, "\n");
+        FC_LOG(LOG_LEVEL_TICK, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_TICK, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
     }
     // order insertion response 
     virtual void OnRspOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo, int  nRequestID, bool bIsLast) 
     {
-        printf("OnRspOrderInsert:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspOrderInsert:");
+        registerTriggered();
         if (NULL != pInputOrder)
         {
-            printf("%s", pInputOrder->OrderRef);
+            FC_LOG(LOG_LEVEL_INFO, "%s", pInputOrder->OrderRef);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        if (pInputOrder != NULL && pRspInfo != NULL && pRspInfo->ErrorID != 0)
+            m_risk.onOrderUpdate(pInputOrder->InstrumentID, m_orders.onInsertError(pInputOrder, pRspInfo->ErrorID), 0, true);
 
     }; 
 
     // order insertion return 
     virtual void OnRtnOrder(CThostFtdcOrderField *pOrder) 
     {
-        printf("OnRtnOrder:");
+        ThreadTopology::enter(THREAD_TRADER_CALLBACK);
+        FC_LOG(LOG_LEVEL_INFO, "OnRtnOrder:");
+        registerTriggered();
         if (NULL != pOrder)
         {
-            printf("%d|%s|OrderSysID:%s|OrderLocalID:%s|%s|%s|%c|%s|%c|%s|%s|%d|%.04f|%d|%d|%s|%s|%s|%c|%c|%c|%c|%.04f|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%d|%s|OrderSysID:%s|OrderLocalID:%s|%s|%s|%c|%s|%c|%s|%s|%d|%.04f|%d|%d|%s|%s|%s|%c|%c|%c|%c|%.04f|%s|%s|",
                 pOrder->SequenceNo,							// 	
                 pOrder->InvestorID,							// ͻ
                 pOrder->OrderSysID,							// ίк
@@ -791,8 +944,16 @@ public:
                 pOrder->OrderRef							// 
                 ); 
         }
-        printf("\n");
-        printf("RequestID=[%d]\n", pOrder->RequestID);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d]\n", pOrder->RequestID);
+
+        int nSlot = m_orders.onRtnOrder(pOrder);
+        if (nSlot >= 0)
+        {
+            const OrderRecord &o = m_orders.order(nSlot);
+            FC_LOG(LOG_LEVEL_DEBUG, "order slot=%d state=%d traded=%d\n", nSlot, o.nState, o.nVolumeTraded);
+            m_risk.onOrderUpdate(pOrder->InstrumentID, nSlot, pOrder->VolumeTotal, o.nState != ORDER_PENDING && o.nState != ORDER_QUEUEING);
+        }
 
         // order insertion success, then send order action request.
         if (pOrder->OrderStatus == THOST_FTDC_OST_NoTradeQueueing && atoi(pOrder->OrderSysID) != 0)
@@ -838,17 +999,32 @@ public:
         static int s_nTotalBuy = 0;
         static int s_nTotalSell = 0;
 
-        printf("OnRtnTrade:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRtnTrade:");
+        registerTriggered();
+        int nSlot = NULL != pTrade ? m_orders.onRtnTrade(pTrade) : ORDER_UNKNOWN;
+        if (nSlot == ORDER_DUPLICATE_TRADE)
+        {
+            // replayed after a reconnect, already counted
+            FC_LOG(LOG_LEVEL_INFO, "duplicate trade %s\n", pTrade->TradeID);
+            return;
+        }
         if (NULL != pTrade)
         {
+            m_risk.onRtnTrade(pTrade, nSlot);
+            if (m_positions.onRtnTrade(pTrade))
+            {
+                int nPosition = m_positions.index().find(pTrade->InstrumentID);
+                FC_LOG(LOG_LEVEL_DEBUG, "%s realized %.02f unrealized %.02f\n", pTrade->InstrumentID,
+                    m_positions.realizedPnl(nPosition), m_positions.unrealizedPnl(nPosition));
+            }
             if (pTrade->Direction == THOST_FTDC_D_Buy)
                 s_nTotalBuy += pTrade->Volume;
             else if (pTrade->Direction == THOST_FTDC_D_Sell)
                 s_nTotalSell += pTrade->Volume;
             else
-                printf ("invalid direction:%c\n", pTrade->Direction);
+                FC_LOG(LOG_LEVEL_INFO, "invalid direction:%c\n", pTrade->Direction);
 
-            printf("%d|%s|%s|%s|%s|ɽ|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|s_nTotalBuy=%d|s_nTotalSell=%d|",
+            FC_LOG(LOG_LEVEL_INFO, "%d|%s|%s|%s|%s|ɽ|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|s_nTotalBuy=%d|s_nTotalSell=%d|",
                 pTrade->SequenceNo,					// 
                 pTrade->InvestorID,					// ͻ
                 pTrade->ExchangeID,					// 
@@ -867,15 +1043,15 @@ public:
                 s_nTotalSell
                 );
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_INFO, "\n");
     }
 
     // the error notification caused by client request
     virtual void OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspError:\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "OnRspError:\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // the client should handle the error
     }
@@ -883,10 +1059,10 @@ public:
     // output the order action result 
     virtual void OnRspOrderAction(CThostFtdcInputOrderActionField *pInputOrderAction, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspOrderAction:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspOrderAction:");
         if (NULL != pInputOrderAction)
         {
-            printf("%s|OrderSysID:%s|%s|%s|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|OrderSysID:%s|%s|%s|%.04f|",
                 pInputOrderAction->InvestorID,							// ͻ
                 pInputOrderAction->OrderSysID,							// ίк
                 pInputOrderAction->ExchangeID,							// 
@@ -894,22 +1070,22 @@ public:
                 pInputOrderAction->LimitPrice							// ίм۸
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
     }
 
     // qryorder return
     virtual void OnRspQryOrder(CThostFtdcOrderField *pOrder, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryOrder:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryOrder:");
         if(pOrder != NULL)
         {
-            printf("%s", pOrder->OrderSysID);
+            FC_LOG(LOG_LEVEL_INFO, "%s", pOrder->OrderSysID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {	
@@ -936,10 +1112,10 @@ public:
     // qrytrade return
     virtual void OnRspQryTrade(CThostFtdcTradeField *pTrade, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTrade:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTrade:");
         if(pTrade != NULL)
         {
-            printf("%s|%s|%s|%s|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|%d",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|%d",
                 pTrade->InvestorID,							// ͻ
                 pTrade->ExchangeID,							// 
                 pTrade->OrderSysID,							// 
@@ -956,9 +1132,9 @@ public:
                 pTrade->SequenceNo							// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -979,10 +1155,10 @@ public:
     // QryInvestorPosition return
     virtual void OnRspQryInvestorPosition(CThostFtdcInvestorPositionField *pInvestorPosition, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestorPosition:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestorPosition:");
         if(pInvestorPosition != NULL)
         {
-            printf("%s|%d|%d|%.04f|%.04f|%s|%c|%.04f|%c|%s|%.04f|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%d|%d|%.04f|%.04f|%s|%c|%.04f|%c|%s|%.04f|", 
                 pInvestorPosition->InvestorID,					// ͻ
                 pInvestorPosition->Position,					// ֲܳ
                 pInvestorPosition->TodayPosition,				// ֲֳ
@@ -996,9 +1172,9 @@ public:
                 pInvestorPosition->UseMargin					// ռõı֤
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {	
@@ -1017,19 +1193,19 @@ public:
     // QryCFMMCTradingAccountKey return
     virtual void OnRspQryCFMMCTradingAccountKey(CThostFtdcCFMMCTradingAccountKeyField *pCFMMCTradingAccountKey, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryCFMMCTradingAccountKey:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryCFMMCTradingAccountKey:");
         if (NULL != pCFMMCTradingAccountKey)
         {
-            printf("%s|%s|%d|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%d|%s|",
                 pCFMMCTradingAccountKey->AccountID,				   // Ͷʺ
                 pCFMMCTradingAccountKey->ParticipantID,			   // ͹˾ͳһ
                 pCFMMCTradingAccountKey->KeyID,					   // Կ
                 pCFMMCTradingAccountKey->CurrentKey				   // ̬Կ
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1053,18 +1229,18 @@ public:
     // PasswordUpdate return
     virtual void OnRspUserPasswordUpdate(CThostFtdcUserPasswordUpdateField *pUserPasswordUpdate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspUserPasswordUpdate:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserPasswordUpdate:");
         if (NULL != pUserPasswordUpdate)
         {
-            printf("%s|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|",
                 pUserPasswordUpdate->UserID,			// ͻ
                 pUserPasswordUpdate->OldPassword,		// ɿ
                 pUserPasswordUpdate->NewPassword		// ¿
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1088,18 +1264,18 @@ public:
     // TradingAccountPasswordUpdate
     virtual void OnRspTradingAccountPasswordUpdate(CThostFtdcTradingAccountPasswordUpdateField *pTradingAccountPasswordUpdate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspTradingAccountPasswordUpdate:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspTradingAccountPasswordUpdate:");
         if (NULL != pTradingAccountPasswordUpdate)
         {
-            printf("%s|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|",
                 pTradingAccountPasswordUpdate->AccountID,				// ʽ˻
                 pTradingAccountPasswordUpdate->OldPassword,				// ɿ
                 pTradingAccountPasswordUpdate->NewPassword				// ¿
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1119,17 +1295,17 @@ public:
     // QrySettlementInfoConfirm return
     virtual void OnRspQrySettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQrySettlementInfoConfirm:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQrySettlementInfoConfirm:");
         if (NULL != pSettlementInfoConfirm)
         {
-            printf("%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|",
                 pSettlementInfoConfirm->InvestorID,					// ͻ
                 pSettlementInfoConfirm->ConfirmDate					// ȷ
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1151,17 +1327,17 @@ public:
     ///QrySettlementInfo return
     virtual void OnRspQrySettlementInfo(CThostFtdcSettlementInfoField *pSettlementInfo, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQrySettlementInfoConfirm:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQrySettlementInfoConfirm:");
         if(pSettlementInfo != NULL)
         {
-            printf("%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|",
                 pSettlementInfo->InvestorID,			// ͻ
                 pSettlementInfo->Content				// Ϣ
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1182,10 +1358,10 @@ public:
     // QryInvestorPositionCombineDetail return
     virtual void OnRspQryInvestorPositionCombineDetail(CThostFtdcInvestorPositionCombineDetailField *pInvestorPositionCombineDetail, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestorPositionCombineDetail:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestorPositionCombineDetail:");
         if(pInvestorPositionCombineDetail != NULL)
         {
-            printf("%s|%s|%s|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%d|%.04f|",
                 pInvestorPositionCombineDetail->InvestorID,					// ͻ
                 pInvestorPositionCombineDetail->ExchangeID,					// 
                 pInvestorPositionCombineDetail->CombInstrumentID,			// ϺԼ
@@ -1193,9 +1369,9 @@ public:
                 pInvestorPositionCombineDetail->Margin						// Ͷ֤߱
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1222,10 +1398,10 @@ public:
     ///ڻʽתڻӦ
     virtual void OnRspFromBankToFutureByFuture(CThostFtdcReqTransferField *pReqTransfer, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) 
     {
-        printf("OnRspFromBankToFutureByFuture:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspFromBankToFutureByFuture:");
         if (NULL != pReqTransfer)
         {
-            printf("%s|%s|%s|%s|%d|%.04f|%c|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%d|%.04f|%c|%c|",
                 pReqTransfer->AccountID,						// Ͷ˺
                 pReqTransfer->BankID,							// д
                 pReqTransfer->BankAccount,						// ˺
@@ -1236,9 +1412,9 @@ public:
                 pReqTransfer->BankAccType						// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1267,10 +1443,10 @@ public:
     ///ڻڻʽתӦ
     virtual void OnRspFromFutureToBankByFuture(CThostFtdcReqTransferField *pReqTransfer, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspFromFutureToBankByFuture:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspFromFutureToBankByFuture:");
         if (NULL != pReqTransfer)
         {
-            printf("%s|%s|%s|%s|%d|%.04f|%c|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%d|%.04f|%c|%c|",
                 pReqTransfer->AccountID,						// Ͷ˺
                 pReqTransfer->BankID,							// д
                 pReqTransfer->BankAccount,						// ˺
@@ -1281,9 +1457,9 @@ public:
                 pReqTransfer->BankAccType						// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1307,10 +1483,10 @@ public:
     ///ڻѯӦ
     virtual void OnRspQueryBankAccountMoneyByFuture(CThostFtdcReqQueryAccountField *pReqQueryAccount, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQueryBankAccountMoneyByFuture:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQueryBankAccountMoneyByFuture:");
         if (NULL != pReqQueryAccount)
         {
-            printf("%s|%s|%s|%s|%d|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%d|%c|",
                 pReqQueryAccount->AccountID,						// Ͷ˺
                 pReqQueryAccount->BankID,							// д
                 pReqQueryAccount->BankAccount,						// ˺
@@ -1319,9 +1495,9 @@ public:
                 pReqQueryAccount->BankAccType						// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1342,10 +1518,10 @@ public:
     // TransferSerial return
     virtual void OnRspQryTransferSerial(CThostFtdcTransferSerialField *pTransferSerial, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTransferSerial:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTransferSerial:");
         if (pTransferSerial != NULL)
         {
-            printf("%d|%s|%s|%s|%s|%s|%.04f|%s|%c|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%d|%s|%s|%s|%s|%s|%.04f|%s|%c|%c|",
                 pTransferSerial->PlateSerial,				// ƽ̨ˮ
                 pTransferSerial->AccountID,					// Ͷ˺
                 pTransferSerial->BankAccount,				// ˺
@@ -1358,9 +1534,9 @@ public:
                 pTransferSerial->AvailabilityFlag			// Ч־
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1376,14 +1552,14 @@ public:
     // notice return
     virtual void OnRspQryNotice(CThostFtdcNoticeField *pNotice, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryNotice:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryNotice:");
         if (NULL != pNotice)
         {
-            printf(":%s", pNotice->Content);
+            FC_LOG(LOG_LEVEL_INFO, ":%s", pNotice->Content);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1401,27 +1577,27 @@ public:
     // trade notice return
     virtual void OnRspQryTradingNotice(CThostFtdcTradingNoticeField *pTradingNotice, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTradingNotice:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTradingNotice:");
         if (NULL != pTradingNotice)
         {
-            printf(":%s", pTradingNotice->FieldContent);
+            FC_LOG(LOG_LEVEL_INFO, ":%s", pTradingNotice->FieldContent);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
     }
 
     // logout return
     virtual void OnRspUserLogout(CThostFtdcUserLogoutField *pUserLogout, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspUserLogout:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogout:");
         if (NULL != pUserLogout)
         {
-            printf("%s",pUserLogout->UserID);
+            FC_LOG(LOG_LEVEL_INFO, "%s",pUserLogout->UserID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // inform the main thread order transaction is over 
         ///SetEvent(m_hEvent); 
@@ -1437,7 +1613,7 @@ private:
 class CCosHandler:public CKSCosSpi
 {
 public:
-  CCosHandler ()
+  CCosHandler (CosManager * pCos = NULL):m_pCos (pCos)
   {
   }
 
@@ -1445,6 +1621,7 @@ public:
   {
   }
 
+
   //¼Ӧ
   virtual void
     OnRspInitInsertConditionalOrder (CKSConditionalOrderOperResultField *
@@ -1452,90 +1629,27 @@ public:
 				     CThostFtdcRspInfoField * pRspInfo,
 				     int nRequestID, bool bIsLast)
   {
-
-    printf ("hello insert\n");
-    if (pInitInsertConditionalOrder != NULL)
-      {
-
-
-	cout << "OnRspInitInsertConditionalOrder:"
-	  << "ù˾:" << pInitInsertConditionalOrder->BrokerID
-	  << "ͻ:" << pInitInsertConditionalOrder->InvestorID
-	  << ":" << pInitInsertConditionalOrder->ConditionalOrderID
-	  << "ر:" << pInitInsertConditionalOrder->OrderLocalID
-	  << ":" << pInitInsertConditionalOrder->ExchangeID
-	  << "Լ:" << pInitInsertConditionalOrder->InstrumentID
-	  << "״̬:" << pInitInsertConditionalOrder->OrderStatus
-	  << ":" << pInitInsertConditionalOrder->Direction
-	  << "ƽֱ־:" << pInitInsertConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pInitInsertConditionalOrder->CombHedgeFlag
-	  << "ί:" << pInitInsertConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pInitInsertConditionalOrder->LimitPrice
-	  << ":" << pInitInsertConditionalOrder->TradingDay
-	  << "û:" << pInitInsertConditionalOrder->UserID
-	  << "ʱ:" << pInitInsertConditionalOrder->CancelTime
-	  << "ͻ:" << pInitInsertConditionalOrder->ClientID
-	  << "״̬:" << pInitInsertConditionalOrder->
-	  ConditionalOrderStatus << "Ϣ:" <<
-	  pInitInsertConditionalOrder->
-	  ErrorMsg << "۸:" << pInitInsertConditionalOrder->
-	  OrderPriceType << ":" << pInitInsertConditionalOrder->
-	  TriggeredTimes << ":" << pInitInsertConditionalOrder->
-	  OrderType << "ע:" << pInitInsertConditionalOrder->
-	  Memo << "Чʱ:" << pInitInsertConditionalOrder->
-	  ActiveTime << "ʧЧʱ:" << pInitInsertConditionalOrder->
-	  InActiveTime << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-
-
-
+    logConditional ("insert", pInitInsertConditionalOrder, pRspInfo,
+		    nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspConditional (pInitInsertConditionalOrder, pRspInfo,
+				nRequestID);
   }
 
+
   //ѯӦ
   virtual void OnRspQueryConditionalOrder (CKSConditionalOrderOperResultField
 					   * pQueryConditionalOrder,
 					   CThostFtdcRspInfoField * pRspInfo,
 					   int nRequestID, bool bIsLast)
   {
-    printf ("hello query\n");
-    if (pQueryConditionalOrder != NULL)
-      {
-	cout << "OnRspQueryConditionalOrder:"
-	  << "ù˾:" << pQueryConditionalOrder->BrokerID
-	  << "ͻ:" << pQueryConditionalOrder->InvestorID
-	  << ":" << pQueryConditionalOrder->ConditionalOrderID
-	  << "ر:" << pQueryConditionalOrder->OrderLocalID
-	  << ":" << pQueryConditionalOrder->ExchangeID
-	  << "Լ:" << pQueryConditionalOrder->InstrumentID
-	  << "״̬:" << pQueryConditionalOrder->OrderStatus
-	  << ":" << pQueryConditionalOrder->Direction
-	  << "ƽֱ־:" << pQueryConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pQueryConditionalOrder->CombHedgeFlag
-	  << "ί:" << pQueryConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pQueryConditionalOrder->LimitPrice
-	  << ":" << pQueryConditionalOrder->TradingDay
-	  << "û:" << pQueryConditionalOrder->UserID
-	  << "ʱ:" << pQueryConditionalOrder->CancelTime
-	  << "ͻ:" << pQueryConditionalOrder->ClientID
-	  << "״̬:" << pQueryConditionalOrder->ConditionalOrderStatus
-	  << "Ϣ:" << pQueryConditionalOrder->ErrorMsg
-	  << "۸:" << pQueryConditionalOrder->OrderPriceType
-	  << ":" << pQueryConditionalOrder->TriggeredTimes
-	  << ":" << pQueryConditionalOrder->OrderType
-	  << "ע:" << pQueryConditionalOrder->Memo
-	  << "Чʱ:" << pQueryConditionalOrder->ActiveTime
-	  << "ʧЧʱ:" << pQueryConditionalOrder->InActiveTime << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+    logConditional ("query", pQueryConditionalOrder, pRspInfo, nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspConditional (pQueryConditionalOrder, pRspInfo,
+				nRequestID);
   }
 
+
   //޸Ӧ
   virtual void
     OnRspModifyConditionalOrder (CKSConditionalOrderOperResultField *
@@ -1543,128 +1657,57 @@ public:
 				 CThostFtdcRspInfoField * pRspInfo,
 				 int nRequestID, bool bIsLast)
   {
-    printf ("hello modify\n");
-    if (pModifyConditionalOrder != NULL)
-      {
-	cout << "OnRspModifyConditionalOrder:"
-	  << "ù˾:" << pModifyConditionalOrder->BrokerID
-	  << "ͻ:" << pModifyConditionalOrder->InvestorID
-	  << ":" << pModifyConditionalOrder->ConditionalOrderID
-	  << "ر:" << pModifyConditionalOrder->OrderLocalID
-	  << ":" << pModifyConditionalOrder->ExchangeID
-	  << "Լ:" << pModifyConditionalOrder->InstrumentID
-	  << "״̬:" << pModifyConditionalOrder->OrderStatus
-	  << ":" << pModifyConditionalOrder->Direction
-	  << "ƽֱ־:" << pModifyConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pModifyConditionalOrder->CombHedgeFlag
-	  << "ί:" << pModifyConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pModifyConditionalOrder->LimitPrice
-	  << ":" << pModifyConditionalOrder->TradingDay
-	  << "û:" << pModifyConditionalOrder->UserID
-	  << "ʱ:" << pModifyConditionalOrder->CancelTime
-	  << "ͻ:" << pModifyConditionalOrder->ClientID
-	  << "״̬:" << pModifyConditionalOrder->ConditionalOrderStatus
-	  << "Ϣ:" << pModifyConditionalOrder->ErrorMsg
-	  << "۸:" << pModifyConditionalOrder->OrderPriceType
-	  << ":" << pModifyConditionalOrder->TriggeredTimes
-	  << ":" << pModifyConditionalOrder->OrderType
-	  << "ע:" << pModifyConditionalOrder->Memo
-	  << "Чʱ:" << pModifyConditionalOrder->ActiveTime
-	  << "ʧЧʱ:" << pModifyConditionalOrder->InActiveTime << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+    logConditional ("modify", pModifyConditionalOrder, pRspInfo, nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspConditional (pModifyConditionalOrder, pRspInfo,
+				nRequestID);
   }
 
+
   //ͣӦ
   virtual void OnRspPauseConditionalOrder (CKSConditionalOrderOperResultField
 					   * pPauseConditionalOrder,
 					   CThostFtdcRspInfoField * pRspInfo,
 					   int nRequestID, bool bIsLast)
   {
-    printf ("hello pause or active\n");
-    if (pPauseConditionalOrder != NULL)
-      {
-	cout << "OnRspPauseConditionalOrder:"
-	  << "ù˾:" << pPauseConditionalOrder->BrokerID
-	  << "ͻ:" << pPauseConditionalOrder->InvestorID
-	  << ":" << pPauseConditionalOrder->ConditionalOrderID
-	  << "ر:" << pPauseConditionalOrder->OrderLocalID
-	  << ":" << pPauseConditionalOrder->ExchangeID
-	  << "Լ:" << pPauseConditionalOrder->InstrumentID
-	  << "״̬:" << pPauseConditionalOrder->OrderStatus
-	  << ":" << pPauseConditionalOrder->Direction
-	  << "ƽֱ־:" << pPauseConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pPauseConditionalOrder->CombHedgeFlag
-	  << "ί:" << pPauseConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pPauseConditionalOrder->LimitPrice
-	  << ":" << pPauseConditionalOrder->TradingDay
-	  << "û:" << pPauseConditionalOrder->UserID
-	  << "ʱ:" << pPauseConditionalOrder->CancelTime
-	  << "ͻ:" << pPauseConditionalOrder->ClientID
-	  << "״̬:" << pPauseConditionalOrder->ConditionalOrderStatus
-	  << "Ϣ:" << pPauseConditionalOrder->ErrorMsg
-	  << "۸:" << pPauseConditionalOrder->OrderPriceType
-	  << ":" << pPauseConditionalOrder->TriggeredTimes
-	  << ":" << pPauseConditionalOrder->OrderType
-	  << "ע:" << pPauseConditionalOrder->Memo
-	  << "Чʱ:" << pPauseConditionalOrder->ActiveTime
-	  << "ʧЧʱ:" << pPauseConditionalOrder->InActiveTime << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    logConditional ("pause", pPauseConditionalOrder, pRspInfo, nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspConditional (pPauseConditionalOrder, pRspInfo,
+				nRequestID);
   }
 
+
   //ɾӦ
   virtual void OnRspRemoveConditionalOrder (CKSConditionalOrderRspResultField
 					    * pRemoveConditionalOrder,
 					    CThostFtdcRspInfoField * pRspInfo,
 					    int nRequestID, bool bIsLast)
   {
-    printf ("hello remove\n");
-    if (pRemoveConditionalOrder != NULL)
-      {
-
-	cout << "OnRspRemoveConditionalOrder:"
-	  << "Ӫҵ:" << pRemoveConditionalOrder->BrokerID
-	  << "Ͷߴ:" << pRemoveConditionalOrder->InvestorID
-	  << ":" << pRemoveConditionalOrder->
-	  ConditionalOrderID << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    if (pRemoveConditionalOrder == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_INFO, "cos remove request %d order %d error %d\n",
+	    nRequestID, pRemoveConditionalOrder->ConditionalOrderID,
+	    pRspInfo != NULL ? pRspInfo->ErrorID : 0);
+    if (m_pCos != NULL && (pRspInfo == NULL || pRspInfo->ErrorID == 0))
+      m_pCos->onRemovedConditional (pRemoveConditionalOrder->
+				    ConditionalOrderID);
   }
 
+
   //ѡӦ
   virtual void OnRspSelectConditionalOrder (CKSConditionalOrderRspResultField
 					    * pSelectConditionalOrder,
 					    CThostFtdcRspInfoField * pRspInfo,
 					    int nRequestID, bool bIsLast)
   {
-    printf ("hello select\n");
-    if (pSelectConditionalOrder != NULL)
-      {
-
-	cout << "OnRspSelectConditionalOrder:"
-	  << "Ӫҵ:" << pSelectConditionalOrder->BrokerID
-	  << "Ͷߴ:" << pSelectConditionalOrder->InvestorID
-	  << ":" << pSelectConditionalOrder->
-	  ConditionalOrderID << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-
+    if (pSelectConditionalOrder == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_INFO, "cos select request %d order %d error %d\n",
+	    nRequestID, pSelectConditionalOrder->ConditionalOrderID,
+	    pRspInfo != NULL ? pRspInfo->ErrorID : 0);
   }
 
+
   //ӯ¼Ӧ
   virtual void
     OnRspInsertProfitAndLossOrder (CKSProfitAndLossOrderOperResultField *
@@ -1672,52 +1715,14 @@ public:
 				   CThostFtdcRspInfoField * pRspInfo,
 				   int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss insert\n");
-    if (pInsertProfitAndLossOrder != NULL)
-      {
-
-	cout << "OnRspInsertProfitAndLossOrder:"
-	  << "Ӫҵ:" << pInsertProfitAndLossOrder->BrokerID
-	  << "Ͷߴ:" << pInsertProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ:" << pInsertProfitAndLossOrder->
-	  ProfitAndLossOrderID << "Ա:" << pInsertProfitAndLossOrder->
-	  UserID << "Ͷ:" << pInsertProfitAndLossOrder->
-	  InvestorName << "ر:" << pInsertProfitAndLossOrder->
-	  OrderLocalID << "ֹ:" << pInsertProfitAndLossOrder->
-	  StopLossPrice << "ֹӯ:" << pInsertProfitAndLossOrder->
-	  TakeProfitPrice << "ƽַʽ:" << pInsertProfitAndLossOrder->
-	  CloseMode << "ƽַӼλ:" << pInsertProfitAndLossOrder->
-	  Figures << "鴥ʱ¼:" << pInsertProfitAndLossOrder->
-	  LastPrice << "ֹֹӯʱ:" << pInsertProfitAndLossOrder->
-	  ProfitAndLossOrderFormTime << "ʱ:" <<
-	  pInsertProfitAndLossOrder->
-	  ConditionalOrderFormTime << "ίеʱ:" <<
-	  pInsertProfitAndLossOrder->
-	  OrderFormTime << "ֹֹӯ״̬:" << pInsertProfitAndLossOrder->
-	  ProfitAndLossOrderStatus << ":" <<
-	  pInsertProfitAndLossOrder->
-	  ConditionalOrderID << ":" << pInsertProfitAndLossOrder->
-	  ExchangeID << "ͻ:" << pInsertProfitAndLossOrder->
-	  ClientID << "Լ:" << pInsertProfitAndLossOrder->
-	  InstrumentID << "ƽ־:" << pInsertProfitAndLossOrder->
-	  CombOffsetFlag << "Ͷױ־:" << pInsertProfitAndLossOrder->
-	  CombHedgeFlag << "" << pInsertProfitAndLossOrder->
-	  Direction << "۸" << pInsertProfitAndLossOrder->
-	  LimitPrice << "" << pInsertProfitAndLossOrder->
-	  VolumeTotalOriginal << "ӯ۵ķʽ" <<
-	  pInsertProfitAndLossOrder->
-	  OffsetValue << "ҵԪ" << pInsertProfitAndLossOrder->
-	  BusinessUnit << "۸" << pInsertProfitAndLossOrder->
-	  SpringType << "ֹ" << pInsertProfitAndLossOrder->
-	  FloatLimitPrice << "ֳɽ۸" << pInsertProfitAndLossOrder->
-	  OpenTradePrice << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    logProfitAndLoss ("insert", pInsertProfitAndLossOrder, pRspInfo,
+		      nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspProfitAndLoss (pInsertProfitAndLossOrder, pRspInfo,
+				  nRequestID);
   }
 
+
   //ӯ޸Ӧ
   virtual void
     OnRspModifyProfitAndLossOrder (CKSProfitAndLossOrderOperResultField *
@@ -1725,53 +1730,14 @@ public:
 				   CThostFtdcRspInfoField * pRspInfo,
 				   int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss modify\n");
-    if (pModifyProfitAndLossOrder != NULL)
-      {
-	cout << "OnRspModifyProfitAndLossOrder:"
-	  << "Ӫҵ:" << pModifyProfitAndLossOrder->BrokerID
-	  << "Ͷߴ:" << pModifyProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ:" << pModifyProfitAndLossOrder->
-	  ProfitAndLossOrderID << "Ա:" << pModifyProfitAndLossOrder->
-	  UserID << "Ͷ:" << pModifyProfitAndLossOrder->
-	  InvestorName << "ر:" << pModifyProfitAndLossOrder->
-	  OrderLocalID << "ֹ:" << pModifyProfitAndLossOrder->
-	  StopLossPrice << "ֹӯ:" << pModifyProfitAndLossOrder->
-	  TakeProfitPrice << "ƽַʽ:" << pModifyProfitAndLossOrder->
-	  CloseMode << "ƽַӼλ:" << pModifyProfitAndLossOrder->
-	  Figures << "鴥ʱ¼:" << pModifyProfitAndLossOrder->
-	  LastPrice << "ֹֹӯʱ:" << pModifyProfitAndLossOrder->
-	  ProfitAndLossOrderFormTime << "ʱ:" <<
-	  pModifyProfitAndLossOrder->
-	  ConditionalOrderFormTime << "ίеʱ:" <<
-	  pModifyProfitAndLossOrder->
-	  OrderFormTime << "ֹֹӯ״̬:" << pModifyProfitAndLossOrder->
-	  ProfitAndLossOrderStatus << ":" <<
-	  pModifyProfitAndLossOrder->
-	  ConditionalOrderID << ":" << pModifyProfitAndLossOrder->
-	  ExchangeID << "ͻ:" << pModifyProfitAndLossOrder->
-	  ClientID << "Լ:" << pModifyProfitAndLossOrder->
-	  InstrumentID << "ƽ־:" << pModifyProfitAndLossOrder->
-	  CombOffsetFlag << "Ͷױ־:" << pModifyProfitAndLossOrder->
-	  CombHedgeFlag << "" << pModifyProfitAndLossOrder->
-	  Direction << "۸" << pModifyProfitAndLossOrder->
-	  LimitPrice << "" << pModifyProfitAndLossOrder->
-	  VolumeTotalOriginal << "ӯ۵ķʽ" <<
-	  pModifyProfitAndLossOrder->
-	  OffsetValue << "ҵԪ" << pModifyProfitAndLossOrder->
-	  BusinessUnit << "۸" << pModifyProfitAndLossOrder->
-	  SpringType << "ֹ" << pModifyProfitAndLossOrder->
-	  FloatLimitPrice << "ֳɽ۸" << pModifyProfitAndLossOrder->
-	  OpenTradePrice << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-
+    logProfitAndLoss ("modify", pModifyProfitAndLossOrder, pRspInfo,
+		      nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspProfitAndLoss (pModifyProfitAndLossOrder, pRspInfo,
+				  nRequestID);
   }
 
+
   //ӯ𵥲ѯӦ
   virtual void
     OnRspQueryProfitAndLossOrder (CKSProfitAndLossOrderOperResultField *
@@ -1779,52 +1745,14 @@ public:
 				  CThostFtdcRspInfoField * pRspInfo,
 				  int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss query\n");
-    if (pQueryProfitAndLossOrder != NULL)
-      {
-	cout << "OnRspQueryProfitAndLossOrder:"
-	  << "Ӫҵ:" << pQueryProfitAndLossOrder->BrokerID
-	  << "Ͷߴ:" << pQueryProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ:" << pQueryProfitAndLossOrder->ProfitAndLossOrderID
-	  << "Ա:" << pQueryProfitAndLossOrder->UserID
-	  << "Ͷ:" << pQueryProfitAndLossOrder->InvestorName
-	  << "ر:" << pQueryProfitAndLossOrder->OrderLocalID
-	  << "ֹ:" << pQueryProfitAndLossOrder->StopLossPrice
-	  << "ֹӯ:" << pQueryProfitAndLossOrder->TakeProfitPrice
-	  << "ƽַʽ:" << pQueryProfitAndLossOrder->CloseMode
-	  << "ƽַӼλ:" << pQueryProfitAndLossOrder->Figures
-	  << "鴥ʱ¼:" << pQueryProfitAndLossOrder->LastPrice
-	  << "ֹֹӯʱ:" << pQueryProfitAndLossOrder->
-	  ProfitAndLossOrderFormTime << "ʱ:" <<
-	  pQueryProfitAndLossOrder->
-	  ConditionalOrderFormTime << "ίеʱ:" <<
-	  pQueryProfitAndLossOrder->
-	  OrderFormTime << "ֹֹӯ״̬:" << pQueryProfitAndLossOrder->
-	  ProfitAndLossOrderStatus << ":" <<
-	  pQueryProfitAndLossOrder->
-	  ConditionalOrderID << ":" << pQueryProfitAndLossOrder->
-	  ExchangeID << "ͻ:" << pQueryProfitAndLossOrder->
-	  ClientID << "Լ:" << pQueryProfitAndLossOrder->
-	  InstrumentID << "ƽ־:" << pQueryProfitAndLossOrder->
-	  CombOffsetFlag << "Ͷױ־:" << pQueryProfitAndLossOrder->
-	  CombHedgeFlag << "" << pQueryProfitAndLossOrder->
-	  Direction << "۸" << pQueryProfitAndLossOrder->
-	  LimitPrice << "" << pQueryProfitAndLossOrder->
-	  VolumeTotalOriginal << "ӯ۵ķʽ" <<
-	  pQueryProfitAndLossOrder->
-	  OffsetValue << "ҵԪ" << pQueryProfitAndLossOrder->
-	  BusinessUnit << "۸" << pQueryProfitAndLossOrder->
-	  SpringType << "ֹ" << pQueryProfitAndLossOrder->
-	  FloatLimitPrice << "ֳɽ۸" << pQueryProfitAndLossOrder->
-	  OpenTradePrice << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    logProfitAndLoss ("query", pQueryProfitAndLossOrder, pRspInfo,
+		      nRequestID);
+    if (m_pCos != NULL)
+      m_pCos->onRspProfitAndLoss (pQueryProfitAndLossOrder, pRspInfo,
+				  nRequestID);
   }
 
+
   ///ֹֹӯɾӦ
   virtual void
     OnRspRemoveProfitAndLossOrder (CKSProfitAndLossOrderRemoveField *
@@ -1832,131 +1760,84 @@ public:
 				   CThostFtdcRspInfoField * pRspInfo,
 				   int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss delete\n");
-    if (pRemoveProfitAndLossOrder != NULL)
-      {
-
-	cout << "OnRspRemoveProfitAndLossOrder:"
-	  << "Ӫҵ:" << pRemoveProfitAndLossOrder->BrokerID
-	  << "Ͷߴ" << pRemoveProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ" << pRemoveProfitAndLossOrder->
-	  ProfitAndLossOrderID << endl;
-
-      }
-
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    if (pRemoveProfitAndLossOrder == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_INFO, "pl remove request %d order %d error %d\n",
+	    nRequestID, pRemoveProfitAndLossOrder->ProfitAndLossOrderID,
+	    pRspInfo != NULL ? pRspInfo->ErrorID : 0);
+    if (m_pCos != NULL && (pRspInfo == NULL || pRspInfo->ErrorID == 0))
+      m_pCos->onRemovedProfitAndLoss (pRemoveProfitAndLossOrder->
+				      ProfitAndLossOrderID);
   }
 
+
   ///ѡ֪ͨ
   virtual void OnRtnCOSAskSelect (CKSCOSAskSelectField * pCOSAskSelect)
   {
-    printf ("condition order select Notice\n");
     if (pCOSAskSelect != NULL)
-      {
-
-	cout << "OnRtnCOSAskSelect:"
-	  << "Ӫҵ:" << pCOSAskSelect->BrokerID
-	  << "Ա:" << pCOSAskSelect->UserID
-	  << "Ͷߴ:" << pCOSAskSelect->InvestorID
-	  << "" << pCOSAskSelect->SequenceNo
-	  << ":" << pCOSAskSelect->ConditionalOrderID
-	  << "ע:" << pCOSAskSelect->Memo
-	  << "ѡʽ:" << pCOSAskSelect->SelectType << endl;
-
-      }
+      FC_LOG(LOG_LEVEL_INFO, "cos ask select order %d\n",
+	      pCOSAskSelect->ConditionalOrderID);
   }
 
+
   ///״̬֪ͨ
   virtual void OnRtnCOSStatus (CKSCOSStatusField * pCOSStatus)
   {
-    printf ("condition order status notice\n");
-    if (pCOSStatus != NULL)
-      {
-
-	cout << "OnRtnCOSStatus:"
-	  << "Ӫҵ:" << pCOSStatus->BrokerID
-	  << "Ա:" << pCOSStatus->UserID
-	  << "Ͷߴ:" << pCOSStatus->InvestorID
-	  << ":" << pCOSStatus->SequenceNo
-	  << ":" << pCOSStatus->ConditionalOrderID
-	  << "״̬:" << pCOSStatus->ConditionalOrderStatus
-	  << "ע:" << pCOSStatus->Memo
-	  << "ر:" << pCOSStatus->OrderLocalID
-	  << ":" << pCOSStatus->ExchangeID
-	  << "Լ:" << pCOSStatus->InstrumentID
-	  << "״̬:" << pCOSStatus->OrderStatus
-	  << "ƽ־:" << pCOSStatus->CombOffsetFlag
-	  << "Ͷױ־:" << pCOSStatus->CombHedgeFlag
-	  << ":" << pCOSStatus->Direction
-	  << "۸:" << pCOSStatus->LimitPrice
-	  << ":" << pCOSStatus->VolumeTotalOriginal
-	  << ":" << pCOSStatus->TradingDay
-	  << "û:" << pCOSStatus->CancelUserID
-	  << "ʱ:" << pCOSStatus->CancelTime
-	  << "ͻ:" << pCOSStatus->ClientID
-	  << "ҵԪ:" << pCOSStatus->BusinessUnit
-	  << ":" << pCOSStatus->OrderSysID
-	  << "ɽ:" << pCOSStatus->VolumeTraded
-	  << "ʣ:" << pCOSStatus->VolumeTotal
-	  << "ίʱ:" << pCOSStatus->InsertTime
-	  << "ʱ:" << pCOSStatus->ActiveTime
-	  << "ɽ۸:" << pCOSStatus->TradePrice
-	  << "Ҵ:" << pCOSStatus->CurrencyID << endl;
-      }
+    if (pCOSStatus == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_DEBUG, "cos status order %d seq %d status %c order status %c traded %d\n",
+	    pCOSStatus->ConditionalOrderID, pCOSStatus->SequenceNo,
+	    pCOSStatus->ConditionalOrderStatus, pCOSStatus->OrderStatus,
+	    pCOSStatus->VolumeTraded);
+    if (m_pCos != NULL)
+      m_pCos->onRtnCOSStatus (pCOSStatus);
   }
 
+
   ///ֹֹӯ״̬֪ͨ
   virtual void OnRtnPLStatus (CKSPLStatusField * pPLStatus)
   {
-    printf ("profit and loss order status notice\n");
-    if (pPLStatus != NULL)
-      {
-
-	cout << "OnRtnPLStatus:"
-	  << "Ӫҵ:" << pPLStatus->BrokerID
-	  << "Ա:" << pPLStatus->UserID
-	  << "Ͷߴ:" << pPLStatus->InvestorID
-	  << ":" << pPLStatus->SequenceNo
-	  << "ֹֹӯ:" << pPLStatus->ProfitAndLossOrderID
-	  << "ֹ:" << pPLStatus->StopLossOrderID
-	  << "ֹӯ:" << pPLStatus->TakeProfitOrderID
-	  << "ӯ״̬:" << pPLStatus->ProfitAndLossOrderStatus
-	  << "ֹ:" << pPLStatus->StopLossPrice
-	  << "ֹӯ:" << pPLStatus->TakeProfitPrice
-	  << "ӯ۵ķʽ:" << pPLStatus->OffsetValue
-	  << "ֳɽ۸:" << pPLStatus->OpenTradePrice
-	  << "ע:" << pPLStatus->Memo
-	  << "ر:" << pPLStatus->OrderLocalID
-	  << ":" << pPLStatus->ExchangeID
-	  << "Լ:" << pPLStatus->InstrumentID
-	  << "״̬:" << pPLStatus->OrderStatus
-	  << "ƽ־:" << pPLStatus->CombOffsetFlag
-	  << "Ͷױ־:" << pPLStatus->CombHedgeFlag
-	  << ":" << pPLStatus->Direction
-	  << "۸:" << pPLStatus->LimitPrice
-	  << ":" << pPLStatus->VolumeTotalOriginal
-	  << ":" << pPLStatus->TradingDay
-	  << "û:" << pPLStatus->CancelUserID
-	  << "ʱ:" << pPLStatus->CancelTime
-	  << "ͻ:" << pPLStatus->ClientID
-	  << "ҵԪ:" << pPLStatus->BusinessUnit
-	  << ":" << pPLStatus->OrderSysID
-	  << "ɽ:" << pPLStatus->VolumeTraded
-	  << "ʣ:" << pPLStatus->VolumeTotal
-	  << "ίʱ:" << pPLStatus->InsertTime
-	  << "ʱ:" << pPLStatus->ActiveTime
-	  << "ɽ۸:" << pPLStatus->TradePrice
-	  << "Ҵ:" << pPLStatus->CurrencyID << endl;
-
-
-      }
+    if (pPLStatus == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_DEBUG, "pl status order %d seq %d status %c\n",
+	    pPLStatus->ProfitAndLossOrderID, pPLStatus->SequenceNo,
+	    pPLStatus->ProfitAndLossOrderStatus);
+    if (m_pCos != NULL)
+      m_pCos->onRtnPLStatus (pPLStatus);
   }
 
 private:
+  // one line per response, the mirror in CosManager has the details
+  void logConditional (const char *pOper,
+		       CKSConditionalOrderOperResultField * pResult,
+		       CThostFtdcRspInfoField * pRspInfo, int nRequestID)
+  {
+    if (pRspInfo != NULL && pRspInfo->ErrorID != 0)
+      FC_LOG(LOG_LEVEL_WARN, "cos %s request %d error %d %s\n", pOper,
+	      nRequestID, pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+    else if (pResult != NULL)
+      FC_LOG(LOG_LEVEL_INFO, "cos %s request %d order %d %s %c %d@%.04f status %c\n",
+	      pOper, nRequestID, pResult->ConditionalOrderID,
+	      pResult->InstrumentID, pResult->Direction,
+	      pResult->VolumeTotalOriginal, pResult->LimitPrice,
+	      pResult->ConditionalOrderStatus);
+  }
 
+  void logProfitAndLoss (const char *pOper,
+			 CKSProfitAndLossOrderOperResultField * pResult,
+			 CThostFtdcRspInfoField * pRspInfo, int nRequestID)
+  {
+    if (pRspInfo != NULL && pRspInfo->ErrorID != 0)
+      FC_LOG(LOG_LEVEL_WARN, "pl %s request %d error %d %s\n", pOper,
+	      nRequestID, pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+    else if (pResult != NULL)
+      FC_LOG(LOG_LEVEL_INFO, "pl %s request %d order %d %s sl %.04f tp %.04f status %c\n",
+	      pOper, nRequestID, pResult->ProfitAndLossOrderID,
+	      pResult->InstrumentID, pResult->StopLossPrice,
+	      pResult->TakeProfitPrice, pResult->ProfitAndLossOrderStatus);
+  }
+
+  CosManager *m_pCos;
 };
 
 void
@@ -2144,14 +2025,173 @@ FormatProfitAndLossModifyData (CKSProfitAndLossOrderModify *
 }
 const int MAX_CONNECTION = 1;
 
+// risk limits, one "InstrumentID MaxOrderVolume MaxPosition MaxNotional"
+// per line, InstrumentID * for the defaults
+static void loadRiskLimits(CTraderHandler *pSpi, const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+    {
+        FC_LOG(LOG_LEVEL_ERROR, "cannot open risk limit file %s\n", pFile);
+        return;
+    }
+    char chLine[256];
+    char chInstrumentID[64];
+    RiskLimits limits;
+    int nLoaded = 0;
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        if (sscanf(chLine, "%63s %d %d %lf", chInstrumentID, &limits.nMaxOrderVolume, &limits.nMaxPosition, &limits.dMaxNotional) != 4 || chInstrumentID[0] == '#')
+            continue;
+        if (strcmp(chInstrumentID, "*") == 0)
+            pSpi->m_risk.setDefaultLimits(limits);
+        else
+            pSpi->m_risk.setLimits(chInstrumentID, limits);
+        nLoaded++;
+    }
+    fclose(fp);
+    FC_LOG(LOG_LEVEL_INFO, "loaded %d risk limits from %s\n", nLoaded, pFile);
+}
+
+// orders for the conditional order service, one per line:
+//   cond InstrumentID ExchangeID buy|sell open|close|closetoday|closeyesterday
+//        Volume LimitPrice ge|le ConditionalPrice
+//   pl OrderLocalID ExchangeID StopLossPrice TakeProfitPrice
+// queued now, sent after login within the flow limit
+static void loadCosOrders(CTraderHandler *pSpi, const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+    {
+        FC_LOG(LOG_LEVEL_ERROR, "cannot open cos order file %s\n", pFile);
+        return;
+    }
+    char chLine[256];
+    char chKind[16], chInstrumentID[64], chOrderLocalID[32], chExchangeID[16], chDirection[16], chOffset[16], chCondition[16];
+    int nQueued = 0;
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        if (sscanf(chLine, "%15s", chKind) != 1 || chKind[0] == '#')
+            continue;
+        int nRequestID = -1;
+        if (strcmp(chKind, "cond") == 0)
+        {
+            CKSConditionalOrderInitInsert order;
+            memset(&order, 0, sizeof(order));
+            if (sscanf(chLine, "%*s %63s %15s %15s %15s %d %lf %15s %lf", chInstrumentID, chExchangeID, chDirection, chOffset,
+                       &order.VolumeTotalOriginal, &order.LimitPrice, chCondition, &order.ConditionalPrice) != 8)
+                continue;
+            strncpy(order.InstrumentID, chInstrumentID, sizeof(order.InstrumentID) - 1);
+            strncpy(order.ExchangeID, chExchangeID, sizeof(order.ExchangeID) - 1);
+            order.Direction = strcmp(chDirection, "buy") == 0 ? THOST_FTDC_D_Buy : THOST_FTDC_D_Sell;
+            if (strcmp(chOffset, "close") == 0)
+                order.CombOffsetFlag = THOST_FTDC_OF_Close;
+            else if (strcmp(chOffset, "closetoday") == 0)
+                order.CombOffsetFlag = THOST_FTDC_OF_CloseToday;
+            else if (strcmp(chOffset, "closeyesterday") == 0)
+                order.CombOffsetFlag = THOST_FTDC_OF_CloseYesterday;
+            else
+                order.CombOffsetFlag = THOST_FTDC_OF_Open;
+            order.CombHedgeFlag = THOST_FTDC_HF_Speculation;
+            order.OrderPriceType = KSCOS_OrderPrice_LastPrice;
+            order.ConditionalType = strcmp(chCondition, "ge") == 0 ? KSCOS_GreaterEqualTermPrice : KSCOS_LesserThanTermPrice;
+            order.OrderType = KSCOS_TRIGGERTYPE_QUOTATION;
+            order.TriggeredTimes = 1;
+            strcpy(order.CurrencyID, "RMB");
+            nRequestID = pSpi->m_cos.queueConditional(&order);
+        }
+        else if (strcmp(chKind, "pl") == 0)
+        {
+            CKSProfitAndLossOrderInsert order;
+            memset(&order, 0, sizeof(order));
+            if (sscanf(chLine, "%*s %31s %15s %lf %lf", chOrderLocalID, chExchangeID, &order.StopLossPrice, &order.TakeProfitPrice) != 4)
+                continue;
+            strncpy(order.OrderLocalID, chOrderLocalID, sizeof(order.OrderLocalID) - 1);
+            strncpy(order.ExchangeID, chExchangeID, sizeof(order.ExchangeID) - 1);
+            order.TriggeredTimes = 1;
+            order.CloseMode = '1';
+            order.OffsetValue = '0';
+            order.SpringType = '1';
+            strcpy(order.CurrencyID, "RMB");
+            nRequestID = pSpi->m_cos.queueProfitAndLoss(&order);
+        }
+        if (nRequestID >= 0)
+            nQueued++;
+    }
+    fclose(fp);
+    FC_LOG(LOG_LEVEL_INFO, "queued %d cos orders from %s\n", nQueued, pFile);
+}
+
 int main(int argc, char* argv[])
 {
+    // -risk file: pre-trade risk limits
+    // -triggers file: local stop and price-cross orders
+    // -cos file: conditional and stop-loss/take-profit orders for the broker
+    // -topology file: cpu and scheduling placement of the threads
+    // -config file: account and front settings, see ServiceConfig.h;
+    // -instance name picks the instance's own keys
+    // -daemon: detach and run in the background, -pidfile file: its pid
+    // -log file: log there instead of stdout
+    // SIGTERM or SIGINT log out and exit, SIGHUP reopens the log and
+    // reloads the -risk file
+    const char *pRiskFile = NULL;
+    const char *pTriggerFile = NULL;
+    const char *pCosFile = NULL;
+    bool bDaemon = false;
+    const char *pPidFile = NULL;
+    const char *pLogFile = NULL;
+    const char *pTopologyFile = NULL;
+    const char *pInstance = NULL;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-risk") == 0 && a + 1 < argc)
+            pRiskFile = argv[++a];
+        else if (strcmp(argv[a], "-triggers") == 0 && a + 1 < argc)
+            pTriggerFile = argv[++a];
+        else if (strcmp(argv[a], "-cos") == 0 && a + 1 < argc)
+            pCosFile = argv[++a];
+        else if (strcmp(argv[a], "-topology") == 0 && a + 1 < argc)
+            pTopologyFile = argv[++a];
+        else if (strcmp(argv[a], "-config") == 0 && a + 1 < argc && !ServiceConfig::load(argv[++a]))
+            printf("cannot read config %s\n", argv[a]);
+        else if (strcmp(argv[a], "-instance") == 0 && a + 1 < argc)
+            pInstance = argv[++a];
+        else if (strcmp(argv[a], "-daemon") == 0)
+            bDaemon = true;
+        else if (strcmp(argv[a], "-pidfile") == 0 && a + 1 < argc)
+            pPidFile = argv[++a];
+        else if (strcmp(argv[a], "-log") == 0 && a + 1 < argc)
+            pLogFile = argv[++a];
+    }
+    ServiceConfig::setInstance(pInstance);
+    if (!ServiceConfig::require("broker_id,user_id,password,front"))
+        return 1;
+    if (pTopologyFile == NULL)
+        pTopologyFile = ServiceConfig::get("topology");
+    if (pTopologyFile != NULL && !ThreadTopology::load(pTopologyFile))
+        printf("cannot read thread topology %s\n", pTopologyFile);
+    if (bDaemon && !ServiceControl::daemonize(pPidFile))
+    {
+        printf("cannot start as a daemon\n");
+        return 1;
+    }
+    // before the first thread, every thread inherits the blocked signals
+    ServiceControl::install();
+    ThreadTopology::enter(THREAD_MAIN);
+
+    // callbacks log through the async logger; FC_LOG_LEVEL=tick turns the
+    // depth dumps on, SIGUSR1/SIGUSR2 change the level while running
+    if (!AsyncLogger::start(pLogFile, LOG_LEVEL_INFO))
+    {
+        printf("cannot open log file %s\n", pLogFile);
+        return 1;
+    }
+    AsyncLogger::installLevelSignals();
+
     MarketSubscriber *subscriber = new MarketSubscriber();
     CThostFtdcTraderApi *pUserApi[MAX_CONNECTION] = {0};
     CTraderHandler *pSpi[MAX_CONNECTION] = {0};
 
-    CKSCosApi *pCosAPI = NULL;
-
     for (int i=0; i < MAX_CONNECTION; i++ )
     {
         // create a CThostFtdcTraderApi instance
@@ -2160,35 +2200,62 @@ int main(int argc, char* argv[])
 
         // create an event handler instance
         pSpi[i] = new CTraderHandler(pUserApi[i], subscriber);
+        if (pRiskFile != NULL)
+            loadRiskLimits(pSpi[i], pRiskFile);
+        pSpi[i]->m_pTriggerFile = pTriggerFile;
+        pSpi[i]->m_pCosSpi = new CCosHandler(&pSpi[i]->m_cos);
+        // the queries seeding the mirror are sent before any queued order
+        pSpi[i]->m_cos.queueQueries();
+        if (pCosFile != NULL)
+            loadCosOrders(pSpi[i], pCosFile);
 
         // Create a manual reset event with no signal
         pSpi[i]->m_hEvent = event_create(true, false);
 
-        CCosHandler CosSpiTest;			//һӦʵ
         // set spi's broker, user, passwd
-        strcpy (pSpi[i]->m_chBrokerID, "3748FD77");	// Nanhua Mechantile Broker ID 
+        if (!ServiceConfig::copy("broker_id", pSpi[i]->m_chBrokerID, sizeof(pSpi[i]->m_chBrokerID)) ||
+            !ServiceConfig::copy("user_id", pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)) ||
+            !ServiceConfig::copy("password", pSpi[i]->m_chPassword, sizeof(pSpi[i]->m_chPassword)))
+        {
+            printf("broker_id, user_id or password longer than the api takes\n");
+            return 1;
+        }
 	printf("userid is %s\n", pSpi[i]->m_chBrokerID);
-
-#ifdef WIN32
-	_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)-1, "8023901");
-#else
-        snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "8023901");
-#endif
-        strcpy (pSpi[i]->m_chPassword, "2525");
         //strcpy (pSpi[i]->m_chContract, "al1412");
 
         // register an event handler instance
         pUserApi[i]->RegisterSpi(pSpi[i]);
 
         // register the kingstar front address and port
-	pUserApi[i]->RegisterFront("tcp://124.160.44.166:17159");		// Nanhua Mechantile API 
+	char chFront[CONFIG_VALUE_SIZE];
+	if (!ServiceConfig::copy("front", chFront, sizeof(chFront)))
+	{
+	    printf("front longer than %d characters\n", CONFIG_VALUE_SIZE - 1);
+	    return 1;
+	}
+	pUserApi[i]->RegisterFront(chFront);
 
         // make the connection between client and CTP server
         pUserApi[i]->Init();
     }
 
+    // the callback threads enter at their first callback, the md one only
+    // after the login and the instrument query; roles still missing when
+    // the wait runs out show as not started
+    ThreadTopology::waitStarted(THREAD_TRADER_CALLBACK, 10000);
+    ThreadTopology::waitStarted(THREAD_MD_CALLBACK, 10000);
+    char chTopology[2048];
+    ThreadTopology::report(chTopology, sizeof(chTopology));
+    printf("\n%s", chTopology);
+
     printf ("\npress return to release...\n");
-    getchar();
+    while (ServiceControl::wait(!bDaemon) == SERVICE_RELOAD)
+    {
+        AsyncLogger::reopen();
+        for (int i=0; i < MAX_CONNECTION && pRiskFile != NULL; i++ )
+            pSpi[i]->reloadRiskLimits(pRiskFile);
+    }
+    ServiceControl::beginStop();
 
     for (int i=0; i < MAX_CONNECTION; i++ )
     {
@@ -2204,17 +2271,22 @@ int main(int argc, char* argv[])
         // waiting for quit event
 	event_timedwait((event_handle)pSpi[i]->m_hEvent, 3000/*INFINITE*/);  
 
+        // stop sending to the COS api before it goes away with the session
+        pSpi[i]->m_cos.stop();
+
         // release the API instance
         pUserApi[i]->Release();
 
         // delete pSpi
+        delete pSpi[i]->m_pCosSpi;
         delete pSpi[i];
     }
 
     delete subscriber;
 
-    printf ("\npress return to quit...\n");
-    getchar();
+    // drain the log before exiting
+    AsyncLogger::stop();
+    ServiceControl::exit();
 
     return 0;
 }
@@ -3,10 +3,11 @@
 #include<stdio.h>
 #include<stdlib.h>
 
-#include "event.h"
+#include "../common/event.h"
 #include "../KSMarketDataAPI/KSMarketDataAPI.h"
-#include "MarketApi.h"
 #include "MarketHandler.h"
+#include "../common/AsyncLogger.h"
+#include "../common/ThreadTopology.h"
 
 #include <iostream>
 #ifdef WIN32
@@ -17,29 +18,32 @@
 #include<unistd.h>
 #include<string.h>
 #endif
+// after the STL headers, it defines min and max
+#include "MarketApi.h"
 
 	// constructorwhich need a valid pointer to a CThostFtdcMduserApi instance 
-	MarketHandler::MarketHandler(CThostFtdcMdApi *pUserApi) : m_pUserApi(pUserApi) {}
+	MarketHandler::MarketHandler(CThostFtdcMdApi *pUserApi) : m_pCache(NULL), m_pPositions(NULL), m_pTriggers(NULL), m_pUserApi(pUserApi) {}
 
 	MarketHandler::~MarketHandler() {}
 
 	// After making a succeed connection with the CTP server, the client should send the login request to the CTP server.
     void MarketHandler::OnFrontConnected()
     {
-        printf("OnFrontConnected:\n");
+        ThreadTopology::enter(THREAD_MD_CALLBACK);
+        FC_LOG(LOG_LEVEL_INFO, "OnFrontConnected:\n");
 
         CThostFtdcReqUserLoginField reqUserLogin;
         memset(&reqUserLogin, 0, sizeof(reqUserLogin));
         // set BrokerID
-        printf("BrokerID:%s\n", m_chBrokerID);
+        FC_LOG(LOG_LEVEL_INFO, "BrokerID:%s\n", m_chBrokerID);
         strcpy(reqUserLogin. BrokerID, m_chBrokerID);
 
         // set user id
-        printf("userid:%s\n", m_chUserID);
+        FC_LOG(LOG_LEVEL_INFO, "userid:%s\n", m_chUserID);
         strcpy(reqUserLogin.UserID, m_chUserID);
 
         // set password
-        printf("password:%s\n",m_chPassword);
+        FC_LOG(LOG_LEVEL_INFO, "password:%s\n",m_chPassword);
         strcpy(reqUserLogin.Password, m_chPassword);
 
         // send the login request
@@ -51,16 +55,16 @@
 	void MarketHandler::OnFrontDisconnected(int nReason)
 	{ 
 		//  Inthis  case,  API  willreconnectthe  client  application can ignore this.
-		printf("OnFrontDisconnected.\n");
+		FC_LOG(LOG_LEVEL_INFO, "OnFrontDisconnected.\n");
 	} 
 
 	// After receiving the login request from  the clientthe CTP server will send the following response to notify the client whether the login success or not.
 	void MarketHandler::OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-        printf("OnRspUserLogin:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogin:");
         if (pRspUserLogin != NULL)
         {
-            printf("%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
                 pRspUserLogin->BrokerID,					// ͹˾
                 pRspUserLogin->UserID,						// û
                 pRspUserLogin->TradingDay,					// 
@@ -75,18 +79,18 @@
                 pRspUserLogin->MaxOrderRef					// 󱨵
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
         if (pRspInfo->ErrorID != 0)
 		{
 			// in case any login failure, the client should handle this error.
-			printf("Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
+			FC_LOG(LOG_LEVEL_ERROR, "Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
             return;
 		}
 
 		// get trading day
-		printf("ȡǰ = %s\n",m_pUserApi->GetTradingDay());
+		FC_LOG(LOG_LEVEL_INFO, "ȡǰ = %s\n",m_pUserApi->GetTradingDay());
 
 /*
 		// 鶩б
@@ -106,8 +110,8 @@
 	///RspSubMarketData return
 	void MarketHandler::OnRspSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-		printf("OnRspSubMarketData:%s\n", pSpecificInstrument->InstrumentID);
-		printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+		FC_LOG(LOG_LEVEL_INFO, "OnRspSubMarketData:%s\n", pSpecificInstrument->InstrumentID);
+		FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
 
 /*		if (bIsLast == true)
 		{
@@ -123,8 +127,8 @@
 	///OnRspUnSubMarketData return
 	void MarketHandler::OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-		printf("OnRspUnSubMarketData:\n");
-		printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+		FC_LOG(LOG_LEVEL_INFO, "OnRspUnSubMarketData:\n");
+		FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
 
 		// logout
 /*		CThostFtdcUserLogoutField UserLogout;
@@ -140,10 +144,21 @@
 	///OnRtnDepthMarketData
 	void MarketHandler::OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData)
 	{
-        printf("OnRtnDepthMarketData:");
+        ThreadTopology::enter(THREAD_MD_CALLBACK);
+        if (m_pCache != NULL && pDepthMarketData != NULL)
+        {
+            int nSlot = m_pCache->update(pDepthMarketData);
+            // triggers first, they send orders
+            if (nSlot >= 0 && m_pTriggers != NULL)
+                m_pTriggers->onTick(nSlot, pDepthMarketData);
+            if (nSlot >= 0 && m_pPositions != NULL)
+                m_pPositions->onTick(nSlot);
+        }
+
+        FC_LOG(LOG_LEVEL_TICK, "OnRtnDepthMarketData:");
         if(pDepthMarketData != NULL)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_TICK, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
                 pDepthMarketData->ExchangeID,					// 
                 pDepthMarketData->InstrumentID,					// Լ
                 pDepthMarketData->PreClosePrice,				// 
@@ -181,20 +196,20 @@
                 pDepthMarketData->AskPrice5						// 
                 );
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_TICK, "\n");
 	}
 
 	// logout return
     void MarketHandler::OnRspUserLogout(CThostFtdcUserLogoutField *pUserLogout, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-        printf("OnRspUserLogout:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogout:");
         if (NULL != pUserLogout)
         {
-            printf("%s",pUserLogout->UserID);
+            FC_LOG(LOG_LEVEL_INFO, "%s",pUserLogout->UserID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // inform the main thread order transaction is over 
         //SetEvent(m_hEvent); 
@@ -2,8 +2,11 @@
 #define __MARKET_HANDLER_H__
 
 #include <string>
-#include "event.h"
+#include "../common/event.h"
 #include "../KSMarketDataAPI/KSMarketDataAPI.h"
+#include "../common/LastValueCache.h"
+#include "../common/PositionKeeper.h"
+#include "../common/TriggerEngine.h"
 
 using namespace std;
 using namespace KingstarAPI;
@@ -42,6 +45,15 @@ public:
     // finish event
     event_handle m_hEvent;
 
+    // latest ticks for the trader side, NULL for none
+    LastValueCache *m_pCache;
+
+    // marked to market on every tick, NULL for none
+    PositionKeeper *m_pPositions;
+
+    // local conditional orders evaluated on every tick, NULL for none
+    TriggerEngine *m_pTriggers;
+
 private: 
      // a pointer of CThostFtdcMduserApi instance
      CThostFtdcMdApi *m_pUserApi;
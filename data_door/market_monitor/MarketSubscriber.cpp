@@ -2,7 +2,8 @@
 //
 #include "MarketSubscriber.h"
 #include "MarketHandler.h"
-#include "event.h"
+#include "../common/event.h"
+#include "../common/ServiceConfig.h"
 #include "../KSMarketDataAPI/KSMarketDataAPI.h"
 #include<stdlib.h>
 #include<stdio.h>
@@ -41,13 +42,9 @@ void MarketSubscriber::init()
         handler->m_hEvent = event_create(true, false);
 
         //set spi's broker, user, passwd
-        strcpy (handler->m_chBrokerID, "3748FD77");	// Nanhua Mechantile Broker ID 
-#ifdef WIN32
-	_snprintf(handler->m_chUserID, sizeof(handler->m_chUserID)-1, "8023901");
-#else
-        snprintf(handler->m_chUserID, sizeof(handler->m_chUserID), "8023901");
-#endif
-        strcpy (handler->m_chPassword, "2525");
+        ServiceConfig::copy("broker_id", handler->m_chBrokerID, sizeof(handler->m_chBrokerID));
+        ServiceConfig::copy("user_id", handler->m_chUserID, sizeof(handler->m_chUserID));
+        ServiceConfig::copy("password", handler->m_chPassword, sizeof(handler->m_chPassword));
 
         strcpy (handler->m_chContract, "al1412");
 
@@ -55,7 +52,9 @@ void MarketSubscriber::init()
         marketApi->RegisterSpi(handler);
 
         //register the kingstar front address and port
-	marketApi->RegisterFront("tcp://124.160.44.166:17159");		// Nanhua Mechantile API 
+	char chFront[CONFIG_VALUE_SIZE];
+	strcpy(chFront, ServiceConfig::get("md_front", ServiceConfig::get("front")));
+	marketApi->RegisterFront(chFront);
         //make the connection between client and CTP server
         marketApi->Init();
 }
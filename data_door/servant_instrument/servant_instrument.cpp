@@ -1,9 +1,16 @@
 // servant_intrument.cpp : Defines the entry point for the console application.
 
 #include "servant_instrument.h"
-#include "event.h"
+#include "../common/event.h"
 #include "ClientSocket.h"
 #include "SocketException.h"
+#include "../common/AsyncLogger.h"
+#include "../common/OrderManager.h"
+#include "../common/PendingRequests.h"
+#include "../common/ThreadTopology.h"
+#include "../common/ServiceControl.h"
+#include "../common/ServiceConfig.h"
+#include "../common/OptionSurface.h"
 #include "../KSTradeAPI/KSTradeAPI.h"
 #include "../CTP/KSCosApiDataType.h"
 #include "../CTP/KSCosApiStruct.h"
@@ -48,12 +55,181 @@ public:
     // finish event
     HANDLE m_hEvent;
 
+    // orders and trades of the session
+    OrderManager m_orders;
+
+    // requests sent with ids from the table, their rows go to the waiting
+    // futures instead of the callbacks below
+    PendingRequests m_pending;
+
+    // set once logged in
+    HANDLE m_hLogin;
+
+    // run the query chain from the login callback, off when main() sends
+    // the startup queries itself
+    bool m_bChain;
+
+    // the option table of servant_market's -options, written under a .tmp
+    // name and renamed once whole; NULL when not asked for
+    FILE *m_pOptionTable;
+    char m_chOptionTable[CONFIG_VALUE_SIZE];
+
+    // KSOptionApi of the session, NULL without one; its spot option
+    // parameters end the table. Loaded at login when m_pOptionSpi is set,
+    // before the instrument query that ends in finishOptionTable()
+    CKSOptionApi *m_pOptionApi;
+    CKSOptionSpi *m_pOptionSpi;
+
 
 public: 
     // constructorwhich need a valid pointer to a CThostFtdcMduserApi instance 
-    CSimpleHandler(CThostFtdcTraderApi *pUserApi) : m_pUserApi(pUserApi), m_nRequestID(0) {}
+    CSimpleHandler(CThostFtdcTraderApi *pUserApi) : m_nRequestID(0), m_hLogin(NULL), m_bChain(true), m_pOptionTable(NULL),
+        m_pOptionApi(NULL), m_pOptionSpi(NULL), m_pUserApi(pUserApi) {}
+
+    ~CSimpleHandler()
+    {
+        // left under its .tmp name, servant_market keeps the last whole one
+        if (m_pOptionTable != NULL)
+            fclose(m_pOptionTable);
+    }
+
+    bool openOptionTable(const char *pFile)
+    {
+        char chTemp[CONFIG_VALUE_SIZE + 8];
+        snprintf(m_chOptionTable, sizeof(m_chOptionTable), "%s", pFile);
+        snprintf(chTemp, sizeof(chTemp), "%s.tmp", pFile);
+        m_pOptionTable = fopen(chTemp, "w");
+        return m_pOptionTable != NULL;
+    }
 
-    ~CSimpleHandler() {}
+    // an option of the instrument list into the table, other instruments
+    // are skipped
+    void writeOption(const CThostFtdcInstrumentField &instrument)
+    {
+        char chLine[256];
+        if (m_pOptionTable != NULL && option_table_line(instrument, chLine, sizeof(chLine)) > 0)
+            fputs(chLine, m_pOptionTable);
+    }
+
+    void writeSpot(const CKSSpotOptionParamsField &params)
+    {
+        char chLine[128];
+        if (m_pOptionTable != NULL && option_spot_line(params, chLine, sizeof(chLine)) > 0)
+            fputs(chLine, m_pOptionTable);
+    }
+
+    // the instrument list is in: ask for the spot option parameters, whose
+    // last response closes the table, or close it now
+    void finishOptionTable()
+    {
+        if (m_pOptionTable == NULL)
+            return;
+        if (m_pOptionApi != NULL)
+        {
+            CKSQrySpotOptionParamsField QrySpotOptionParams;
+            memset(&QrySpotOptionParams, 0, sizeof(QrySpotOptionParams));
+            strcpy(QrySpotOptionParams.BrokerID, m_chBrokerID);
+            strcpy(QrySpotOptionParams.InvestorID, m_chUserID);
+            if (m_pOptionApi->ReqQrySpotOptionParams(&QrySpotOptionParams, m_nRequestID++) == 0)
+                return;
+            FC_LOG(LOG_LEVEL_WARN, "spot option parameters not queried, the table goes without them\n");
+        }
+        closeOptionTable();
+    }
+
+    void closeOptionTable()
+    {
+        if (m_pOptionTable == NULL)
+            return;
+        fclose(m_pOptionTable);
+        m_pOptionTable = NULL;
+        char chTemp[CONFIG_VALUE_SIZE + 8];
+        snprintf(chTemp, sizeof(chTemp), "%s.tmp", m_chOptionTable);
+        if (rename(chTemp, m_chOptionTable) != 0)
+            FC_LOG(LOG_LEVEL_ERROR, "cannot rename %s to %s\n", chTemp, m_chOptionTable);
+        else
+            FC_LOG(LOG_LEVEL_INFO, "option table %s written\n", m_chOptionTable);
+    }
+
+    // one query through the request table, resent while the front's flow
+    // control refuses it (-2 outstanding, -3 per second); returns once the
+    // last row is in, the caller releases the result
+    template <class Field, class Req>
+    RequestFuture<Field> query(int (CThostFtdcTraderApi::*pfnReq)(Req *, int), Req *pReq)
+    {
+        for (int nTry = 0; ; nTry++)
+        {
+            RequestFuture<Field> result = sendRequest<Field>(&m_pending, m_pUserApi, pfnReq, pReq);
+            if (!result.wait(10000))
+            {
+                FC_LOG(LOG_LEVEL_WARN, "request %d timed out\n", result.requestID());
+                return result;
+            }
+            if ((result.errorID() != -2 && result.errorID() != -3) || nTry == 10)
+                return result;
+            result.release();
+            sleep(1);
+        }
+    }
+
+    // send an order, the future completes with its first OnRtnOrder or
+    // with the rejection
+    RequestFuture<CThostFtdcOrderField> insertOrder(CThostFtdcInputOrderField *pInputOrder)
+    {
+        int nRequestID = m_pending.begin(sizeof(CThostFtdcOrderField));
+        if (nRequestID >= 0)
+        {
+            pInputOrder->RequestID = nRequestID;
+            m_orders.onInsert(pInputOrder);
+            int nResult = m_pUserApi->ReqOrderInsert(pInputOrder, nRequestID);
+            if (nResult != 0)
+                m_pending.fail(nRequestID, nResult);
+        }
+        return RequestFuture<CThostFtdcOrderField>(&m_pending, nRequestID);
+    }
+
+    // the startup queries of the login chain as one sequence on the calling
+    // thread; not on the api thread, the waits would block its responses
+    void querySnapshot()
+    {
+        CThostFtdcQryTradingAccountField QryTradingAccount;
+        memset(&QryTradingAccount, 0, sizeof(QryTradingAccount));
+        strcpy(QryTradingAccount.BrokerID, m_chBrokerID);
+        strcpy(QryTradingAccount.InvestorID, m_chUserID);
+        RequestFuture<CThostFtdcTradingAccountField> account =
+            query<CThostFtdcTradingAccountField>(&CThostFtdcTraderApi::ReqQryTradingAccount, &QryTradingAccount);
+        if (account.size() > 0)
+            FC_LOG(LOG_LEVEL_INFO, "account %s balance %.04f available %.04f margin %.04f\n", account[0].AccountID,
+                   account[0].Balance, account[0].Available, account[0].CurrMargin);
+        account.release();
+
+        CThostFtdcQryInstrumentField QryInstrument;
+        memset(&QryInstrument, 0, sizeof(QryInstrument));
+        RequestFuture<CThostFtdcInstrumentField> instruments =
+            query<CThostFtdcInstrumentField>(&CThostFtdcTraderApi::ReqQryInstrument, &QryInstrument);
+        for (int i = 0; i < instruments.size(); i++)
+        {
+            const CThostFtdcInstrumentField &ins = instruments[i];
+            publish(format("%s|%s|%s|%s|%d|%s|%s|%.04f|%d|", "FCMESSAGE_TYPE_INSTRUMENT", ins.ExchangeID, ins.InstrumentID,
+                           ins.InstrumentName, ins.VolumeMultiple, ins.ExpireDate, ins.ProductID, ins.PriceTick,
+                           instruments.requestID()));
+            writeOption(ins);
+        }
+        FC_LOG(LOG_LEVEL_INFO, "%d instruments, error %d\n", instruments.size(), instruments.errorID());
+        instruments.release();
+        finishOptionTable();
+
+        CThostFtdcQryInvestorPositionDetailField QryPositionDetail;
+        memset(&QryPositionDetail, 0, sizeof(QryPositionDetail));
+        strcpy(QryPositionDetail.BrokerID, m_chBrokerID);
+        strcpy(QryPositionDetail.InvestorID, m_chUserID);
+        RequestFuture<CThostFtdcInvestorPositionDetailField> positions =
+            query<CThostFtdcInvestorPositionDetailField>(&CThostFtdcTraderApi::ReqQryInvestorPositionDetail, &QryPositionDetail);
+        for (int i = 0; i < positions.size(); i++)
+            FC_LOG(LOG_LEVEL_INFO, "position %s %c %d@%.04f opened %s\n", positions[i].InstrumentID, positions[i].Direction,
+                   positions[i].Volume, positions[i].OpenPrice, positions[i].OpenDate);
+        positions.release();
+    }
 
     //missing string printf
     //this is safe and convenient but not exactly efficient
@@ -81,7 +257,9 @@ public:
 	std::string reply = "No Uuid Received"; 
 	try
 	{
-	      ClientSocket client_socket ( "localhost", 9999 );
+	      static std::string s_host = ServiceConfig::get("publisher_host", "localhost");
+	      static int s_nPort = ServiceConfig::getInt("publisher_port", 9999);
+	      ClientSocket client_socket ( s_host, s_nPort );
 
 	      try
 		{
@@ -90,12 +268,12 @@ public:
 		}
 	      catch ( SocketException& ) {}
 
-	      std::cout << "Received uuid for the message:\n\"" << reply << "\"\n";;
+	      FC_LOG(LOG_LEVEL_INFO, "Received uuid for the message:\n\"%s\"\n", reply.c_str());
 
 	}
 	catch ( SocketException& e )
 	{
-	      std::cout << "Exception was caught:" << e.description() << "\n";
+	      FC_LOG(LOG_LEVEL_ERROR, "Exception was caught:%s\n", e.description().c_str());
 	}
 
 	return reply;
@@ -105,20 +283,21 @@ public:
     // After making a succeed connection with the CTP server, the client should send the login request to the CTP server.
     virtual void OnFrontConnected()
     {
-        printf("OnFrontConnected:\n");
+        ThreadTopology::enter(THREAD_TRADER_CALLBACK);
+        FC_LOG(LOG_LEVEL_INFO, "OnFrontConnected:\n");
 
         CThostFtdcReqUserLoginField reqUserLogin;
         memset(&reqUserLogin, 0, sizeof(reqUserLogin));
         // set BrokerID
-        printf("BrokerID:%s\n", m_chBrokerID);
+        FC_LOG(LOG_LEVEL_INFO, "BrokerID:%s\n", m_chBrokerID);
         strcpy(reqUserLogin. BrokerID, m_chBrokerID);
 
         // set user id
-        printf("userid:%s\n", m_chUserID);
+        FC_LOG(LOG_LEVEL_INFO, "userid:%s\n", m_chUserID);
         strcpy(reqUserLogin.UserID, m_chUserID);
 
         // set password
-        printf("password:%s\n",m_chPassword);
+        FC_LOG(LOG_LEVEL_INFO, "password:%s\n",m_chPassword);
         strcpy(reqUserLogin.Password, m_chPassword);
 
         // send the login request
@@ -129,39 +308,43 @@ public:
     virtual void OnFrontDisconnected(int nReason)
     { 
         //  Inthis  case,  API  willreconnectthe  client  application can ignore this.
-        printf("OnFrontDisconnected.\n");
+        FC_LOG(LOG_LEVEL_INFO, "OnFrontDisconnected.\n");
     } 
 
     virtual void OnRtnInstrumentStatus(CThostFtdcInstrumentStatusField *pInstrumentStatus)
     {
-        printf("OnRtnInstrumentStatus:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRtnInstrumentStatus:");
         if (NULL != pInstrumentStatus)
         {
-            printf("%s-%c-%c",pInstrumentStatus->ExchangeID, pInstrumentStatus->InstrumentStatus, pInstrumentStatus->EnterReason);
+            FC_LOG(LOG_LEVEL_INFO, "%s-%c-%c",pInstrumentStatus->ExchangeID, pInstrumentStatus->InstrumentStatus, pInstrumentStatus->EnterReason);
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_INFO, "\n");
     }
 
     ///¼ر
     virtual void OnErrRtnOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo)
     {
-        printf("OnErrRtnOrderInsert:\n");
+        FC_LOG(LOG_LEVEL_INFO, "OnErrRtnOrderInsert:\n");
+        if (pInputOrder != NULL)
+            m_pending.onError(pRspInfo, pInputOrder->RequestID);
+        if (pInputOrder != NULL && pRspInfo != NULL && pRspInfo->ErrorID != 0)
+            m_orders.onInsertError(pInputOrder, pRspInfo->ErrorID);
 
     }
 
     ///ر
     virtual void OnErrRtnOrderAction(CThostFtdcOrderActionField *pOrderAction, CThostFtdcRspInfoField *pRspInfo)
     {
-        printf("OnErrRtnOrderAction:\n");
+        FC_LOG(LOG_LEVEL_INFO, "OnErrRtnOrderAction:\n");
     }
 
     // After receiving the login request from the clientthe CTP server will send the following response to notify the client whether the login success or not.
     virtual void OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspUserLogin:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogin:");
         if (pRspUserLogin != NULL)
         {
-            printf("%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
                 pRspUserLogin->BrokerID,					// ͹˾
                 pRspUserLogin->UserID,						// û
                 pRspUserLogin->TradingDay,					// 
@@ -176,18 +359,30 @@ public:
                 pRspUserLogin->MaxOrderRef					// 󱨵
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
         if (pRspInfo->ErrorID != 0)
         {
             // in case any login failure, the client should handle this error.
-            printf("Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
+            FC_LOG(LOG_LEVEL_ERROR, "Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
             return;
         }
+        if (pRspUserLogin != NULL)
+            m_orders.onLogin(pRspUserLogin);
+        if (m_pOptionSpi != NULL && m_pOptionApi == NULL)
+        {
+            m_pOptionApi = (CKSOptionApi *)m_pUserApi->LoadExtApi(m_pOptionSpi, "KSOptionApi");
+            if (m_pOptionApi == NULL)
+                FC_LOG(LOG_LEVEL_WARN, "no KSOptionApi, the option table goes without spot parameters\n");
+        }
+        if (m_hLogin != NULL)
+            event_set((event_handle)m_hLogin);
+        if (!m_bChain)
+            return;
 
         // get trading day
-        // printf("%s\n",m_pUserApi->GetTradingDay());
+        // FC_LOG(LOG_LEVEL_INFO, "%s\n",m_pUserApi->GetTradingDay());
         // qryInvestor request.
         CThostFtdcQryInvestorField Investor;
         memset(&Investor, 0, sizeof(Investor));
@@ -210,10 +405,12 @@ public:
     // investor response
     virtual void OnRspQryInvestor(CThostFtdcInvestorField *pInvestor, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestor:");
+        if (m_pending.onRsp(pInvestor, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestor:");
         if (NULL != pInvestor)
         {
-            printf("%s|%s|%s|%s|%s|%s|%c|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%s|%c|%s|%s|",
                 pInvestor->InvestorID,						// Ͷߴ
                 pInvestor->InvestorName,					// Ͷ
                 pInvestor->IdentifiedCardNo,				// ֤
@@ -224,9 +421,9 @@ public:
                 pInvestor->Mobile,							// ֻ
                 pInvestor->OpenDate);						// 
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg); 
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg); 
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -245,10 +442,12 @@ public:
     // tradeaccount response
     virtual void OnRspQryTradingAccount(CThostFtdcTradingAccountField *pTradingAccount, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTradingAccount:");
+        if (m_pending.onRsp(pTradingAccount, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTradingAccount:");
         if (NULL != pTradingAccount)
         {
-            printf(":%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, ":%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
                 pTradingAccount->AccountID,					// ˺
                 pTradingAccount->PreBalance,				// ϴν׼
                 pTradingAccount->Available,					// ʽ
@@ -262,9 +461,9 @@ public:
                 pTradingAccount->Mortgage,					// Ѻ
                 pTradingAccount->Credit);					// ö
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // QryExchange
         CThostFtdcQryExchangeField QryExchange;
@@ -278,16 +477,18 @@ public:
     // RspQryExchange
     virtual void OnRspQryExchange(CThostFtdcExchangeField *pExchange, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryExchange:");
+        if (m_pending.onRsp(pExchange, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryExchange:");
         if (NULL != pExchange)
         {
-            printf("%s|%s", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s", 
                 pExchange->ExchangeID,					// 
                 pExchange->ExchangeName);				// 
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -304,10 +505,12 @@ public:
     // RspQryInstrument
     virtual void OnRspQryInstrument(CThostFtdcInstrumentField *pInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInstrument:");
+        if (m_pending.onRsp(pInstrument, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInstrument:");
         if (NULL != pInstrument)
         {
-            printf("%s|%s|%s|%d|%s|%s|%.04f|%d|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%d|%s|%s|%.04f|%d|", 
                 pInstrument->ExchangeID,							// 
                 pInstrument->InstrumentID,							// Լ
                 pInstrument->InstrumentName,						// Լ
@@ -327,13 +530,16 @@ public:
                 pInstrument->PriceTick,                                                         // С䶯λ
                 nRequestID);
 	    std::string uuid = publish(mystr);
+            writeOption(*pInstrument);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
+            finishOptionTable();
+
             // QryInvestorPositionDetail
             CThostFtdcQryInvestorPositionDetailField InvestorPositionDetail;
             memset(&InvestorPositionDetail, 0, sizeof(InvestorPositionDetail));
@@ -349,10 +555,12 @@ public:
     // QryInvestorPositionDetail response
     virtual void OnRspQryInvestorPositionDetail(CThostFtdcInvestorPositionDetailField *pInvestorPositionDetail, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestorPositionDetail:");
+        if (m_pending.onRsp(pInvestorPositionDetail, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestorPositionDetail:");
         if (NULL != pInvestorPositionDetail)
         {
-            printf("%s|%s|%s|%s|%s|%c|%c|%d|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%c|%c|%d|%.04f|%.04f|%.04f|",
                 pInvestorPositionDetail->TradingDay,			// 
                 pInvestorPositionDetail->OpenDate,				// 
                 pInvestorPositionDetail->TradeID,				// ɽ
@@ -366,9 +574,9 @@ public:
                 pInvestorPositionDetail->ExchMargin				// ֤
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -389,10 +597,12 @@ public:
     // QryInstrumentMarginRate response
     virtual void OnRspQryInstrumentMarginRate(CThostFtdcInstrumentMarginRateField *pInstrumentMarginRate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInstrumentMarginRate:");
+        if (m_pending.onRsp(pInstrumentMarginRate, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInstrumentMarginRate:");
         if (NULL != pInstrumentMarginRate)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%.04f|%.04f|%.04f|%.04f|",
                 pInstrumentMarginRate->InvestorID,						// Ͷߴ
                 pInstrumentMarginRate->InstrumentID,					// Լ
                 pInstrumentMarginRate->LongMarginRatioByMoney,			// ͷ֤
@@ -400,9 +610,9 @@ public:
                 pInstrumentMarginRate->ShortMarginRatioByMoney,			// ͷ֤
                 pInstrumentMarginRate->ShortMarginRatioByVolume);		// ͷ֤
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -424,10 +634,12 @@ public:
     // QryInstrumentCommissionRate response
     virtual void OnRspQryInstrumentCommissionRate(CThostFtdcInstrumentCommissionRateField *pInstrumentCommissionRate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInstrumentCommissionRate:");
+        if (m_pending.onRsp(pInstrumentCommissionRate, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInstrumentCommissionRate:");
         if (NULL != pInstrumentCommissionRate)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%.04f|",
                 pInstrumentCommissionRate->InvestorID,						// Ͷߴ
                 pInstrumentCommissionRate->InstrumentID,					// Լ
                 pInstrumentCommissionRate->OpenRatioByMoney,				// 
@@ -437,9 +649,9 @@ public:
                 pInstrumentCommissionRate->CloseTodayRatioByMoney,			// ƽ
                 pInstrumentCommissionRate->CloseTodayRatioByVolume);		// ƽ
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -456,10 +668,12 @@ public:
     // output the DepthMarketData result 
     virtual void OnRspQryDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryDepthMarketData:");
+        if (m_pending.onRsp(pDepthMarketData, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_TICK, "OnRspQryDepthMarketData:");
         if(pDepthMarketData != NULL)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_TICK, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
                 pDepthMarketData->ExchangeID,					// 
                 pDepthMarketData->InstrumentID,					// Լ
                 pDepthMarketData->PreClosePrice,				// 
@@ -538,9 +752,9 @@ public:
             std::string uuid = publish(mystr);
 
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_TICK, "\n");
+        FC_LOG(LOG_LEVEL_TICK, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_TICK, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         return;
 
@@ -556,7 +770,7 @@ public:
             // instrument ID 
             strcpy(ord.InstrumentID, m_chContract);
             ///order reference 
-            strcpy(ord.OrderRef, "9");  
+            m_orders.nextOrderRef(ord.OrderRef);
             // user id 
             strcpy(ord.UserID, m_chUserID); 
             // order price type 
@@ -592,6 +806,7 @@ public:
             // request id
             ord.RequestID = m_nRequestID;
 
+            m_orders.onInsert(&ord);
             m_pUserApi->ReqOrderInsert(&ord, m_nRequestID++ );
         }
 
@@ -616,24 +831,32 @@ public:
     // order insertion response 
     virtual void OnRspOrderInsert(CThostFtdcInputOrderField *pInputOrder, CThostFtdcRspInfoField *pRspInfo, int  nRequestID, bool bIsLast) 
     {
-        printf("OnRspOrderInsert:");
+        // the front only answers a rejected insert here
+        m_pending.onError(pRspInfo, nRequestID);
+        FC_LOG(LOG_LEVEL_INFO, "OnRspOrderInsert:");
         if (NULL != pInputOrder)
         {
-            printf("%s", pInputOrder->OrderRef);
+            FC_LOG(LOG_LEVEL_INFO, "%s", pInputOrder->OrderRef);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        if (pInputOrder != NULL && pRspInfo != NULL && pRspInfo->ErrorID != 0)
+            m_orders.onInsertError(pInputOrder, pRspInfo->ErrorID);
 
     }; 
 
     // order insertion return 
     virtual void OnRtnOrder(CThostFtdcOrderField *pOrder) 
     {
-        printf("OnRtnOrder:");
+        ThreadTopology::enter(THREAD_TRADER_CALLBACK);
+        // the first report of an order sent by insertOrder() completes it
+        if (pOrder != NULL)
+            m_pending.onRsp(pOrder, (CThostFtdcRspInfoField *)NULL, pOrder->RequestID, true);
+        FC_LOG(LOG_LEVEL_INFO, "OnRtnOrder:");
         if (NULL != pOrder)
         {
-            printf("%d|%s|OrderSysID:%s|OrderLocalID:%s|%s|%s|%c|%s|%c|%s|%s|%d|%.04f|%d|%d|%s|%s|%s|%c|%c|%c|%c|%.04f|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%d|%s|OrderSysID:%s|OrderLocalID:%s|%s|%s|%c|%s|%c|%s|%s|%d|%.04f|%d|%d|%s|%s|%s|%c|%c|%c|%c|%.04f|%s|%s|",
                 pOrder->SequenceNo,							// 	
                 pOrder->InvestorID,							// ͻ
                 pOrder->OrderSysID,							// ίк
@@ -661,8 +884,12 @@ public:
                 pOrder->OrderRef							// 
                 ); 
         }
-        printf("\n");
-        printf("RequestID=[%d]\n", pOrder->RequestID);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d]\n", pOrder->RequestID);
+
+        int nSlot = m_orders.onRtnOrder(pOrder);
+        if (nSlot >= 0)
+            FC_LOG(LOG_LEVEL_DEBUG, "order slot=%d state=%d traded=%d\n", nSlot, m_orders.order(nSlot).nState, m_orders.order(nSlot).nVolumeTraded);
 
         // order insertion success, then send order action request.
         if (pOrder->OrderStatus == THOST_FTDC_OST_NoTradeQueueing && atoi(pOrder->OrderSysID) != 0)
@@ -708,7 +935,13 @@ public:
         static int s_nTotalBuy = 0;
         static int s_nTotalSell = 0;
 
-        printf("OnRtnTrade:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRtnTrade:");
+        if (NULL != pTrade && m_orders.onRtnTrade(pTrade) == ORDER_DUPLICATE_TRADE)
+        {
+            // replayed after a reconnect, already counted
+            FC_LOG(LOG_LEVEL_INFO, "duplicate trade %s\n", pTrade->TradeID);
+            return;
+        }
         if (NULL != pTrade)
         {
             if (pTrade->Direction == THOST_FTDC_D_Buy)
@@ -716,9 +949,9 @@ public:
             else if (pTrade->Direction == THOST_FTDC_D_Sell)
                 s_nTotalSell += pTrade->Volume;
             else
-                printf ("invalid direction:%c\n", pTrade->Direction);
+                FC_LOG(LOG_LEVEL_INFO, "invalid direction:%c\n", pTrade->Direction);
 
-            printf("%d|%s|%s|%s|%s|ɽ|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|s_nTotalBuy=%d|s_nTotalSell=%d|",
+            FC_LOG(LOG_LEVEL_INFO, "%d|%s|%s|%s|%s|ɽ|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|s_nTotalBuy=%d|s_nTotalSell=%d|",
                 pTrade->SequenceNo,					// 
                 pTrade->InvestorID,					// ͻ
                 pTrade->ExchangeID,					// 
@@ -737,15 +970,17 @@ public:
                 s_nTotalSell
                 );
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_INFO, "\n");
     }
 
     // the error notification caused by client request
     virtual void OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspError:\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        if (m_pending.onError(pRspInfo, nRequestID))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspError:\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // the client should handle the error
     }
@@ -753,10 +988,10 @@ public:
     // output the order action result 
     virtual void OnRspOrderAction(CThostFtdcInputOrderActionField *pInputOrderAction, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspOrderAction:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspOrderAction:");
         if (NULL != pInputOrderAction)
         {
-            printf("%s|OrderSysID:%s|%s|%s|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|OrderSysID:%s|%s|%s|%.04f|",
                 pInputOrderAction->InvestorID,							// ͻ
                 pInputOrderAction->OrderSysID,							// ίк
                 pInputOrderAction->ExchangeID,							// 
@@ -764,22 +999,24 @@ public:
                 pInputOrderAction->LimitPrice							// ίм۸
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
     }
 
     // qryorder return
     virtual void OnRspQryOrder(CThostFtdcOrderField *pOrder, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryOrder:");
+        if (m_pending.onRsp(pOrder, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryOrder:");
         if(pOrder != NULL)
         {
-            printf("%s", pOrder->OrderSysID);
+            FC_LOG(LOG_LEVEL_INFO, "%s", pOrder->OrderSysID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {	
@@ -806,10 +1043,12 @@ public:
     // qrytrade return
     virtual void OnRspQryTrade(CThostFtdcTradeField *pTrade, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTrade:");
+        if (m_pending.onRsp(pTrade, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTrade:");
         if(pTrade != NULL)
         {
-            printf("%s|%s|%s|%s|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|%d",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%c|%c|%c|%d|%.04f|%s|%s|%s|%s|%d",
                 pTrade->InvestorID,							// ͻ
                 pTrade->ExchangeID,							// 
                 pTrade->OrderSysID,							// 
@@ -826,9 +1065,9 @@ public:
                 pTrade->SequenceNo							// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -849,10 +1088,12 @@ public:
     // QryInvestorPosition return
     virtual void OnRspQryInvestorPosition(CThostFtdcInvestorPositionField *pInvestorPosition, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestorPosition:");
+        if (m_pending.onRsp(pInvestorPosition, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestorPosition:");
         if(pInvestorPosition != NULL)
         {
-            printf("%s|%d|%d|%.04f|%.04f|%s|%c|%.04f|%c|%s|%.04f|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%d|%d|%.04f|%.04f|%s|%c|%.04f|%c|%s|%.04f|", 
                 pInvestorPosition->InvestorID,					// ͻ
                 pInvestorPosition->Position,					// ֲܳ
                 pInvestorPosition->TodayPosition,				// ֲֳ
@@ -866,9 +1107,9 @@ public:
                 pInvestorPosition->UseMargin					// ռõı֤
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {	
@@ -887,19 +1128,19 @@ public:
     // QryCFMMCTradingAccountKey return
     virtual void OnRspQryCFMMCTradingAccountKey(CThostFtdcCFMMCTradingAccountKeyField *pCFMMCTradingAccountKey, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryCFMMCTradingAccountKey:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryCFMMCTradingAccountKey:");
         if (NULL != pCFMMCTradingAccountKey)
         {
-            printf("%s|%s|%d|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%d|%s|",
                 pCFMMCTradingAccountKey->AccountID,				   // Ͷʺ
                 pCFMMCTradingAccountKey->ParticipantID,			   // ͹˾ͳһ
                 pCFMMCTradingAccountKey->KeyID,					   // Կ
                 pCFMMCTradingAccountKey->CurrentKey				   // ̬Կ
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -923,18 +1164,18 @@ public:
     // PasswordUpdate return
     virtual void OnRspUserPasswordUpdate(CThostFtdcUserPasswordUpdateField *pUserPasswordUpdate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspUserPasswordUpdate:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserPasswordUpdate:");
         if (NULL != pUserPasswordUpdate)
         {
-            printf("%s|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|",
                 pUserPasswordUpdate->UserID,			// ͻ
                 pUserPasswordUpdate->OldPassword,		// ɿ
                 pUserPasswordUpdate->NewPassword		// ¿
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -958,18 +1199,18 @@ public:
     // TradingAccountPasswordUpdate
     virtual void OnRspTradingAccountPasswordUpdate(CThostFtdcTradingAccountPasswordUpdateField *pTradingAccountPasswordUpdate, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspTradingAccountPasswordUpdate:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspTradingAccountPasswordUpdate:");
         if (NULL != pTradingAccountPasswordUpdate)
         {
-            printf("%s|%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|",
                 pTradingAccountPasswordUpdate->AccountID,				// ʽ˻
                 pTradingAccountPasswordUpdate->OldPassword,				// ɿ
                 pTradingAccountPasswordUpdate->NewPassword				// ¿
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -989,17 +1230,19 @@ public:
     // QrySettlementInfoConfirm return
     virtual void OnRspQrySettlementInfoConfirm(CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQrySettlementInfoConfirm:");
+        if (m_pending.onRsp(pSettlementInfoConfirm, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQrySettlementInfoConfirm:");
         if (NULL != pSettlementInfoConfirm)
         {
-            printf("%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|",
                 pSettlementInfoConfirm->InvestorID,					// ͻ
                 pSettlementInfoConfirm->ConfirmDate					// ȷ
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1021,17 +1264,19 @@ public:
     ///QrySettlementInfo return
     virtual void OnRspQrySettlementInfo(CThostFtdcSettlementInfoField *pSettlementInfo, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQrySettlementInfoConfirm:");
+        if (m_pending.onRsp(pSettlementInfo, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQrySettlementInfoConfirm:");
         if(pSettlementInfo != NULL)
         {
-            printf("%s|%s|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|",
                 pSettlementInfo->InvestorID,			// ͻ
                 pSettlementInfo->Content				// Ϣ
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1052,10 +1297,12 @@ public:
     // QryInvestorPositionCombineDetail return
     virtual void OnRspQryInvestorPositionCombineDetail(CThostFtdcInvestorPositionCombineDetailField *pInvestorPositionCombineDetail, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryInvestorPositionCombineDetail:");
+        if (m_pending.onRsp(pInvestorPositionCombineDetail, pRspInfo, nRequestID, bIsLast))
+            return;
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryInvestorPositionCombineDetail:");
         if(pInvestorPositionCombineDetail != NULL)
         {
-            printf("%s|%s|%s|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%d|%.04f|",
                 pInvestorPositionCombineDetail->InvestorID,					// ͻ
                 pInvestorPositionCombineDetail->ExchangeID,					// 
                 pInvestorPositionCombineDetail->CombInstrumentID,			// ϺԼ
@@ -1063,9 +1310,9 @@ public:
                 pInvestorPositionCombineDetail->Margin						// Ͷ֤߱
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1092,10 +1339,10 @@ public:
     ///ڻʽתڻӦ
     virtual void OnRspFromBankToFutureByFuture(CThostFtdcReqTransferField *pReqTransfer, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) 
     {
-        printf("OnRspFromBankToFutureByFuture:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspFromBankToFutureByFuture:");
         if (NULL != pReqTransfer)
         {
-            printf("%s|%s|%s|%s|%d|%.04f|%c|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%d|%.04f|%c|%c|",
                 pReqTransfer->AccountID,						// Ͷ˺
                 pReqTransfer->BankID,							// д
                 pReqTransfer->BankAccount,						// ˺
@@ -1106,9 +1353,9 @@ public:
                 pReqTransfer->BankAccType						// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1137,10 +1384,10 @@ public:
     ///ڻڻʽתӦ
     virtual void OnRspFromFutureToBankByFuture(CThostFtdcReqTransferField *pReqTransfer, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspFromFutureToBankByFuture:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspFromFutureToBankByFuture:");
         if (NULL != pReqTransfer)
         {
-            printf("%s|%s|%s|%s|%d|%.04f|%c|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%d|%.04f|%c|%c|",
                 pReqTransfer->AccountID,						// Ͷ˺
                 pReqTransfer->BankID,							// д
                 pReqTransfer->BankAccount,						// ˺
@@ -1151,9 +1398,9 @@ public:
                 pReqTransfer->BankAccType						// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1177,10 +1424,10 @@ public:
     ///ڻѯӦ
     virtual void OnRspQueryBankAccountMoneyByFuture(CThostFtdcReqQueryAccountField *pReqQueryAccount, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQueryBankAccountMoneyByFuture:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQueryBankAccountMoneyByFuture:");
         if (NULL != pReqQueryAccount)
         {
-            printf("%s|%s|%s|%s|%d|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%d|%c|",
                 pReqQueryAccount->AccountID,						// Ͷ˺
                 pReqQueryAccount->BankID,							// д
                 pReqQueryAccount->BankAccount,						// ˺
@@ -1189,9 +1436,9 @@ public:
                 pReqQueryAccount->BankAccType						// 
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1212,10 +1459,10 @@ public:
     // TransferSerial return
     virtual void OnRspQryTransferSerial(CThostFtdcTransferSerialField *pTransferSerial, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTransferSerial:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTransferSerial:");
         if (pTransferSerial != NULL)
         {
-            printf("%d|%s|%s|%s|%s|%s|%.04f|%s|%c|%c|",
+            FC_LOG(LOG_LEVEL_INFO, "%d|%s|%s|%s|%s|%s|%.04f|%s|%c|%c|",
                 pTransferSerial->PlateSerial,				// ƽ̨ˮ
                 pTransferSerial->AccountID,					// Ͷ˺
                 pTransferSerial->BankAccount,				// ˺
@@ -1228,9 +1475,9 @@ public:
                 pTransferSerial->AvailabilityFlag			// Ч־
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1246,14 +1493,14 @@ public:
     // notice return
     virtual void OnRspQryNotice(CThostFtdcNoticeField *pNotice, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryNotice:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryNotice:");
         if (NULL != pNotice)
         {
-            printf(":%s", pNotice->Content);
+            FC_LOG(LOG_LEVEL_INFO, ":%s", pNotice->Content);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         if (bIsLast == true)
         {
@@ -1271,27 +1518,27 @@ public:
     // trade notice return
     virtual void OnRspQryTradingNotice(CThostFtdcTradingNoticeField *pTradingNotice, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspQryTradingNotice:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspQryTradingNotice:");
         if (NULL != pTradingNotice)
         {
-            printf(":%s", pTradingNotice->FieldContent);
+            FC_LOG(LOG_LEVEL_INFO, ":%s", pTradingNotice->FieldContent);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
     }
 
     // logout return
     virtual void OnRspUserLogout(CThostFtdcUserLogoutField *pUserLogout, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
     {
-        printf("OnRspUserLogout:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogout:");
         if (NULL != pUserLogout)
         {
-            printf("%s",pUserLogout->UserID);
+            FC_LOG(LOG_LEVEL_INFO, "%s",pUserLogout->UserID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // inform the main thread order transaction is over 
         ///SetEvent(m_hEvent); 
@@ -1304,6 +1551,26 @@ private:
     CThostFtdcTraderApi *m_pUserApi;
 };
 
+// KSOptionApi responses: the spot option parameters end the option table
+class COptionHandler : public CKSOptionSpi
+{
+public:
+    COptionHandler(CSimpleHandler *pSpi) : m_pSpi(pSpi) {}
+
+    virtual void OnRspQrySpotOptionParams(CKSSpotOptionParamsField *pParams, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+    {
+        if (pRspInfo != NULL && pRspInfo->ErrorID != 0)
+            FC_LOG(LOG_LEVEL_WARN, "spot option parameters: error %d %s\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        if (pParams != NULL)
+            m_pSpi->writeSpot(*pParams);
+        if (bIsLast)
+            m_pSpi->closeOptionTable();
+    }
+
+private:
+    CSimpleHandler *m_pSpi;
+};
+
 class CCosHandler:public CKSCosSpi
 {
 public:
@@ -1315,6 +1582,7 @@ public:
   {
   }
 
+
   //¼Ӧ
   virtual void
     OnRspInitInsertConditionalOrder (CKSConditionalOrderOperResultField *
@@ -1322,90 +1590,21 @@ public:
 				     CThostFtdcRspInfoField * pRspInfo,
 				     int nRequestID, bool bIsLast)
   {
-
-    printf ("hello insert\n");
-    if (pInitInsertConditionalOrder != NULL)
-      {
-
-
-	cout << "OnRspInitInsertConditionalOrder:"
-	  << "ù˾:" << pInitInsertConditionalOrder->BrokerID
-	  << "ͻ:" << pInitInsertConditionalOrder->InvestorID
-	  << ":" << pInitInsertConditionalOrder->ConditionalOrderID
-	  << "ر:" << pInitInsertConditionalOrder->OrderLocalID
-	  << ":" << pInitInsertConditionalOrder->ExchangeID
-	  << "Լ:" << pInitInsertConditionalOrder->InstrumentID
-	  << "״̬:" << pInitInsertConditionalOrder->OrderStatus
-	  << ":" << pInitInsertConditionalOrder->Direction
-	  << "ƽֱ־:" << pInitInsertConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pInitInsertConditionalOrder->CombHedgeFlag
-	  << "ί:" << pInitInsertConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pInitInsertConditionalOrder->LimitPrice
-	  << ":" << pInitInsertConditionalOrder->TradingDay
-	  << "û:" << pInitInsertConditionalOrder->UserID
-	  << "ʱ:" << pInitInsertConditionalOrder->CancelTime
-	  << "ͻ:" << pInitInsertConditionalOrder->ClientID
-	  << "״̬:" << pInitInsertConditionalOrder->
-	  ConditionalOrderStatus << "Ϣ:" <<
-	  pInitInsertConditionalOrder->
-	  ErrorMsg << "۸:" << pInitInsertConditionalOrder->
-	  OrderPriceType << ":" << pInitInsertConditionalOrder->
-	  TriggeredTimes << ":" << pInitInsertConditionalOrder->
-	  OrderType << "ע:" << pInitInsertConditionalOrder->
-	  Memo << "Чʱ:" << pInitInsertConditionalOrder->
-	  ActiveTime << "ʧЧʱ:" << pInitInsertConditionalOrder->
-	  InActiveTime << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-
-
-
+    logConditional ("insert", pInitInsertConditionalOrder, pRspInfo,
+		    nRequestID);
   }
 
+
   //ѯӦ
   virtual void OnRspQueryConditionalOrder (CKSConditionalOrderOperResultField
 					   * pQueryConditionalOrder,
 					   CThostFtdcRspInfoField * pRspInfo,
 					   int nRequestID, bool bIsLast)
   {
-    printf ("hello query\n");
-    if (pQueryConditionalOrder != NULL)
-      {
-	cout << "OnRspQueryConditionalOrder:"
-	  << "ù˾:" << pQueryConditionalOrder->BrokerID
-	  << "ͻ:" << pQueryConditionalOrder->InvestorID
-	  << ":" << pQueryConditionalOrder->ConditionalOrderID
-	  << "ر:" << pQueryConditionalOrder->OrderLocalID
-	  << ":" << pQueryConditionalOrder->ExchangeID
-	  << "Լ:" << pQueryConditionalOrder->InstrumentID
-	  << "״̬:" << pQueryConditionalOrder->OrderStatus
-	  << ":" << pQueryConditionalOrder->Direction
-	  << "ƽֱ־:" << pQueryConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pQueryConditionalOrder->CombHedgeFlag
-	  << "ί:" << pQueryConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pQueryConditionalOrder->LimitPrice
-	  << ":" << pQueryConditionalOrder->TradingDay
-	  << "û:" << pQueryConditionalOrder->UserID
-	  << "ʱ:" << pQueryConditionalOrder->CancelTime
-	  << "ͻ:" << pQueryConditionalOrder->ClientID
-	  << "״̬:" << pQueryConditionalOrder->ConditionalOrderStatus
-	  << "Ϣ:" << pQueryConditionalOrder->ErrorMsg
-	  << "۸:" << pQueryConditionalOrder->OrderPriceType
-	  << ":" << pQueryConditionalOrder->TriggeredTimes
-	  << ":" << pQueryConditionalOrder->OrderType
-	  << "ע:" << pQueryConditionalOrder->Memo
-	  << "Чʱ:" << pQueryConditionalOrder->ActiveTime
-	  << "ʧЧʱ:" << pQueryConditionalOrder->InActiveTime << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+    logConditional ("query", pQueryConditionalOrder, pRspInfo, nRequestID);
   }
 
+
   //޸Ӧ
   virtual void
     OnRspModifyConditionalOrder (CKSConditionalOrderOperResultField *
@@ -1413,128 +1612,48 @@ public:
 				 CThostFtdcRspInfoField * pRspInfo,
 				 int nRequestID, bool bIsLast)
   {
-    printf ("hello modify\n");
-    if (pModifyConditionalOrder != NULL)
-      {
-	cout << "OnRspModifyConditionalOrder:"
-	  << "ù˾:" << pModifyConditionalOrder->BrokerID
-	  << "ͻ:" << pModifyConditionalOrder->InvestorID
-	  << ":" << pModifyConditionalOrder->ConditionalOrderID
-	  << "ر:" << pModifyConditionalOrder->OrderLocalID
-	  << ":" << pModifyConditionalOrder->ExchangeID
-	  << "Լ:" << pModifyConditionalOrder->InstrumentID
-	  << "״̬:" << pModifyConditionalOrder->OrderStatus
-	  << ":" << pModifyConditionalOrder->Direction
-	  << "ƽֱ־:" << pModifyConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pModifyConditionalOrder->CombHedgeFlag
-	  << "ί:" << pModifyConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pModifyConditionalOrder->LimitPrice
-	  << ":" << pModifyConditionalOrder->TradingDay
-	  << "û:" << pModifyConditionalOrder->UserID
-	  << "ʱ:" << pModifyConditionalOrder->CancelTime
-	  << "ͻ:" << pModifyConditionalOrder->ClientID
-	  << "״̬:" << pModifyConditionalOrder->ConditionalOrderStatus
-	  << "Ϣ:" << pModifyConditionalOrder->ErrorMsg
-	  << "۸:" << pModifyConditionalOrder->OrderPriceType
-	  << ":" << pModifyConditionalOrder->TriggeredTimes
-	  << ":" << pModifyConditionalOrder->OrderType
-	  << "ע:" << pModifyConditionalOrder->Memo
-	  << "Чʱ:" << pModifyConditionalOrder->ActiveTime
-	  << "ʧЧʱ:" << pModifyConditionalOrder->InActiveTime << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+    logConditional ("modify", pModifyConditionalOrder, pRspInfo, nRequestID);
   }
 
+
   //ͣӦ
   virtual void OnRspPauseConditionalOrder (CKSConditionalOrderOperResultField
 					   * pPauseConditionalOrder,
 					   CThostFtdcRspInfoField * pRspInfo,
 					   int nRequestID, bool bIsLast)
   {
-    printf ("hello pause or active\n");
-    if (pPauseConditionalOrder != NULL)
-      {
-	cout << "OnRspPauseConditionalOrder:"
-	  << "ù˾:" << pPauseConditionalOrder->BrokerID
-	  << "ͻ:" << pPauseConditionalOrder->InvestorID
-	  << ":" << pPauseConditionalOrder->ConditionalOrderID
-	  << "ر:" << pPauseConditionalOrder->OrderLocalID
-	  << ":" << pPauseConditionalOrder->ExchangeID
-	  << "Լ:" << pPauseConditionalOrder->InstrumentID
-	  << "״̬:" << pPauseConditionalOrder->OrderStatus
-	  << ":" << pPauseConditionalOrder->Direction
-	  << "ƽֱ־:" << pPauseConditionalOrder->CombOffsetFlag
-	  << "Ͷ:" << pPauseConditionalOrder->CombHedgeFlag
-	  << "ί:" << pPauseConditionalOrder->VolumeTotalOriginal
-	  << "ίм۸:" << pPauseConditionalOrder->LimitPrice
-	  << ":" << pPauseConditionalOrder->TradingDay
-	  << "û:" << pPauseConditionalOrder->UserID
-	  << "ʱ:" << pPauseConditionalOrder->CancelTime
-	  << "ͻ:" << pPauseConditionalOrder->ClientID
-	  << "״̬:" << pPauseConditionalOrder->ConditionalOrderStatus
-	  << "Ϣ:" << pPauseConditionalOrder->ErrorMsg
-	  << "۸:" << pPauseConditionalOrder->OrderPriceType
-	  << ":" << pPauseConditionalOrder->TriggeredTimes
-	  << ":" << pPauseConditionalOrder->OrderType
-	  << "ע:" << pPauseConditionalOrder->Memo
-	  << "Чʱ:" << pPauseConditionalOrder->ActiveTime
-	  << "ʧЧʱ:" << pPauseConditionalOrder->InActiveTime << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    logConditional ("pause", pPauseConditionalOrder, pRspInfo, nRequestID);
   }
 
+
   //ɾӦ
   virtual void OnRspRemoveConditionalOrder (CKSConditionalOrderRspResultField
 					    * pRemoveConditionalOrder,
 					    CThostFtdcRspInfoField * pRspInfo,
 					    int nRequestID, bool bIsLast)
   {
-    printf ("hello remove\n");
-    if (pRemoveConditionalOrder != NULL)
-      {
-
-	cout << "OnRspRemoveConditionalOrder:"
-	  << "Ӫҵ:" << pRemoveConditionalOrder->BrokerID
-	  << "Ͷߴ:" << pRemoveConditionalOrder->InvestorID
-	  << ":" << pRemoveConditionalOrder->
-	  ConditionalOrderID << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    if (pRemoveConditionalOrder == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_INFO, "cos remove request %d order %d error %d\n",
+	    nRequestID, pRemoveConditionalOrder->ConditionalOrderID,
+	    pRspInfo != NULL ? pRspInfo->ErrorID : 0);
   }
 
+
   //ѡӦ
   virtual void OnRspSelectConditionalOrder (CKSConditionalOrderRspResultField
 					    * pSelectConditionalOrder,
 					    CThostFtdcRspInfoField * pRspInfo,
 					    int nRequestID, bool bIsLast)
   {
-    printf ("hello select\n");
-    if (pSelectConditionalOrder != NULL)
-      {
-
-	cout << "OnRspSelectConditionalOrder:"
-	  << "Ӫҵ:" << pSelectConditionalOrder->BrokerID
-	  << "Ͷߴ:" << pSelectConditionalOrder->InvestorID
-	  << ":" << pSelectConditionalOrder->
-	  ConditionalOrderID << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-
+    if (pSelectConditionalOrder == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_INFO, "cos select request %d order %d error %d\n",
+	    nRequestID, pSelectConditionalOrder->ConditionalOrderID,
+	    pRspInfo != NULL ? pRspInfo->ErrorID : 0);
   }
 
+
   //ӯ¼Ӧ
   virtual void
     OnRspInsertProfitAndLossOrder (CKSProfitAndLossOrderOperResultField *
@@ -1542,52 +1661,11 @@ public:
 				   CThostFtdcRspInfoField * pRspInfo,
 				   int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss insert\n");
-    if (pInsertProfitAndLossOrder != NULL)
-      {
-
-	cout << "OnRspInsertProfitAndLossOrder:"
-	  << "Ӫҵ:" << pInsertProfitAndLossOrder->BrokerID
-	  << "Ͷߴ:" << pInsertProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ:" << pInsertProfitAndLossOrder->
-	  ProfitAndLossOrderID << "Ա:" << pInsertProfitAndLossOrder->
-	  UserID << "Ͷ:" << pInsertProfitAndLossOrder->
-	  InvestorName << "ر:" << pInsertProfitAndLossOrder->
-	  OrderLocalID << "ֹ:" << pInsertProfitAndLossOrder->
-	  StopLossPrice << "ֹӯ:" << pInsertProfitAndLossOrder->
-	  TakeProfitPrice << "ƽַʽ:" << pInsertProfitAndLossOrder->
-	  CloseMode << "ƽַӼλ:" << pInsertProfitAndLossOrder->
-	  Figures << "鴥ʱ¼:" << pInsertProfitAndLossOrder->
-	  LastPrice << "ֹֹӯʱ:" << pInsertProfitAndLossOrder->
-	  ProfitAndLossOrderFormTime << "ʱ:" <<
-	  pInsertProfitAndLossOrder->
-	  ConditionalOrderFormTime << "ίеʱ:" <<
-	  pInsertProfitAndLossOrder->
-	  OrderFormTime << "ֹֹӯ״̬:" << pInsertProfitAndLossOrder->
-	  ProfitAndLossOrderStatus << ":" <<
-	  pInsertProfitAndLossOrder->
-	  ConditionalOrderID << ":" << pInsertProfitAndLossOrder->
-	  ExchangeID << "ͻ:" << pInsertProfitAndLossOrder->
-	  ClientID << "Լ:" << pInsertProfitAndLossOrder->
-	  InstrumentID << "ƽ־:" << pInsertProfitAndLossOrder->
-	  CombOffsetFlag << "Ͷױ־:" << pInsertProfitAndLossOrder->
-	  CombHedgeFlag << "" << pInsertProfitAndLossOrder->
-	  Direction << "۸" << pInsertProfitAndLossOrder->
-	  LimitPrice << "" << pInsertProfitAndLossOrder->
-	  VolumeTotalOriginal << "ӯ۵ķʽ" <<
-	  pInsertProfitAndLossOrder->
-	  OffsetValue << "ҵԪ" << pInsertProfitAndLossOrder->
-	  BusinessUnit << "۸" << pInsertProfitAndLossOrder->
-	  SpringType << "ֹ" << pInsertProfitAndLossOrder->
-	  FloatLimitPrice << "ֳɽ۸" << pInsertProfitAndLossOrder->
-	  OpenTradePrice << endl;
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    logProfitAndLoss ("insert", pInsertProfitAndLossOrder, pRspInfo,
+		      nRequestID);
   }
 
+
   //ӯ޸Ӧ
   virtual void
     OnRspModifyProfitAndLossOrder (CKSProfitAndLossOrderOperResultField *
@@ -1595,53 +1673,11 @@ public:
 				   CThostFtdcRspInfoField * pRspInfo,
 				   int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss modify\n");
-    if (pModifyProfitAndLossOrder != NULL)
-      {
-	cout << "OnRspModifyProfitAndLossOrder:"
-	  << "Ӫҵ:" << pModifyProfitAndLossOrder->BrokerID
-	  << "Ͷߴ:" << pModifyProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ:" << pModifyProfitAndLossOrder->
-	  ProfitAndLossOrderID << "Ա:" << pModifyProfitAndLossOrder->
-	  UserID << "Ͷ:" << pModifyProfitAndLossOrder->
-	  InvestorName << "ر:" << pModifyProfitAndLossOrder->
-	  OrderLocalID << "ֹ:" << pModifyProfitAndLossOrder->
-	  StopLossPrice << "ֹӯ:" << pModifyProfitAndLossOrder->
-	  TakeProfitPrice << "ƽַʽ:" << pModifyProfitAndLossOrder->
-	  CloseMode << "ƽַӼλ:" << pModifyProfitAndLossOrder->
-	  Figures << "鴥ʱ¼:" << pModifyProfitAndLossOrder->
-	  LastPrice << "ֹֹӯʱ:" << pModifyProfitAndLossOrder->
-	  ProfitAndLossOrderFormTime << "ʱ:" <<
-	  pModifyProfitAndLossOrder->
-	  ConditionalOrderFormTime << "ίеʱ:" <<
-	  pModifyProfitAndLossOrder->
-	  OrderFormTime << "ֹֹӯ״̬:" << pModifyProfitAndLossOrder->
-	  ProfitAndLossOrderStatus << ":" <<
-	  pModifyProfitAndLossOrder->
-	  ConditionalOrderID << ":" << pModifyProfitAndLossOrder->
-	  ExchangeID << "ͻ:" << pModifyProfitAndLossOrder->
-	  ClientID << "Լ:" << pModifyProfitAndLossOrder->
-	  InstrumentID << "ƽ־:" << pModifyProfitAndLossOrder->
-	  CombOffsetFlag << "Ͷױ־:" << pModifyProfitAndLossOrder->
-	  CombHedgeFlag << "" << pModifyProfitAndLossOrder->
-	  Direction << "۸" << pModifyProfitAndLossOrder->
-	  LimitPrice << "" << pModifyProfitAndLossOrder->
-	  VolumeTotalOriginal << "ӯ۵ķʽ" <<
-	  pModifyProfitAndLossOrder->
-	  OffsetValue << "ҵԪ" << pModifyProfitAndLossOrder->
-	  BusinessUnit << "۸" << pModifyProfitAndLossOrder->
-	  SpringType << "ֹ" << pModifyProfitAndLossOrder->
-	  FloatLimitPrice << "ֳɽ۸" << pModifyProfitAndLossOrder->
-	  OpenTradePrice << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
-
+    logProfitAndLoss ("modify", pModifyProfitAndLossOrder, pRspInfo,
+		      nRequestID);
   }
 
+
   //ӯ𵥲ѯӦ
   virtual void
     OnRspQueryProfitAndLossOrder (CKSProfitAndLossOrderOperResultField *
@@ -1649,52 +1685,11 @@ public:
 				  CThostFtdcRspInfoField * pRspInfo,
 				  int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss query\n");
-    if (pQueryProfitAndLossOrder != NULL)
-      {
-	cout << "OnRspQueryProfitAndLossOrder:"
-	  << "Ӫҵ:" << pQueryProfitAndLossOrder->BrokerID
-	  << "Ͷߴ:" << pQueryProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ:" << pQueryProfitAndLossOrder->ProfitAndLossOrderID
-	  << "Ա:" << pQueryProfitAndLossOrder->UserID
-	  << "Ͷ:" << pQueryProfitAndLossOrder->InvestorName
-	  << "ر:" << pQueryProfitAndLossOrder->OrderLocalID
-	  << "ֹ:" << pQueryProfitAndLossOrder->StopLossPrice
-	  << "ֹӯ:" << pQueryProfitAndLossOrder->TakeProfitPrice
-	  << "ƽַʽ:" << pQueryProfitAndLossOrder->CloseMode
-	  << "ƽַӼλ:" << pQueryProfitAndLossOrder->Figures
-	  << "鴥ʱ¼:" << pQueryProfitAndLossOrder->LastPrice
-	  << "ֹֹӯʱ:" << pQueryProfitAndLossOrder->
-	  ProfitAndLossOrderFormTime << "ʱ:" <<
-	  pQueryProfitAndLossOrder->
-	  ConditionalOrderFormTime << "ίеʱ:" <<
-	  pQueryProfitAndLossOrder->
-	  OrderFormTime << "ֹֹӯ״̬:" << pQueryProfitAndLossOrder->
-	  ProfitAndLossOrderStatus << ":" <<
-	  pQueryProfitAndLossOrder->
-	  ConditionalOrderID << ":" << pQueryProfitAndLossOrder->
-	  ExchangeID << "ͻ:" << pQueryProfitAndLossOrder->
-	  ClientID << "Լ:" << pQueryProfitAndLossOrder->
-	  InstrumentID << "ƽ־:" << pQueryProfitAndLossOrder->
-	  CombOffsetFlag << "Ͷױ־:" << pQueryProfitAndLossOrder->
-	  CombHedgeFlag << "" << pQueryProfitAndLossOrder->
-	  Direction << "۸" << pQueryProfitAndLossOrder->
-	  LimitPrice << "" << pQueryProfitAndLossOrder->
-	  VolumeTotalOriginal << "ӯ۵ķʽ" <<
-	  pQueryProfitAndLossOrder->
-	  OffsetValue << "ҵԪ" << pQueryProfitAndLossOrder->
-	  BusinessUnit << "۸" << pQueryProfitAndLossOrder->
-	  SpringType << "ֹ" << pQueryProfitAndLossOrder->
-	  FloatLimitPrice << "ֳɽ۸" << pQueryProfitAndLossOrder->
-	  OpenTradePrice << endl;
-
-      }
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    logProfitAndLoss ("query", pQueryProfitAndLossOrder, pRspInfo,
+		      nRequestID);
   }
 
+
   ///ֹֹӯɾӦ
   virtual void
     OnRspRemoveProfitAndLossOrder (CKSProfitAndLossOrderRemoveField *
@@ -1702,130 +1697,75 @@ public:
 				   CThostFtdcRspInfoField * pRspInfo,
 				   int nRequestID, bool bIsLast)
   {
-    printf ("hello profit and loss delete\n");
-    if (pRemoveProfitAndLossOrder != NULL)
-      {
-
-	cout << "OnRspRemoveProfitAndLossOrder:"
-	  << "Ӫҵ:" << pRemoveProfitAndLossOrder->BrokerID
-	  << "Ͷߴ" << pRemoveProfitAndLossOrder->InvestorID
-	  << "ֹֹӯ" << pRemoveProfitAndLossOrder->
-	  ProfitAndLossOrderID << endl;
-
-      }
-
-    printf ("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID,
-	    pRspInfo->ErrorMsg);
-    printf ("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
-
+    if (pRemoveProfitAndLossOrder == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_INFO, "pl remove request %d order %d error %d\n",
+	    nRequestID, pRemoveProfitAndLossOrder->ProfitAndLossOrderID,
+	    pRspInfo != NULL ? pRspInfo->ErrorID : 0);
   }
 
+
   ///ѡ֪ͨ
   virtual void OnRtnCOSAskSelect (CKSCOSAskSelectField * pCOSAskSelect)
   {
-    printf ("condition order select Notice\n");
     if (pCOSAskSelect != NULL)
-      {
-
-	cout << "OnRtnCOSAskSelect:"
-	  << "Ӫҵ:" << pCOSAskSelect->BrokerID
-	  << "Ա:" << pCOSAskSelect->UserID
-	  << "Ͷߴ:" << pCOSAskSelect->InvestorID
-	  << "" << pCOSAskSelect->SequenceNo
-	  << ":" << pCOSAskSelect->ConditionalOrderID
-	  << "ע:" << pCOSAskSelect->Memo
-	  << "ѡʽ:" << pCOSAskSelect->SelectType << endl;
-
-      }
+      FC_LOG(LOG_LEVEL_INFO, "cos ask select order %d\n",
+	      pCOSAskSelect->ConditionalOrderID);
   }
 
+
   ///״̬֪ͨ
   virtual void OnRtnCOSStatus (CKSCOSStatusField * pCOSStatus)
   {
-    printf ("condition order status notice\n");
-    if (pCOSStatus != NULL)
-      {
-
-	cout << "OnRtnCOSStatus:"
-	  << "Ӫҵ:" << pCOSStatus->BrokerID
-	  << "Ա:" << pCOSStatus->UserID
-	  << "Ͷߴ:" << pCOSStatus->InvestorID
-	  << ":" << pCOSStatus->SequenceNo
-	  << ":" << pCOSStatus->ConditionalOrderID
-	  << "״̬:" << pCOSStatus->ConditionalOrderStatus
-	  << "ע:" << pCOSStatus->Memo
-	  << "ر:" << pCOSStatus->OrderLocalID
-	  << ":" << pCOSStatus->ExchangeID
-	  << "Լ:" << pCOSStatus->InstrumentID
-	  << "״̬:" << pCOSStatus->OrderStatus
-	  << "ƽ־:" << pCOSStatus->CombOffsetFlag
-	  << "Ͷױ־:" << pCOSStatus->CombHedgeFlag
-	  << ":" << pCOSStatus->Direction
-	  << "۸:" << pCOSStatus->LimitPrice
-	  << ":" << pCOSStatus->VolumeTotalOriginal
-	  << ":" << pCOSStatus->TradingDay
-	  << "û:" << pCOSStatus->CancelUserID
-	  << "ʱ:" << pCOSStatus->CancelTime
-	  << "ͻ:" << pCOSStatus->ClientID
-	  << "ҵԪ:" << pCOSStatus->BusinessUnit
-	  << ":" << pCOSStatus->OrderSysID
-	  << "ɽ:" << pCOSStatus->VolumeTraded
-	  << "ʣ:" << pCOSStatus->VolumeTotal
-	  << "ίʱ:" << pCOSStatus->InsertTime
-	  << "ʱ:" << pCOSStatus->ActiveTime
-	  << "ɽ۸:" << pCOSStatus->TradePrice
-	  << "Ҵ:" << pCOSStatus->CurrencyID << endl;
-      }
+    if (pCOSStatus == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_DEBUG, "cos status order %d seq %d status %c order status %c traded %d\n",
+	    pCOSStatus->ConditionalOrderID, pCOSStatus->SequenceNo,
+	    pCOSStatus->ConditionalOrderStatus, pCOSStatus->OrderStatus,
+	    pCOSStatus->VolumeTraded);
   }
 
+
   ///ֹֹӯ״̬֪ͨ
   virtual void OnRtnPLStatus (CKSPLStatusField * pPLStatus)
   {
-    printf ("profit and loss order status notice\n");
-    if (pPLStatus != NULL)
-      {
-
-	cout << "OnRtnPLStatus:"
-	  << "Ӫҵ:" << pPLStatus->BrokerID
-	  << "Ա:" << pPLStatus->UserID
-	  << "Ͷߴ:" << pPLStatus->InvestorID
-	  << ":" << pPLStatus->SequenceNo
-	  << "ֹֹӯ:" << pPLStatus->ProfitAndLossOrderID
-	  << "ֹ:" << pPLStatus->StopLossOrderID
-	  << "ֹӯ:" << pPLStatus->TakeProfitOrderID
-	  << "ӯ״̬:" << pPLStatus->ProfitAndLossOrderStatus
-	  << "ֹ:" << pPLStatus->StopLossPrice
-	  << "ֹӯ:" << pPLStatus->TakeProfitPrice
-	  << "ӯ۵ķʽ:" << pPLStatus->OffsetValue
-	  << "ֳɽ۸:" << pPLStatus->OpenTradePrice
-	  << "ע:" << pPLStatus->Memo
-	  << "ر:" << pPLStatus->OrderLocalID
-	  << ":" << pPLStatus->ExchangeID
-	  << "Լ:" << pPLStatus->InstrumentID
-	  << "״̬:" << pPLStatus->OrderStatus
-	  << "ƽ־:" << pPLStatus->CombOffsetFlag
-	  << "Ͷױ־:" << pPLStatus->CombHedgeFlag
-	  << ":" << pPLStatus->Direction
-	  << "۸:" << pPLStatus->LimitPrice
-	  << ":" << pPLStatus->VolumeTotalOriginal
-	  << ":" << pPLStatus->TradingDay
-	  << "û:" << pPLStatus->CancelUserID
-	  << "ʱ:" << pPLStatus->CancelTime
-	  << "ͻ:" << pPLStatus->ClientID
-	  << "ҵԪ:" << pPLStatus->BusinessUnit
-	  << ":" << pPLStatus->OrderSysID
-	  << "ɽ:" << pPLStatus->VolumeTraded
-	  << "ʣ:" << pPLStatus->VolumeTotal
-	  << "ίʱ:" << pPLStatus->InsertTime
-	  << "ʱ:" << pPLStatus->ActiveTime
-	  << "ɽ۸:" << pPLStatus->TradePrice
-	  << "Ҵ:" << pPLStatus->CurrencyID << endl;
-
-
-      }
+    if (pPLStatus == NULL)
+      return;
+    FC_LOG(LOG_LEVEL_DEBUG, "pl status order %d seq %d status %c\n",
+	    pPLStatus->ProfitAndLossOrderID, pPLStatus->SequenceNo,
+	    pPLStatus->ProfitAndLossOrderStatus);
   }
 
 private:
+  // one line per response
+  void logConditional (const char *pOper,
+		       CKSConditionalOrderOperResultField * pResult,
+		       CThostFtdcRspInfoField * pRspInfo, int nRequestID)
+  {
+    if (pRspInfo != NULL && pRspInfo->ErrorID != 0)
+      FC_LOG(LOG_LEVEL_WARN, "cos %s request %d error %d %s\n", pOper,
+	      nRequestID, pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+    else if (pResult != NULL)
+      FC_LOG(LOG_LEVEL_INFO, "cos %s request %d order %d %s %c %d@%.04f status %c\n",
+	      pOper, nRequestID, pResult->ConditionalOrderID,
+	      pResult->InstrumentID, pResult->Direction,
+	      pResult->VolumeTotalOriginal, pResult->LimitPrice,
+	      pResult->ConditionalOrderStatus);
+  }
+
+  void logProfitAndLoss (const char *pOper,
+			 CKSProfitAndLossOrderOperResultField * pResult,
+			 CThostFtdcRspInfoField * pRspInfo, int nRequestID)
+  {
+    if (pRspInfo != NULL && pRspInfo->ErrorID != 0)
+      FC_LOG(LOG_LEVEL_WARN, "pl %s request %d error %d %s\n", pOper,
+	      nRequestID, pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+    else if (pResult != NULL)
+      FC_LOG(LOG_LEVEL_INFO, "pl %s request %d order %d %s sl %.04f tp %.04f status %c\n",
+	      pOper, nRequestID, pResult->ProfitAndLossOrderID,
+	      pResult->InstrumentID, pResult->StopLossPrice,
+	      pResult->TakeProfitPrice, pResult->ProfitAndLossOrderStatus);
+  }
 
 };
 
@@ -2016,10 +1956,75 @@ const int MAX_CONNECTION = 1;
 
 int main(int argc, char* argv[])
 {
+    // -snapshot: send the startup queries from here, one after the other,
+    // instead of chaining them through the callbacks
+    // -topology file: cpu and scheduling placement of the threads
+    // -config file: account and front settings, see ServiceConfig.h;
+    // -instance name picks the instance's own keys
+    // -daemon: detach and run in the background, -pidfile file: its pid
+    // -log file: log there instead of stdout
+    // -options file: write the options of the instrument list and the spot
+    // option parameters there for servant_market's -options; also the
+    // options key
+    // SIGTERM or SIGINT log out and exit, SIGHUP reopens the log
+    bool bSnapshot = false;
+    bool bDaemon = false;
+    const char *pPidFile = NULL;
+    const char *pLogFile = NULL;
+    const char *pTopologyFile = NULL;
+    const char *pInstance = NULL;
+    const char *pOptionFile = NULL;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-snapshot") == 0)
+            bSnapshot = true;
+        else if (strcmp(argv[a], "-topology") == 0 && a + 1 < argc)
+            pTopologyFile = argv[++a];
+        else if (strcmp(argv[a], "-config") == 0 && a + 1 < argc && !ServiceConfig::load(argv[++a]))
+            printf("cannot read config %s\n", argv[a]);
+        else if (strcmp(argv[a], "-instance") == 0 && a + 1 < argc)
+            pInstance = argv[++a];
+        else if (strcmp(argv[a], "-daemon") == 0)
+            bDaemon = true;
+        else if (strcmp(argv[a], "-pidfile") == 0 && a + 1 < argc)
+            pPidFile = argv[++a];
+        else if (strcmp(argv[a], "-log") == 0 && a + 1 < argc)
+            pLogFile = argv[++a];
+        else if (strcmp(argv[a], "-options") == 0 && a + 1 < argc)
+            pOptionFile = argv[++a];
+    }
+    ServiceConfig::setInstance(pInstance);
+    if (!ServiceConfig::require("broker_id,user_id,password,front"))
+        return 1;
+    if (pOptionFile == NULL)
+        pOptionFile = ServiceConfig::get("options");
+    if (pTopologyFile == NULL)
+        pTopologyFile = ServiceConfig::get("topology");
+    if (pTopologyFile != NULL && !ThreadTopology::load(pTopologyFile))
+        printf("cannot read thread topology %s\n", pTopologyFile);
+    if (bDaemon && !ServiceControl::daemonize(pPidFile))
+    {
+        printf("cannot start as a daemon\n");
+        return 1;
+    }
+    // before the first thread, every thread inherits the blocked signals
+    ServiceControl::install();
+    ThreadTopology::enter(THREAD_MAIN);
+
+    // callbacks log through the async logger; FC_LOG_LEVEL=tick turns the
+    // depth dumps on, SIGUSR1/SIGUSR2 change the level while running
+    if (!AsyncLogger::start(pLogFile, LOG_LEVEL_INFO))
+    {
+        printf("cannot open log file %s\n", pLogFile);
+        return 1;
+    }
+    AsyncLogger::installLevelSignals();
+
     CThostFtdcTraderApi *pUserApi[MAX_CONNECTION] = {0};
     CSimpleHandler *pSpi[MAX_CONNECTION] = {0};
 
     CKSCosApi *pCosAPI = NULL;
+    COptionHandler *pOptionSpi[MAX_CONNECTION] = {0};
 
     for (int i=0; i < MAX_CONNECTION; i++ )
     {
@@ -2031,18 +2036,19 @@ int main(int argc, char* argv[])
 
         // Create a manual reset event with no signal
         pSpi[i]->m_hEvent = event_create(true, false);
+        pSpi[i]->m_hLogin = event_create(true, false);
+        pSpi[i]->m_bChain = !bSnapshot;
 
         CCosHandler CosSpiTest;			//һӦʵ
         // set spi's broker, user, passwd
-        strcpy (pSpi[i]->m_chBrokerID, "3748FD77");	// Nanhua Mechantile Broker ID 
+        if (!ServiceConfig::copy("broker_id", pSpi[i]->m_chBrokerID, sizeof(pSpi[i]->m_chBrokerID)) ||
+            !ServiceConfig::copy("user_id", pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)) ||
+            !ServiceConfig::copy("password", pSpi[i]->m_chPassword, sizeof(pSpi[i]->m_chPassword)))
+        {
+            printf("broker_id, user_id or password longer than the api takes\n");
+            return 1;
+        }
 	printf("userid is %s\n", pSpi[i]->m_chBrokerID);
-
-#ifdef WIN32
-	_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)-1, "8023901");
-#else
-        snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "8023901");
-#endif
-        strcpy (pSpi[i]->m_chPassword, "2525");
         //strcpy (pSpi[i]->m_chContract, "al1412");
 
         // register an event handler instance
@@ -2050,14 +2056,46 @@ int main(int argc, char* argv[])
         pUserApi[i]->RegisterSpi(pSpi[i]);
 
         // register the kingstar front address and port
-	pUserApi[i]->RegisterFront("tcp://124.160.44.166:17159");		// Nanhua Mechantile API 
+	char chFront[CONFIG_VALUE_SIZE];
+	if (!ServiceConfig::copy("front", chFront, sizeof(chFront)))
+	{
+	    printf("front longer than %d characters\n", CONFIG_VALUE_SIZE - 1);
+	    return 1;
+	}
+	pUserApi[i]->RegisterFront(chFront);
+
+        if (pOptionFile != NULL && !pSpi[i]->openOptionTable(pOptionFile))
+            printf("cannot write option table %s\n", pOptionFile);
+        // spot option parameters, when the front has the option api
+        if (pSpi[i]->m_pOptionTable != NULL)
+        {
+            pOptionSpi[i] = new COptionHandler(pSpi[i]);
+            pSpi[i]->m_pOptionSpi = pOptionSpi[i];
+        }
 
         // make the connection between client and CTP server
         pUserApi[i]->Init();
     }
 
+    for (int i=0; i < MAX_CONNECTION && bSnapshot; i++ )
+    {
+        if (event_timedwait((event_handle)pSpi[i]->m_hLogin, 30000) == 0)
+            pSpi[i]->querySnapshot();
+        else
+            printf("not logged in, no snapshot\n");
+    }
+
+    // the trader callback thread enters at its first callback; shown as
+    // not started when the front does not answer in time
+    ThreadTopology::waitStarted(THREAD_TRADER_CALLBACK, 10000);
+    char chTopology[2048];
+    ThreadTopology::report(chTopology, sizeof(chTopology));
+    printf("\n%s", chTopology);
+
     printf ("\npress return to release...\n");
-    getchar();
+    while (ServiceControl::wait(!bDaemon) == SERVICE_RELOAD)
+        AsyncLogger::reopen();
+    ServiceControl::beginStop();
 
     for (int i=0; i < MAX_CONNECTION; i++ )
     {
@@ -2078,10 +2116,12 @@ int main(int argc, char* argv[])
 
         // delete pSpi
         delete pSpi[i];
+        delete pOptionSpi[i];
     }
 
-    printf ("\npress return to quit...\n");
-    getchar();
+    // drain the log before exiting
+    AsyncLogger::stop();
+    ServiceControl::exit();
 
     return 0;
 }
@@ -1,9 +1,23 @@
 // servant_market.cpp : Defines the entry point for the console application.
 //
 #include "servant_market.h"
-#include "event.h"
+#include "../common/event.h"
 #include "ClientSocket.h"
 #include "SocketException.h"
+#include "../common/DepthDeltaCodec.h"
+#include "../common/TickRing.h"
+#include "../common/TickNormalizer.h"
+#include "../common/IndicatorEngine.h"
+#include "../common/SpreadBook.h"
+#include "../common/OptionSurface.h"
+#include "../common/FeedMonitor.h"
+#include "../common/LatencyStats.h"
+#include "../common/AsyncLogger.h"
+#include "../common/ThreadTopology.h"
+#include "../common/ServiceControl.h"
+#include "../common/ServiceConfig.h"
+#include "../common/IngestClient.h"
+#include "../common/McastFeed.h"
 #include "../KSMarketDataAPI/KSMarketDataAPI.h"
 #include<stdlib.h>
 #include<stdio.h>
@@ -28,6 +42,26 @@ using namespace std;
 
 using namespace KingstarAPI;
 
+class CSampleHandler;
+static void loadPriceTicks(CSampleHandler *pSpi, const char *pFile);
+
+// ingest ring entry: the tick plus its probe timestamps
+struct IngestTick
+{
+    CThostFtdcDepthMarketDataField field;
+    // latency_now() at OnRtnDepthMarketData entry and before the push
+    unsigned long long nRecvTsc;
+    unsigned long long nEnqueueTsc;
+};
+
+// request for quote queued for the publisher, apart from the ticks
+struct ForQuoteEvent
+{
+    CThostFtdcForQuoteRspField field;
+    // latency_now() at OnRtnForQuoteRsp entry
+    unsigned long long nRecvTsc;
+};
+
 class CSampleHandler : public CThostFtdcMdSpi
 {
 public:
@@ -52,11 +86,49 @@ public:
     // finish event
     HANDLE m_hEvent;
 
+    // delta encoder for published ticks, NULL publishes every field
+    DepthDeltaEncoder *m_pDeltaEncoder;
+
+    // publishing connection stamping its own ids with asynchronous acks,
+    // NULL waits for the listener's uuid per tick in publish()
+    IngestClient *m_pClient;
+
+    // multicast of the binary frames to local strategies ahead of the
+    // ingest path, NULL when off; the encoder is its own, with its own
+    // snapshot interval
+    McastPublisher *m_pMcast;
+    DepthDeltaEncoder *m_pMcastEncoder;
+
+    // normalizer run by the publisher thread, holds the PriceTick table
+    TickNormalizer m_normalizer;
+
+    // indicators appended to the published lines, NULL when off; run by
+    // the publisher thread after the normalizer, whose slots it shares
+    IndicatorEngine *m_pIndicators;
+
+    // calendar and ratio spreads implied from the legs' ticks, published
+    // as ticks of their own; NULL when none are defined
+    SpreadBook *m_pSpreads;
+
+    // implied volatilities and greeks of the option chains in the table,
+    // refreshed after each batch; NULL without one
+    OptionSurface *m_pOptions;
+
+    // subscribe the requests for quote of the instruments as well
+    bool m_bForQuote;
+
+    // staleness, rate and latency per instrument, fed by the publisher
+    // thread with the normalizer's slots; NULL when off
+    FeedMonitor *m_pMonitor;
+
 public: 
     // constructorwhich need a valid pointer to a CThostFtdcMduserApi instance 
-    CSampleHandler(CThostFtdcMdApi *pUserApi, int nContracts) : m_pUserApi(pUserApi), m_nContracts(nContracts) {}
+    CSampleHandler(CThostFtdcMdApi *pUserApi, int nContracts) : m_pUserApi(pUserApi), m_nContracts(nContracts), m_pDeltaEncoder(NULL), m_pClient(NULL), m_pMcast(NULL), m_pMcastEncoder(NULL), m_pIndicators(NULL), m_pSpreads(NULL), m_pOptions(NULL), m_bForQuote(false), m_pMonitor(NULL),
+        m_pRing(new TickRing<IngestTick>(ServiceConfig::getInt("ingest_ring_size", INGEST_RING_SIZE))), m_nDropped(0), m_nRejected(0),
+        m_pForQuotes(new TickRing<ForQuoteEvent>(FOR_QUOTE_RING_SIZE)), m_nForQuotes(0), m_nForQuoteDropped(0), m_bRunning(false),
+        m_pReloadFile(NULL), m_bReload(false) {}
 
-    ~CSampleHandler() {}
+    ~CSampleHandler() { delete m_pRing; delete m_pForQuotes; }
 
     //missing string printf
     //this is safe and convenient but not exactly efficient
@@ -79,49 +151,332 @@ public:
 	  return ret;
     }
 
-    static std::string publish(std::string fc_message)
+    // nRecvTsc: probe timestamp of the tick being published, 0 for none
+    static std::string publish(std::string fc_message, unsigned long long nRecvTsc = 0)
     {
 	std::string reply = "No Uuid Received"; 
 	try
 	{
-	      ClientSocket client_socket ( "localhost", 9999 );
+	      static std::string s_host = ServiceConfig::get("publisher_host", "localhost");
+	      static int s_nPort = ServiceConfig::getInt("publisher_port", 9999);
+	      unsigned long long t = latency_now();
+	      ClientSocket client_socket ( s_host, s_nPort );
+	      if (nRecvTsc != 0)
+		t = LatencyStats::stamp(LAT_CONNECT, t);
 
 	      try
 		{
 		  client_socket << fc_message + "\n";
+		  if (nRecvTsc != 0)
+		  {
+		      t = LatencyStats::stamp(LAT_SOCKET_WRITE, t);
+		      LatencyStats::record(LAT_TICK_TO_WIRE, t - nRecvTsc);
+		  }
 		  client_socket >> reply;
+		  if (nRecvTsc != 0)
+		      LatencyStats::stamp(LAT_ACK, t);
 		}
 	      catch ( SocketException& ) {}
 
-	      std::cout << "Received uuid for the message:\n\"" << reply << "\"\n";;
+	      FC_LOG(LOG_LEVEL_INFO, "Received uuid for the message:\n\"%s\"\n", reply.c_str());
 
 	}
 	catch ( SocketException& e )
 	{
-	      std::cout << "Exception was caught:" << e.description() << "\n";
+	      FC_LOG(LOG_LEVEL_ERROR, "Exception was caught:%s\n", e.description().c_str());
 	}
 
 	return reply;
     }
 
 
+    // start the thread draining the ingest ring
+    void startPublisher()
+    {
+        m_bRunning = true;
+        pthread_create(&m_hPublisher, NULL, publisherMain, this);
+    }
+
+    // publish whatever is still queued and join the publisher thread
+    void stopPublisher()
+    {
+        m_bRunning = false;
+        pthread_join(m_hPublisher, NULL);
+        FC_LOG(LOG_LEVEL_INFO, "publisher stopped, dropped=%lu rejected=%lu\n", m_nDropped, m_nRejected);
+        if (m_bForQuote)
+            FC_LOG(LOG_LEVEL_INFO, "requests for quote: published=%lu dropped=%lu\n", m_nForQuotes, m_nForQuoteDropped);
+        if (m_pClient != NULL)
+            FC_LOG(LOG_LEVEL_INFO, "ingest client: sent=%llu acked=%llu resent=%llu reconnects=%llu dropped=%llu\n",
+                   m_pClient->sent(), m_pClient->acked(), m_pClient->resent(), m_pClient->reconnects(), m_pClient->dropped());
+        if (m_pMcast != NULL)
+            FC_LOG(LOG_LEVEL_INFO, "multicast: packets=%llu messages=%llu requests=%llu retransmitted=%llu gone=%llu\n",
+                   m_pMcast->packets(), m_pMcast->messages(), m_pMcast->requests(), m_pMcast->retransmitted(), m_pMcast->gone());
+    }
+
+    // reread the PriceTick table on the publisher thread, which owns the
+    // normalizer
+    void reloadPriceTicks(const char *pFile)
+    {
+        m_pReloadFile = pFile;
+        __atomic_store_n(&m_bReload, true, __ATOMIC_RELEASE);
+    }
+
+    // publisher thread: drain the ring in batches, normalize each batch
+    // and publish the ticks that survive validation
+    static void *publisherMain(void *pArg)
+    {
+        CSampleHandler *pThis = (CSampleHandler *)pArg;
+        ThreadTopology::enter(THREAD_PUBLISHER);
+        IngestTick ticks[PUBLISH_BATCH];
+        NormalizedTick norm[PUBLISH_BATCH];
+        IndicatorValues values[PUBLISH_BATCH];
+        for (;;)
+        {
+            if (__atomic_exchange_n(&pThis->m_bReload, false, __ATOMIC_ACQUIRE))
+                loadPriceTicks(pThis, pThis->m_pReloadFile);
+            bool bRunning = pThis->m_bRunning;
+            // requests for quote go ahead of any queued tick
+            pThis->publishForQuotes();
+            int n = pThis->m_pRing->pop(ticks, PUBLISH_BATCH);
+            if (n == 0)
+            {
+                // acks keep arriving while the feed is quiet
+                if (pThis->m_pClient != NULL)
+                    pThis->m_pClient->poll();
+                // heartbeats and retransmit requests
+                if (pThis->m_pMcast != NULL)
+                    pThis->m_pMcast->poll();
+                if (!bRunning)
+                    break;
+                ThreadTopology::idle(THREAD_PUBLISHER, 100);
+                continue;
+            }
+            unsigned long long t = latency_now();
+            for (int i = 0; i < n; i++)
+                LatencyStats::record(LAT_QUEUE_WAIT, t - ticks[i].nEnqueueTsc);
+            pThis->m_normalizer.normalize(&ticks[0].field, n, norm, sizeof(IngestTick));
+            if (pThis->m_pIndicators != NULL)
+                pThis->m_pIndicators->update(&ticks[0].field, norm, n, values, sizeof(IngestTick));
+            LatencyStats::record(LAT_NORMALIZE, (latency_now() - t) / n);
+            if (pThis->m_pMcast != NULL)
+            {
+                // the multicast first, it has no text to format and the
+                // batch leaves in as few datagrams as fit
+                for (int i = 0; i < n; i++)
+                {
+                    if (!(norm[i].nFlags & (TICK_STALE | TICK_NO_SLOT)))
+                        pThis->multicastTick(&ticks[i].field);
+                }
+                pThis->m_pMcast->flush();
+                pThis->m_pMcast->poll();
+            }
+            for (int i = 0; i < n; i++)
+            {
+                // stale replays after a reconnect are not published
+                if (norm[i].nFlags & (TICK_STALE | TICK_NO_SLOT))
+                {
+                    pThis->m_nRejected++;
+                    continue;
+                }
+                // and do not wait for the rest of the batch
+                if (!pThis->m_pForQuotes->empty())
+                    pThis->publishForQuotes();
+                if (pThis->m_pMonitor != NULL)
+                    pThis->m_pMonitor->onTick(norm[i].nSlot, norm[i].nTimeMs, ticks[i].nRecvTsc);
+                pThis->publishTick(&ticks[i].field, ticks[i].nRecvTsc, pThis->m_pIndicators != NULL ? &values[i] : NULL);
+                if (pThis->m_pSpreads != NULL)
+                    pThis->publishSpreads(&ticks[i].field, ticks[i].nRecvTsc);
+                if (pThis->m_pOptions != NULL)
+                    pThis->m_pOptions->onTick(&ticks[i].field);
+            }
+            // the spreads' frames added after the batch's flush
+            if (pThis->m_pSpreads != NULL && pThis->m_pMcast != NULL)
+                pThis->m_pMcast->flush();
+            // each chain the batch moved, once
+            if (pThis->m_pOptions != NULL)
+                pThis->publishSurfaces(ticks[n - 1].nRecvTsc);
+            if (pThis->m_pClient != NULL)
+            {
+                // the whole batch in one write
+                t = latency_now();
+                pThis->m_pClient->poll();
+                t = LatencyStats::stamp(LAT_SOCKET_WRITE, t);
+                for (int i = 0; i < n; i++)
+                {
+                    if (!(norm[i].nFlags & (TICK_STALE | TICK_NO_SLOT)))
+                        LatencyStats::record(LAT_TICK_TO_WIRE, t - ticks[i].nRecvTsc);
+                }
+            }
+        }
+        if (pThis->m_pClient != NULL && !pThis->m_pClient->drain(3000))
+            FC_LOG(LOG_LEVEL_WARN, "%d published ticks not acknowledged at exit\n", pThis->m_pClient->poll());
+        return NULL;
+    }
+
+    void multicastTick(const CThostFtdcDepthMarketDataField *pDepthMarketData)
+    {
+        char frame[DEPTH_DELTA_MAX_FRAME];
+        int nFrame = m_pMcastEncoder->encode(pDepthMarketData, frame, sizeof(frame));
+        if (nFrame > 0)
+            m_pMcast->add(frame, nFrame);
+    }
+
+    // the spreads a leg tick moved, down the same path as the tick
+    void publishSpreads(const CThostFtdcDepthMarketDataField *pLeg, unsigned long long nRecvTsc)
+    {
+        unsigned long long t = latency_now();
+        int n = m_pSpreads->onTick(pLeg);
+        LatencyStats::stamp(LAT_SPREAD, t);
+        for (int i = 0; i < n; i++)
+        {
+            if (m_pMcast != NULL)
+                multicastTick(&m_pSpreads->ticks()[i]);
+            publishTick(&m_pSpreads->ticks()[i], nRecvTsc, NULL);
+        }
+    }
+
+    // the chains whose underlying or options ticked, recomputed and sent as
+    // surface lines; not multicast
+    void publishSurfaces(unsigned long long nRecvTsc)
+    {
+        unsigned long long t = latency_now();
+        int n = m_pOptions->refresh();
+        if (n == 0)
+            return;
+        LatencyStats::record(LAT_OPTION_CHAIN, (latency_now() - t) / n);
+        char chLine[OPTION_SURFACE_SIZE];
+        for (int i = 0; i < n; i++)
+        {
+            int nFrom = 0;
+            int nLength;
+            while ((nLength = m_pOptions->format(m_pOptions->changed(i), &nFrom, chLine, sizeof(chLine))) > 0)
+            {
+                // never waits for the window on the publisher thread, dropped() counts
+                if (m_pClient != NULL)
+                    m_pClient->send(chLine, nLength, 0);
+                else
+                    publish(std::string(chLine, nLength), nRecvTsc);
+            }
+        }
+    }
+
+    // the queued requests for quote, each written at once rather than with
+    // the batch's ticks; not multicast, the frames there are ticks only
+    void publishForQuotes()
+    {
+        ForQuoteEvent events[FOR_QUOTE_BATCH];
+        int n;
+        while ((n = m_pForQuotes->pop(events, FOR_QUOTE_BATCH)) > 0)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                const CThostFtdcForQuoteRspField &rfq = events[i].field;
+                char chLine[256];
+                int nLength = snprintf(chLine, sizeof(chLine), "FCMESSAGE_TYPE_FOR_QUOTE|%s|%s|%s|%s|%s|", rfq.InstrumentID,
+                                       rfq.ForQuoteSysID, rfq.ForQuoteTime, rfq.TradingDay, rfq.ActionDay);
+                if (m_pClient != NULL)
+                {
+                    m_pClient->send(chLine, nLength, 0);
+                    m_pClient->poll();
+                }
+                else
+                    publish(std::string(chLine, nLength));
+                LatencyStats::record(LAT_FOR_QUOTE, latency_now() - events[i].nRecvTsc);
+                m_nForQuotes++;
+            }
+        }
+    }
+
+    // pValues: the tick's indicators, appended as fields, NULL for none
+    void publishTick(const CThostFtdcDepthMarketDataField *pDepthMarketData, unsigned long long nRecvTsc, const IndicatorValues *pValues)
+    {
+	    unsigned long long t = latency_now();
+	    std::string mystr;
+	    if (m_pDeltaEncoder != NULL)
+	    {
+		// only the fields changed since the instrument's previous tick
+		char frame[DEPTH_DELTA_MAX_FRAME];
+		char hex[DEPTH_DELTA_MAX_FRAME * 2 + 1];
+		int nFrame = m_pDeltaEncoder->encode(pDepthMarketData, frame, sizeof(frame));
+		if (nFrame > 0 && depth_delta_to_hex(frame, nFrame, hex, sizeof(hex)) > 0)
+		    mystr = std::string("FCMESSAGE_TYPE_MARKET_DELTA|") + hex;
+	    }
+	    // the full line without -delta, or when the frame could not be made
+	    if (mystr.empty())
+		mystr = format("%s|%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+		"FCMESSAGE_TYPE_MARKET",
+                pDepthMarketData->ExchangeID,					// 
+                pDepthMarketData->InstrumentID,					// Լ
+                pDepthMarketData->PreClosePrice,				// 
+                pDepthMarketData->OpenPrice,					// 
+                pDepthMarketData->HighestPrice,					// ߼
+                pDepthMarketData->LowestPrice,					// ͼ
+                pDepthMarketData->LastPrice,					// ¼
+                pDepthMarketData->Volume,						// 
+                pDepthMarketData->Turnover,						// ɽ
+                pDepthMarketData->BidPrice1,					// һ
+                pDepthMarketData->AskPrice1,					// һ
+                pDepthMarketData->BidVolume1,					// һ
+                pDepthMarketData->AskVolume1,					// һ
+                pDepthMarketData->UpperLimitPrice,				// ͣ
+                pDepthMarketData->LowerLimitPrice,				// ͣ
+                pDepthMarketData->PreSettlementPrice,			// ϴν
+                pDepthMarketData->SettlementPrice,				// ν
+                pDepthMarketData->OpenInterest,					// ֲ
+                pDepthMarketData->TradingDay,					// 
+                pDepthMarketData->BidVolume2,					// 
+                pDepthMarketData->BidPrice2,					// ۶
+                pDepthMarketData->BidVolume3,					// 
+                pDepthMarketData->BidPrice3,					// 
+                pDepthMarketData->BidVolume4,					// 
+                pDepthMarketData->BidPrice4,					// 
+                pDepthMarketData->BidVolume5,					// 
+                pDepthMarketData->BidPrice5,					// 
+                pDepthMarketData->AskVolume2,					// 
+                pDepthMarketData->AskPrice2,					// ۶
+                pDepthMarketData->AskVolume3,					// 
+                pDepthMarketData->AskPrice3,					// 
+                pDepthMarketData->AskVolume4,					// 
+                pDepthMarketData->AskPrice4,					// 
+                pDepthMarketData->AskVolume5,					// 
+                pDepthMarketData->AskPrice5				        // 
+                );
+	    if (pValues != NULL)
+	    {
+		char chIndicators[INDICATOR_TEXT_SIZE];
+		if (indicator_format(*pValues, chIndicators, sizeof(chIndicators)) > 0)
+		{
+		    // the delta line has no trailing '|'
+		    if (mystr[mystr.size() - 1] != '|')
+			mystr += '|';
+		    mystr += chIndicators;
+		}
+	    }
+	    LatencyStats::stamp(LAT_SERIALIZE, t);
+	    if (m_pClient != NULL)
+		m_pClient->send(mystr.data(), mystr.size(), 0);
+	    else
+		std::string uuid = publish(mystr, nRecvTsc);
+    }
+
 	// After making a succeed connection with the CTP server, the client should send the login request to the CTP server.
     virtual void OnFrontConnected()
     {
-        printf("OnFrontConnected:\n");
+        ThreadTopology::enter(THREAD_MD_CALLBACK);
+        FC_LOG(LOG_LEVEL_INFO, "OnFrontConnected:\n");
 
         CThostFtdcReqUserLoginField reqUserLogin;
         memset(&reqUserLogin, 0, sizeof(reqUserLogin));
         // set BrokerID
-        printf("BrokerID:%s\n", m_chBrokerID);
+        FC_LOG(LOG_LEVEL_INFO, "BrokerID:%s\n", m_chBrokerID);
         strcpy(reqUserLogin. BrokerID, m_chBrokerID);
 
         // set user id
-        printf("userid:%s\n", m_chUserID);
+        FC_LOG(LOG_LEVEL_INFO, "userid:%s\n", m_chUserID);
         strcpy(reqUserLogin.UserID, m_chUserID);
 
         // set password
-        printf("password:%s\n",m_chPassword);
+        FC_LOG(LOG_LEVEL_INFO, "password:%s\n",m_chPassword);
         strcpy(reqUserLogin.Password, m_chPassword);
 
         // send the login request
@@ -133,16 +488,16 @@ public:
 	virtual void OnFrontDisconnected(int nReason)
 	{ 
 		//  Inthis  case,  API  willreconnectthe  client  application can ignore this.
-		printf("OnFrontDisconnected.\n");
+		FC_LOG(LOG_LEVEL_INFO, "OnFrontDisconnected.\n");
 	} 
 
 	// After receiving the login request from  the clientthe CTP server will send the following response to notify the client whether the login success or not.
 	virtual void OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-        printf("OnRspUserLogin:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogin:");
         if (pRspUserLogin != NULL)
         {
-            printf("%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
+            FC_LOG(LOG_LEVEL_INFO, "%s|%s|%s|%s|%s|%s|%s|%s|%s|%d|%d|%s|", 
                 pRspUserLogin->BrokerID,					// ͹˾
                 pRspUserLogin->UserID,						// û
                 pRspUserLogin->TradingDay,					// 
@@ -157,18 +512,18 @@ public:
                 pRspUserLogin->MaxOrderRef					// 󱨵
                 );
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
         if (pRspInfo->ErrorID != 0)
 		{
 			// in case any login failure, the client should handle this error.
-			printf("Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
+			FC_LOG(LOG_LEVEL_ERROR, "Failed to login, errorcode=%d errormsg=%s requestid=%d chain=%d", pRspInfo->ErrorID, pRspInfo->ErrorMsg, nRequestID, bIsLast);
             return;
 		}
 
 		// get trading day
-		printf("ȡǰ = %s\n",m_pUserApi->GetTradingDay());
+		FC_LOG(LOG_LEVEL_INFO, "ȡǰ = %s\n",m_pUserApi->GetTradingDay());
 
 		// 鶩б
 		//char *ppInstrumentID[] = {"IF1203"};
@@ -182,6 +537,9 @@ public:
 		int iInstrumentID = m_nContracts;
         	// 	
 		m_pUserApi->SubscribeMarketData(ppInstrumentID, iInstrumentID);
+		// requests for quote of the same instruments
+		if (m_bForQuote)
+			m_pUserApi->SubscribeForQuoteRsp(ppInstrumentID, iInstrumentID);
         	// ͷڴ
 
 		for(int i=0; i<m_nContracts; i++) {
@@ -192,8 +550,8 @@ public:
 	///RspSubMarketData return
 	virtual void OnRspSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-		printf("OnRspSubMarketData:%s\n", pSpecificInstrument->InstrumentID);
-		printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+		FC_LOG(LOG_LEVEL_INFO, "OnRspSubMarketData:%s\n", pSpecificInstrument->InstrumentID);
+		FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
 
 /*		if (bIsLast == true)
 		{
@@ -206,11 +564,37 @@ public:
 */	}
 
 
+	///OnRspSubForQuoteRsp return
+	virtual void OnRspSubForQuoteRsp(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
+	{
+		FC_LOG(LOG_LEVEL_INFO, "OnRspSubForQuoteRsp:%s\n", pSpecificInstrument != NULL ? pSpecificInstrument->InstrumentID : "");
+		if (pRspInfo != NULL && pRspInfo->ErrorID != 0)
+			FC_LOG(LOG_LEVEL_ERROR, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+	}
+
+	///OnRtnForQuoteRsp: a request for quote, queued on its own ring so it
+	///does not wait behind the ticks. Nothing wakes the publisher: like a
+	///tick, it waits at most one idle of the publisher loop, 100us asleep
+	///or a spin with a busy polling topology
+	virtual void OnRtnForQuoteRsp(CThostFtdcForQuoteRspField *pForQuoteRsp)
+	{
+	    unsigned long long nRecvTsc = latency_now();
+	    ThreadTopology::enter(THREAD_MD_CALLBACK);
+	    if (pForQuoteRsp == NULL)
+		return;
+	    FC_LOG(LOG_LEVEL_TICK, "OnRtnForQuoteRsp:%s|%s|%s|\n", pForQuoteRsp->InstrumentID, pForQuoteRsp->ForQuoteSysID, pForQuoteRsp->ForQuoteTime);
+	    ForQuoteEvent event;
+	    memcpy(&event.field, pForQuoteRsp, sizeof(event.field));
+	    event.nRecvTsc = nRecvTsc;
+	    if (!m_pForQuotes->push(event) && m_nForQuoteDropped++ == 0)
+		FC_LOG(LOG_LEVEL_WARN, "request for quote ring full, dropping\n");
+	}
+
 	///OnRspUnSubMarketData return
 	virtual void OnRspUnSubMarketData(CThostFtdcSpecificInstrumentField *pSpecificInstrument, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-		printf("OnRspUnSubMarketData:\n");
-		printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+		FC_LOG(LOG_LEVEL_INFO, "OnRspUnSubMarketData:\n");
+		FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
 
 		// logout
 /*		CThostFtdcUserLogoutField UserLogout;
@@ -226,10 +610,12 @@ public:
 	///OnRtnDepthMarketData
 	virtual void OnRtnDepthMarketData(CThostFtdcDepthMarketDataField *pDepthMarketData)
 	{
-        printf("OnRtnDepthMarketData:");
+        unsigned long long nRecvTsc = latency_now();
+        ThreadTopology::enter(THREAD_MD_CALLBACK);
+        FC_LOG(LOG_LEVEL_TICK, "OnRtnDepthMarketData:");
         if(pDepthMarketData != NULL)
         {
-            printf("%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
+            FC_LOG(LOG_LEVEL_TICK, "%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
                 pDepthMarketData->ExchangeID,					// 
                 pDepthMarketData->InstrumentID,					// Լ
                 pDepthMarketData->PreClosePrice,				// 
@@ -266,61 +652,31 @@ public:
                 pDepthMarketData->AskVolume5,					// 
                 pDepthMarketData->AskPrice5						// 
                 );
-	    std::string mystr = format("%s|%s|%s|%.04f|%.04f|%.04f|%.04f|%.04f|%d|%.04f|%.04f|%.04f|%d|%d|%.04f|%.04f|%.04f|%.04f|%.04f|%s|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|%d|%.04f|",
-		"FCMESSAGE_TYPE_MARKET",
-                pDepthMarketData->ExchangeID,					// 
-                pDepthMarketData->InstrumentID,					// Լ
-                pDepthMarketData->PreClosePrice,				// 
-                pDepthMarketData->OpenPrice,					// 
-                pDepthMarketData->HighestPrice,					// ߼
-                pDepthMarketData->LowestPrice,					// ͼ
-                pDepthMarketData->LastPrice,					// ¼
-                pDepthMarketData->Volume,						// 
-                pDepthMarketData->Turnover,						// ɽ
-                pDepthMarketData->BidPrice1,					// һ
-                pDepthMarketData->AskPrice1,					// һ
-                pDepthMarketData->BidVolume1,					// һ
-                pDepthMarketData->AskVolume1,					// һ
-                pDepthMarketData->UpperLimitPrice,				// ͣ
-                pDepthMarketData->LowerLimitPrice,				// ͣ
-                pDepthMarketData->PreSettlementPrice,			// ϴν
-                pDepthMarketData->SettlementPrice,				// ν
-                pDepthMarketData->OpenInterest,					// ֲ
-                pDepthMarketData->TradingDay,					// 
-                pDepthMarketData->BidVolume2,					// 
-                pDepthMarketData->BidPrice2,					// ۶
-                pDepthMarketData->BidVolume3,					// 
-                pDepthMarketData->BidPrice3,					// 
-                pDepthMarketData->BidVolume4,					// 
-                pDepthMarketData->BidPrice4,					// 
-                pDepthMarketData->BidVolume5,					// 
-                pDepthMarketData->BidPrice5,					// 
-                pDepthMarketData->AskVolume2,					// 
-                pDepthMarketData->AskPrice2,					// ۶
-                pDepthMarketData->AskVolume3,					// 
-                pDepthMarketData->AskPrice3,					// 
-                pDepthMarketData->AskVolume4,					// 
-                pDepthMarketData->AskPrice4,					// 
-                pDepthMarketData->AskVolume5,					// 
-                pDepthMarketData->AskPrice5				        // 
-                );
-	    std::string uuid = publish(mystr);
+	    // hand the tick to the publisher thread, never block the api thread
+	    IngestTick tick;
+	    memcpy(&tick.field, pDepthMarketData, sizeof(tick.field));
+	    tick.nRecvTsc = nRecvTsc;
+	    tick.nEnqueueTsc = latency_now();
+	    if (!m_pRing->push(tick))
+		m_nDropped++;
+	    else
+		LatencyStats::record(LAT_CALLBACK_TO_ENQUEUE, tick.nEnqueueTsc - nRecvTsc);
  
         }
-        printf("\n");
+        FC_LOG(LOG_LEVEL_TICK, "\n");
 	}
 
 	// logout return
     virtual void OnRspUserLogout(CThostFtdcUserLogoutField *pUserLogout, CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast)
 	{
-        printf("OnRspUserLogout:");
+        FC_LOG(LOG_LEVEL_INFO, "OnRspUserLogout:");
         if (NULL != pUserLogout)
         {
-            printf("%s",pUserLogout->UserID);
+            FC_LOG(LOG_LEVEL_INFO, "%s",pUserLogout->UserID);
         }
-        printf("\n");
-        printf("ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
-        printf("RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
+        FC_LOG(LOG_LEVEL_INFO, "\n");
+        FC_LOG(LOG_LEVEL_INFO, "ErrorCode=[%d], ErrorMsg=[%s]\n", pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+        FC_LOG(LOG_LEVEL_INFO, "RequestID=[%d], Chain=[%d]\n", nRequestID, bIsLast);
 
         // inform the main thread order transaction is over 
         //SetEvent(m_hEvent); 
@@ -331,24 +687,262 @@ public:
 private: 
 	// a pointer of CThostFtdcMduserApi instance
 	CThostFtdcMdApi *m_pUserApi;
+
+	// ticks queued between OnRtnDepthMarketData and the publisher thread
+	enum { INGEST_RING_SIZE = 16384, PUBLISH_BATCH = 64 };
+	TickRing<IngestTick> *m_pRing;
+	// ticks lost to a full ring, ticks rejected by the normalizer
+	unsigned long m_nDropped;
+	unsigned long m_nRejected;
+	// requests for quote between OnRtnForQuoteRsp and the publisher thread,
+	// drained before each batch of ticks and between its ticks
+	enum { FOR_QUOTE_RING_SIZE = 1024, FOR_QUOTE_BATCH = 16 };
+	TickRing<ForQuoteEvent> *m_pForQuotes;
+	unsigned long m_nForQuotes;
+	unsigned long m_nForQuoteDropped;
+	volatile bool m_bRunning;
+	pthread_t m_hPublisher;
+	// PriceTick file waiting to be reloaded by the publisher thread
+	const char *m_pReloadFile;
+	bool m_bReload;
 };
 
 
 const int MAX_CONNECTION = 2;
 
+// PriceTick per instrument for the normalizer, one "InstrumentID PriceTick"
+// pair per line; a third column, the VolumeMultiple, goes to the indicators'
+// VWAP
+static void loadPriceTicks(CSampleHandler *pSpi, const char *pFile)
+{
+    FILE *fp = fopen(pFile, "r");
+    if (fp == NULL)
+    {
+        FC_LOG(LOG_LEVEL_ERROR, "cannot open price tick file %s\n", pFile);
+        return;
+    }
+    char chInstrumentID[31];
+    double dPriceTick;
+    char chLine[256];
+    int nLoaded = 0;
+    while (fgets(chLine, sizeof(chLine), fp) != NULL)
+    {
+        double dMultiplier;
+        int nColumns = sscanf(chLine, "%30s %lf %lf", chInstrumentID, &dPriceTick, &dMultiplier);
+        if (nColumns < 2)
+            continue;
+        pSpi->m_normalizer.setPriceTick(chInstrumentID, dPriceTick);
+        if (nColumns == 3 && pSpi->m_pIndicators != NULL)
+            pSpi->m_pIndicators->setMultiplier(pSpi->m_normalizer.index().find(chInstrumentID), dMultiplier);
+        nLoaded++;
+    }
+    fclose(fp);
+    FC_LOG(LOG_LEVEL_INFO, "loaded %d price ticks from %s\n", nLoaded, pFile);
+}
+
+// shard_products (product letters of the InstrumentID, any case) and
+// shard_count/shard_index (hash of the InstrumentID) select the instruments
+// of this instance
+static bool inShard(const char *pInstrumentID, const char *pProducts, int nShardCount, int nShardIndex)
+{
+    if (pProducts != NULL)
+    {
+        int nLen = 0;
+        while (isalpha((unsigned char)pInstrumentID[nLen]))
+            nLen++;
+        bool bFound = false;
+        const char *p = pProducts;
+        while (!bFound && *p != '\0')
+        {
+            size_t nItem = strcspn(p, ",");
+            bFound = nLen > 0 && nItem == (size_t)nLen && strncasecmp(p, pInstrumentID, nLen) == 0;
+            p += p[nItem] == ',' ? nItem + 1 : nItem;
+        }
+        if (!bFound)
+            return false;
+    }
+    if (nShardCount <= 1)
+        return true;
+    unsigned int nHash = 2166136261u;
+    for (const char *p = pInstrumentID; *p != '\0'; p++)
+        nHash = (nHash ^ (unsigned char)*p) * 16777619u;
+    return (int)(nHash % nShardCount) == nShardIndex;
+}
+
 int main(int argc, char* argv[])
 {
     CThostFtdcMdApi *pUserApi[MAX_CONNECTION] = {0};
     CSampleHandler *pSpi[MAX_CONNECTION] = {0};
+
+    // -delta [n]: publish FCMESSAGE_TYPE_MARKET_DELTA frames with a full
+    // snapshot of each instrument every n ticks instead of full records
+    // -ticks file: PriceTick table for tick validation
+    // -async: stamp ticks with local MessageIds over one connection and
+    // take the acks asynchronously, needs ingest_server; also the
+    // publish_async key
+    // -stats file / -statsport port: latency histograms every 10s to the
+    // file and on request on 127.0.0.1:port, with -monitor's summary, and
+    // on the port its table per instrument
+    // -topology file: cpu and scheduling placement of the threads
+    // -config file: account, front, shard and queue settings, see
+    // ServiceConfig.h; -instance name picks the instance's own keys
+    // -daemon: detach and run in the background, -pidfile file: its pid
+    // -log file: log there instead of stdout
+    // -indicators: append EMA, VWAP, volatility, book imbalance and
+    // microprice to every published tick; also the indicators key
+    // -spreads file: synthetic spreads to publish, see SpreadBook.h; also
+    // the spreads key
+    // -options file: the option table servant_instrument writes, publishes
+    // the chains' volatilities and greeks, see OptionSurface.h; also the
+    // options key, option_rate the discount rate
+    // -forquote: subscribe the requests for quote of the instruments and
+    // publish them ahead of the ticks; also the for_quote key. The
+    // ingest_server fanout sends them to the instrument's subscribers
+    // -monitor: per instrument staleness, gaps, tick rate and exchange to
+    // local latency, alerts to the log and the table on the stats port;
+    // also the feed_monitor key, feed_ keys for the thresholds
+    // SIGTERM or SIGINT release and exit, SIGHUP reopens the log and
+    // reloads the -ticks file
+    int nSnapshotInterval = 0;
+    const char *pTickFile = NULL;
+    bool bAsync = false;
+    const char *pStatsFile = NULL;
+    int nStatsPort = 0;
+    bool bDaemon = false;
+    const char *pPidFile = NULL;
+    const char *pLogFile = NULL;
+    const char *pTopologyFile = NULL;
+    const char *pInstance = NULL;
+    const char *pMcast = NULL;
+    bool bIndicators = false;
+    const char *pSpreadFile = NULL;
+    const char *pOptionFile = NULL;
+    bool bForQuote = false;
+    bool bMonitor = false;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "-delta") == 0)
+            nSnapshotInterval = (a + 1 < argc && atoi(argv[a + 1]) > 0) ? atoi(argv[++a]) : 100;
+        else if (strcmp(argv[a], "-ticks") == 0 && a + 1 < argc)
+            pTickFile = argv[++a];
+        else if (strcmp(argv[a], "-async") == 0)
+            bAsync = true;
+        else if (strcmp(argv[a], "-stats") == 0 && a + 1 < argc)
+            pStatsFile = argv[++a];
+        else if (strcmp(argv[a], "-statsport") == 0 && a + 1 < argc)
+            nStatsPort = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-topology") == 0 && a + 1 < argc)
+            pTopologyFile = argv[++a];
+        else if (strcmp(argv[a], "-config") == 0 && a + 1 < argc && !ServiceConfig::load(argv[++a]))
+            printf("cannot read config %s\n", argv[a]);
+        else if (strcmp(argv[a], "-instance") == 0 && a + 1 < argc)
+            pInstance = argv[++a];
+        else if (strcmp(argv[a], "-daemon") == 0)
+            bDaemon = true;
+        else if (strcmp(argv[a], "-pidfile") == 0 && a + 1 < argc)
+            pPidFile = argv[++a];
+        else if (strcmp(argv[a], "-log") == 0 && a + 1 < argc)
+            pLogFile = argv[++a];
+        else if (strcmp(argv[a], "-mcast") == 0 && a + 1 < argc)
+            pMcast = argv[++a];
+        else if (strcmp(argv[a], "-indicators") == 0)
+            bIndicators = true;
+        else if (strcmp(argv[a], "-spreads") == 0 && a + 1 < argc)
+            pSpreadFile = argv[++a];
+        else if (strcmp(argv[a], "-options") == 0 && a + 1 < argc)
+            pOptionFile = argv[++a];
+        else if (strcmp(argv[a], "-forquote") == 0)
+            bForQuote = true;
+        else if (strcmp(argv[a], "-monitor") == 0)
+            bMonitor = true;
+    }
+    ServiceConfig::setInstance(pInstance);
+    if (!ServiceConfig::require("broker_id,user_id,password,front"))
+        return 1;
+    bAsync = bAsync || ServiceConfig::getInt("publish_async", 0) != 0;
+    bIndicators = bIndicators || ServiceConfig::getInt("indicators", 0) != 0;
+    bForQuote = bForQuote || ServiceConfig::getInt("for_quote", 0) != 0;
+    bMonitor = bMonitor || ServiceConfig::getInt("feed_monitor", 0) != 0;
+    if (pSpreadFile == NULL)
+        pSpreadFile = ServiceConfig::get("spreads");
+    if (pOptionFile == NULL)
+        pOptionFile = ServiceConfig::get("options");
+    MessageIdGenerator::setNode(ServiceConfig::getInt("node_id", (int)(gethostid() & 0xffff)));
+    if (pTopologyFile == NULL)
+        pTopologyFile = ServiceConfig::get("topology");
+    if (pTopologyFile != NULL && !ThreadTopology::load(pTopologyFile))
+        printf("cannot read thread topology %s\n", pTopologyFile);
+
+    // -mcast group:port, or the mcast_ keys of the config
+    char chGroup[CONFIG_VALUE_SIZE] = "";
+    int nMcastPort = ServiceConfig::getInt("mcast_port", 31001);
+    if (pMcast != NULL)
+    {
+        snprintf(chGroup, sizeof(chGroup), "%s", pMcast);
+        char *pColon = strchr(chGroup, ':');
+        if (pColon != NULL)
+        {
+            *pColon = '\0';
+            nMcastPort = atoi(pColon + 1);
+        }
+    }
+    else
+        ServiceConfig::copy("mcast_group", chGroup, sizeof(chGroup));
+    McastPublisher *pMcastPublisher = NULL;
+    if (chGroup[0] != '\0')
+    {
+        // the recovery port is bound before daemonizing, as the stats port
+        pMcastPublisher = new McastPublisher();
+        if (!pMcastPublisher->open(chGroup, nMcastPort, ServiceConfig::get("mcast_interface"), ServiceConfig::getInt("mcast_ttl", 1),
+                                   ServiceConfig::getInt("mcast_recovery_port", 0), ServiceConfig::getInt("mcast_history", MCAST_HISTORY)))
+        {
+            printf("cannot open multicast %s:%d\n", chGroup, nMcastPort);
+            return 1;
+        }
+    }
+    if (bDaemon && !ServiceControl::daemonize(pPidFile))
+    {
+        printf("cannot start as a daemon\n");
+        return 1;
+    }
+    // before the first thread, every thread inherits the blocked signals
+    ServiceControl::install();
+    ThreadTopology::enter(THREAD_MAIN);
+
+    // callbacks log through the async logger; FC_LOG_LEVEL=tick turns the
+    // depth dumps on, SIGUSR1/SIGUSR2 change the level while running
+    if (!AsyncLogger::start(pLogFile, LOG_LEVEL_INFO))
+    {
+        printf("cannot open log file %s\n", pLogFile);
+        return 1;
+    }
+    AsyncLogger::installLevelSignals();
+
+    if ((pStatsFile != NULL || nStatsPort > 0) && !LatencyStats::startReporter(pStatsFile, nStatsPort, 10))
+        printf("cannot start latency reporter on port %d\n", nStatsPort);
+
     std::string instrumentStr = CSampleHandler::publish("FCQUERY_ALL_INSTRUMENTS");
 
+    // outlives the reporter, whose port dumps its table
+    FeedMonitor *pMonitor = NULL;
+
+    // instruments of other shards are left to their own instances
+    const char *pProducts = ServiceConfig::get("shard_products");
+    int nShardCount = ServiceConfig::getInt("shard_count", 1);
+    int nShardIndex = ServiceConfig::getInt("shard_index", 0);
     char contracts[1024][80];
     int nContracts = 0;
+    int nOffered = 0;
     stringstream ssin(instrumentStr);
     while (ssin.good() && nContracts<1024){
         ssin >> contracts[nContracts];
-        ++nContracts;
+        ++nOffered;
+        if (inShard(contracts[nContracts], pProducts, nShardCount, nShardIndex))
+            ++nContracts;
     }
+    if (pProducts != NULL || nShardCount > 1)
+        printf("shard %d of %d%s%s: %d of %d instruments\n", nShardIndex, nShardCount, pProducts != NULL ? ", products " : "",
+               pProducts != NULL ? pProducts : "", nContracts, nOffered);
 
     //for (int i=0; i < MAX_CONNECTION; i++ )
     for (int i=0; i < 1; i++ )
@@ -358,25 +952,68 @@ int main(int argc, char* argv[])
 
         // create an event handler instance
         pSpi[i] = new CSampleHandler(pUserApi[i], nContracts);
+        if (nSnapshotInterval > 0)
+            pSpi[i]->m_pDeltaEncoder = new DepthDeltaEncoder(nSnapshotInterval);
+        if (bAsync)
+        {
+            pSpi[i]->m_pClient = new IngestClient();
+            pSpi[i]->m_pClient->setServer(ServiceConfig::get("publisher_host", "localhost"), ServiceConfig::getInt("publisher_port", 9999));
+        }
+        if (pMcastPublisher != NULL)
+        {
+            pSpi[i]->m_pMcast = pMcastPublisher;
+            pSpi[i]->m_pMcastEncoder = new DepthDeltaEncoder(ServiceConfig::getInt("mcast_snapshot", 100));
+        }
+        if (bIndicators)
+            pSpi[i]->m_pIndicators = new IndicatorEngine(ServiceConfig::getInt("indicator_ema", INDICATOR_EMA_TICKS),
+                                                         ServiceConfig::getInt("indicator_window", INDICATOR_WINDOW));
+        if (pTickFile != NULL)
+            loadPriceTicks(pSpi[i], pTickFile);
+        if (pSpreadFile != NULL)
+        {
+            pSpi[i]->m_pSpreads = new SpreadBook();
+            int nSpreads = pSpi[i]->m_pSpreads->load(pSpreadFile);
+            if (nSpreads < 0)
+                FC_LOG(LOG_LEVEL_ERROR, "cannot open spread file %s\n", pSpreadFile);
+            else
+                FC_LOG(LOG_LEVEL_INFO, "%d spreads over %d legs from %s\n", nSpreads, pSpi[i]->m_pSpreads->legs(), pSpreadFile);
+        }
+        if (pOptionFile != NULL)
+        {
+            pSpi[i]->m_pOptions = new OptionSurface();
+            pSpi[i]->m_pOptions->setRate(atof(ServiceConfig::get("option_rate", "0")));
+            int nOptions = pSpi[i]->m_pOptions->load(pOptionFile);
+            if (nOptions < 0)
+                FC_LOG(LOG_LEVEL_ERROR, "cannot open option table %s\n", pOptionFile);
+            else
+                FC_LOG(LOG_LEVEL_INFO, "%d options in %d chains from %s\n", nOptions, pSpi[i]->m_pOptions->chains(), pOptionFile);
+        }
+        pSpi[i]->m_bForQuote = bForQuote;
+        if (bMonitor)
+        {
+            pMonitor = new FeedMonitor(&pSpi[i]->m_normalizer.index());
+            pMonitor->setThresholds(ServiceConfig::getInt("feed_stale_ms", FEED_STALE_MS), ServiceConfig::getInt("feed_silent_ms", FEED_SILENT_MS),
+                                    ServiceConfig::getInt("feed_lag_ms", 0));
+            pMonitor->setScanInterval(ServiceConfig::getInt("feed_scan_ms", FEED_SCAN_MS));
+            if (ServiceConfig::get("feed_stale") != NULL && !pMonitor->setProducts(ServiceConfig::get("feed_stale")))
+                FC_LOG(LOG_LEVEL_ERROR, "bad feed_stale list %s\n", ServiceConfig::get("feed_stale"));
+            if (!pMonitor->start())
+                FC_LOG(LOG_LEVEL_ERROR, "cannot start the feed monitor\n");
+            pSpi[i]->m_pMonitor = pMonitor;
+        }
+        pSpi[i]->startPublisher();
 
         // Create a manual reset event with no signal
         pSpi[i]->m_hEvent = event_create(true, false);
 
         // set spi's broker, user, passwd
-        //strcpy (pSpi[i]->m_chBrokerID, "31000853");	// ڻܱ߲ϵͳ(v6)
-        strcpy (pSpi[i]->m_chBrokerID, "3748FD77");	// Nanhua Mechantile Broker ID 
-        //_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "8000%d", i+1);
-        //snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "8000%d", i+1);
-#ifdef WIN32
-	//_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)-1, "80008");
-	_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)-1, "8023901");
-#else
-        //snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "80008");
-        snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "8023901");
-#endif
-        //ks_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID), "8000%d", i+1);
-        //strcpy (pSpi[i]->m_chPassword, "123456");
-        strcpy (pSpi[i]->m_chPassword, "2525");
+        if (!ServiceConfig::copy("broker_id", pSpi[i]->m_chBrokerID, sizeof(pSpi[i]->m_chBrokerID)) ||
+            !ServiceConfig::copy("user_id", pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)) ||
+            !ServiceConfig::copy("password", pSpi[i]->m_chPassword, sizeof(pSpi[i]->m_chPassword)))
+        {
+            printf("broker_id, user_id or password longer than the api takes\n");
+            return 1;
+        }
 
         //_snprintf(pSpi[i]->m_chUserID, sizeof(pSpi[i]->m_chUserID)-1, "36000002");
         //strcpy (pSpi[i]->m_chPassword, "");
@@ -408,7 +1045,14 @@ int main(int argc, char* argv[])
         //pUserApi[i]->RegisterFront("http://10.253.46.23:18993/10.253.44.234:8080");		// kstar v6 local proxy trading
         //pUserApi[i]->RegisterFront("tcp://10.253.117.107:13153");		// kstar v6 local local marketdata
 	//pUserApi[i]->RegisterFront("tcp://10.253.117.107:13163");		// kstar v8 local local marketdata
-	pUserApi[i]->RegisterFront("tcp://124.160.44.166:17159");		// Nanhua Mechantile API 
+	char chFront[CONFIG_VALUE_SIZE];
+	const char *pFrontKey = ServiceConfig::get("md_front") != NULL ? "md_front" : "front";
+	if (!ServiceConfig::copy(pFrontKey, chFront, sizeof(chFront)))
+	{
+	    printf("%s longer than %d characters\n", pFrontKey, CONFIG_VALUE_SIZE - 1);
+	    return 1;
+	}
+	pUserApi[i]->RegisterFront(chFront);
         //pUserApi[i]->RegisterFront("tcp://10.253.44.30:17993");		// kstar v6 system test10261226
         //pUserApi[i]->RegisterFront("tcp://127.0.0.1:17993");		// kstar v6 localhost
         //pUserApi[i]->RegisterFront("http://210.5.154.195:18993/jazzmonk.vicp.net:80");	// kstar v6 internet proxy
@@ -419,8 +1063,21 @@ int main(int argc, char* argv[])
         pUserApi[i]->Init();
     }
 
+    // the md callback thread enters at its first callback; shown as not
+    // started when the front does not answer in time
+    ThreadTopology::waitStarted(THREAD_MD_CALLBACK, 10000);
+    char chTopology[2048];
+    ThreadTopology::report(chTopology, sizeof(chTopology));
+    printf("\n%s", chTopology);
+
     printf ("\npress return to release...\n");
-    getchar();
+    while (ServiceControl::wait(!bDaemon) == SERVICE_RELOAD)
+    {
+        AsyncLogger::reopen();
+        for (int i=0; i < 1 && pTickFile != NULL; i++ )
+            pSpi[i]->reloadPriceTicks(pTickFile);
+    }
+    ServiceControl::beginStop();
 
     for (int i=0; i < 1; i++ )
     {
@@ -440,12 +1097,28 @@ int main(int argc, char* argv[])
         // release the API instance
         pUserApi[i]->Release();
 
+        // no more callbacks, flush the ingest ring
+        pSpi[i]->stopPublisher();
+        if (pMonitor != NULL)
+            pMonitor->stop();
+
         // delete pSpi
+        delete pSpi[i]->m_pDeltaEncoder;
+        delete pSpi[i]->m_pClient;
+        delete pSpi[i]->m_pMcastEncoder;
+        delete pSpi[i]->m_pIndicators;
+        delete pSpi[i]->m_pSpreads;
+        delete pSpi[i]->m_pOptions;
         delete pSpi[i];
     }
 
-    printf ("\npress return to quit...\n");
-    getchar();
+    delete pMcastPublisher;
+    LatencyStats::stopReporter();
+    delete pMonitor;
+
+    // drain the log before exiting
+    AsyncLogger::stop();
+    ServiceControl::exit();
 
     return 0;
 }